@@ -0,0 +1,101 @@
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+
+const size_t ARENA_ALIGNMENT = sizeof(max_align_t);
+
+struct ArenaChunk *arena_chunk_new(size_t size, struct ArenaChunk *next)
+{
+    struct ArenaChunk *chunk = malloc(sizeof(struct ArenaChunk) + size);
+    if (chunk == NULL)
+    {
+        InternalError("Unable to allocate %zu byte arena chunk", size);
+    }
+    chunk->next = next;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+struct Arena *arena_new(size_t chunkSize)
+{
+    struct Arena *wip = malloc(sizeof(struct Arena));
+    wip->chunks = NULL;
+    wip->chunkSize = chunkSize;
+    wip->nAllocations = 0;
+    wip->bytesAllocated = 0;
+    return wip;
+}
+
+void arena_free(struct Arena *arena)
+{
+    struct ArenaChunk *runner = arena->chunks;
+    while (runner != NULL)
+    {
+        struct ArenaChunk *old = runner;
+        runner = runner->next;
+        free(old);
+    }
+    free(arena);
+}
+
+size_t arena_align_up(size_t offset, size_t alignment)
+{
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+void *arena_alloc_aligned(struct Arena *arena, size_t size, size_t alignment)
+{
+    arena->nAllocations++;
+    arena->bytesAllocated += size;
+
+    struct ArenaChunk *current = arena->chunks;
+    if (current != NULL)
+    {
+        size_t alignedUsed = arena_align_up(current->used, alignment);
+        if ((alignedUsed <= current->size) && ((current->size - alignedUsed) >= size))
+        {
+            current->used = alignedUsed + size;
+            return current->data + alignedUsed;
+        }
+    }
+
+    // oversized allocations get a chunk of their own, kept behind the current chunk so its free space isn't abandoned
+    if (size > (arena->chunkSize / 4))
+    {
+        struct ArenaChunk *dedicated = NULL;
+        if (current == NULL)
+        {
+            dedicated = arena_chunk_new(size, NULL);
+            arena->chunks = dedicated;
+        }
+        else
+        {
+            dedicated = arena_chunk_new(size, current->next);
+            current->next = dedicated;
+        }
+        dedicated->used = size;
+        return dedicated->data;
+    }
+
+    current = arena_chunk_new(arena->chunkSize, current);
+    arena->chunks = current;
+    current->used = size;
+    return current->data;
+}
+
+void *arena_alloc(struct Arena *arena, size_t size)
+{
+    return arena_alloc_aligned(arena, size, ARENA_ALIGNMENT);
+}
+
+char *arena_strdup(struct Arena *arena, const char *str)
+{
+    size_t length = strlen(str);
+    char *duplicated = arena_alloc_aligned(arena, length + 1, 1);
+    memcpy(duplicated, str, length + 1);
+    return duplicated;
+}
@@ -2,6 +2,7 @@
 #include <string.h>
 
 #include "ast.h"
+#include "arena.h"
 #include "util.h"
 
 #include "mbcl/stack.h"
@@ -108,9 +109,16 @@ char *token_get_name(enum TOKEN type)
     return tokenNames[type];
 }
 
-struct Ast *ast_new(enum TOKEN type, char *value, char *curFile, u32 curLine, u32 curCol)
+const size_t AST_ARENA_CHUNK_SIZE = 64 * 1024;
+
+struct Arena *ast_arena_new()
+{
+    return arena_new(AST_ARENA_CHUNK_SIZE);
+}
+
+struct Ast *ast_new(struct Arena *arena, enum TOKEN type, char *value, char *curFile, u32 curLine, u32 curCol)
 {
-    struct Ast *wip = malloc(sizeof(struct Ast));
+    struct Ast *wip = arena_alloc(arena, sizeof(struct Ast));
     wip->child = NULL;
     wip->sibling = NULL;
     wip->type = type;
@@ -238,18 +246,3 @@ void ast_dump(FILE *outFile, struct Ast *tree)
 
     stack_free(ranks);
 }
-
-void ast_free(struct Ast *tree)
-{
-    struct Ast *runner = tree;
-    while (runner != NULL)
-    {
-        if (runner->child != NULL)
-        {
-            ast_free(runner->child);
-        }
-        struct Ast *old = runner;
-        runner = runner->sibling;
-        free(old);
-    }
-}
\ No newline at end of file
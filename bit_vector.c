@@ -0,0 +1,143 @@
+#include "bit_vector.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+
+const size_t BIT_VECTOR_WORD_BITS = sizeof(u64) * 8;
+
+struct BitVector *bit_vector_array_new(size_t nVectors, size_t nBits)
+{
+    size_t nWords = (nBits + BIT_VECTOR_WORD_BITS - 1) / BIT_VECTOR_WORD_BITS;
+    // always allocate at least one vector and one word, so the first vector's words can be freed as the storage of all of them
+    struct BitVector *vectors = calloc(MAX(nVectors, 1), sizeof(struct BitVector));
+    u64 *storage = calloc((nVectors * nWords) + 1, sizeof(u64));
+    vectors[0].words = storage;
+
+    for (size_t vectorIndex = 0; vectorIndex < nVectors; vectorIndex++)
+    {
+        vectors[vectorIndex].words = storage + (vectorIndex * nWords);
+        vectors[vectorIndex].nWords = nWords;
+        vectors[vectorIndex].nBits = nBits;
+    }
+
+    return vectors;
+}
+
+void bit_vector_array_free(struct BitVector *vectors)
+{
+    free(vectors[0].words);
+    free(vectors);
+}
+
+void bit_vector_check_bit(struct BitVector *vector, size_t bit)
+{
+    if (bit >= vector->nBits)
+    {
+        InternalError("Bit %zu out of range for bit vector of %zu bits", bit, vector->nBits);
+    }
+}
+
+void bit_vector_set(struct BitVector *vector, size_t bit)
+{
+    bit_vector_check_bit(vector, bit);
+    vector->words[bit / BIT_VECTOR_WORD_BITS] |= (u64)1 << (bit % BIT_VECTOR_WORD_BITS);
+}
+
+void bit_vector_unset(struct BitVector *vector, size_t bit)
+{
+    bit_vector_check_bit(vector, bit);
+    vector->words[bit / BIT_VECTOR_WORD_BITS] &= ~((u64)1 << (bit % BIT_VECTOR_WORD_BITS));
+}
+
+bool bit_vector_test(struct BitVector *vector, size_t bit)
+{
+    bit_vector_check_bit(vector, bit);
+    return (vector->words[bit / BIT_VECTOR_WORD_BITS] >> (bit % BIT_VECTOR_WORD_BITS)) & 1;
+}
+
+void bit_vector_clear_all(struct BitVector *vector)
+{
+    memset(vector->words, 0, vector->nWords * sizeof(u64));
+}
+
+void bit_vector_copy(struct BitVector *dest, struct BitVector *src)
+{
+    memcpy(dest->words, src->words, dest->nWords * sizeof(u64));
+}
+
+// the word loops below are kept free of early exits so the compiler can vectorize them
+bool bit_vector_union(struct BitVector *dest, struct BitVector *src)
+{
+    u64 changed = 0;
+    for (size_t wordIndex = 0; wordIndex < dest->nWords; wordIndex++)
+    {
+        u64 merged = dest->words[wordIndex] | src->words[wordIndex];
+        changed |= merged ^ dest->words[wordIndex];
+        dest->words[wordIndex] = merged;
+    }
+    return changed != 0;
+}
+
+bool bit_vector_intersect(struct BitVector *dest, struct BitVector *src)
+{
+    u64 changed = 0;
+    for (size_t wordIndex = 0; wordIndex < dest->nWords; wordIndex++)
+    {
+        u64 merged = dest->words[wordIndex] & src->words[wordIndex];
+        changed |= merged ^ dest->words[wordIndex];
+        dest->words[wordIndex] = merged;
+    }
+    return changed != 0;
+}
+
+bool bit_vector_difference(struct BitVector *dest, struct BitVector *src)
+{
+    u64 changed = 0;
+    for (size_t wordIndex = 0; wordIndex < dest->nWords; wordIndex++)
+    {
+        u64 merged = dest->words[wordIndex] & ~src->words[wordIndex];
+        changed |= merged ^ dest->words[wordIndex];
+        dest->words[wordIndex] = merged;
+    }
+    return changed != 0;
+}
+
+bool bit_vector_equals(struct BitVector *vectorA, struct BitVector *vectorB)
+{
+    return memcmp(vectorA->words, vectorB->words, vectorA->nWords * sizeof(u64)) == 0;
+}
+
+size_t bit_vector_count(struct BitVector *vector)
+{
+    size_t count = 0;
+    for (size_t wordIndex = 0; wordIndex < vector->nWords; wordIndex++)
+    {
+        count += __builtin_popcountll(vector->words[wordIndex]);
+    }
+    return count;
+}
+
+size_t bit_vector_next(struct BitVector *vector, size_t from)
+{
+    if (from >= vector->nBits)
+    {
+        return vector->nBits;
+    }
+
+    size_t wordIndex = from / BIT_VECTOR_WORD_BITS;
+    // mask off the bits of the first word which come before from
+    u64 word = vector->words[wordIndex] & (~(u64)0 << (from % BIT_VECTOR_WORD_BITS));
+    while (word == 0)
+    {
+        wordIndex++;
+        if (wordIndex >= vector->nWords)
+        {
+            return vector->nBits;
+        }
+        word = vector->words[wordIndex];
+    }
+
+    return (wordIndex * BIT_VECTOR_WORD_BITS) + __builtin_ctzll(word);
+}
@@ -0,0 +1,182 @@
+// Thin client for sbcc's compile server (sbcc --server <socket>)
+// Takes exactly the same arguments as sbcc, forwards them to the server named by $SBCC_SERVER_SOCKET, and relays the result
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "compile_server.h"
+
+bool read_all(int fd, void *buf, size_t n)
+{
+    u8 *readTo = buf;
+    while (n > 0)
+    {
+        ssize_t nRead = read(fd, readTo, n);
+        if (nRead < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (nRead <= 0)
+        {
+            return false;
+        }
+        readTo += nRead;
+        n -= nRead;
+    }
+    return true;
+}
+
+bool write_all(int fd, const void *buf, size_t n)
+{
+    const u8 *writeFrom = buf;
+    while (n > 0)
+    {
+        ssize_t nWritten = write(fd, writeFrom, n);
+        if (nWritten < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (nWritten <= 0)
+        {
+            return false;
+        }
+        writeFrom += nWritten;
+        n -= nWritten;
+    }
+    return true;
+}
+
+bool write_u64(int fd, u64 value)
+{
+    return write_all(fd, &value, sizeof(u64));
+}
+
+bool write_string(int fd, const char *str, size_t length)
+{
+    return write_u64(fd, length) && write_all(fd, str, length);
+}
+
+// read a length-prefixed string from the server and copy it straight to outFile
+bool relay_string(int fd, FILE *outFile)
+{
+    u64 length = 0;
+    if (!read_all(fd, &length, sizeof(u64)))
+    {
+        return false;
+    }
+
+    char relayBuf[4096];
+    while (length > 0)
+    {
+        size_t chunkSize = (length < sizeof(relayBuf)) ? length : sizeof(relayBuf);
+        if (!read_all(fd, relayBuf, chunkSize))
+        {
+            return false;
+        }
+        fwrite(relayBuf, 1, chunkSize, outFile);
+        length -= chunkSize;
+    }
+    return true;
+}
+
+char *read_stdin(size_t *lengthOut)
+{
+    size_t capacity = 4096;
+    size_t length = 0;
+    char *contents = malloc(capacity);
+    size_t nRead = 0;
+    while ((nRead = fread(contents + length, 1, capacity - length, stdin)) > 0)
+    {
+        length += nRead;
+        if (length == capacity)
+        {
+            capacity *= 2;
+            contents = realloc(contents, capacity);
+        }
+    }
+
+    *lengthOut = length;
+    return contents;
+}
+
+// like sbcc itself, read the input from stdin unless an input file is given
+bool args_read_stdin(int argc, char **argv)
+{
+    for (int argIndex = 1; argIndex < argc; argIndex++)
+    {
+        if (strncmp(argv[argIndex], "-i", 2) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    char *socketPath = getenv(COMPILE_SERVER_SOCKET_ENV);
+    if (socketPath == NULL)
+    {
+        fprintf(stderr, "sbcc-client: set %s to the socket of a running 'sbcc --server <socket>'\n", COMPILE_SERVER_SOCKET_ENV);
+        return 1;
+    }
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(struct sockaddr_un));
+    address.sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "sbcc-client: socket path %s is too long\n", socketPath);
+        return 1;
+    }
+    strcpy(address.sun_path, socketPath);
+
+    int serverFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if ((serverFd < 0) || (connect(serverFd, (struct sockaddr *)&address, sizeof(struct sockaddr_un)) != 0))
+    {
+        fprintf(stderr, "sbcc-client: unable to connect to compile server at %s: %s\n", socketPath, strerror(errno));
+        return 1;
+    }
+
+    char *workingDirectory = getcwd(NULL, 0);
+    bool sent = write_u64(serverFd, COMPILE_SERVER_PROTOCOL_VERSION) &&
+                write_string(serverFd, workingDirectory, strlen(workingDirectory)) &&
+                write_u64(serverFd, argc);
+    free(workingDirectory);
+
+    for (int argIndex = 0; sent && (argIndex < argc); argIndex++)
+    {
+        sent = write_string(serverFd, argv[argIndex], strlen(argv[argIndex]));
+    }
+
+    if (sent && args_read_stdin(argc, argv))
+    {
+        size_t stdinLength = 0;
+        char *stdinContents = read_stdin(&stdinLength);
+        sent = write_u64(serverFd, 1) && write_string(serverFd, stdinContents, stdinLength);
+        free(stdinContents);
+    }
+    else if (sent)
+    {
+        sent = write_u64(serverFd, 0);
+    }
+
+    u64 status = 1;
+    if (!sent ||
+        !read_all(serverFd, &status, sizeof(u64)) ||
+        !relay_string(serverFd, stdout) ||
+        !relay_string(serverFd, stdout))
+    {
+        fprintf(stderr, "sbcc-client: lost connection to compile server\n");
+        close(serverFd);
+        return 1;
+    }
+
+    close(serverFd);
+    return (int)status;
+}
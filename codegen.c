@@ -1,10 +1,14 @@
 #include "codegen.h"
 
+#include <ctype.h>
+
 #include "codegen_generic.h"
+#include "compilation_cache.h"
 #include "log.h"
 #include "regalloc.h"
 #include "regalloc_riscv.h"
 #include "symtab.h"
+#include "time_report.h"
 
 void generate_code_for_program(struct SymbolTable *table,
                                FILE *outFile,
@@ -18,10 +22,11 @@ void generate_code_for_program(struct SymbolTable *table,
     size_t globalInstructionIndex = 0;
     globalContext.instructionIndex = &globalInstructionIndex;
     globalContext.outFile = outFile;
+    globalContext.instanceFunctions = codegen_instance_functions_new();
 
     // fprintf(outFile, "\t.text\n");
     Iterator *entryIterator = NULL;
-    for (entryIterator = set_begin(table->globalScope->entries); iterator_gettable(entryIterator); iterator_next(entryIterator))
+    for (entryIterator = deque_front(table->globalScope->entries); iterator_gettable(entryIterator); iterator_next(entryIterator))
     {
         struct ScopeMember *thisMember = iterator_get(entryIterator);
         switch (thisMember->type)
@@ -40,7 +45,7 @@ void generate_code_for_program(struct SymbolTable *table,
                 fprintf(outFile, ".align 2\n\t.globl _start\n_start:\n\tcall main\n\tpgm_done:\n\tli a0, 0\n\tcall exit\n");
             }
 
-            generate_code_for_function(outFile, generatedFunction, info, NULL, emitPrologue, emitEpilogue, generateCodeForBasicBlock);
+            generate_code_for_function(outFile, generatedFunction, info, NULL, NULL, emitPrologue, emitEpilogue, generateCodeForBasicBlock);
             fprintf(outFile, "\t.size %s, .-%s\n", generatedFunction->name, generatedFunction->name);
         }
         break;
@@ -68,6 +73,9 @@ void generate_code_for_program(struct SymbolTable *table,
         }
     }
     iterator_free(entryIterator);
+
+    codegen_emit_instance_functions(outFile, globalContext.instanceFunctions);
+    deque_free(globalContext.instanceFunctions);
 };
 
 void generate_code_for_type_non_generic(struct CodegenState *globalContext,
@@ -78,7 +86,7 @@ void generate_code_for_type_non_generic(struct CodegenState *globalContext,
                                         void (*generateCodeForBasicBlock)(struct CodegenState *, struct RegallocMetadata *, struct MachineInfo *, struct BasicBlock *, char *))
 {
     Iterator *implementedIter = NULL;
-    for (implementedIter = set_begin(theType->implemented->entries); iterator_gettable(implementedIter); iterator_next(implementedIter))
+    for (implementedIter = deque_front(theType->implemented->entries); iterator_gettable(implementedIter); iterator_next(implementedIter))
     {
 
         struct ScopeMember *entry = iterator_get(implementedIter);
@@ -90,7 +98,7 @@ void generate_code_for_type_non_generic(struct CodegenState *globalContext,
         if (implementedFunction->isDefined)
         {
             char *mangledName = type_get_mangled_name(&theType->type);
-            generate_code_for_function(globalContext->outFile, implementedFunction, info, mangledName, emitPrologue, emitEpilogue, generateCodeForBasicBlock);
+            generate_code_for_function(globalContext->outFile, implementedFunction, info, mangledName, (theType->genericType == G_INSTANCE) ? globalContext->instanceFunctions : NULL, emitPrologue, emitEpilogue, generateCodeForBasicBlock);
             free(mangledName);
         }
     }
@@ -144,7 +152,7 @@ void generate_code_for_struct(struct CodegenState *globalContext,
     log(LOG_DEBUG, "Generating code for struct %s", theStruct->name);
 
     Iterator *entryIterator = NULL;
-    for (entryIterator = set_begin(theStruct->members->entries); iterator_gettable(entryIterator); iterator_next(entryIterator))
+    for (entryIterator = deque_front(theStruct->members->entries); iterator_gettable(entryIterator); iterator_next(entryIterator))
     {
         struct ScopeMember *thisMember = iterator_get(entryIterator);
         switch (thisMember->type)
@@ -155,7 +163,7 @@ void generate_code_for_struct(struct CodegenState *globalContext,
             if (methodToGenerate->isDefined)
             {
                 char *structName = theStruct->name;
-                generate_code_for_function(globalContext->outFile, methodToGenerate, info, structName, emitPrologue, emitEpilogue, generateCodeForBasicBlock);
+                generate_code_for_function(globalContext->outFile, methodToGenerate, info, structName, NULL, emitPrologue, emitEpilogue, generateCodeForBasicBlock);
                 free(structName);
             }
         }
@@ -198,12 +206,12 @@ void generate_code_for_object(struct CodegenState *globalContext, struct Scope *
 
 void generate_code_for_string_literal(struct CodegenState *globalContext, struct VariableEntry *variable, struct Scope *globalScope)
 {
-    if (variable->type.basicType != VT_ARRAY)
+    if (variable->type->basicType != VT_ARRAY)
     {
         InternalError("generateCodeForStringLiteral called with non-array type!\n");
     }
 
-    if (variable->type.array.initializeArrayTo == NULL)
+    if (variable->initializeArrayTo == NULL)
     {
         InternalError("generateCodeForStringLiteral called with NULL initializeArrayTo!\n");
     }
@@ -221,13 +229,13 @@ void generate_code_for_string_literal(struct CodegenState *globalContext, struct
     fprintf(globalContext->outFile, ".section\t.rodata\n");
     fprintf(globalContext->outFile, "\t.globl %s\n", variable->name);
     fprintf(globalContext->outFile, "\t.type %s, @object\n", variable->name);
-    fprintf(globalContext->outFile, "\t.size %s, %zu\n", variable->name, type_get_size(&variable->type, globalScope));
+    fprintf(globalContext->outFile, "\t.size %s, %zu\n", variable->name, type_get_size(variable->type, globalScope));
 
-    size_t stringLength = variable->type.array.size;
+    size_t stringLength = variable->type->array.size;
     fprintf(globalContext->outFile, "%s:\n\t.asciz \"", variable->name);
     for (size_t charIndex = 0; charIndex < stringLength; charIndex++)
     {
-        fprintf(globalContext->outFile, "%c", ((char *)(variable->type.array.initializeArrayTo[charIndex]))[0]);
+        fprintf(globalContext->outFile, "%c", ((char *)(variable->initializeArrayTo[charIndex]))[0]);
     }
     fprintf(globalContext->outFile, "\"\n");
 }
@@ -239,12 +247,12 @@ void generate_code_for_initialized_global_array(struct CodegenState *globalConte
 
 void generate_code_for_initialized_global(struct CodegenState *globalContext, struct VariableEntry *variable, struct Scope *globalScope)
 {
-    if (variable->type.basicType == VT_ARRAY)
+    if (variable->type->basicType == VT_ARRAY)
     {
         InternalError("generateCodeForInitializedGlobal called with array type!\n");
     }
 
-    if (variable->type.nonArray.initializeTo == NULL)
+    if (variable->initializeTo == NULL)
     {
         InternalError("generateCodeForInitializedGlobal called with NULL initializeTo!\n");
     }
@@ -253,13 +261,13 @@ void generate_code_for_initialized_global(struct CodegenState *globalContext, st
 
     fprintf(globalContext->outFile, "\t.globl %s\n", variable->name);
     fprintf(globalContext->outFile, "\t.type %s, @object\n", variable->name);
-    fprintf(globalContext->outFile, "\t.size %s, %zu\n", variable->name, type_get_size(&variable->type, globalScope));
+    fprintf(globalContext->outFile, "\t.size %s, %zu\n", variable->name, type_get_size(variable->type, globalScope));
     fprintf(globalContext->outFile, "%s:\n", variable->name);
 
-    size_t objectSize = type_get_size(&variable->type, NULL);
+    size_t objectSize = type_get_size(variable->type, NULL);
     for (size_t byteIndex = 0; byteIndex < objectSize; byteIndex++)
     {
-        fprintf(globalContext->outFile, "\t.byte %d\n", (variable->type.nonArray.initializeTo)[byteIndex]);
+        fprintf(globalContext->outFile, "\t.byte %d\n", (variable->initializeTo)[byteIndex]);
     }
 }
 
@@ -267,7 +275,7 @@ void generate_code_for_uninitialized_global(struct CodegenState *globalContext,
 {
     fprintf(globalContext->outFile, ".section\t.bss\n");
 
-    fprintf(globalContext->outFile, ".comm %s, %zu, 4\n", variable->name, type_get_size(&variable->type, globalScope));
+    fprintf(globalContext->outFile, ".comm %s, %zu, 4\n", variable->name, type_get_size(variable->type, globalScope));
 }
 
 void generate_code_for_global_variable(struct CodegenState *globalContext, struct Scope *globalScope, struct VariableEntry *variable)
@@ -278,10 +286,10 @@ void generate_code_for_global_variable(struct CodegenState *globalContext, struc
         return;
     }
 
-    if (variable->type.basicType == VT_ARRAY)
+    if (variable->type->basicType == VT_ARRAY)
     {
         // string literals go in rodata
-        if ((variable->type.array.initializeArrayTo != NULL))
+        if ((variable->initializeArrayTo != NULL))
         {
             if (variable->isStringLiteral)
             {
@@ -299,7 +307,7 @@ void generate_code_for_global_variable(struct CodegenState *globalContext, struc
     }
     else
     {
-        if (variable->type.nonArray.initializeTo != NULL)
+        if (variable->initializeTo != NULL)
         {
             generate_code_for_initialized_global(globalContext, variable, globalScope);
         }
@@ -317,36 +325,33 @@ void generate_code_for_global_variable(struct CodegenState *globalContext, struc
  *
  */
 extern struct Config config;
-void generate_code_for_function(FILE *outFile,
-                                struct FunctionEntry *function,
-                                struct MachineInfo *info,
-                                char *methodOfStructName,
-                                void (*emitPrologue)(struct CodegenState *, struct RegallocMetadata *, struct MachineInfo *),
-                                void (*emitEpilogue)(struct CodegenState *, struct RegallocMetadata *, struct MachineInfo *, char *),
-                                void (*generateCodeForBasicBlock)(struct CodegenState *, struct RegallocMetadata *, struct MachineInfo *, struct BasicBlock *, char *))
+
+// generate a function's code, including its symbol unless it belongs to a generic instance (see codegen_emit_instance_functions)
+void generate_code_for_function_body(FILE *outFile,
+                                     struct FunctionEntry *function,
+                                     struct MachineInfo *info,
+                                     char *fullFunctionName,
+                                     bool isGenericInstance,
+                                     void (*emitPrologue)(struct CodegenState *, struct RegallocMetadata *, struct MachineInfo *),
+                                     void (*emitEpilogue)(struct CodegenState *, struct RegallocMetadata *, struct MachineInfo *, char *),
+                                     void (*generateCodeForBasicBlock)(struct CodegenState *, struct RegallocMetadata *, struct MachineInfo *, struct BasicBlock *, char *))
 {
-    char *fullFunctionName = function->name;
-    if (methodOfStructName != NULL)
-    {
-        // TODO: method/associated function name mangling/uniqueness
-        fullFunctionName = malloc(strlen(function->name) + strlen(methodOfStructName) + 2);
-        strcpy(fullFunctionName, methodOfStructName);
-        strcat(fullFunctionName, "_");
-        strcat(fullFunctionName, function->name);
-        log(LOG_DEBUG, "the real name of %s is %s", function->name, fullFunctionName);
-    }
     size_t instructionIndex = 0; // index from start of function in terms of number of instructions
     struct CodegenState state;
     state.outFile = outFile;
     state.instructionIndex = &instructionIndex;
+    state.instanceFunctions = NULL;
 
     log(LOG_INFO, "Generate code for function %s", fullFunctionName);
 
-    fprintf(outFile, ".globl %s\n", fullFunctionName);
-    fprintf(outFile, ".type %s, @function\n", fullFunctionName);
-
-    fprintf(outFile, ".align 2\n%s:\n", fullFunctionName);
-    fprintf(outFile, "\t.loc 1 %d %d\n", function->correspondingTree.sourceLine, function->correspondingTree.sourceCol);
+    if (!isGenericInstance)
+    {
+        fprintf(outFile, ".globl %s\n", fullFunctionName);
+        fprintf(outFile, ".type %s, @function\n", fullFunctionName);
+        fprintf(outFile, ".align 2\n%s:\n", fullFunctionName);
+    }
+    struct SourceLocation *functionLocation = source_location_get(function->location);
+    fprintf(outFile, "\t.loc 1 %d %d\n", functionLocation->line, functionLocation->col);
 
     // TODO: debug symbols for asm functions?
     if (function->isAsmFun)
@@ -365,7 +370,7 @@ void generate_code_for_function(FILE *outFile,
     for (argIterator = deque_front(function->arguments); iterator_gettable(argIterator); iterator_next(argIterator))
     {
         struct VariableEntry *examinedArgument = iterator_get(argIterator);
-        struct Lifetime *argLifetime = lifetime_find_by_name(function->regalloc.allLifetimes, examinedArgument->name);
+        struct Lifetime *argLifetime = lifetime_find_for_variable(&function->regalloc, examinedArgument);
         if (argLifetime->wbLocation == WB_REGISTER)
         {
             argLifetime->writebackInfo.regLocation->containedLifetime = argLifetime;
@@ -373,18 +378,299 @@ void generate_code_for_function(FILE *outFile,
     }
     iterator_free(argIterator);
 
-    Iterator *blockRunner = NULL;
-    for (blockRunner = list_begin(function->BasicBlockList); iterator_gettable(blockRunner); iterator_next(blockRunner))
+    struct FunctionIr *ir = function->ir;
+    for (size_t layoutIndex = 0; layoutIndex < ir->nLaidOut; layoutIndex++)
     {
-        struct BasicBlock *block = iterator_get(blockRunner);
+        struct BasicBlock *block = ir->blocks[ir->layout[layoutIndex]].block;
         generateCodeForBasicBlock(&state, &function->regalloc, info, block, fullFunctionName);
     }
-    iterator_free(blockRunner);
 
     emitEpilogue(&state, &function->regalloc, info, fullFunctionName);
+}
+
+void generate_code_for_function(FILE *outFile,
+                                struct FunctionEntry *function,
+                                struct MachineInfo *info,
+                                char *methodOfStructName,
+                                Deque *instanceFunctions,
+                                void (*emitPrologue)(struct CodegenState *, struct RegallocMetadata *, struct MachineInfo *),
+                                void (*emitEpilogue)(struct CodegenState *, struct RegallocMetadata *, struct MachineInfo *, char *),
+                                void (*generateCodeForBasicBlock)(struct CodegenState *, struct RegallocMetadata *, struct MachineInfo *, struct BasicBlock *, char *))
+{
+    char *fullFunctionName = function->name;
+    if (methodOfStructName != NULL)
+    {
+        // TODO: method/associated function name mangling/uniqueness
+        fullFunctionName = malloc(strlen(function->name) + strlen(methodOfStructName) + 2);
+        strcpy(fullFunctionName, methodOfStructName);
+        strcat(fullFunctionName, "_");
+        strcat(fullFunctionName, function->name);
+        log(LOG_DEBUG, "the real name of %s is %s", function->name, fullFunctionName);
+    }
+    time_report_begin(fullFunctionName);
+
+    // with a cache active, reuse code generated for an identical function by a previous compile
+    // code for generic instances doesn't depend on the rest of the TU, so it can be reused from a compile of any TU
+    struct CompilationCache *cache = compilation_cache_get_active();
+    bool isGenericInstance = (instanceFunctions != NULL);
+    enum COMPILATION_CACHE_KIND cacheKind = isGenericInstance ? CC_INSTANCE : CC_FUNCTION;
+    char *cacheKey = NULL;
+    char *generatedCode = NULL;
+    size_t generatedCodeSize = 0;
+    FILE *finalOutFile = outFile;
+    // instance functions are held in memory until they can be folded together with identical ones
+    if ((cache != NULL) || isGenericInstance)
+    {
+        outFile = open_memstream(&generatedCode, &generatedCodeSize);
+    }
+
+    bool cached = false;
+    if (cache != NULL)
+    {
+        if (isGenericInstance)
+        {
+            cacheKey = compilation_cache_instance_key(cache, function, fullFunctionName);
+        }
+        else
+        {
+            cacheKey = compilation_cache_function_key(cache, function, fullFunctionName);
+        }
+        cached = compilation_cache_fetch(cache, cacheKind, cacheKey, outFile);
+    }
+
+    if (cached)
+    {
+        log(LOG_INFO, "Reuse cached code for function %s", fullFunctionName);
+    }
+    else
+    {
+        generate_code_for_function_body(outFile, function, info, fullFunctionName, isGenericInstance, emitPrologue, emitEpilogue, generateCodeForBasicBlock);
+    }
+
+    if (outFile != finalOutFile)
+    {
+        fclose(outFile);
+        if ((cache != NULL) && !cached)
+        {
+            compilation_cache_store(cache, cacheKind, cacheKey, generatedCode, generatedCodeSize);
+        }
+
+        if (isGenericInstance)
+        {
+            codegen_add_instance_function(instanceFunctions, fullFunctionName, generatedCode);
+        }
+        else
+        {
+            fwrite(generatedCode, 1, generatedCodeSize, finalOutFile);
+        }
+        free(generatedCode);
+    }
+    free(cacheKey);
+
+    // nothing reads a function's TAC once its code is generated, so don't hold onto it for the rest of the unit
+    function_entry_release_tac(function);
+
+    time_report_end();
 
     if (methodOfStructName != NULL)
     {
         free(fullFunctionName);
     }
 }
+
+/*
+ * Identical code folding for generic instances
+ * Instances whose parameters share a layout (such as any two pointer types) often generate identical code for the same
+ * method. Each distinct function body is emitted once, and every instance function generating it becomes an alias.
+ */
+
+// stands in for a function's own name within its labels, so that code can be compared regardless of which function it belongs to
+const char CODEGEN_OWN_NAME_PLACEHOLDER = '\x01';
+
+struct InstanceFunctionCode
+{
+    char *name;
+    char *code; // with the function's own name in its labels replaced by CODEGEN_OWN_NAME_PLACEHOLDER
+};
+
+void codegen_instance_function_code_free(struct InstanceFunctionCode *instanceFunction)
+{
+    free(instanceFunction->name);
+    free(instanceFunction->code);
+    free(instanceFunction);
+}
+
+Deque *codegen_instance_functions_new()
+{
+    return deque_new((MBCL_DATA_FREE_FUNCTION)codegen_instance_function_code_free);
+}
+
+bool codegen_is_symbol_char(char c)
+{
+    return isalnum(c) || (c == '_') || (c == '.') || (c == '$');
+}
+
+// whether suffix completes one of a function's own labels ("_done" or "_<block number>") after its name
+bool codegen_is_own_label_suffix(const char *suffix)
+{
+    if (suffix[0] != '_')
+    {
+        return false;
+    }
+
+    size_t suffixLength = 1;
+    if (strncmp(suffix + 1, "done", 4) == 0)
+    {
+        suffixLength += 4;
+    }
+    else
+    {
+        while (isdigit(suffix[suffixLength]))
+        {
+            suffixLength++;
+        }
+    }
+
+    return (suffixLength > 1) && !codegen_is_symbol_char(suffix[suffixLength]);
+}
+
+void codegen_add_instance_function(Deque *instanceFunctions, char *name, char *code)
+{
+    struct InstanceFunctionCode *instanceFunction = malloc(sizeof(struct InstanceFunctionCode));
+    instanceFunction->name = strdup(name);
+
+    // replacement only ever shortens the code
+    size_t nameLength = strlen(name);
+    instanceFunction->code = malloc(strlen(code) + 1);
+    char *replaced = instanceFunction->code;
+    const char *scan = code;
+    while (*scan != '\0')
+    {
+        if ((strncmp(scan, name, nameLength) == 0) &&
+            ((scan == code) || !codegen_is_symbol_char(scan[-1])) &&
+            codegen_is_own_label_suffix(scan + nameLength))
+        {
+            *replaced++ = CODEGEN_OWN_NAME_PLACEHOLDER;
+            scan += nameLength;
+        }
+        else
+        {
+            *replaced++ = *scan++;
+        }
+    }
+    *replaced = '\0';
+
+    deque_push_back(instanceFunctions, instanceFunction);
+}
+
+int codegen_compare_instance_function_names(const void *a, const void *b)
+{
+    const struct InstanceFunctionCode *functionA = *(struct InstanceFunctionCode *const *)a;
+    const struct InstanceFunctionCode *functionB = *(struct InstanceFunctionCode *const *)b;
+    return strcmp(functionA->name, functionB->name);
+}
+
+// emit one body for a group of instance functions with identical code, under the name of each function in the group
+void codegen_emit_instance_function_group(FILE *outFile, List *group)
+{
+    size_t nMembers = 0;
+    struct InstanceFunctionCode **members = malloc(group->size * sizeof(struct InstanceFunctionCode *));
+    Iterator *memberIter = NULL;
+    for (memberIter = list_begin(group); iterator_gettable(memberIter); iterator_next(memberIter))
+    {
+        members[nMembers++] = iterator_get(memberIter);
+    }
+    iterator_free(memberIter);
+
+    // sort so that every TU picks the same canonical name for the same group
+    qsort(members, nMembers, sizeof(struct InstanceFunctionCode *), codegen_compare_instance_function_names);
+    char *canonicalName = members[0]->name;
+
+    // every TU using an instance emits it, so the linker keeps only one COMDAT group per signature
+    // a group's signature must therefore identify exactly the set of functions defined within it
+    char *signature = NULL;
+    if (nMembers == 1)
+    {
+        signature = strdup(canonicalName);
+    }
+    else
+    {
+        log(LOG_INFO, "Fold %zu identical instance functions into %s", nMembers, canonicalName);
+        struct ContentHash membersHash;
+        content_hash_init(&membersHash);
+        for (size_t memberIndex = 0; memberIndex < nMembers; memberIndex++)
+        {
+            content_hash_update_string(&membersHash, members[memberIndex]->name);
+        }
+        char membersHashString[CONTENT_HASH_STRING_LENGTH];
+        content_hash_sprint(&membersHash, membersHashString);
+
+        signature = malloc(strlen(canonicalName) + strlen(".icf.") + strlen(membersHashString) + 1);
+        sprintf(signature, "%s.icf.%s", canonicalName, membersHashString);
+    }
+
+    fprintf(outFile, ".section .text.%s,\"axG\",@progbits,%s,comdat\n", canonicalName, signature);
+    for (size_t memberIndex = 0; memberIndex < nMembers; memberIndex++)
+    {
+        fprintf(outFile, ".weak %s\n", members[memberIndex]->name);
+        fprintf(outFile, ".type %s, @function\n", members[memberIndex]->name);
+    }
+    fprintf(outFile, ".align 2\n%s:\n", canonicalName);
+    for (size_t memberIndex = 1; memberIndex < nMembers; memberIndex++)
+    {
+        fprintf(outFile, ".set %s, %s\n", members[memberIndex]->name, canonicalName);
+    }
+
+    for (char *code = members[0]->code; *code != '\0'; code++)
+    {
+        if (*code == CODEGEN_OWN_NAME_PLACEHOLDER)
+        {
+            fputs(canonicalName, outFile);
+        }
+        else
+        {
+            putc(*code, outFile);
+        }
+    }
+
+    for (size_t memberIndex = 0; memberIndex < nMembers; memberIndex++)
+    {
+        fprintf(outFile, "\t.size %s, .-%s\n", members[memberIndex]->name, canonicalName);
+    }
+    fprintf(outFile, ".section .text\n");
+
+    free(signature);
+    free(members);
+}
+
+void codegen_emit_instance_functions(FILE *outFile, Deque *instanceFunctions)
+{
+    // group functions by their code, keeping groups in the order their first function was generated
+    Deque *groups = deque_new((MBCL_DATA_FREE_FUNCTION)list_free);
+    HashTable *groupsByCode = hash_table_new(NULL, NULL, (ssize_t(*)(void *, void *))strcmp, hash_string, instanceFunctions->size + 1);
+
+    Iterator *functionIter = NULL;
+    for (functionIter = deque_front(instanceFunctions); iterator_gettable(functionIter); iterator_next(functionIter))
+    {
+        struct InstanceFunctionCode *instanceFunction = iterator_get(functionIter);
+        List *group = hash_table_find(groupsByCode, instanceFunction->code);
+        if (group == NULL)
+        {
+            group = list_new(NULL, NULL);
+            deque_push_back(groups, group);
+            hash_table_insert(groupsByCode, instanceFunction->code, group);
+        }
+        list_append(group, instanceFunction);
+    }
+    iterator_free(functionIter);
+
+    Iterator *groupIter = NULL;
+    for (groupIter = deque_front(groups); iterator_gettable(groupIter); iterator_next(groupIter))
+    {
+        codegen_emit_instance_function_group(outFile, iterator_get(groupIter));
+    }
+    iterator_free(groupIter);
+
+    hash_table_free(groupsByCode);
+    deque_free(groups);
+}
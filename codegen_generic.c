@@ -25,10 +25,11 @@ void emit_loc(struct CodegenState *context, struct TACLine *thisTAC, size_t *las
 {
     // don't duplicate .loc's for the same line
     // riscv64-unknown-elf-gdb (or maybe the as/ld) don't enjoy going backwards/staying put in line or column loc
-    if (thisTAC->correspondingTree.sourceLine > *lastLineNo)
+    u32 sourceLine = source_location_get(thisTAC->location)->line;
+    if (sourceLine > *lastLineNo)
     {
-        fprintf(context->outFile, "\t.loc 1 %d\n", thisTAC->correspondingTree.sourceLine);
-        *lastLineNo = thisTAC->correspondingTree.sourceLine;
+        fprintf(context->outFile, "\t.loc 1 %d\n", sourceLine);
+        *lastLineNo = sourceLine;
     }
 }
 
@@ -86,10 +87,10 @@ struct Register *pick_write_register(struct RegallocMetadata *metadata,
                                      struct TACOperand *operand,
                                      struct Register *scratchReg)
 {
-    struct Lifetime *relevantLifetime = lifetime_find(metadata->allLifetimes, operand);
+    struct Lifetime *relevantLifetime = lifetime_find(metadata, operand);
     if (relevantLifetime == NULL)
     {
-        InternalError("Unable to find lifetime for variable %s!", operand->name.variable->name);
+        InternalError("Unable to find lifetime for variable %s!", tac_operand_get_variable_name(operand));
     }
 
     switch (relevantLifetime->wbLocation)
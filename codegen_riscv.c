@@ -1,6 +1,7 @@
 #include "codegen_riscv.h"
 
 #include "codegen_generic.h"
+#include "dump.h"
 #include "log.h"
 #include "symtab.h"
 #include "tac.h"
@@ -119,13 +120,13 @@ char riscv_select_width_char_for_dereference(struct Scope *scope, struct TACOper
 char riscv_select_width_char_for_lifetime(struct Scope *scope, struct Lifetime *lifetime)
 {
     char widthChar = '\0';
-    if (lifetime->type.pointerLevel > 0)
+    if (lifetime->type->pointerLevel > 0)
     {
         widthChar = 'd';
     }
     else
     {
-        widthChar = riscv_select_width_char_for_size(type_get_size(&lifetime->type, scope));
+        widthChar = riscv_select_width_char_for_size(type_get_size(lifetime->type, scope));
     }
 
     return widthChar;
@@ -217,7 +218,7 @@ Stack *get_touched_caller_save_registers(struct RegallocMetadata *metadata, stru
 }
 
 // returns a set of lifetimes for all of the function's arguments which were callee-saved to somewhere on the stack
-// this set should be searched before regalloc->allLifetimes so that variables which lived in argument registers but have been stomped can still be read
+// this set should be searched before the function's own lifetimes so that variables which lived in argument registers but have been stomped can still be read
 // this comes in to play when function a() calls function b(), but we want to pass one of a's arguments to b by reading a register which already has been overwritten with one of b's arguments
 Set *riscv_caller_save_registers(struct CodegenState *state, struct RegallocMetadata *regalloc, struct MachineInfo *info)
 {
@@ -423,10 +424,10 @@ struct Register *riscv_place_or_find_operand_in_register(struct TACLine *corresp
         return placedOrFoundIn;
     }
 
-    struct Lifetime *operandLt = lifetime_find(metadata->allLifetimes, operand);
+    struct Lifetime *operandLt = lifetime_find(metadata, operand);
     if (operandLt == NULL)
     {
-        InternalError("Unable to find lifetime for variable %s!", operand->name.variable->name);
+        InternalError("Unable to find lifetime for variable %s!", tac_operand_get_variable_name(operand));
     }
 
     switch (operandLt->wbLocation)
@@ -453,7 +454,7 @@ struct Register *riscv_place_or_find_operand_in_register(struct TACLine *corresp
         char loadWidth = 'X';
         const char *loadSign = "";
 
-        if (operandLt->type.basicType == VT_ARRAY)
+        if (operandLt->type->basicType == VT_ARRAY)
         {
             // if array, treat as pointer
             loadWidth = 'd';
@@ -470,7 +471,7 @@ struct Register *riscv_place_or_find_operand_in_register(struct TACLine *corresp
                          operandLt->name,
                          operand->name.str);
 
-        if (operandLt->type.basicType != VT_ARRAY)
+        if (operandLt->type->basicType != VT_ARRAY)
         {
             emit_instruction(correspondingTACLine, state, "\tl%c%s %s, 0(%s) # place %s\n",
                              loadWidth,
@@ -508,10 +509,10 @@ void riscv_write_variable(struct TACLine *correspondingTACLine,
         InternalError("TAC Operand with non standard/temp permutation passed to riscv_write_variable!");
     }
 
-    struct Lifetime *writtenLifetime = lifetime_find(metadata->allLifetimes, writtenTo);
+    struct Lifetime *writtenLifetime = lifetime_find(metadata, writtenTo);
     if (writtenLifetime == NULL)
     {
-        InternalError("No lifetime found for %s", writtenTo->name.variable->name);
+        InternalError("No lifetime found for %s", tac_operand_get_variable_name(writtenTo));
     }
 
     switch (writtenLifetime->wbLocation)
@@ -597,7 +598,7 @@ void riscv_place_addr_of_operand_in_reg(struct TACLine *correspondingTACLine,
                                         struct TACOperand *operand,
                                         struct Register *destReg)
 {
-    struct Lifetime *lifetime = lifetime_find(metadata->allLifetimes, operand);
+    struct Lifetime *lifetime = lifetime_find(metadata, operand);
     switch (lifetime->wbLocation)
     {
     case WB_REGISTER:
@@ -682,12 +683,12 @@ void riscv_emit_argument_stores(struct CodegenState *state,
         struct TACOperand *argOperand = deque_at(argumentOperands, argIndex);
         struct VariableEntry *argument = deque_at(calledFunction->arguments, argIndex);
 
-        if (type_compare_allow_implicit_widening(tac_operand_get_type(argOperand), &argument->type))
+        if (type_compare_allow_implicit_widening(tac_operand_get_type(argOperand), argument->type))
         {
-            InternalError("Type mismatch during internal argument store handling for argument %s of function %s\nExpected type %s, got type %s", argument->name, calledFunction->name, type_get_name(tac_operand_get_type(argOperand)), type_get_name(&argument->type));
+            InternalError("Type mismatch during internal argument store handling for argument %s of function %s\nExpected type %s, got type %s", argument->name, calledFunction->name, type_get_name(tac_operand_get_type(argOperand)), type_get_name(argument->type));
         }
 
-        struct Lifetime *argLifetime = lifetime_find_by_name(calledFunction->regalloc.allLifetimes, argument->name);
+        struct Lifetime *argLifetime = lifetime_find_for_variable(&calledFunction->regalloc, argument);
 
         log(LOG_DEBUG, "Store argument %s - %s", argument->name, argOperand->name.str);
         char *printedOperand = tac_operand_sprint(argOperand);
@@ -705,7 +706,7 @@ void riscv_emit_argument_stores(struct CodegenState *state,
             case VP_STANDARD:
             case VP_TEMP:
             {
-                struct Lifetime *callerSavedDummyLifetime = lifetime_find(callerSavedArgLifetimes, argOperand);
+                struct Lifetime *callerSavedDummyLifetime = set_find(callerSavedArgLifetimes, lifetime_find(metadata, argOperand));
                 if (callerSavedDummyLifetime != NULL)
                 {
                     placedOrFoundIn = acquire_scratch_register(info);
@@ -721,7 +722,7 @@ void riscv_emit_argument_stores(struct CodegenState *state,
                     if (array_at(&info->arguments, argRegIdx) == placedOrFoundIn)
                     {
                         InternalError("When attempting to store argument %s for call to %s - the value we want to read from (%s) is contained in %s, an argument register we've already overwritten with one of %s's arguments",
-                                      argLifetime->name, calledFunction->name, argOperand->name.variable->name, placedOrFoundIn->name, calledFunction->name);
+                                      argLifetime->name, calledFunction->name, tac_operand_get_variable_name(argOperand), placedOrFoundIn->name, calledFunction->name);
                     }
                 }
             }
@@ -803,7 +804,7 @@ struct Register *riscv_place_addr_of_array_element_in_register(struct TACLine *g
     free(printedArrayOperand);
     free(printedIndexOperand);
 
-    struct Lifetime *loadedFromLt = lifetime_find(metadata->allLifetimes, arrayOperand);
+    struct Lifetime *loadedFromLt = lifetime_find(metadata, arrayOperand);
     switch (loadedFromLt->wbLocation)
     {
     case WB_STACK:
@@ -811,14 +812,14 @@ struct Register *riscv_place_addr_of_array_element_in_register(struct TACLine *g
         break;
 
     case WB_REGISTER:
-        if (type_is_struct_object(&loadedFromLt->type))
+        if (type_is_struct_object(loadedFromLt->type))
         {
             InternalError("Codegen for array load for array with WB_REGISTER not implemented");
         }
         break;
 
     case WB_UNKNOWN:
-        InternalError("Unknown writeback location for lifetime %s (%s)", loadedFromLt->name, type_get_name(&loadedFromLt->type));
+        InternalError("Unknown writeback location for lifetime %s (%s)", loadedFromLt->name, type_get_name(loadedFromLt->type));
     }
 
     struct Type *loadedFromArrayType = tac_operand_get_type(arrayOperand);
@@ -831,7 +832,7 @@ struct Register *riscv_place_addr_of_array_element_in_register(struct TACLine *g
 
     // TODO: this really supports array index operations on arrays and array single pointers. Ensure that array single pointers are []'d correctly (linearization issue? if an issue at all)
     struct Register *arrayBaseAddrReg = NULL;
-    if (type_is_struct_object(&loadedFromLt->type))
+    if (type_is_struct_object(loadedFromLt->type))
     {
         arrayBaseAddrReg = acquire_scratch_register(info);
         riscv_place_addr_of_operand_in_reg(generate, state, metadata, info, arrayOperand, arrayBaseAddrReg);
@@ -930,7 +931,7 @@ void riscv_emit_struct_field_load(struct TACLine *generate, struct CodegenState
     }
 
     struct TacFieldLoad *fieldLoadOperands = &generate->operands.fieldLoad;
-    struct Lifetime *loadedFromLt = lifetime_find(metadata->allLifetimes, &fieldLoadOperands->source);
+    struct Lifetime *loadedFromLt = lifetime_find(metadata, &fieldLoadOperands->source);
     switch (loadedFromLt->wbLocation)
     {
     case WB_STACK:
@@ -938,21 +939,21 @@ void riscv_emit_struct_field_load(struct TACLine *generate, struct CodegenState
         break;
 
     case WB_REGISTER:
-        if (type_is_struct_object(&loadedFromLt->type))
+        if (type_is_struct_object(loadedFromLt->type))
         {
             InternalError("Codegen for struct field load for struct with WB_REGISTER not implemented");
         }
         break;
 
     case WB_UNKNOWN:
-        InternalError("Unknown writeback location for lifetime %s (%s)", loadedFromLt->name, type_get_name(&loadedFromLt->type));
+        InternalError("Unknown writeback location for lifetime %s (%s)", loadedFromLt->name, type_get_name(loadedFromLt->type));
     }
 
-    struct StructDesc *loadedFromStruct = scope_lookup_struct_by_type_or_pointer(metadata->scope, &loadedFromLt->type);
+    struct StructDesc *loadedFromStruct = scope_lookup_struct_by_type_or_pointer(metadata->scope, loadedFromLt->type);
     struct StructField *loadedField = struct_lookup_field_by_name(loadedFromStruct, fieldLoadOperands->fieldName, metadata->scope);
 
     struct Register *structBaseAddrReg = NULL;
-    if (type_is_struct_object(&loadedFromLt->type))
+    if (type_is_struct_object(loadedFromLt->type))
     {
         structBaseAddrReg = acquire_scratch_register(info);
         riscv_place_addr_of_operand_in_reg(generate, state, metadata, info, &fieldLoadOperands->source, structBaseAddrReg);
@@ -962,10 +963,10 @@ void riscv_emit_struct_field_load(struct TACLine *generate, struct CodegenState
         structBaseAddrReg = riscv_place_or_find_operand_in_register(generate, state, metadata, info, &fieldLoadOperands->source, NULL);
     }
 
-    if (!type_is_object(&loadedField->variable->type))
+    if (!type_is_object(loadedField->variable->type))
     {
         struct Register *loadedTo = acquire_scratch_register(info);
-        char loadChar = riscv_select_width_char_for_size(type_get_size(&loadedField->variable->type, metadata->scope));
+        char loadChar = riscv_select_width_char_for_size(type_get_size(loadedField->variable->type, metadata->scope));
         emit_instruction(generate, state, "\tl%c%s %s, %zd(%s)\n",
                          loadChar,
                          riscv_select_sign_for_load_char(loadChar),
@@ -978,7 +979,7 @@ void riscv_emit_struct_field_load(struct TACLine *generate, struct CodegenState
     {
         struct Register *destAddrReg = acquire_scratch_register(info);
         riscv_place_addr_of_operand_in_reg(generate, state, metadata, info, &fieldLoadOperands->destination, destAddrReg);
-        riscv_generate_internal_copy(generate, state, structBaseAddrReg, destAddrReg, acquire_scratch_register(info), type_get_size(&loadedField->variable->type, metadata->scope));
+        riscv_generate_internal_copy(generate, state, structBaseAddrReg, destAddrReg, acquire_scratch_register(info), type_get_size(loadedField->variable->type, metadata->scope));
     }
 }
 
@@ -990,7 +991,7 @@ void riscv_emit_struct_field_lea(struct TACLine *generate, struct CodegenState *
     }
 
     struct TacFieldLoad *fieldLeaOperands = &generate->operands.fieldLoad;
-    struct Lifetime *loadedFromLt = lifetime_find(metadata->allLifetimes, &fieldLeaOperands->source);
+    struct Lifetime *loadedFromLt = lifetime_find(metadata, &fieldLeaOperands->source);
     switch (loadedFromLt->wbLocation)
     {
     case WB_STACK:
@@ -998,21 +999,21 @@ void riscv_emit_struct_field_lea(struct TACLine *generate, struct CodegenState *
         break;
 
     case WB_REGISTER:
-        if (type_is_struct_object(&loadedFromLt->type))
+        if (type_is_struct_object(loadedFromLt->type))
         {
             InternalError("Codegen for struct field lea for struct with WB_REGISTER not implemented");
         }
         break;
 
     case WB_UNKNOWN:
-        InternalError("Unknown writeback location for lifetime %s (%s)", loadedFromLt->name, type_get_name(&loadedFromLt->type));
+        InternalError("Unknown writeback location for lifetime %s (%s)", loadedFromLt->name, type_get_name(loadedFromLt->type));
     }
 
-    struct StructDesc *loadedFromStruct = scope_lookup_struct_by_type_or_pointer(metadata->scope, &loadedFromLt->type);
+    struct StructDesc *loadedFromStruct = scope_lookup_struct_by_type_or_pointer(metadata->scope, loadedFromLt->type);
     struct StructField *loadedField = struct_lookup_field_by_name(loadedFromStruct, fieldLeaOperands->fieldName, metadata->scope);
 
     struct Register *structBaseAddrReg = NULL;
-    if (type_is_struct_object(&loadedFromLt->type))
+    if (type_is_struct_object(loadedFromLt->type))
     {
         structBaseAddrReg = acquire_scratch_register(info);
         riscv_place_addr_of_operand_in_reg(generate, state, metadata, info, &fieldLeaOperands->source, structBaseAddrReg);
@@ -1036,7 +1037,7 @@ void riscv_emit_struct_field_store(struct TACLine *generate, struct CodegenState
     }
 
     struct TacFieldStore *fieldStoreOperands = &generate->operands.fieldStore;
-    struct Lifetime *storedToLt = lifetime_find(metadata->allLifetimes, &fieldStoreOperands->destination);
+    struct Lifetime *storedToLt = lifetime_find(metadata, &fieldStoreOperands->destination);
     switch (storedToLt->wbLocation)
     {
     case WB_STACK:
@@ -1044,21 +1045,21 @@ void riscv_emit_struct_field_store(struct TACLine *generate, struct CodegenState
         break;
 
     case WB_REGISTER:
-        if (type_is_struct_object(&storedToLt->type))
+        if (type_is_struct_object(storedToLt->type))
         {
             InternalError("Codegen for struct field store for struct with WB_REGISTER not implemented");
         }
         break;
 
     case WB_UNKNOWN:
-        InternalError("Unknown writeback location for lifetime %s (%s)", storedToLt->name, type_get_name(&storedToLt->type));
+        InternalError("Unknown writeback location for lifetime %s (%s)", storedToLt->name, type_get_name(storedToLt->type));
     }
 
-    struct StructDesc *storedFromStruct = scope_lookup_struct_by_type_or_pointer(metadata->scope, &storedToLt->type);
+    struct StructDesc *storedFromStruct = scope_lookup_struct_by_type_or_pointer(metadata->scope, storedToLt->type);
     struct StructField *storedField = struct_lookup_field_by_name(storedFromStruct, fieldStoreOperands->fieldName, metadata->scope);
 
     struct Register *structBaseAddrReg = NULL;
-    if (type_is_struct_object(&storedToLt->type))
+    if (type_is_struct_object(storedToLt->type))
     {
         structBaseAddrReg = acquire_scratch_register(info);
         riscv_place_addr_of_operand_in_reg(generate, state, metadata, info, &fieldStoreOperands->destination, structBaseAddrReg);
@@ -1068,11 +1069,11 @@ void riscv_emit_struct_field_store(struct TACLine *generate, struct CodegenState
         structBaseAddrReg = riscv_place_or_find_operand_in_register(generate, state, metadata, info, &fieldStoreOperands->destination, NULL);
     }
 
-    if (!type_is_object(&storedField->variable->type))
+    if (!type_is_object(storedField->variable->type))
     {
         struct Register *sourceReg = riscv_place_or_find_operand_in_register(generate, state, metadata, info, &fieldStoreOperands->source, NULL);
         emit_instruction(generate, state, "\ts%c %s, %zd(%s)#:(\n",
-                         riscv_select_width_char_for_size(type_get_size(&storedField->variable->type, metadata->scope)),
+                         riscv_select_width_char_for_size(type_get_size(storedField->variable->type, metadata->scope)),
                          sourceReg->name,
                          storedField->offset,
                          structBaseAddrReg->name);
@@ -1091,6 +1092,16 @@ void riscv_emit_struct_field_store(struct TACLine *generate, struct CodegenState
     }
 }
 
+// looking up a callee which doesn't exist yet would instantiate it, but too late for it to be allocated registers or have code generated
+void riscv_check_callee_instantiated(struct TypeEntry *calledOn, char *name)
+{
+    if ((calledOn->genericType == G_INSTANCE) && (hash_table_find(calledOn->implementedByName, name) == NULL))
+    {
+        char *calledOnName = type_entry_name(calledOn);
+        InternalError("%s::%s is called but was never instantiated", calledOnName, name);
+    }
+}
+
 // NOLINTBEGIN(readability-function-cognitive-complexity)
 void riscv_generate_code_for_tac(struct CodegenState *state,
                                  struct RegallocMetadata *metadata,
@@ -1110,13 +1121,13 @@ void riscv_generate_code_for_tac(struct CodegenState *state,
         struct Register *loadedTo = find_register_by_name(info, generate->operands.asmLoad.destRegisterName);
         if (loadedTo == NULL)
         {
-            log_tree(LOG_FATAL, &generate->correspondingTree, "%s does not name a valid register", generate->operands.asmLoad.destRegisterName);
+            log_loc(LOG_FATAL, generate->location, "%s does not name a valid register", generate->operands.asmLoad.destRegisterName);
         }
 
         size_t loadSize = type_get_size(tac_operand_get_type(&generate->operands.asmLoad.sourceOperand), metadata->scope);
         if (loadSize > sizeof(size_t))
         {
-            log_tree(LOG_FATAL, &generate->correspondingTree, "Loaded variable has size %zu, which is larger than sizeof(size_t) (%zu)", loadSize, sizeof(size_t));
+            log_loc(LOG_FATAL, generate->location, "Loaded variable has size %zu, which is larger than sizeof(size_t) (%zu)", loadSize, sizeof(size_t));
         }
 
         struct Register *placedOrFoundIn = riscv_place_or_find_operand_in_register(generate, state, metadata, info, &generate->operands.asmLoad.sourceOperand, loadedTo);
@@ -1133,13 +1144,13 @@ void riscv_generate_code_for_tac(struct CodegenState *state,
         struct Register *storedFrom = find_register_by_name(info, generate->operands.asmStore.sourceRegisterName);
         if (storedFrom == NULL)
         {
-            log_tree(LOG_FATAL, &generate->correspondingTree, "%s does not name a valid register", generate->operands.asmStore.sourceRegisterName);
+            log_loc(LOG_FATAL, generate->location, "%s does not name a valid register", generate->operands.asmStore.sourceRegisterName);
         }
 
         size_t storeSize = type_get_size(tac_operand_get_type(&generate->operands.asmStore.destinationOperand), metadata->scope);
         if (storeSize > sizeof(size_t))
         {
-            log_tree(LOG_FATAL, &generate->correspondingTree, "Stored variable has size %zu, which is larger than sizeof(size_t) (%zu)", storeSize, sizeof(size_t));
+            log_loc(LOG_FATAL, generate->location, "Stored variable has size %zu, which is larger than sizeof(size_t) (%zu)", storeSize, sizeof(size_t));
         }
 
         riscv_write_variable(generate, state, metadata, info, &generate->operands.asmStore.destinationOperand, storedFrom);
@@ -1148,8 +1159,8 @@ void riscv_generate_code_for_tac(struct CodegenState *state,
 
     case TT_ASSIGN:
     {
-        struct Lifetime *writtenLt = lifetime_find(metadata->allLifetimes, &generate->operands.assign.destination);
-        if (type_is_object(&writtenLt->type))
+        struct Lifetime *writtenLt = lifetime_find(metadata, &generate->operands.assign.destination);
+        if (type_is_object(writtenLt->type))
         {
             struct Register *sourceAddrReg = acquire_scratch_register(info);
             riscv_place_addr_of_operand_in_reg(generate, state, metadata, info, &generate->operands.assign.source, sourceAddrReg);
@@ -1158,7 +1169,7 @@ void riscv_generate_code_for_tac(struct CodegenState *state,
 
             struct Register *intermediateReg = acquire_scratch_register(info);
 
-            riscv_generate_internal_copy(generate, state, sourceAddrReg, destAddrReg, intermediateReg, type_get_size(&writtenLt->type, metadata->scope));
+            riscv_generate_internal_copy(generate, state, sourceAddrReg, destAddrReg, intermediateReg, type_get_size(writtenLt->type, metadata->scope));
         }
         else
         {
@@ -1207,8 +1218,8 @@ void riscv_generate_code_for_tac(struct CodegenState *state,
 
     case TT_LOAD:
     {
-        struct Lifetime *writtenLt = lifetime_find(metadata->allLifetimes, &generate->operands.load.destination);
-        if (type_is_object(&writtenLt->type))
+        struct Lifetime *writtenLt = lifetime_find(metadata, &generate->operands.load.destination);
+        if (type_is_object(writtenLt->type))
         {
             struct Register *sourceAddrReg = riscv_place_or_find_operand_in_register(generate, state, metadata, info, &generate->operands.load.address, NULL);
             struct Register *destAddrReg = acquire_scratch_register(info);
@@ -1216,7 +1227,7 @@ void riscv_generate_code_for_tac(struct CodegenState *state,
 
             struct Register *intermediateReg = acquire_scratch_register(info);
 
-            riscv_generate_internal_copy(generate, state, sourceAddrReg, destAddrReg, intermediateReg, type_get_size(&writtenLt->type, metadata->scope));
+            riscv_generate_internal_copy(generate, state, sourceAddrReg, destAddrReg, intermediateReg, type_get_size(writtenLt->type, metadata->scope));
         }
         else
         {
@@ -1241,7 +1252,7 @@ void riscv_generate_code_for_tac(struct CodegenState *state,
         struct Register *destAddrReg = riscv_place_or_find_operand_in_register(generate, state, metadata, info, &generate->operands.store.address, NULL);
         if (moveSize > sizeof(size_t) || type_is_object(srcType))
         {
-            emit_instruction(generate, state, "\t#move %s to %s (size %zu)\n", generate->operands.store.source.name.variable->name, generate->operands.store.address.name.variable->name, moveSize);
+            emit_instruction(generate, state, "\t#move %s to %s (size %zu)\n", tac_operand_get_variable_name(&generate->operands.store.source), tac_operand_get_variable_name(&generate->operands.store.address), moveSize);
             struct Register *sourceAddrReg = acquire_scratch_register(info);
             riscv_place_addr_of_operand_in_reg(generate, state, metadata, info, &generate->operands.store.source, sourceAddrReg);
             struct Register *intermediateReg = acquire_scratch_register(info);
@@ -1357,8 +1368,10 @@ void riscv_generate_code_for_tac(struct CodegenState *state,
     case TT_METHOD_CALL:
     {
         struct TypeEntry *calledOnType = scope_lookup_type_remove_pointer(metadata->scope, tac_operand_get_type(&generate->operands.methodCall.calledOn));
+        riscv_check_callee_instantiated(calledOnType, generate->operands.methodCall.methodName);
 
-        struct Ast dummyAst = generate->correspondingTree;
+        struct Ast dummyAst = {0};
+        source_location_populate_ast(generate->location, &dummyAst);
         dummyAst.value = generate->operands.methodCall.methodName;
 
         struct FunctionEntry *calledMethod = type_entry_lookup_method(calledOnType, &dummyAst, metadata->scope);
@@ -1395,8 +1408,9 @@ void riscv_generate_code_for_tac(struct CodegenState *state,
     case TT_ASSOCIATED_CALL:
     {
         struct TypeEntry *associatedWith = scope_lookup_type(metadata->scope, &generate->operands.associatedCall.associatedWith);
+        riscv_check_callee_instantiated(associatedWith, generate->operands.associatedCall.functionName);
         struct Ast dummyAst = {0};
-        dummyAst = generate->correspondingTree;
+        source_location_populate_ast(generate->location, &dummyAst);
         dummyAst.value = generate->operands.associatedCall.functionName;
 
         struct FunctionEntry *calledAssociated = type_entry_lookup_associated_function(associatedWith, &dummyAst, metadata->scope);
@@ -1473,19 +1487,31 @@ void riscv_generate_code_for_basic_block(struct CodegenState *state,
         fprintf(state->outFile, "%s_%zu:\n", functionName, block->labelNum);
     }
 
+    bool emitTacComments = dump_function_enabled(DUMP_TAC_COMMENTS, functionName);
+    bool logTac = (get_log_level() <= LOG_DEBUG);
+
+    struct FunctionIr *ir = metadata->function->ir;
+    struct IrBlock *irBlock = &ir->blocks[block->labelNum];
+
     Stack *calledFunctionArguments = stack_new(NULL);
     size_t lastLineNo = 0;
-    Iterator *tacRunner = NULL;
-    for (tacRunner = list_begin(block->TACList); iterator_gettable(tacRunner); iterator_next(tacRunner))
+    for (size_t lineIndex = irBlock->firstLine; lineIndex < irBlock->firstLine + irBlock->nLines; lineIndex++)
     {
         release_all_scratch_registers(info);
 
-        struct TACLine *thisTac = iterator_get(tacRunner);
+        struct TACLine *thisTac = ir->lines[lineIndex];
 
-        char *printedTac = sprint_tac_line(thisTac);
-        log(LOG_DEBUG, "Generate code for %s (alloc %s:%d)", printedTac, thisTac->allocFile, thisTac->allocLine);
-        fprintf(state->outFile, "#%s\n", printedTac);
-        free(printedTac);
+        // only print the TAC line if it is actually going somewhere
+        if (emitTacComments || logTac)
+        {
+            char *printedTac = sprint_tac_line(thisTac);
+            log(LOG_DEBUG, "Generate code for %s (%s:%d)", printedTac, source_location_file_name(thisTac->location), source_location_get(thisTac->location)->line);
+            if (emitTacComments)
+            {
+                fprintf(state->outFile, "#%s\n", printedTac);
+            }
+            free(printedTac);
+        }
 
         emit_loc(state, thisTac, &lastLineNo);
         riscv_generate_code_for_tac(state, metadata, info, thisTac, functionName, calledFunctionArguments);
@@ -1501,6 +1527,5 @@ void riscv_generate_code_for_basic_block(struct CodegenState *state,
         }
         iterator_free(regIterator);
     }
-    iterator_free(tacRunner);
     stack_free(calledFunctionArguments);
 }
@@ -0,0 +1,634 @@
+#include "compilation_cache.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "compiler.h"
+#include "dump.h"
+#include "log.h"
+#include "pch.h"
+#include "regalloc_generic.h"
+#include "symtab.h"
+#include "tac.h"
+
+// bump whenever the format of cached entries or the way keys are computed changes
+const u64 COMPILATION_CACHE_FORMAT_VERSION = 3;
+
+_Thread_local struct CompilationCache *activeCompilationCache = NULL;
+
+// identifies the running compiler binary, so that rebuilding sbcc invalidates everything it cached
+struct ContentHash compilerIdentity;
+pthread_once_t compilerIdentityOnce = PTHREAD_ONCE_INIT;
+
+void compilation_cache_compute_compiler_identity()
+{
+    content_hash_init(&compilerIdentity);
+    content_hash_update_u64(&compilerIdentity, COMPILATION_CACHE_FORMAT_VERSION);
+
+    FILE *self = fopen("/proc/self/exe", "rb");
+    if (self == NULL)
+    {
+        // fall back to the build time of this file - rebuilding sbcc usually rebuilds this too
+        log(LOG_WARNING, "Unable to read /proc/self/exe to identify compiler for caching - falling back to build timestamp");
+        content_hash_update_string(&compilerIdentity, __DATE__ " " __TIME__);
+        return;
+    }
+
+    u8 readBuf[4096];
+    size_t nRead = 0;
+    while ((nRead = fread(readBuf, 1, sizeof(readBuf), self)) > 0)
+    {
+        content_hash_update(&compilerIdentity, readBuf, nRead);
+    }
+    fclose(self);
+}
+
+void compilation_cache_make_directory(char *path)
+{
+    if ((mkdir(path, 0777) != 0) && (errno != EEXIST))
+    {
+        InternalError("Unable to create cache directory %s: %s", path, strerror(errno));
+    }
+}
+
+char *compilation_cache_kind_names[] = {
+    "tu",
+    "fn",
+    "inst",
+};
+
+struct CompilationCache *compilation_cache_new(char *directory)
+{
+    pthread_once(&compilerIdentityOnce, compilation_cache_compute_compiler_identity);
+
+    struct CompilationCache *wip = malloc(sizeof(struct CompilationCache));
+    memset(wip, 0, sizeof(struct CompilationCache));
+    wip->directory = directory;
+
+    compilation_cache_make_directory(directory);
+    for (size_t kindIndex = 0; kindIndex <= CC_INSTANCE; kindIndex++)
+    {
+        char *kindDirectory = malloc(strlen(directory) + strlen(compilation_cache_kind_names[kindIndex]) + 2);
+        sprintf(kindDirectory, "%s/%s", directory, compilation_cache_kind_names[kindIndex]);
+        compilation_cache_make_directory(kindDirectory);
+        free(kindDirectory);
+    }
+
+    return wip;
+}
+
+void compilation_cache_free(struct CompilationCache *cache)
+{
+    free(cache);
+}
+
+void compilation_cache_begin_unit(struct CompilationCache *cache,
+                                  struct TranslationUnit *unit,
+                                  const char *preprocessedText,
+                                  size_t preprocessedLength,
+                                  struct PrecompiledHeader *pch)
+{
+    struct ContentHash unitHash = compilerIdentity;
+    // the input file name is emitted in .file directives, so it is part of the output
+    content_hash_update_string(&unitHash, unit->inFileName);
+    content_hash_update_u64(&unitHash, unit->emitStart);
+    // TAC comments are part of the generated code
+    content_hash_update_u64(&unitHash, dump_enabled(DUMP_TAC_COMMENTS));
+    content_hash_update_string(&unitHash, (unit->dump.functionFilter != NULL) ? unit->dump.functionFilter : "");
+    content_hash_update_u64(&unitHash, (pch != NULL));
+    if (pch != NULL)
+    {
+        content_hash_update(&unitHash, pch->mapping, pch->mappingSize);
+    }
+    content_hash_update(&unitHash, preprocessedText, preprocessedLength);
+
+    content_hash_sprint(&unitHash, cache->unitKey);
+}
+
+/*
+ * Per-function fingerprinting
+ */
+
+void compilation_cache_hash_type(struct ContentHash *hash, struct Type *type)
+{
+    char *typeName = type_get_name(type);
+    content_hash_update_string(hash, typeName);
+    free(typeName);
+}
+
+void compilation_cache_hash_operand(struct ContentHash *hash, struct TACOperand *operand)
+{
+    content_hash_update_u64(hash, operand->permutation);
+    switch (operand->permutation)
+    {
+    case VP_STANDARD:
+    case VP_TEMP:
+        content_hash_update_string(hash, tac_operand_get_variable_name(operand));
+        break;
+
+    case VP_LITERAL_STR:
+        content_hash_update_string(hash, operand->name.str);
+        break;
+
+    case VP_LITERAL_VAL:
+        content_hash_update_u64(hash, operand->name.val);
+        break;
+
+    case VP_UNUSED:
+        return;
+    }
+
+    compilation_cache_hash_type(hash, tac_operand_get_non_cast_type(operand));
+    if (operand->castAsType != NULL)
+    {
+        content_hash_update_u64(hash, operand->castAsType->basicType);
+        compilation_cache_hash_type(hash, operand->castAsType);
+    }
+    else
+    {
+        content_hash_update_u64(hash, VT_NULL);
+    }
+}
+
+void compilation_cache_hash_operand_usages(struct ContentHash *hash, struct OperandUsages *usages)
+{
+    size_t nReads = operand_usages_n_reads(usages);
+    content_hash_update_u64(hash, nReads);
+    for (size_t readIndex = 0; readIndex < nReads; readIndex++)
+    {
+        compilation_cache_hash_operand(hash, operand_usages_read(usages, readIndex));
+    }
+
+    content_hash_update_u64(hash, usages->nWrites);
+    for (size_t writeIndex = 0; writeIndex < usages->nWrites; writeIndex++)
+    {
+        compilation_cache_hash_operand(hash, usages->writes[writeIndex]);
+    }
+}
+
+void compilation_cache_hash_tac_line(struct ContentHash *hash, struct TACLine *line)
+{
+    content_hash_update_u64(hash, line->operation);
+    content_hash_update_u64(hash, line->index);
+    // line numbers are emitted in .loc directives
+    content_hash_update_u64(hash, source_location_get(line->location)->line);
+
+    struct OperandUsages usages = get_operand_usages(line);
+    compilation_cache_hash_operand_usages(hash, &usages);
+
+    // everything which isn't an operand
+    switch (line->operation)
+    {
+    case TT_ASM:
+        content_hash_update_string(hash, line->operands.asm_.asmString);
+        break;
+
+    case TT_ASM_LOAD:
+        content_hash_update_string(hash, line->operands.asmLoad.destRegisterName);
+        break;
+
+    case TT_ASM_STORE:
+        content_hash_update_string(hash, line->operands.asmStore.sourceRegisterName);
+        break;
+
+    case TT_FIELD_LOAD:
+    case TT_FIELD_LEA:
+        content_hash_update_string(hash, line->operands.fieldLoad.fieldName);
+        break;
+
+    case TT_FIELD_STORE:
+        content_hash_update_string(hash, line->operands.fieldStore.fieldName);
+        break;
+
+    case TT_SIZEOF:
+        compilation_cache_hash_type(hash, &line->operands.sizeof_.type);
+        break;
+
+    case TT_BEQ:
+    case TT_BNE:
+    case TT_BGEU:
+    case TT_BLTU:
+    case TT_BGTU:
+    case TT_BLEU:
+    case TT_BEQZ:
+    case TT_BNEZ:
+        content_hash_update_u64(hash, line->operands.conditionalBranch.label);
+        break;
+
+    case TT_JMP:
+        content_hash_update_u64(hash, line->operands.jump.label);
+        break;
+
+    case TT_FUNCTION_CALL:
+        content_hash_update_string(hash, line->operands.functionCall.functionName);
+        break;
+
+    case TT_METHOD_CALL:
+        content_hash_update_string(hash, line->operands.methodCall.methodName);
+        break;
+
+    case TT_ASSOCIATED_CALL:
+        compilation_cache_hash_type(hash, &line->operands.associatedCall.associatedWith);
+        content_hash_update_string(hash, line->operands.associatedCall.functionName);
+        break;
+
+    case TT_LABEL:
+        content_hash_update_u64(hash, line->operands.label.labelNumber);
+        break;
+
+    default:
+        break;
+    }
+}
+
+// hash what callers of a function depend on: its signature and where its arguments live
+void compilation_cache_hash_function_interface(struct ContentHash *hash, struct FunctionEntry *function)
+{
+    content_hash_update_string(hash, function->name);
+    content_hash_update_u64(hash, function->isDefined);
+    compilation_cache_hash_type(hash, &function->returnType);
+    content_hash_update_u64(hash, function->regalloc.argStackSize);
+
+    Iterator *argIter = NULL;
+    for (argIter = deque_front(function->arguments); iterator_gettable(argIter); iterator_next(argIter))
+    {
+        struct VariableEntry *argument = iterator_get(argIter);
+        content_hash_update_string(hash, argument->name);
+        compilation_cache_hash_type(hash, argument->type);
+
+        // NULL if the function hasn't had its registers allocated
+        struct Lifetime *argLifetime = lifetime_find_for_variable(&function->regalloc, argument);
+
+        if (argLifetime == NULL)
+        {
+            content_hash_update_u64(hash, WB_UNKNOWN);
+            continue;
+        }
+
+        content_hash_update_u64(hash, argLifetime->wbLocation);
+        switch (argLifetime->wbLocation)
+        {
+        case WB_REGISTER:
+            content_hash_update_string(hash, argLifetime->writebackInfo.regLocation->name);
+            break;
+
+        case WB_STACK:
+            content_hash_update_u64(hash, argLifetime->writebackInfo.stackOffset);
+            break;
+
+        case WB_GLOBAL:
+        case WB_UNKNOWN:
+            break;
+        }
+    }
+    iterator_free(argIter);
+}
+
+void compilation_cache_hash_scope(struct ContentHash *hash, struct Scope *scope);
+
+void compilation_cache_hash_struct_layout(struct ContentHash *hash, struct StructDesc *theStruct)
+{
+    content_hash_update_u64(hash, theStruct->totalSize);
+    Iterator *fieldIter = NULL;
+    for (fieldIter = deque_front(theStruct->fieldLocations); iterator_gettable(fieldIter); iterator_next(fieldIter))
+    {
+        struct StructField *field = iterator_get(fieldIter);
+        content_hash_update_string(hash, field->variable->name);
+        compilation_cache_hash_type(hash, field->variable->type);
+        content_hash_update_u64(hash, field->offset);
+    }
+    iterator_free(fieldIter);
+}
+
+void compilation_cache_hash_type_entry(struct ContentHash *hash, struct TypeEntry *theType)
+{
+    char *typeName = type_entry_name(theType);
+    content_hash_update_string(hash, typeName);
+    free(typeName);
+    content_hash_update_u64(hash, theType->permutation);
+
+    if (theType->permutation == TP_STRUCT)
+    {
+        compilation_cache_hash_struct_layout(hash, theType->data.asStruct);
+    }
+
+    if (theType->genericType == G_BASE)
+    {
+        Iterator *instanceIter = NULL;
+        for (instanceIter = hash_table_begin(theType->generic.base.instances); iterator_gettable(instanceIter); iterator_next(instanceIter))
+        {
+            HashTableEntry *instanceEntry = iterator_get(instanceIter);
+            compilation_cache_hash_type_entry(hash, instanceEntry->value);
+        }
+        iterator_free(instanceIter);
+    }
+    else
+    {
+        compilation_cache_hash_scope(hash, theType->implemented);
+    }
+}
+
+void compilation_cache_hash_scope(struct ContentHash *hash, struct Scope *scope)
+{
+    Iterator *memberIter = NULL;
+    for (memberIter = deque_front(scope->entries); iterator_gettable(memberIter); iterator_next(memberIter))
+    {
+        struct ScopeMember *member = iterator_get(memberIter);
+        switch (member->type)
+        {
+        case E_FUNCTION:
+            compilation_cache_hash_function_interface(hash, member->entry);
+            break;
+
+        case E_TYPE:
+            compilation_cache_hash_type_entry(hash, member->entry);
+            break;
+
+        case E_VARIABLE:
+        {
+            struct VariableEntry *variable = member->entry;
+            content_hash_update_string(hash, variable->name);
+            compilation_cache_hash_type(hash, variable->type);
+        }
+        break;
+
+        case E_SCOPE:
+            compilation_cache_hash_scope(hash, member->entry);
+            break;
+
+        case E_ARGUMENT:
+        case E_BASICBLOCK:
+        case E_TRAIT:
+            break;
+        }
+    }
+    iterator_free(memberIter);
+}
+
+void compilation_cache_begin_codegen(struct CompilationCache *cache, struct SymbolTable *table)
+{
+    cache->unitFingerprint = compilerIdentity;
+    compilation_cache_hash_scope(&cache->unitFingerprint, table->globalScope);
+}
+
+void compilation_cache_hash_function_body(struct ContentHash *hash, struct FunctionEntry *function, char *fullFunctionName)
+{
+    content_hash_update_string(hash, fullFunctionName);
+    struct SourceLocation *functionLocation = source_location_get(function->location);
+    content_hash_update_u64(hash, functionLocation->line);
+    content_hash_update_u64(hash, functionLocation->col);
+    content_hash_update_u64(hash, function->isAsmFun);
+    content_hash_update_u64(hash, function->callsOtherFunction);
+    content_hash_update_u64(hash, dump_function_enabled(DUMP_TAC_COMMENTS, fullFunctionName));
+
+    Iterator *blockIter = NULL;
+    for (blockIter = list_begin(function->BasicBlockList); iterator_gettable(blockIter); iterator_next(blockIter))
+    {
+        struct BasicBlock *block = iterator_get(blockIter);
+        content_hash_update_u64(hash, block->labelNum);
+        Iterator *tacIter = NULL;
+        for (tacIter = list_begin(block->TACList); iterator_gettable(tacIter); iterator_next(tacIter))
+        {
+            compilation_cache_hash_tac_line(hash, iterator_get(tacIter));
+        }
+        iterator_free(tacIter);
+    }
+    iterator_free(blockIter);
+}
+
+char *compilation_cache_function_key(struct CompilationCache *cache, struct FunctionEntry *function, char *fullFunctionName)
+{
+    struct ContentHash functionHash = cache->unitFingerprint;
+    compilation_cache_hash_function_body(&functionHash, function, fullFunctionName);
+
+    char *key = malloc(CONTENT_HASH_STRING_LENGTH);
+    content_hash_sprint(&functionHash, key);
+    return key;
+}
+
+/*
+ * Generic instance fingerprinting
+ * Every TU using a generic instance generates the same code for it, so instances are keyed only by what their own code
+ * depends on rather than by the whole TU, letting one TU reuse the code another generated.
+ */
+
+// hash the layout of type (or what it points to) if it is a concrete struct or enum
+void compilation_cache_hash_type_layout(struct ContentHash *hash, struct Scope *scope, struct Type *type)
+{
+    switch (type->basicType)
+    {
+    case VT_NULL:
+    case VT_ANY:
+    case VT_U8:
+    case VT_U16:
+    case VT_U32:
+    case VT_U64:
+    case VT_SELF:
+    case VT_GENERIC_PARAM:
+        break;
+
+    case VT_ARRAY:
+        content_hash_update_u64(hash, type->array.size);
+        compilation_cache_hash_type_layout(hash, scope, type->array.type);
+        break;
+
+    case VT_STRUCT:
+    case VT_ENUM:
+    {
+        if (type_is_generic(type))
+        {
+            break;
+        }
+
+        struct TypeEntry *theType = scope_lookup_type_remove_pointer(scope, type);
+        struct TypeLayout *layout = type_entry_get_layout(theType);
+        content_hash_update_u64(hash, layout->size);
+        content_hash_update_u64(hash, layout->alignment);
+
+        switch (theType->permutation)
+        {
+        case TP_PRIMITIVE:
+            break;
+
+        case TP_STRUCT:
+            compilation_cache_hash_struct_layout(hash, theType->data.asStruct);
+            break;
+
+        case TP_ENUM:
+        {
+            Iterator *memberIter = NULL;
+            for (memberIter = set_begin(theType->data.asEnum->members); iterator_gettable(memberIter); iterator_next(memberIter))
+            {
+                struct EnumMember *member = iterator_get(memberIter);
+                content_hash_update_string(hash, member->name);
+                content_hash_update_u64(hash, member->numerical);
+            }
+            iterator_free(memberIter);
+        }
+        break;
+        }
+    }
+    break;
+    }
+}
+
+void compilation_cache_hash_operand_layout(struct ContentHash *hash, struct Scope *scope, struct TACOperand *operand)
+{
+    if (operand->permutation != VP_UNUSED)
+    {
+        compilation_cache_hash_type_layout(hash, scope, tac_operand_get_type(operand));
+    }
+}
+
+// hash the layouts of the types a line touches and the interface of anything it calls
+void compilation_cache_hash_tac_line_dependencies(struct ContentHash *hash, struct Scope *scope, struct TACLine *line)
+{
+    struct OperandUsages usages = get_operand_usages(line);
+    for (size_t readIndex = 0; readIndex < operand_usages_n_reads(&usages); readIndex++)
+    {
+        compilation_cache_hash_operand_layout(hash, scope, operand_usages_read(&usages, readIndex));
+    }
+    for (size_t writeIndex = 0; writeIndex < usages.nWrites; writeIndex++)
+    {
+        compilation_cache_hash_operand_layout(hash, scope, usages.writes[writeIndex]);
+    }
+
+    struct FunctionEntry *callee = NULL;
+    switch (line->operation)
+    {
+    case TT_SIZEOF:
+        compilation_cache_hash_type_layout(hash, scope, &line->operands.sizeof_.type);
+        break;
+
+    case TT_FUNCTION_CALL:
+        callee = lookup_fun_by_string(scope, line->operands.functionCall.functionName);
+        break;
+
+    case TT_METHOD_CALL:
+    {
+        struct TypeEntry *calledOn = scope_lookup_type_remove_pointer(scope, tac_operand_get_type(&line->operands.methodCall.calledOn));
+        callee = hash_table_find(calledOn->implementedByName, line->operands.methodCall.methodName);
+    }
+    break;
+
+    case TT_ASSOCIATED_CALL:
+    {
+        struct TypeEntry *associatedWith = scope_lookup_type(scope, &line->operands.associatedCall.associatedWith);
+        callee = hash_table_find(associatedWith->implementedByName, line->operands.associatedCall.functionName);
+    }
+    break;
+
+    default:
+        break;
+    }
+
+    if (callee != NULL)
+    {
+        compilation_cache_hash_function_interface(hash, callee);
+    }
+}
+
+char *compilation_cache_instance_key(struct CompilationCache *cache, struct FunctionEntry *function, char *fullFunctionName)
+{
+    struct ContentHash instanceHash = compilerIdentity;
+    compilation_cache_hash_function_interface(&instanceHash, function);
+    compilation_cache_hash_function_body(&instanceHash, function, fullFunctionName);
+
+    Iterator *blockIter = NULL;
+    for (blockIter = list_begin(function->BasicBlockList); iterator_gettable(blockIter); iterator_next(blockIter))
+    {
+        struct BasicBlock *block = iterator_get(blockIter);
+        Iterator *tacIter = NULL;
+        for (tacIter = list_begin(block->TACList); iterator_gettable(tacIter); iterator_next(tacIter))
+        {
+            compilation_cache_hash_tac_line_dependencies(&instanceHash, function->mainScope, iterator_get(tacIter));
+        }
+        iterator_free(tacIter);
+    }
+    iterator_free(blockIter);
+
+    char *key = malloc(CONTENT_HASH_STRING_LENGTH);
+    content_hash_sprint(&instanceHash, key);
+    return key;
+}
+
+/*
+ * Storage
+ */
+
+char *compilation_cache_entry_path(struct CompilationCache *cache, enum COMPILATION_CACHE_KIND kind, char *key)
+{
+    char *kindName = compilation_cache_kind_names[kind];
+    char *path = malloc(strlen(cache->directory) + strlen(kindName) + strlen(key) + 5);
+    sprintf(path, "%s/%s/%s.S", cache->directory, kindName, key);
+    return path;
+}
+
+bool compilation_cache_fetch(struct CompilationCache *cache, enum COMPILATION_CACHE_KIND kind, char *key, FILE *outFile)
+{
+    char *path = compilation_cache_entry_path(cache, kind, key);
+    FILE *cachedFile = fopen(path, "rb");
+    free(path);
+
+    if ((kind == CC_FUNCTION) || (kind == CC_INSTANCE))
+    {
+        *((cachedFile != NULL) ? &cache->nFunctionHits : &cache->nFunctionMisses) += 1;
+    }
+
+    if (cachedFile == NULL)
+    {
+        return false;
+    }
+
+    char copyBuf[4096];
+    size_t nRead = 0;
+    while ((nRead = fread(copyBuf, 1, sizeof(copyBuf), cachedFile)) > 0)
+    {
+        fwrite(copyBuf, 1, nRead, outFile);
+    }
+    fclose(cachedFile);
+    return true;
+}
+
+void compilation_cache_store(struct CompilationCache *cache, enum COMPILATION_CACHE_KIND kind, char *key, const char *data, size_t length)
+{
+    char *path = compilation_cache_entry_path(cache, kind, key);
+
+    // write to a uniquely-named file and rename it into place so concurrent compiles never see a partial entry
+    char *tempPath = malloc(strlen(path) + 64);
+    sprintf(tempPath, "%s.%d.%lx.tmp", path, getpid(), (unsigned long)pthread_self());
+
+    FILE *tempFile = fopen(tempPath, "wb");
+    if (tempFile == NULL)
+    {
+        log(LOG_WARNING, "Unable to write cache entry %s: %s", tempPath, strerror(errno));
+    }
+    else
+    {
+        fwrite(data, 1, length, tempFile);
+        bool writeFailed = (ferror(tempFile) != 0);
+        writeFailed |= (fclose(tempFile) != 0);
+        if (writeFailed || (rename(tempPath, path) != 0))
+        {
+            log(LOG_WARNING, "Unable to write cache entry %s", path);
+            unlink(tempPath);
+        }
+    }
+
+    free(tempPath);
+    free(path);
+}
+
+void compilation_cache_set_active(struct CompilationCache *cache)
+{
+    activeCompilationCache = cache;
+}
+
+struct CompilationCache *compilation_cache_get_active()
+{
+    return activeCompilationCache;
+}
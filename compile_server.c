@@ -0,0 +1,411 @@
+#include "compile_server.h"
+
+#include <errno.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "compiler.h"
+#include "log.h"
+#include "pch.h"
+#include "preprocessor.h"
+
+extern _Thread_local struct IncludeCache *includeCache;
+extern List *includePath;
+
+const int COMPILE_SERVER_BACKLOG = 16;
+
+volatile sig_atomic_t compileServerShouldExit = false;
+
+void compile_server_handle_signal(int signalNumber)
+{
+    compileServerShouldExit = true;
+}
+
+/*
+ * Socket I/O helpers
+ */
+
+bool compile_server_read_all(int fd, void *buf, size_t n)
+{
+    u8 *readTo = buf;
+    while (n > 0)
+    {
+        ssize_t nRead = read(fd, readTo, n);
+        if (nRead < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (nRead <= 0)
+        {
+            return false;
+        }
+        readTo += nRead;
+        n -= nRead;
+    }
+    return true;
+}
+
+bool compile_server_write_all(int fd, const void *buf, size_t n)
+{
+    const u8 *writeFrom = buf;
+    while (n > 0)
+    {
+        ssize_t nWritten = write(fd, writeFrom, n);
+        if (nWritten < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (nWritten <= 0)
+        {
+            return false;
+        }
+        writeFrom += nWritten;
+        n -= nWritten;
+    }
+    return true;
+}
+
+bool compile_server_read_u64(int fd, u64 *value)
+{
+    return compile_server_read_all(fd, value, sizeof(u64));
+}
+
+// read a length-prefixed string, returning a null-terminated copy in *str
+bool compile_server_read_string(int fd, char **str, size_t *lengthOut)
+{
+    u64 length = 0;
+    if (!compile_server_read_u64(fd, &length))
+    {
+        return false;
+    }
+
+    *str = malloc(length + 1);
+    if (!compile_server_read_all(fd, *str, length))
+    {
+        free(*str);
+        *str = NULL;
+        return false;
+    }
+    (*str)[length] = '\0';
+
+    if (lengthOut != NULL)
+    {
+        *lengthOut = length;
+    }
+    return true;
+}
+
+bool compile_server_write_string(int fd, const char *str, size_t length)
+{
+    u64 length64 = length;
+    return compile_server_write_all(fd, &length64, sizeof(u64)) && compile_server_write_all(fd, str, length);
+}
+
+/*
+ * Request handling
+ */
+
+struct CompileRequest
+{
+    char *workingDirectory;
+    u64 argc;
+    char **argv;
+    char *stdinContents; // NULL if the client didn't send its stdin
+    size_t stdinLength;
+};
+
+void compile_request_free(struct CompileRequest *request)
+{
+    free(request->workingDirectory);
+    for (size_t argIndex = 0; argIndex < request->argc; argIndex++)
+    {
+        free(request->argv[argIndex]);
+    }
+    free(request->argv);
+    free(request->stdinContents);
+}
+
+bool compile_request_read(int fd, struct CompileRequest *request)
+{
+    memset(request, 0, sizeof(struct CompileRequest));
+
+    u64 version = 0;
+    if (!compile_server_read_u64(fd, &version) || (version != COMPILE_SERVER_PROTOCOL_VERSION))
+    {
+        log(LOG_WARNING, "Compile server: bad protocol version from client (got %lu, expected %d)", version, COMPILE_SERVER_PROTOCOL_VERSION);
+        return false;
+    }
+
+    if (!compile_server_read_string(fd, &request->workingDirectory, NULL) ||
+        !compile_server_read_u64(fd, &request->argc))
+    {
+        return false;
+    }
+
+    // leave room for getopt's trailing NULL
+    request->argv = malloc((request->argc + 1) * sizeof(char *));
+    memset(request->argv, 0, (request->argc + 1) * sizeof(char *));
+    for (size_t argIndex = 0; argIndex < request->argc; argIndex++)
+    {
+        if (!compile_server_read_string(fd, &request->argv[argIndex], NULL))
+        {
+            return false;
+        }
+    }
+
+    u64 hasStdin = 0;
+    if (!compile_server_read_u64(fd, &hasStdin))
+    {
+        return false;
+    }
+
+    if (hasStdin)
+    {
+        return compile_server_read_string(fd, &request->stdinContents, &request->stdinLength);
+    }
+
+    return true;
+}
+
+// what a request owns while it runs, so that it can be released if a fatal error cuts the request short
+struct CompileRequestState
+{
+    struct CompilerOptions options;
+    bool haveOptions;
+    struct TranslationUnit *units;
+    size_t nUnits;
+};
+
+void compile_request_state_release(struct CompileRequestState *state)
+{
+    if (state->units != NULL)
+    {
+        compiler_free_units(state->units, state->nUnits);
+        state->units = NULL;
+    }
+    if (state->haveOptions)
+    {
+        compiler_options_deinit(&state->options);
+        state->haveOptions = false;
+    }
+    includePath = NULL;
+}
+
+// compile everything a request asks for, with logs going to logFile and code generated to stdout going to codeFile
+int compile_request_run(struct CompileRequest *request, struct CompileRequestState *state, FILE *logFile, FILE *codeFile)
+{
+    struct CompilerOptions *options = &state->options;
+    state->haveOptions = true;
+    if (!compiler_options_parse(options, request->argc, request->argv))
+    {
+        usage(logFile);
+        return 1;
+    }
+
+    if (options->serverSocket != NULL)
+    {
+        log(LOG_ERROR, "--server can't be passed through a compile server");
+        return 1;
+    }
+
+    includePath = options->includePath;
+
+    if (options->emitPch != NULL)
+    {
+        if (options->outFileName == NULL)
+        {
+            log(LOG_ERROR, "--emit-pch requires an output file (-o)");
+            return 1;
+        }
+        return pch_emit(options->emitPch, options->outFileName) ? 0 : 1;
+    }
+
+    // the client's stdin stands in for ours
+    if (request->stdinContents != NULL)
+    {
+        struct IncludedFile *stdinFile = include_cache_lookup(includeCache, "<stdin>");
+        free(stdinFile->contents);
+        stdinFile->contents = request->stdinContents;
+        stdinFile->length = request->stdinLength;
+        request->stdinContents = NULL;
+    }
+
+    state->units = compiler_create_units(options, &state->nUnits);
+    struct TranslationUnit *units = state->units;
+
+    int status = 0;
+    if (state->nUnits == 1)
+    {
+        // compile on the server thread so that its warm state is used and kept
+        if (strcmp(units[0].outFileName, "stdout") == 0)
+        {
+            units[0].outFile = codeFile;
+        }
+        // a warm preamble changes the unit's cache key (see compilation_cache_begin_unit) - with a cache, don't warm so that server and CLI builds share entries
+        units[0].warmPreamble = (units[0].cacheDir == NULL);
+        compile_translation_unit_captured(&units[0]);
+        log_set_output(logFile);
+
+        fwrite(units[0].logBuffer, 1, units[0].logBufferSize, logFile);
+        status = units[0].status;
+    }
+    else
+    {
+        status = compile_translation_units_parallel(units, state->nUnits, options->nJobs, logFile);
+    }
+
+    return status;
+}
+
+void compile_server_handle_client(int clientFd, char **lastWorkingDirectory, enum LOG_LEVEL defaultLogLevel)
+{
+    struct CompileRequest request;
+    if (!compile_request_read(clientFd, &request))
+    {
+        log(LOG_WARNING, "Compile server: malformed request from client");
+        compile_request_free(&request);
+        return;
+    }
+
+    char *logBuffer = NULL;
+    size_t logBufferSize = 0;
+    FILE *logFile = open_memstream(&logBuffer, &logBufferSize);
+    char *codeBuffer = NULL;
+    size_t codeBufferSize = 0;
+    FILE *codeFile = open_memstream(&codeBuffer, &codeBufferSize);
+
+    log_set_output(logFile);
+    set_log_level(defaultLogLevel);
+
+    int status = 0;
+    if (chdir(request.workingDirectory) != 0)
+    {
+        log(LOG_ERROR, "Compile server: unable to change to client working directory %s: %s", request.workingDirectory, strerror(errno));
+        status = 1;
+    }
+    else
+    {
+        // cached include paths (and the warm preambles found through them) are relative to the working directory they were found from
+        if ((*lastWorkingDirectory != NULL) && (strcmp(*lastWorkingDirectory, request.workingDirectory) != 0))
+        {
+            compiler_free_thread_state();
+        }
+        free(*lastWorkingDirectory);
+        *lastWorkingDirectory = strdup(request.workingDirectory);
+
+        compiler_init_thread_state();
+        include_cache_revalidate(includeCache);
+
+        // a fatal error anywhere in the request (even while parsing its options) fails only that request
+        struct CompileRequestState state;
+        memset(&state, 0, sizeof(struct CompileRequestState));
+        jmp_buf fatalErrorHandler;
+        if (setjmp(fatalErrorHandler) == 0)
+        {
+            log_set_fatal_handler(&fatalErrorHandler);
+            status = compile_request_run(&request, &state, logFile, codeFile);
+        }
+        else
+        {
+            status = 1;
+            log_set_output(logFile);
+            // the thread's warm state may have been left half-built
+            compiler_free_thread_state();
+        }
+        log_set_fatal_handler(NULL);
+        compile_request_state_release(&state);
+    }
+
+    log_set_output(NULL);
+    // the log level is process-wide and the request may have changed it with -v
+    if (get_log_level() != defaultLogLevel)
+    {
+        set_log_level(defaultLogLevel);
+    }
+    fclose(logFile);
+    fclose(codeFile);
+
+    u64 status64 = status;
+    if (!compile_server_write_all(clientFd, &status64, sizeof(u64)) ||
+        !compile_server_write_string(clientFd, logBuffer, logBufferSize) ||
+        !compile_server_write_string(clientFd, codeBuffer, codeBufferSize))
+    {
+        log(LOG_WARNING, "Compile server: client disconnected before response was sent");
+    }
+
+    free(logBuffer);
+    free(codeBuffer);
+    compile_request_free(&request);
+}
+
+int compile_server_run(char *socketPath)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(struct sockaddr_un));
+    address.sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(address.sun_path))
+    {
+        log(LOG_ERROR, "Compile server socket path %s is too long", socketPath);
+        return 1;
+    }
+    strcpy(address.sun_path, socketPath);
+
+    int serverFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (serverFd < 0)
+    {
+        log(LOG_ERROR, "Unable to create compile server socket: %s", strerror(errno));
+        return 1;
+    }
+
+    // clean up after a previous server which didn't exit cleanly
+    unlink(socketPath);
+    if ((bind(serverFd, (struct sockaddr *)&address, sizeof(struct sockaddr_un)) != 0) || (listen(serverFd, COMPILE_SERVER_BACKLOG) != 0))
+    {
+        log(LOG_ERROR, "Unable to listen on compile server socket %s: %s", socketPath, strerror(errno));
+        close(serverFd);
+        return 1;
+    }
+
+    // no SA_RESTART, so that accept() is interrupted and we can clean up the socket on exit
+    struct sigaction exitAction;
+    memset(&exitAction, 0, sizeof(struct sigaction));
+    exitAction.sa_handler = compile_server_handle_signal;
+    sigaction(SIGINT, &exitAction, NULL);
+    sigaction(SIGTERM, &exitAction, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    log(LOG_INFO, "Compile server listening on %s", socketPath);
+
+    enum LOG_LEVEL defaultLogLevel = get_log_level();
+    char *lastWorkingDirectory = NULL;
+    while (!compileServerShouldExit)
+    {
+        int clientFd = accept(serverFd, NULL, NULL);
+        if (clientFd < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            log(LOG_ERROR, "Compile server: accept failed: %s", strerror(errno));
+            break;
+        }
+
+        compile_server_handle_client(clientFd, &lastWorkingDirectory, defaultLogLevel);
+        close(clientFd);
+    }
+
+    log(LOG_INFO, "Compile server shutting down");
+    free(lastWorkingDirectory);
+    close(serverFd);
+    unlink(socketPath);
+    compiler_free_thread_state();
+
+    return 0;
+}
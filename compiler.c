@@ -1,20 +1,31 @@
-#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <setjmp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/wait.h>
 #include <unistd.h>
 
+#include "arena.h"
 #include "ast.h"
 #include "codegen.h"
+#include "compilation_cache.h"
+#include "compile_server.h"
+#include "compiler.h"
 #include "drop.h"
+#include "dump.h"
 #include "linearizer.h"
 #include "log.h"
+#include "pch.h"
+#include "preprocessor.h"
 #include "regalloc.h"
+#include "source_location.h"
 #include "ssa.h"
 #include "substratum_defs.h"
 #include "symtab.h"
 #include "tac.h"
+#include "time_report.h"
+#include "type_table.h"
 #include "util.h"
 
 #include "codegen_riscv.h"
@@ -22,229 +33,471 @@
 
 #include <mbcl/stack.h>
 
-struct Dictionary *parseDict = NULL;
+// per-thread state so that multiple translation units can be compiled in parallel
+// identifiers, block names and mangled names - kept for the lifetime of the thread, so that every TU it compiles reuses
+// the strings interned by the ones before
+_Thread_local struct StringInterner *stringInterner = NULL;
 
-void usage()
+void usage(FILE *outFile)
 {
-    printf("Substratum language compiler: Usage\n");
-    printf("-i (infile) : specify input substratum file to compile\n");
-    printf("-o (outfile): specify output file to generate object code to\n");
-    printf("-s: emit a _start label with a call to main if compiling a file with a 'main' function\n");
-    printf("\n");
+    fprintf(outFile, "Substratum language compiler: Usage\n");
+    fprintf(outFile, "-i (infile) : specify input substratum file to compile\n");
+    fprintf(outFile, "-o (outfile): specify output file to generate object code to\n");
+    fprintf(outFile, "-s: emit a _start label with a call to main if compiling a file with a 'main' function\n");
+    fprintf(outFile, "-j (n): compile up to n input files in parallel (when multiple -i flags are given)\n");
+    fprintf(outFile, "-d (outdir): with multiple input files, generate each input's .S file within outdir\n");
+    fprintf(outFile, "--emit-pch (header): precompile a header, writing the result to the file specified by -o\n");
+    fprintf(outFile, "--include-pch (pch): use a header precompiled by --emit-pch, skipping its preprocessing and parsing\n");
+    fprintf(outFile, "--cache-dir (dir): reuse code generated for unchanged translation units and functions by previous compiles, caching it within dir\n");
+    fprintf(outFile, "--dump=(kinds): write debug artifacts - a comma-separated list of ast (ast.dot), symtab (symtab.dot), cfg (control-flows/), tac-comments (TAC as comments in the generated assembly) - with multiple input files, dumps are named after each output (out.S.ast.dot)\n");
+    fprintf(outFile, "--dump-filter=(glob): only write per-function dumps (cfg, tac-comments) for functions whose names match glob\n");
+    fprintf(outFile, "-ftime-report: print wall time, CPU time, allocations, and peak RSS for each compiler phase and the most expensive functions (allocations within libc and mbcl are not counted, and peak RSS is for the whole process)\n");
+    fprintf(outFile, "-ftime-trace[=file]: write the same figures as a Chrome trace (chrome://tracing), by default to (outfile).json\n");
+    fprintf(outFile, "--server (socket): run as a persistent compile server listening on the given unix socket (see sbcc-client)\n");
+    fprintf(outFile, "\n");
 }
 
-Stack *parseProgressStack = NULL;
-Stack *parsedAsts = NULL;
+_Thread_local Stack *parseProgressStack = NULL;
+_Thread_local Stack *parsedAsts = NULL;
+_Thread_local struct IncludeCache *includeCache = NULL;
+_Thread_local HashTable *warmPreambles = NULL; // preamble key (see compiler_preamble_key) -> struct PrecompiledHeader
+extern _Thread_local struct TempList *temps;
+
+// shared between all translation units - read-only once options are parsed
 List *includePath = NULL;
-List *inputFiles = NULL;
 
-void run_preprocessor(char *inFileName)
+// parse the output of a preprocessor which has already begun preprocessing inFileName
+struct Ast *parse_preprocessed(struct Preprocessor *preprocessor, char *inFileName, struct Arena *astArena)
 {
-    const u32 BASE_PREPROCESSOR_PARAM_COUNT = 6;
-    char **preprocessorArgv = malloc(((includePath->size * 2) + BASE_PREPROCESSOR_PARAM_COUNT) * sizeof(char *));
-    u32 preprocessorArgI = 0;
+    struct ParseProgress fileProgress;
+    memset(&fileProgress, 0, sizeof(struct ParseProgress));
+    fileProgress.curLine = 1;
+    fileProgress.curCol = 1;
+    fileProgress.curLineRaw = 1;
+    fileProgress.curColRaw = 1;
+    fileProgress.curFile = string_interner_intern(stringInterner, inFileName, NULL);
+    fileProgress.charsRemainingPerLine = list_new(free, NULL);
+
+    size_t *firstLineChars = malloc(sizeof(size_t));
+    *firstLineChars = 0;
+    list_append(fileProgress.charsRemainingPerLine, firstLineChars);
 
-    preprocessorArgv[preprocessorArgI++] = "gcc";
-    preprocessorArgv[preprocessorArgI++] = "-x";
-    preprocessorArgv[preprocessorArgI++] = "c";
-    preprocessorArgv[preprocessorArgI++] = "-E";
+    fileProgress.interner = stringInterner;
+    fileProgress.astArena = astArena;
+    fileProgress.preprocessor = preprocessor;
 
-    if (strcmp(inFileName, "stdin") != 0)
+    pcc_context_t *parseContext = pcc_create(&fileProgress);
+
+    struct Ast *parsed = NULL;
+    struct Ast *translationUnit = NULL;
+    while (pcc_parse(parseContext, &translationUnit))
     {
-        preprocessorArgv[preprocessorArgI++] = inFileName;
+        parsed = AST_S(parsed, translationUnit);
     }
-    else
+
+    pcc_destroy(parseContext);
+
+    list_free(fileProgress.charsRemainingPerLine);
+
+    return parsed;
+}
+
+// past this many strings, a thread's interner is assumed to be mostly holding names from TUs it will never see again
+const size_t COMPILER_MAX_WARM_STRINGS = 1 << 20;
+
+void compiler_init_thread_state()
+{
+    // the include cache and interner are kept per-thread for the lifetime of the thread, so they are shared by every TU it compiles
+    if (includeCache == NULL)
     {
-        preprocessorArgv[preprocessorArgI++] = "- ";
+        includeCache = include_cache_new();
     }
 
-    Iterator *includePathRunner = NULL;
-    for (includePathRunner = list_begin(includePath); iterator_gettable(includePathRunner); iterator_next(includePathRunner))
+    if ((stringInterner != NULL) && (stringInterner->nStrings > COMPILER_MAX_WARM_STRINGS))
     {
-        preprocessorArgv[preprocessorArgI++] = "-I";
-        preprocessorArgv[preprocessorArgI++] = iterator_get(includePathRunner);
+        log(LOG_INFO, "Interned string limit reached (%zu strings) - starting over with an empty interner", stringInterner->nStrings);
+        string_interner_free(stringInterner);
+        stringInterner = NULL;
     }
-    iterator_free(includePathRunner);
 
-    preprocessorArgv[preprocessorArgI++] = NULL;
-
-    if (execvp(preprocessorArgv[0], preprocessorArgv) < 0)
+    if (stringInterner == NULL)
     {
-        InternalError("Failed to execute preprocessor: %s", strerror(errno));
+        stringInterner = string_interner_new();
     }
-    InternalError("Returned from exec of preprocessor!");
 }
 
-struct Ast *parse_file(char *inFileName)
+// past this many, warm preambles are assumed to mostly be from files which have since changed
+const size_t COMPILER_MAX_WARM_PREAMBLES = 64;
+
+// a preamble's AST and macros depend on where its #includes are searched for as well as its text
+char *compiler_preamble_key(char *inFileName, const char *preamble, size_t preambleLength)
 {
-    struct ParseProgress fileProgress;
-    memset(&fileProgress, 0, sizeof(struct ParseProgress));
-    fileProgress.curLine = 1;
-    fileProgress.curCol = 1;
-    fileProgress.curLineRaw = 1;
-    fileProgress.curColRaw = 1;
-    fileProgress.curFile = dictionary_lookup_or_insert(parseDict, inFileName);
-    fileProgress.charsRemainingPerLine = list_new(free, NULL);
+    char *key = NULL;
+    size_t keyLength = 0;
+    FILE *keyFile = open_memstream(&key, &keyLength);
 
-    size_t *firstLineChars = malloc(sizeof(size_t));
-    *firstLineChars = 0;
-    list_append(fileProgress.charsRemainingPerLine, firstLineChars);
+    Iterator *includePathIter = NULL;
+    for (includePathIter = list_begin(includePath); iterator_gettable(includePathIter); iterator_next(includePathIter))
+    {
+        fprintf(keyFile, "-I%s\n", (char *)iterator_get(includePathIter));
+    }
+    iterator_free(includePathIter);
+
+    char *lastSlash = strrchr(inFileName, '/');
+    int directoryLength = (lastSlash != NULL) ? (int)(lastSlash - inFileName) : 0;
+    fprintf(keyFile, "%.*s/\n", directoryLength, inFileName);
+    fwrite(preamble, 1, preambleLength, keyFile);
+    fclose(keyFile);
+    return key;
+}
 
-    fileProgress.dict = parseDict;
+// find (precompiling it if necessary) the calling thread's warm copy of inFileName's preamble, if it has one
+// the returned PCH belongs to the thread, and is only valid until the next call
+struct PrecompiledHeader *compiler_warm_preamble(char *inFileName, size_t *preambleLengthOut, size_t *preambleLinesOut)
+{
+    *preambleLengthOut = 0;
+    *preambleLinesOut = 0;
 
-    pcc_context_t *parseContext = pcc_create(&fileProgress);
+    // stdin isn't read until preprocessing begins, and a missing file will be reported then
+    if (strcmp(inFileName, "stdin") == 0)
+    {
+        return NULL;
+    }
+    struct IncludedFile *mainFile = include_cache_lookup(includeCache, inFileName);
+    if (mainFile->contents == NULL)
+    {
+        return NULL;
+    }
 
-    int pid;
-    int preprocessorPipe[2] = {0};
-    if (pipe(preprocessorPipe) < 0)
+    size_t preambleLines = 0;
+    size_t preambleLength = preprocessor_preamble_length(mainFile->contents, mainFile->length, &preambleLines);
+    if (preambleLength == 0)
     {
-        InternalError("Unable to make pipe for preprocessor: %s", strerror(errno));
+        return NULL;
     }
 
-    pid = fork();
-    if (pid == -1)
+    if (warmPreambles == NULL)
     {
-        InternalError("Couldn't fork to run preprocessor!");
+        warmPreambles = hash_table_new(free, (MBCL_DATA_FREE_FUNCTION)pch_free, (ssize_t(*)(void *, void *))strcmp, hash_string, 64);
     }
-    else if (pid == 0)
+
+    char *key = compiler_preamble_key(inFileName, mainFile->contents, preambleLength);
+    struct PrecompiledHeader *pch = hash_table_find(warmPreambles, key);
+    if ((pch != NULL) && !pch_is_up_to_date(pch))
     {
-        dup2(preprocessorPipe[1], STDOUT_FILENO);
-        close(preprocessorPipe[0]); // duplicated
-        close(preprocessorPipe[1]); // not needed - we don't read from stdout
-        run_preprocessor(inFileName);
+        hash_table_remove(warmPreambles, key);
+        pch = NULL;
     }
-    else
+
+    if (pch == NULL)
     {
-        close(preprocessorPipe[1]); // we won't write to the preprocessor
-        dup2(preprocessorPipe[0], STDIN_FILENO);
-        close(preprocessorPipe[0]); // duplicated
-        if (waitpid(pid, NULL, 0) != pid)
+        pch = pch_precompile_preamble(mainFile, preambleLength);
+        if (pch == NULL)
         {
-            InternalError("Error waiting for preprocessor (pid %d): %s", pid, strerror(errno));
+            free(key);
+            return NULL;
         }
+
+        if (warmPreambles->size >= COMPILER_MAX_WARM_PREAMBLES)
+        {
+            hash_table_free(warmPreambles);
+            warmPreambles = hash_table_new(free, (MBCL_DATA_FREE_FUNCTION)pch_free, (ssize_t(*)(void *, void *))strcmp, hash_string, 64);
+        }
+        hash_table_insert(warmPreambles, key, pch);
+    }
+    else
+    {
+        log(LOG_INFO, "Reuse warm preamble of %s", inFileName);
+        free(key);
     }
 
-    fileProgress.f = stdin;
+    *preambleLengthOut = preambleLength;
+    *preambleLinesOut = preambleLines;
+    return pch;
+}
 
-    struct Ast *parsed = NULL;
-    struct Ast *translationUnit = NULL;
-    while (pcc_parse(parseContext, &translationUnit))
+FILE *compiler_open_output(struct TranslationUnit *unit)
+{
+    if (unit->outFile != NULL)
     {
-        parsed = AST_S(parsed, translationUnit);
+        return unit->outFile;
     }
 
-    pcc_destroy(parseContext);
+    if (strcmp(unit->outFileName, "stdout") == 0)
+    {
+        return stdout;
+    }
 
-    list_free(fileProgress.charsRemainingPerLine);
+    FILE *outFile = fopen(unit->outFileName, "wb");
+    if (outFile == NULL)
+    {
+        InternalError("Unable to open output file %s", unit->outFileName);
+    }
+    unit->resources.createdOutput = true;
+    return outFile;
+}
 
-    return parsed;
+void compiler_close_output(struct TranslationUnit *unit, FILE *outFile)
+{
+    if ((outFile != stdout) && (outFile != unit->outFile))
+    {
+        fclose(outFile);
+    }
 }
 
-int main(int argc, char **argv)
+// name of the dump file or directory called dumpName for unit
+char *compiler_dump_file_name(struct TranslationUnit *unit, char *dumpName)
 {
-    bool emitStart = false;
-    char *inFileName = "stdin";
-    char *outFileName = "stdout";
+    if (!unit->dumpsNamedAfterOutput)
+    {
+        return strdup(dumpName);
+    }
 
-    includePath = list_new(free, NULL);
+    char *fileName = malloc(strlen(unit->outFileName) + strlen(dumpName) + 2);
+    sprintf(fileName, "%s.%s", unit->outFileName, dumpName);
+    return fileName;
+}
 
-    int option;
-    while ((option = getopt(argc, argv, "i:o:O:l:r:c:v:I:s")) != EOF)
+// print and/or write out the calling thread's time report for unit, if it has one
+void compiler_finish_time_report(struct TranslationUnit *unit)
+{
+    struct TimeReport *report = time_report_get_active();
+    if (report == NULL)
     {
-        switch (option)
-        {
-        case 'i':
-            inFileName = optarg;
-            break;
+        return;
+    }
+    time_report_set_active(NULL);
 
-        case 'o':
-            outFileName = optarg;
-            break;
+    if (unit->timeReport)
+    {
+        fprintf(log_output(), "Time report for %s:\n", unit->inFileName);
+        time_report_print(report, log_output());
+    }
 
-        case 'v':
-        {
-            int level = atoi(optarg);
-            switch (level)
-            {
-            case LOG_DEBUG:
-            case LOG_INFO:
-            case LOG_WARNING:
-            case LOG_ERROR:
-            case LOG_FATAL:
-                set_log_level(level);
-                break;
+    if (unit->timeTraceFileName != NULL)
+    {
+        time_report_write_trace(report, unit->timeTraceFileName);
+    }
 
-            default:
-                log(LOG_ERROR, "Unexpected log level %d - expected %d-%d\n", level, LOG_DEBUG, LOG_FATAL);
-                usage();
-                exit(1);
-            }
-        }
-        break;
+    time_report_free(report);
+}
 
-        case 'I':
-        {
-            list_append(includePath, strdup(optarg));
-        }
-        break;
+// release everything a unit owns - after a fatal error this may be partway through compilation, so anything may be missing
+void compiler_release_unit(struct TranslationUnit *unit)
+{
+    struct TranslationUnitResources *owned = &unit->resources;
 
-        case 's':
-            emitStart = true;
-            break;
+    if (owned->codeFile != NULL)
+    {
+        fclose(owned->codeFile);
+    }
+    free(owned->generatedCode);
 
-        default:
-            log(LOG_ERROR, "Invalid argument flag \"%c\"", option);
-            usage();
-            exit(1);
-        }
+    if (owned->outFile != NULL)
+    {
+        compiler_close_output(unit, owned->outFile);
     }
 
-    log(LOG_INFO, "Output will be generated to %s", outFileName);
+    if (owned->machineInfo != NULL)
+    {
+        machine_info_free(owned->machineInfo);
+    }
+
+    compilation_cache_set_active(NULL);
+    if (owned->cache != NULL)
+    {
+        compilation_cache_free(owned->cache);
+    }
+
+    tac_set_arena(NULL);
+    if (owned->symbolTable != NULL)
+    {
+        symbol_table_free(owned->symbolTable);
+    }
+    source_location_table_set_active(NULL);
+    if (owned->sourceLocations != NULL)
+    {
+        source_location_table_free(owned->sourceLocations);
+    }
+    type_table_set_active(NULL);
+    if (owned->types != NULL)
+    {
+        type_table_free(owned->types);
+    }
+
+    if (owned->preprocessor != NULL)
+    {
+        preprocessor_free(owned->preprocessor);
+    }
+    if (owned->astArena != NULL)
+    {
+        arena_free(owned->astArena);
+    }
+    // strings in the AST (and therefore symbol table) may point into the precompiled header, so it goes last
+    if ((owned->pch != NULL) && !owned->pchIsWarm)
+    {
+        pch_free(owned->pch);
+    }
+
+    memset(owned, 0, sizeof(struct TranslationUnitResources));
+
+    if (temps != NULL)
+    {
+        temp_list_free(temps);
+        temps = NULL;
+    }
+    if (parseProgressStack != NULL)
+    {
+        stack_free(parseProgressStack);
+        parseProgressStack = NULL;
+    }
+    dump_set_options(NULL);
+}
+
+void compile_translation_unit(struct TranslationUnit *unit)
+{
+    char *inFileName = unit->inFileName;
+    char *outFileName = unit->outFileName;
+    struct TranslationUnitResources *owned = &unit->resources;
+    memset(owned, 0, sizeof(struct TranslationUnitResources));
+
+    log(LOG_INFO, "Compiling %s - output will be generated to %s", inFileName, outFileName);
 
     parseProgressStack = stack_new(NULL);
+    compiler_init_thread_state();
+    dump_set_options(&unit->dump);
+
+    if (unit->timeReport || (unit->timeTraceFileName != NULL))
+    {
+        time_report_set_active(time_report_new());
+    }
 
-    const int N_PARSE_DICT_BUCKETS = 1;
-    // parseDict = dictionary_new(N_PARSE_DICT_BUCKETS, (void *(*)(void *))strdup, hash_string, (ssize_t(*)(void *, void *))strcmp, free);
-    parseDict = dictionary_new(free, (ssize_t(*)(void *, void *))strcmp, hash_string, N_PARSE_DICT_BUCKETS, (void *(*)(void *))strdup);
+    // an unusable precompiled header isn't fatal - the header will just be #included as normal
+    size_t preambleLength = 0;
+    size_t preambleLines = 0;
+    if (unit->pchFileName != NULL)
+    {
+        time_report_begin("load precompiled header");
+        owned->pch = pch_load(unit->pchFileName);
+        time_report_end();
+    }
+    else if (unit->warmPreamble)
+    {
+        time_report_begin("warm preamble");
+        owned->pch = compiler_warm_preamble(inFileName, &preambleLength, &preambleLines);
+        owned->pchIsWarm = (owned->pch != NULL);
+        time_report_end();
+    }
+    struct PrecompiledHeader *pch = owned->pch;
+
+    struct Preprocessor *preprocessor = preprocessor_new(includePath, includeCache);
+    owned->preprocessor = preprocessor;
+    if (pch != NULL)
+    {
+        pch_apply_to_preprocessor(pch, preprocessor);
+    }
+    preprocessor_begin(preprocessor, inFileName);
+    if (preambleLength > 0)
+    {
+        preprocessor_skip(preprocessor, preambleLength, preambleLines);
+    }
+
+    // preprocessing is normally interleaved with parsing - do it all up front when the cache needs the full text or it is being timed separately
+    if ((unit->cacheDir != NULL) || (time_report_get_active() != NULL))
+    {
+        time_report_begin("preprocess");
+        preprocessor_read_all(preprocessor);
+        time_report_end();
+    }
+
+    struct CompilationCache *cache = NULL;
+    if (unit->cacheDir != NULL)
+    {
+        // the unit is keyed by its entire preprocessed text
+        cache = compilation_cache_new(unit->cacheDir);
+        owned->cache = cache;
+        compilation_cache_begin_unit(cache, unit, preprocessor->output.data, preprocessor->output.length, pch);
+
+        owned->outFile = compiler_open_output(unit);
+        if (compilation_cache_fetch(cache, CC_UNIT, cache->unitKey, owned->outFile))
+        {
+            log(LOG_INFO, "Reuse cached code for %s", inFileName);
+            compiler_release_unit(unit);
+            compiler_finish_time_report(unit);
+            return;
+        }
+        compiler_close_output(unit, owned->outFile);
+        owned->outFile = NULL;
+    }
 
-    struct Ast *program = parse_file(inFileName);
-    list_free(includePath);
+    time_report_begin("parse");
+    struct Arena *astArena = ast_arena_new();
+    owned->astArena = astArena;
+    struct Ast *program = parse_preprocessed(preprocessor, inFileName, astArena);
+    preprocessor_free(preprocessor);
+    owned->preprocessor = NULL;
 
-    // TODO: option to enable/disable ast dump
+    // the precompiled header's contents come before everything in the file itself
+    if (pch != NULL)
     {
-        FILE *astOutFile = NULL;
-        astOutFile = fopen("ast.dot", "wb");
+        program = AST_S(pch_build_ast(pch, astArena), program);
+    }
+    time_report_end();
+
+    if (dump_enabled(DUMP_AST))
+    {
+        char *astFileName = compiler_dump_file_name(unit, "ast.dot");
+        FILE *astOutFile = fopen(astFileName, "wb");
         if (astOutFile == NULL)
         {
-            InternalError("Unable to open output file ast.dot");
+            InternalError("Unable to open output file %s", astFileName);
         }
         ast_dump(astOutFile, program);
+        fclose(astOutFile);
+        free(astFileName);
     }
 
+    // TAC and functions refer back to the source through this table until the unit is finished
+    owned->sourceLocations = source_location_table_new();
+    source_location_table_set_active(owned->sourceLocations);
+    // as does every type used as the cast of a TAC operand
+    owned->types = type_table_new();
+    type_table_set_active(owned->types);
+
     log(LOG_INFO, "Generating symbol table from AST");
-    struct SymbolTable *theTable = walk_program(program);
+    time_report_begin("walk_program");
+    struct SymbolTable *theTable = symbol_table_new("Program");
+    owned->symbolTable = theTable;
+    walk_program(theTable, program);
+    time_report_end();
 
     // TODO: option to enable/disable symtab dump
     // log(LOG_DEBUG, "Symbol table before linearization/scope collapse:");
     // symbol_table_print(theTable, stderr, 0);
 
-    // TODO: option to enable/disable symtab dump
+    if (dump_enabled(DUMP_SYMTAB))
     {
-        FILE *symtabOutFile = NULL;
-        symtabOutFile = fopen("symtab.dot", "wb");
+        char *symtabFileName = compiler_dump_file_name(unit, "symtab.dot");
+        FILE *symtabOutFile = fopen(symtabFileName, "wb");
         if (symtabOutFile == NULL)
         {
-            InternalError("Unable to open output file symtab.dot");
+            InternalError("Unable to open output file %s", symtabFileName);
         }
         symbol_table_dump_dot(symtabOutFile, theTable, false);
+        fclose(symtabOutFile);
+        free(symtabFileName);
     }
 
+    time_report_begin("add_drops");
     add_drops(theTable);
+    time_report_end();
 
     // symbol_table_print(theTable, stderr, 0);
 
     log(LOG_INFO, "Collapsing scopes");
-    symbol_table_collapse_scopes(theTable, parseDict);
+    time_report_begin("collapse_scopes");
+    symbol_table_collapse_scopes(theTable, stringInterner);
+    time_report_end();
 
     // generate_ssa(theTable);
 
@@ -252,17 +505,21 @@ int main(int argc, char **argv)
     // log(LOG_DEBUG, "Symbol table after linearization/scope collapse:");
     // symbol_table_print(theTable, stderr, true);
 
-    symbol_table_print_cfgs(theTable, "control-flows");
+    if (dump_enabled(DUMP_CFG))
+    {
+        char *cfgDirName = compiler_dump_file_name(unit, "control-flows");
+        symbol_table_print_cfgs(theTable, cfgDirName);
+        free(cfgDirName);
+    }
 
-    FILE *outFile = stdout;
+    owned->outFile = compiler_open_output(unit);
 
-    if (strcmp(outFileName, "stdout") != 0)
+    // when caching, buffer the generated code so the whole unit can be stored once it is complete
+    FILE *codeFile = owned->outFile;
+    if (cache != NULL)
     {
-        outFile = fopen(outFileName, "wb");
-        if (outFile == NULL)
-        {
-            InternalError("Unable to open output file %s", outFileName);
-        }
+        owned->codeFile = open_memstream(&owned->generatedCode, &owned->generatedCodeSize);
+        codeFile = owned->codeFile;
     }
 
     log(LOG_INFO, "Generating code");
@@ -275,10 +532,10 @@ int main(int argc, char **argv)
 
         for (size_t asmIndex = 0; boilerplateAsm1[asmIndex] != NULL; asmIndex++)
         {
-            fprintf(outFile, "%s\n", boilerplateAsm1[asmIndex]);
+            fprintf(codeFile, "%s\n", boilerplateAsm1[asmIndex]);
         }
 
-        fprintf(outFile, "\t.file 1 \"%s\"\n", inFileName);
+        fprintf(codeFile, "\t.file 1 \"%s\"\n", inFileName);
 
         char *boilerplateAsm2[] = {
             "\t.attribute unaligned_access, 0",
@@ -286,30 +543,496 @@ int main(int argc, char **argv)
 
         for (size_t asmIndex = 0; boilerplateAsm2[asmIndex] != NULL; asmIndex++)
         {
-            fprintf(outFile, "%s\n", boilerplateAsm2[asmIndex]);
+            fprintf(codeFile, "%s\n", boilerplateAsm2[asmIndex]);
         }
 
-        fprintf(outFile, "\t.file 2 \"%s\"\n", inFileName);
+        fprintf(codeFile, "\t.file 2 \"%s\"\n", inFileName);
     }
 
-    setupMachineInfo = riscv_setup_machine_info;
     struct MachineInfo *info = setupMachineInfo();
+    owned->machineInfo = info;
 
+    time_report_begin("regalloc");
     allocate_registers_for_program(theTable, info);
+    time_report_end();
+
+    // per-function cache keys depend on register allocation results for the whole program
+    if (cache != NULL)
+    {
+        compilation_cache_begin_codegen(cache, theTable);
+        compilation_cache_set_active(cache);
+    }
 
     // symbol_table_print(theTable, stderr, true);
 
-    generate_code_for_program(theTable, outFile, info, riscv_emit_prologue, riscv_emit_epilogue, riscv_generate_code_for_basic_block, emitStart);
+    time_report_begin("codegen");
+    generate_code_for_program(theTable, codeFile, info, riscv_emit_prologue, riscv_emit_epilogue, riscv_generate_code_for_basic_block, unit->emitStart);
+    time_report_end();
+
+    if (cache != NULL)
+    {
+        compilation_cache_set_active(NULL);
+        fclose(owned->codeFile);
+        owned->codeFile = NULL;
+        fwrite(owned->generatedCode, 1, owned->generatedCodeSize, owned->outFile);
+        compilation_cache_store(cache, CC_UNIT, cache->unitKey, owned->generatedCode, owned->generatedCodeSize);
+        log(LOG_INFO, "Reused cached code for %zu of %zu functions", cache->nFunctionHits, cache->nFunctionHits + cache->nFunctionMisses);
+    }
+
+    compiler_release_unit(unit);
+    compiler_finish_time_report(unit);
+}
+
+void compiler_free_thread_state()
+{
+    if (includeCache != NULL)
+    {
+        include_cache_free(includeCache);
+        includeCache = NULL;
+    }
+
+    if (warmPreambles != NULL)
+    {
+        hash_table_free(warmPreambles);
+        warmPreambles = NULL;
+    }
+
+    if (stringInterner != NULL)
+    {
+        string_interner_free(stringInterner);
+        stringInterner = NULL;
+    }
+
+    scope_free_lookup_generations();
+}
+
+// generate the output file name for an input file when compiling multiple files at once: foo/bar.sb -> outDir/bar.S
+char *output_file_name_for(char *inFileName, char *outDir)
+{
+    char *baseName = strrchr(inFileName, '/');
+    baseName = (baseName != NULL) ? baseName + 1 : inFileName;
+    size_t baseNameLength = strlen(baseName);
+    char *extension = strrchr(baseName, '.');
+    if (extension != NULL)
+    {
+        baseNameLength = extension - baseName;
+    }
+
+    char *outFileName = malloc(strlen(outDir) + baseNameLength + 4);
+    sprintf(outFileName, "%s/%.*s.S", outDir, (int)baseNameLength, baseName);
+    return outFileName;
+}
+
+/*
+ * Worker pool for compiling multiple translation units in parallel
+ * Each worker pulls the next unit off a shared index, capturing its logs so they can be printed in input order
+ */
+struct CompilationQueue
+{
+    struct TranslationUnit *units;
+    size_t nUnits;
+    size_t nextUnit;
+    pthread_mutex_t lock;
+};
+
+void compile_translation_unit_captured(struct TranslationUnit *unit)
+{
+    FILE *logFile = open_memstream(&unit->logBuffer, &unit->logBufferSize);
+    log_set_output(logFile);
+
+    // the compile server has a handler of its own around the whole request
+    jmp_buf *outerFatalErrorHandler = log_get_fatal_handler();
+    jmp_buf fatalErrorHandler;
+    if (setjmp(fatalErrorHandler) == 0)
+    {
+        log_set_fatal_handler(&fatalErrorHandler);
+        compile_translation_unit(unit);
+        unit->status = 0;
+    }
+    else
+    {
+        // a fatal error was raised partway through - free what the unit owns, and don't leave behind partial output
+        unit->status = 1;
+        bool createdOutput = unit->resources.createdOutput;
+        compiler_release_unit(unit);
+        if (createdOutput)
+        {
+            unlink(unit->outFileName);
+        }
+
+        struct TimeReport *report = time_report_get_active();
+        if (report != NULL)
+        {
+            time_report_set_active(NULL);
+            time_report_free(report);
+        }
+    }
+
+    log_set_fatal_handler(outerFatalErrorHandler);
+    log_set_output(NULL);
+    fclose(logFile);
+}
+
+void *compilation_worker(void *data)
+{
+    struct CompilationQueue *queue = data;
+    while (true)
+    {
+        pthread_mutex_lock(&queue->lock);
+        size_t unitIndex = queue->nextUnit++;
+        pthread_mutex_unlock(&queue->lock);
+
+        if (unitIndex >= queue->nUnits)
+        {
+            break;
+        }
+
+        compile_translation_unit_captured(&queue->units[unitIndex]);
+    }
+
+    compiler_free_thread_state();
+    return NULL;
+}
+
+int compile_translation_units_parallel(struct TranslationUnit *units, size_t nUnits, size_t nJobs, FILE *logOutFile)
+{
+    struct CompilationQueue queue = {0};
+    queue.units = units;
+    queue.nUnits = nUnits;
+    pthread_mutex_init(&queue.lock, NULL);
+
+    nJobs = MIN(nJobs, nUnits);
+    pthread_t *workers = malloc(nJobs * sizeof(pthread_t));
+    for (size_t workerIndex = 0; workerIndex < nJobs; workerIndex++)
+    {
+        if (pthread_create(&workers[workerIndex], NULL, compilation_worker, &queue) != 0)
+        {
+            InternalError("Unable to create compilation worker thread");
+        }
+    }
+
+    for (size_t workerIndex = 0; workerIndex < nJobs; workerIndex++)
+    {
+        pthread_join(workers[workerIndex], NULL);
+    }
+    free(workers);
+    pthread_mutex_destroy(&queue.lock);
+
+    // report in input order regardless of which worker finished first
+    int status = 0;
+    for (size_t unitIndex = 0; unitIndex < nUnits; unitIndex++)
+    {
+        struct TranslationUnit *unit = &units[unitIndex];
+        fwrite(unit->logBuffer, 1, unit->logBufferSize, logOutFile);
+        free(unit->logBuffer);
+        unit->logBuffer = NULL;
+        if (unit->status != 0)
+        {
+            fprintf(logOutFile, "Compilation of %s failed\n", unit->inFileName);
+            status = 1;
+        }
+    }
+
+    return status;
+}
+
+// with multiple input files, outputs are named after the inputs' base names - parallel workers must not write to the same one
+bool compiler_output_names_unique(struct CompilerOptions *options)
+{
+    bool unique = true;
+    HashTable *inputsByOutput = hash_table_new(free, NULL, (ssize_t(*)(void *, void *))strcmp, hash_string, options->inputFiles->size);
+    Iterator *inputIter = NULL;
+    for (inputIter = list_begin(options->inputFiles); iterator_gettable(inputIter); iterator_next(inputIter))
+    {
+        char *inFileName = iterator_get(inputIter);
+        char *outFileName = output_file_name_for(inFileName, (options->outDir != NULL) ? options->outDir : ".");
+        char *otherInput = hash_table_find(inputsByOutput, outFileName);
+        if (otherInput != NULL)
+        {
+            log(LOG_ERROR, "%s and %s would both be compiled to %s - rename one or compile them separately", otherInput, inFileName, outFileName);
+            unique = false;
+            free(outFileName);
+            break;
+        }
+        hash_table_insert(inputsByOutput, outFileName, inFileName);
+    }
+    iterator_free(inputIter);
+    hash_table_free(inputsByOutput);
+
+    return unique;
+}
+
+bool compiler_options_parse(struct CompilerOptions *options, int argc, char **argv)
+{
+    memset(options, 0, sizeof(struct CompilerOptions));
+    options->nJobs = 1;
+    options->includePath = list_new(free, NULL);
+    options->inputFiles = list_new(NULL, NULL);
+
+    struct option longOptions[] = {
+        {"server", required_argument, NULL, 'S'},
+        {"emit-pch", required_argument, NULL, 'P'},
+        {"include-pch", required_argument, NULL, 'H'},
+        {"cache-dir", required_argument, NULL, 'C'},
+        {"dump", required_argument, NULL, 'D'},
+        {"dump-filter", required_argument, NULL, 'F'},
+        {NULL, 0, NULL, 0},
+    };
+
+    // options may be parsed more than once per process (by the compile server) - fully reset getopt's state
+    optind = 0;
+    int option;
+    while ((option = getopt_long(argc, argv, "i:o:O:l:r:c:v:I:sj:d:f:", longOptions, NULL)) != EOF)
+    {
+        switch (option)
+        {
+        case 'i':
+            list_append(options->inputFiles, optarg);
+            break;
+
+        case 'o':
+            options->outFileName = optarg;
+            break;
+
+        case 'd':
+            options->outDir = optarg;
+            break;
 
-    machine_info_free(info);
+        case 'S':
+            options->serverSocket = optarg;
+            break;
 
-    symbol_table_free(theTable);
+        case 'P':
+            options->emitPch = optarg;
+            break;
+
+        case 'H':
+            options->includePch = optarg;
+            break;
+
+        case 'C':
+            options->cacheDir = optarg;
+            break;
+
+        case 'D':
+            if (!dump_options_parse(&options->dump, optarg))
+            {
+                return false;
+            }
+            break;
+
+        case 'F':
+            options->dump.functionFilter = optarg;
+            break;
+
+        case 'f':
+            if (strcmp(optarg, "time-report") == 0)
+            {
+                options->timeReport = true;
+            }
+            else if (strcmp(optarg, "time-trace") == 0)
+            {
+                options->timeTrace = true;
+            }
+            else if (strncmp(optarg, "time-trace=", strlen("time-trace=")) == 0)
+            {
+                options->timeTrace = true;
+                options->timeTraceFileName = optarg + strlen("time-trace=");
+            }
+            else
+            {
+                log(LOG_ERROR, "Unknown option -f%s", optarg);
+                return false;
+            }
+            break;
 
-    fclose(outFile);
-    ast_free(program);
+        case 'j':
+        {
+            int jobs = atoi(optarg);
+            if (jobs < 1)
+            {
+                log(LOG_ERROR, "Invalid job count %s - expected at least 1", optarg);
+                return false;
+            }
+            options->nJobs = jobs;
+        }
+        break;
+
+        case 'v':
+        {
+            int level = atoi(optarg);
+            switch (level)
+            {
+            case LOG_DEBUG:
+            case LOG_INFO:
+            case LOG_WARNING:
+            case LOG_ERROR:
+            case LOG_FATAL:
+                set_log_level(level);
+                break;
+
+            default:
+                log(LOG_ERROR, "Unexpected log level %d - expected %d-%d\n", level, LOG_DEBUG, LOG_FATAL);
+                return false;
+            }
+        }
+        break;
+
+        case 'I':
+        {
+            list_append(options->includePath, strdup(optarg));
+        }
+        break;
+
+        case 's':
+            options->emitStart = true;
+            break;
+
+        default:
+            log(LOG_ERROR, "Invalid argument flag \"%c\"", option);
+            return false;
+        }
+    }
+
+    if (options->inputFiles->size == 0)
+    {
+        list_append(options->inputFiles, "stdin");
+    }
+
+    if ((options->inputFiles->size > 1) && (options->outFileName != NULL))
+    {
+        log(LOG_ERROR, "-o can't be used with multiple input files - use -d to specify an output directory");
+        return false;
+    }
+
+    if ((options->inputFiles->size > 1) && (options->timeTraceFileName != NULL))
+    {
+        log(LOG_ERROR, "-ftime-trace=file can't be used with multiple input files - use -ftime-trace to write a trace per output file");
+        return false;
+    }
+
+    if ((options->inputFiles->size > 1) && !compiler_output_names_unique(options))
+    {
+        return false;
+    }
+
+    return true;
+}
+
+void compiler_options_deinit(struct CompilerOptions *options)
+{
+    list_free(options->inputFiles);
+    list_free(options->includePath);
+}
+
+struct TranslationUnit *compiler_create_units(struct CompilerOptions *options, size_t *nUnitsOut)
+{
+    size_t nUnits = options->inputFiles->size;
+    struct TranslationUnit *units = malloc(nUnits * sizeof(struct TranslationUnit));
+    memset(units, 0, nUnits * sizeof(struct TranslationUnit));
+
+    size_t unitIndex = 0;
+    Iterator *inputIter = NULL;
+    for (inputIter = list_begin(options->inputFiles); iterator_gettable(inputIter); iterator_next(inputIter))
+    {
+        struct TranslationUnit *unit = &units[unitIndex++];
+        unit->inFileName = iterator_get(inputIter);
+        unit->emitStart = options->emitStart;
+        unit->pchFileName = options->includePch;
+        unit->cacheDir = options->cacheDir;
+        unit->dump = options->dump;
+        // outputs are already unique with multiple inputs (see compiler_output_names_unique), so dumps named after them are too
+        unit->dumpsNamedAfterOutput = (nUnits > 1);
+        unit->timeReport = options->timeReport;
+        if (nUnits == 1)
+        {
+            unit->outFileName = strdup((options->outFileName != NULL) ? options->outFileName : "stdout");
+        }
+        else
+        {
+            unit->outFileName = output_file_name_for(unit->inFileName, (options->outDir != NULL) ? options->outDir : ".");
+        }
+
+        if (options->timeTraceFileName != NULL)
+        {
+            unit->timeTraceFileName = strdup(options->timeTraceFileName);
+        }
+        else if (options->timeTrace)
+        {
+            // when generating to stdout, name the trace after the input file instead
+            char *traceBaseName = (strcmp(unit->outFileName, "stdout") == 0) ? unit->inFileName : unit->outFileName;
+            unit->timeTraceFileName = malloc(strlen(traceBaseName) + strlen(".json") + 1);
+            sprintf(unit->timeTraceFileName, "%s.json", traceBaseName);
+        }
+    }
+    iterator_free(inputIter);
+
+    *nUnitsOut = nUnits;
+    return units;
+}
+
+void compiler_free_units(struct TranslationUnit *units, size_t nUnits)
+{
+    for (size_t unitIndex = 0; unitIndex < nUnits; unitIndex++)
+    {
+        free(units[unitIndex].outFileName);
+        free(units[unitIndex].timeTraceFileName);
+        free(units[unitIndex].logBuffer);
+    }
+    free(units);
+}
+
+int main(int argc, char **argv)
+{
+    struct CompilerOptions options;
+    if (!compiler_options_parse(&options, argc, argv))
+    {
+        usage(stdout);
+        exit(1);
+    }
+    includePath = options.includePath;
+
+    setupMachineInfo = riscv_setup_machine_info;
+
+    if (options.emitPch != NULL)
+    {
+        if (options.outFileName == NULL)
+        {
+            log(LOG_ERROR, "--emit-pch requires an output file (-o)");
+            usage(stdout);
+            exit(1);
+        }
+
+        int status = pch_emit(options.emitPch, options.outFileName) ? 0 : 1;
+        compiler_free_thread_state();
+        compiler_options_deinit(&options);
+        return status;
+    }
+
+    if (options.serverSocket != NULL)
+    {
+        int status = compile_server_run(options.serverSocket);
+        compiler_options_deinit(&options);
+        return status;
+    }
+
+    size_t nUnits = 0;
+    struct TranslationUnit *units = compiler_create_units(&options, &nUnits);
+
+    int status = 0;
+    if (nUnits == 1)
+    {
+        // compile a lone file directly on the main thread, with logs going straight to stdout
+        compile_translation_unit(&units[0]);
+        compiler_free_thread_state();
+    }
+    else
+    {
+        status = compile_translation_units_parallel(units, nUnits, options.nJobs, stdout);
+    }
 
-    // TempListFree(temps);
-    dictionary_free(parseDict);
+    compiler_free_units(units, nUnits);
+    compiler_options_deinit(&options);
 
-    return 0;
+    return status;
 }
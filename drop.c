@@ -59,7 +59,7 @@ void add_drops_to_scope(struct Scope *scope, struct RegallocMetadata *regalloc)
 
     Deque *drops = deque_new(NULL);
 
-    for (memberIter = set_begin(scope->entries); iterator_gettable(memberIter); iterator_next(memberIter))
+    for (memberIter = deque_front(scope->entries); iterator_gettable(memberIter); iterator_next(memberIter))
     {
         struct ScopeMember *member = iterator_get(memberIter);
         switch (member->type)
@@ -72,7 +72,7 @@ void add_drops_to_scope(struct Scope *scope, struct RegallocMetadata *regalloc)
         case E_ARGUMENT:
         {
             struct VariableEntry *dropCandidate = member->entry;
-            if ((dropCandidate->name[0] != '.') && (type_is_struct_object(&dropCandidate->type) || type_is_enum_object(&dropCandidate->type)))
+            if ((dropCandidate->name[0] != '.') && (type_is_struct_object(dropCandidate->type) || type_is_enum_object(dropCandidate->type)))
             {
                 deque_push_back(drops, dropCandidate);
             }
@@ -140,7 +140,7 @@ void add_drops_to_scope(struct Scope *scope, struct RegallocMetadata *regalloc)
         }
         else
         {
-            log_tree(LOG_FATAL, &lastLine->correspondingTree, "Last line in block is not a jump");
+            log_loc(LOG_FATAL, lastLine->location, "Last line in block is not a jump");
         }
     }
 
@@ -158,7 +158,7 @@ void add_drops_to_scope(struct Scope *scope, struct RegallocMetadata *regalloc)
             struct TACLine *dropLine = new_tac_line(TT_METHOD_CALL, &dummyDropTree);
             dropLine->operands.methodCall.methodName = DROP_TRAIT_FUNCTION_NAME;
             dropLine->operands.methodCall.arguments = deque_new(NULL);
-            struct TACOperand *dropArg = malloc(sizeof(struct TACOperand));
+            struct TACOperand *dropArg = tac_operand_new();
 
             tac_operand_populate_from_variable(dropArg, drop);
             *dropArg = *get_addr_of_operand(&dummyDropTree, latestBlockInScope, scope, &maxIndex, dropArg);
@@ -184,7 +184,12 @@ void add_drops_to_function(struct FunctionEntry *function)
         return;
     }
     log(LOG_DEBUG, "Adding drops to function %s", function->name);
+    struct Arena *previousTacArena = tac_set_arena(function->tacArena);
     add_drops_to_scope(function->mainScope, &function->regalloc);
+    tac_set_arena(previousTacArena);
+
+    // the drops we just added may be the only calls to methods of generic instances
+    type_entry_instantiate_callees(function);
 }
 
 struct TACLine *generate_subdrop_tac(struct TACOperand *dropArg, struct Type *droppedType)
@@ -196,12 +201,12 @@ struct TACLine *generate_subdrop_tac(struct TACOperand *dropArg, struct Type *dr
     subDropLine->operands.methodCall.methodName = DROP_TRAIT_FUNCTION_NAME;
     subDropLine->operands.methodCall.arguments = deque_new(NULL);
 
-    struct TACOperand *dropArgCopy = malloc(sizeof(struct TACOperand));
+    struct TACOperand *dropArgCopy = tac_operand_new();
     *dropArgCopy = *dropArg;
 
     // cheesy sort of hack to get later calls to tac_operand_get_type() on this operand to return the correct type
     subDropLine->operands.methodCall.calledOn.permutation = VP_LITERAL_VAL;
-    subDropLine->operands.methodCall.calledOn.castAsType = *droppedType;
+    subDropLine->operands.methodCall.calledOn.castAsType = type_intern(droppedType);
 
     deque_push_back(subDropLine->operands.methodCall.arguments, dropArgCopy);
 
@@ -218,7 +223,7 @@ void implement_default_drop_for_struct(struct StructDesc *theStruct, struct Func
     for (size_t fieldIdx = 0; fieldIdx < theStruct->fieldLocations->size; fieldIdx++)
     {
         struct StructField *field = deque_at(theStruct->fieldLocations, fieldIdx);
-        if (type_is_struct_object(&field->variable->type) || type_is_enum_object(&field->variable->type))
+        if (type_is_struct_object(field->variable->type) || type_is_enum_object(field->variable->type))
         {
             struct Ast dummyDropTree = {0};
             dummyDropTree.sourceFile = "intrinsic";
@@ -229,14 +234,14 @@ void implement_default_drop_for_struct(struct StructDesc *theStruct, struct Func
 
             // lea the field, pass as argument to subdrop
             struct TACLine *fieldLeaLine = new_tac_line(TT_FIELD_LEA, &dummyDropTree);
-            struct Type pointerType = type_duplicate_non_pointer(&field->variable->type);
+            struct Type pointerType = type_duplicate_non_pointer(field->variable->type);
             pointerType.pointerLevel++;
             tac_operand_populate_as_temp(dropFunction->mainScope, &fieldLeaLine->operands.fieldLoad.destination, &pointerType);
             tac_operand_populate_from_variable(&fieldLeaLine->operands.fieldLoad.source, scope_lookup_var_by_string(dropFunction->mainScope, "self"));
             fieldLeaLine->operands.fieldLoad.fieldName = field->variable->name;
             basic_block_append(dropBlock, fieldLeaLine, &dropTacIndex);
 
-            basic_block_append(dropBlock, generate_subdrop_tac(&fieldLeaLine->operands.fieldLoad.destination, &field->variable->type), &dropTacIndex);
+            basic_block_append(dropBlock, generate_subdrop_tac(&fieldLeaLine->operands.fieldLoad.destination, field->variable->type), &dropTacIndex);
         }
     }
 
@@ -261,11 +266,11 @@ void enum_default_drop_add_match_and_drop_for_member(struct FunctionEntry *dropF
     struct TACLine *matchJump = new_tac_line(TT_BEQ, &dummyDropTree);
 
     matchJump->operands.conditionalBranch.sourceA.name.val = member->numerical;
-    matchJump->operands.conditionalBranch.sourceA.castAsType = *tac_operand_get_type(matchedAgainstNumerical);
+    matchJump->operands.conditionalBranch.sourceA.castAsType = type_intern(tac_operand_get_type(matchedAgainstNumerical));
     matchJump->operands.conditionalBranch.sourceA.permutation = VP_LITERAL_VAL;
 
     matchJump->operands.conditionalBranch.sourceB = *matchedAgainstNumerical;
-    matchJump->operands.conditionalBranch.sourceB.castAsType.basicType = VT_U64; // TODO: size_t definition?
+    matchJump->operands.conditionalBranch.sourceB.castAsType = type_intern_basic(VT_U64, 0); // TODO: size_t definition?
 
     matchJump->operands.conditionalBranch.label = dropCaseBlock->labelNum;
     basic_block_append(dropMatchBlock, matchJump, dropTacIndex);
@@ -276,7 +281,7 @@ void enum_default_drop_add_match_and_drop_for_member(struct FunctionEntry *dropF
     tac_operand_populate_from_variable(&compAddrOfEnumData->operands.arithmetic.sourceA, scope_lookup_var_by_string(dropFunction->mainScope, "self"));
     compAddrOfEnumData->operands.arithmetic.sourceB.name.val = sizeof(size_t);
     compAddrOfEnumData->operands.arithmetic.sourceB.permutation = VP_LITERAL_VAL;
-    compAddrOfEnumData->operands.arithmetic.sourceB.castAsType.basicType = select_variable_type_for_number(sizeof(size_t));
+    compAddrOfEnumData->operands.arithmetic.sourceB.castAsType = type_intern_basic(select_variable_type_for_number(sizeof(size_t)), 0);
 
     struct Type memberPointerType = type_duplicate_non_pointer(&member->type);
     memberPointerType.pointerLevel++;
@@ -348,6 +353,11 @@ void implement_default_drop_for_non_generic_type(struct TypeEntry *type, struct
     struct TraitEntry *dropTrait = type_entry_lookup_trait(type, DROP_TRAIT_NAME);
     if (dropTrait != NULL)
     {
+        // the instance may predate the implementation of Drop for its base, in which case its drop hasn't been instantiated yet
+        if (type->genericType == G_INSTANCE)
+        {
+            type_entry_instantiate_implemented(type, DROP_TRAIT_FUNCTION_NAME);
+        }
         return;
     }
 
@@ -360,6 +370,7 @@ void implement_default_drop_for_non_generic_type(struct TypeEntry *type, struct
     scope_insert(type->implemented, DROP_TRAIT_FUNCTION_NAME, dropFunction, E_FUNCTION, A_PRIVATE);
     dropFunction->implementedFor = type;
 
+    struct Arena *previousTacArena = tac_set_arena(dropFunction->tacArena);
     switch (type->genericType)
     {
     case G_NONE:
@@ -383,6 +394,7 @@ void implement_default_drop_for_non_generic_type(struct TypeEntry *type, struct
         InternalError("Generic base type %s seen in implement_default_drop_for_non_generic_type", type_entry_name(type));
         break;
     }
+    tac_set_arena(previousTacArena);
 
     type_entry_add_implemented(type, dropFunction, A_PRIVATE);
 
@@ -392,6 +404,12 @@ void implement_default_drop_for_non_generic_type(struct TypeEntry *type, struct
 
     type_entry_verify_trait(&dummyDropTraitTree, type, dropTrait, implementedPrivate, implementedPublic);
 
+    // drops of members which are generic instances are called from nowhere else
+    if (!type_is_generic(&type->type))
+    {
+        type_entry_instantiate_callees(dropFunction);
+    }
+
     switch (type->genericType)
     {
     case G_NONE:
@@ -435,7 +453,7 @@ void implement_default_drops_for_scope(struct Scope *scope)
 {
     // iterate all scope members, recursing. If a member is a type, make sure it has an implementaiton of Drop
     Iterator *memberIter = NULL;
-    for (memberIter = set_begin(scope->entries); iterator_gettable(memberIter); iterator_next(memberIter))
+    for (memberIter = deque_front(scope->entries); iterator_gettable(memberIter); iterator_next(memberIter))
     {
         struct ScopeMember *member = iterator_get(memberIter);
         switch (member->type)
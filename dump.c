@@ -0,0 +1,82 @@
+#include "dump.h"
+
+#include <fnmatch.h>
+#include <string.h>
+
+#include "log.h"
+
+_Thread_local struct DumpOptions *currentDumpOptions = NULL;
+
+struct DumpKindName
+{
+    char *name;
+    enum DUMP_KIND kind;
+};
+
+struct DumpKindName dumpKindNames[] = {
+    {"ast", DUMP_AST},
+    {"symtab", DUMP_SYMTAB},
+    {"cfg", DUMP_CFG},
+    {"tac-comments", DUMP_TAC_COMMENTS},
+    {NULL, 0},
+};
+
+bool dump_options_parse(struct DumpOptions *options, char *list)
+{
+    const char *kindStart = list;
+    while (*kindStart != '\0')
+    {
+        size_t kindLength = strcspn(kindStart, ",");
+
+        bool found = false;
+        for (size_t kindIndex = 0; dumpKindNames[kindIndex].name != NULL; kindIndex++)
+        {
+            if ((strlen(dumpKindNames[kindIndex].name) == kindLength) && (strncmp(dumpKindNames[kindIndex].name, kindStart, kindLength) == 0))
+            {
+                options->enabled |= dumpKindNames[kindIndex].kind;
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+        {
+            log(LOG_ERROR, "Unknown dump kind \"%.*s\" - expected one or more of ast,symtab,cfg,tac-comments", (int)kindLength, kindStart);
+            return false;
+        }
+
+        kindStart += kindLength;
+        if (*kindStart == ',')
+        {
+            kindStart++;
+        }
+    }
+
+    return true;
+}
+
+void dump_set_options(struct DumpOptions *options)
+{
+    currentDumpOptions = options;
+}
+
+bool dump_enabled(enum DUMP_KIND kind)
+{
+    return (currentDumpOptions != NULL) && (currentDumpOptions->enabled & kind);
+}
+
+bool dump_function_enabled(enum DUMP_KIND kind, char *functionName)
+{
+    if (!dump_enabled(kind))
+    {
+        return false;
+    }
+
+    if (currentDumpOptions->functionFilter == NULL)
+    {
+        return true;
+    }
+
+    // code outside of any function (such as global initializers) is only dumped when there is no filter
+    return (functionName != NULL) && (fnmatch(currentDumpOptions->functionFilter, functionName, 0) == 0);
+}
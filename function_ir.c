@@ -0,0 +1,206 @@
+#include "function_ir.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "symtab_basicblock.h"
+#include "symtab_function.h"
+
+// lay out the lines of every block of the function in one array, in the order of the function's block list
+void function_ir_lay_out_lines(struct FunctionIr *ir, struct FunctionEntry *function)
+{
+    Iterator *blockRunner = NULL;
+    for (blockRunner = list_begin(function->BasicBlockList); iterator_gettable(blockRunner); iterator_next(blockRunner))
+    {
+        struct BasicBlock *block = iterator_get(blockRunner);
+        ir->nLines += block->TACList->size;
+    }
+    iterator_free(blockRunner);
+
+    ir->lines = malloc(ir->nLines * sizeof(struct TACLine *));
+
+    size_t lineIndex = 0;
+    for (blockRunner = list_begin(function->BasicBlockList); iterator_gettable(blockRunner); iterator_next(blockRunner))
+    {
+        struct BasicBlock *block = iterator_get(blockRunner);
+        struct IrBlock *irBlock = &ir->blocks[block->labelNum];
+        if (irBlock->block != NULL)
+        {
+            InternalError("Duplicate block label number %zd in function %s", block->labelNum, function->name);
+        }
+        irBlock->block = block;
+        irBlock->firstLine = lineIndex;
+        irBlock->nLines = block->TACList->size;
+        ir->layout[ir->nLaidOut++] = block->labelNum;
+
+        Iterator *tacRunner = NULL;
+        for (tacRunner = list_begin(block->TACList); iterator_gettable(tacRunner); iterator_next(tacRunner))
+        {
+            ir->lines[lineIndex++] = iterator_get(tacRunner);
+        }
+        iterator_free(tacRunner);
+    }
+    iterator_free(blockRunner);
+}
+
+// build both CSR edge arrays from the blocks' successor sets, counting first so each is allocated exactly once
+void function_ir_build_edges(struct FunctionIr *ir, struct FunctionEntry *function)
+{
+    ir->successorStarts = calloc(ir->nBlocks + 1, sizeof(size_t));
+    ir->predecessorStarts = calloc(ir->nBlocks + 1, sizeof(size_t));
+
+    size_t nEdges = 0;
+    for (size_t labelNum = 0; labelNum < ir->nBlocks; labelNum++)
+    {
+        if (ir->blocks[labelNum].block == NULL)
+        {
+            continue;
+        }
+
+        Iterator *successorRunner = NULL;
+        for (successorRunner = set_begin(ir->blocks[labelNum].block->successors); iterator_gettable(successorRunner); iterator_next(successorRunner))
+        {
+            ssize_t *successorLabel = iterator_get(successorRunner);
+            if ((*successorLabel < 0) || ((size_t)*successorLabel >= ir->nBlocks) || (ir->blocks[*successorLabel].block == NULL))
+            {
+                InternalError("Block %zu of function %s has successor %zd which does not exist", labelNum, function->name, *successorLabel);
+            }
+            ir->successorStarts[labelNum + 1]++;
+            ir->predecessorStarts[*successorLabel + 1]++;
+            nEdges++;
+        }
+        iterator_free(successorRunner);
+    }
+
+    for (size_t labelNum = 0; labelNum < ir->nBlocks; labelNum++)
+    {
+        ir->successorStarts[labelNum + 1] += ir->successorStarts[labelNum];
+        ir->predecessorStarts[labelNum + 1] += ir->predecessorStarts[labelNum];
+    }
+
+    ir->successors = malloc(nEdges * sizeof(size_t));
+    ir->predecessors = malloc(nEdges * sizeof(size_t));
+
+    // visiting blocks in label order leaves every block's successors and predecessors sorted by label
+    size_t *nPredecessorsPlaced = calloc(ir->nBlocks, sizeof(size_t));
+    for (size_t labelNum = 0; labelNum < ir->nBlocks; labelNum++)
+    {
+        if (ir->blocks[labelNum].block == NULL)
+        {
+            continue;
+        }
+
+        size_t successorIndex = ir->successorStarts[labelNum];
+        Iterator *successorRunner = NULL;
+        for (successorRunner = set_begin(ir->blocks[labelNum].block->successors); iterator_gettable(successorRunner); iterator_next(successorRunner))
+        {
+            size_t successorLabel = *(ssize_t *)iterator_get(successorRunner);
+            ir->successors[successorIndex++] = successorLabel;
+            ir->predecessors[ir->predecessorStarts[successorLabel] + nPredecessorsPlaced[successorLabel]++] = labelNum;
+        }
+        iterator_free(successorRunner);
+    }
+    free(nPredecessorsPlaced);
+}
+
+// the depth-first walk is iterative so that deeply nested control flow can't overflow the stack
+void function_ir_order_blocks(struct FunctionIr *ir)
+{
+    ir->postOrder = malloc(ir->nLaidOut * sizeof(size_t));
+    size_t nPostOrdered = 0;
+
+    bool *visited = calloc(ir->nBlocks, sizeof(bool));
+    size_t *nextSuccessors = calloc(ir->nBlocks, sizeof(size_t));
+    size_t *walkStack = malloc(ir->nLaidOut * sizeof(size_t));
+
+    // root the walk at the entry block, then at whichever blocks remain unvisited in layout order
+    for (size_t rootIndex = 0; rootIndex <= ir->nLaidOut; rootIndex++)
+    {
+        size_t root = (rootIndex == 0) ? FUNCTION_ENTRY_BLOCK_LABEL : ir->layout[rootIndex - 1];
+        if ((root >= ir->nBlocks) || (ir->blocks[root].block == NULL) || visited[root])
+        {
+            continue;
+        }
+
+        size_t depth = 0;
+        visited[root] = true;
+        walkStack[depth++] = root;
+        while (depth > 0)
+        {
+            size_t labelNum = walkStack[depth - 1];
+            size_t nSuccessors = 0;
+            size_t *successors = function_ir_successors(ir, labelNum, &nSuccessors);
+            if (nextSuccessors[labelNum] < nSuccessors)
+            {
+                size_t successor = successors[nextSuccessors[labelNum]++];
+                if (!visited[successor])
+                {
+                    visited[successor] = true;
+                    walkStack[depth++] = successor;
+                }
+            }
+            else
+            {
+                ir->postOrder[nPostOrdered++] = labelNum;
+                depth--;
+            }
+        }
+    }
+
+    free(visited);
+    free(nextSuccessors);
+    free(walkStack);
+}
+
+struct FunctionIr *function_ir_build(struct FunctionEntry *function)
+{
+    struct FunctionIr *ir = malloc(sizeof(struct FunctionIr));
+    memset(ir, 0, sizeof(struct FunctionIr));
+
+    Iterator *blockRunner = NULL;
+    for (blockRunner = list_begin(function->BasicBlockList); iterator_gettable(blockRunner); iterator_next(blockRunner))
+    {
+        struct BasicBlock *block = iterator_get(blockRunner);
+        if (block->labelNum < 0)
+        {
+            InternalError("Negative block label number %zd in function %s", block->labelNum, function->name);
+        }
+        ir->nBlocks = MAX(ir->nBlocks, (size_t)block->labelNum + 1);
+    }
+    iterator_free(blockRunner);
+
+    ir->blocks = calloc(ir->nBlocks, sizeof(struct IrBlock));
+    ir->layout = malloc(function->BasicBlockList->size * sizeof(size_t));
+
+    function_ir_lay_out_lines(ir, function);
+    function_ir_build_edges(ir, function);
+    function_ir_order_blocks(ir);
+
+    return ir;
+}
+
+void function_ir_free(struct FunctionIr *ir)
+{
+    free(ir->lines);
+    free(ir->blocks);
+    free(ir->layout);
+    free(ir->postOrder);
+    free(ir->successorStarts);
+    free(ir->successors);
+    free(ir->predecessorStarts);
+    free(ir->predecessors);
+    free(ir);
+}
+
+size_t *function_ir_successors(struct FunctionIr *ir, size_t labelNum, size_t *nSuccessors)
+{
+    *nSuccessors = ir->successorStarts[labelNum + 1] - ir->successorStarts[labelNum];
+    return &ir->successors[ir->successorStarts[labelNum]];
+}
+
+size_t *function_ir_predecessors(struct FunctionIr *ir, size_t labelNum, size_t *nPredecessors)
+{
+    *nPredecessors = ir->predecessorStarts[labelNum + 1] - ir->predecessorStarts[labelNum];
+    return &ir->predecessors[ir->predecessorStarts[labelNum]];
+}
@@ -1,258 +1,231 @@
 #include "idfa.h"
+#include "function_ir.h"
 #include "log.h"
 #include "symtab_basicblock.h"
+#include "tac.h"
+#include "time_report.h"
 #include "util.h"
 
-#include "mbcl/set.h"
-
-// returns an array of sets - index i in the array is a set containing the blocks which are successors of block i
-Array *generate_successors(Array *blocks)
+struct IdfaContext *idfa_context_create(char *name, struct FunctionIr *ir)
 {
-    Array *blockSuccessors = array_new((MBCL_DATA_FREE_FUNCTION)set_free, blocks->size);
-    for (size_t blockIndex = 0; blockIndex < blocks->size; blockIndex++)
-    {
-        // block pointers will be unique, so we can directly compare them
-        Set *thisblockSuccessors = set_new(NULL, pointer_compare);
-        array_emplace(blockSuccessors, blockIndex, thisblockSuccessors);
-
-        struct BasicBlock *thisBlock = array_at(blocks, blockIndex);
-
-        Iterator *successorRunner = NULL;
-        for (successorRunner = set_begin(thisBlock->successors); iterator_gettable(successorRunner); iterator_next(successorRunner))
-        {
-            ssize_t *successorLabel = iterator_get(successorRunner);
-            set_insert(thisblockSuccessors, array_at(blocks, *successorLabel));
-        }
-        iterator_free(successorRunner);
-    }
+    struct IdfaContext *wip = malloc(sizeof(struct IdfaContext));
+    wip->name = name;
+    wip->nBlocks = ir->nBlocks;
+    wip->ir = ir;
 
-    return blockSuccessors;
+    return wip;
 }
 
-Array *generate_predecessors(Array *blocks, Array *successors)
+void idfa_context_free(struct IdfaContext *context)
 {
-    Array *blockPredecessors = array_new((MBCL_DATA_FREE_FUNCTION)set_free, blocks->size);
-
-    for (size_t blockIndex = 0; blockIndex < blocks->size; blockIndex++)
-    {
-        // block pointers will always be unique, so we can directly compare them
-        array_emplace(blockPredecessors, blockIndex, set_new(NULL, pointer_compare));
-    }
-
-    for (size_t blockIndex = 0; blockIndex < blocks->size; blockIndex++)
-    {
-        Iterator *successorRunner = NULL;
-        for (successorRunner = set_begin(array_at(successors, blockIndex)); iterator_gettable(successorRunner); iterator_next(successorRunner))
-        {
-            struct BasicBlock *successor = iterator_get(successorRunner);
-            set_insert(array_at(blockPredecessors, successor->labelNum), array_at(blocks, blockIndex));
-        }
-        iterator_free(successorRunner);
-    }
-
-    return blockPredecessors;
+    free(context);
 }
 
-struct IdfaContext *idfa_context_create(char *name, List *blocks)
+// number every operand read or written in the function, then size the fact vectors to match
+void idfa_number_facts(struct Idfa *idfa)
 {
-    struct IdfaContext *wip = malloc(sizeof(struct IdfaContext));
-    wip->name = name;
-    size_t nBlocks = blocks->size;
-    wip->nBlocks = nBlocks;
-    wip->blocks = array_new(NULL, nBlocks);
+    struct FunctionIr *ir = idfa->context->ir;
+    idfa->factNumbers = hash_table_new(NULL, free, idfa->compareFacts, idfa->hashFact, (ir->nLines * 2) + 1);
+    size_t factsCapacity = ir->nLines + 1;
+    idfa->numberedFacts = malloc(factsCapacity * sizeof(struct TACOperand *));
+    idfa->nFacts = 0;
 
-    Iterator *blockRunner = NULL;
-    for (blockRunner = list_begin(blocks); iterator_gettable(blockRunner); iterator_next(blockRunner))
+    for (size_t lineIndex = 0; lineIndex < ir->nLines; lineIndex++)
     {
-        struct BasicBlock *thisBlock = iterator_get(blockRunner);
-        if (thisBlock->labelNum >= nBlocks)
+        struct OperandUsages usages = get_operand_usages(ir->lines[lineIndex]);
+        size_t nReads = operand_usages_n_reads(&usages);
+        for (size_t usageIndex = 0; usageIndex < nReads + usages.nWrites; usageIndex++)
         {
-            InternalError("Block label number %zu exceeds number of blocks %zu in IdfaContext_Create", thisBlock->labelNum, blocks->size);
+            struct TACOperand *operand = (usageIndex < nReads) ? operand_usages_read(&usages, usageIndex) : usages.writes[usageIndex - nReads];
+            if (hash_table_find(idfa->factNumbers, operand) != NULL)
+            {
+                continue;
+            }
+
+            if (idfa->nFacts == factsCapacity)
+            {
+                factsCapacity *= 2;
+                idfa->numberedFacts = realloc(idfa->numberedFacts, factsCapacity * sizeof(struct TACOperand *));
+            }
+
+            size_t *number = malloc(sizeof(size_t));
+            *number = idfa->nFacts;
+            idfa->numberedFacts[idfa->nFacts++] = operand;
+            hash_table_insert(idfa->factNumbers, operand, number);
         }
-        array_emplace(wip->blocks, thisBlock->labelNum, thisBlock);
     }
-    iterator_free(blockRunner);
 
-    wip->successors = generate_successors(wip->blocks);
-    wip->predecessors = generate_predecessors(wip->blocks, wip->successors);
-
-    return wip;
+    idfa->facts.in = bit_vector_array_new(idfa->context->nBlocks, idfa->nFacts);
+    idfa->facts.out = bit_vector_array_new(idfa->context->nBlocks, idfa->nFacts);
+    idfa->facts.gen = bit_vector_array_new(idfa->context->nBlocks, idfa->nFacts);
+    idfa->facts.kill = bit_vector_array_new(idfa->context->nBlocks, idfa->nFacts);
 }
 
-void idfa_context_free(struct IdfaContext *context)
+void idfa_release_facts(struct Idfa *idfa)
 {
-    array_free(context->blocks);
-    array_free(context->predecessors);
-    array_free(context->successors);
-    free(context);
+    hash_table_free(idfa->factNumbers);
+    free(idfa->numberedFacts);
+    bit_vector_array_free(idfa->facts.in);
+    bit_vector_array_free(idfa->facts.out);
+    bit_vector_array_free(idfa->facts.gen);
+    bit_vector_array_free(idfa->facts.kill);
 }
 
 struct Idfa *idfa_create(struct IdfaContext *context,
-                         Set *(*fTransfer)(struct Idfa *idfa, struct BasicBlock *block, Set *facts),
+                         void (*fTransfer)(struct Idfa *idfa, size_t labelNum, struct BitVector *facts, struct BitVector *transferred),
                          void (*findGenKills)(struct Idfa *idfa),
                          enum IDFA_ANALYSIS_DIRECTION direction,
                          ssize_t (*compareFacts)(void *factA, void *factB),
+                         size_t (*hashFact)(void *fact),
                          char *(*sprintFact)(void *factData),
-                         Set *(*fMeet)(Set *factsA, Set *factsB))
+                         bool (*fMeet)(struct BitVector *dest, struct BitVector *src))
 {
     struct Idfa *wip = malloc(sizeof(struct Idfa));
     wip->context = context;
     wip->compareFacts = compareFacts;
+    wip->hashFact = hashFact;
     wip->sprintFact = sprintFact;
     wip->fTransfer = fTransfer;
     wip->findGenKills = findGenKills;
     wip->fMeet = fMeet;
     wip->direction = direction;
 
-    // fixme: pointer for set_free
-    wip->facts.in = array_new((void (*)(void *))rb_tree_free, wip->context->blocks->size);
-    wip->facts.out = array_new((void (*)(void *))rb_tree_free, wip->context->blocks->size);
-    wip->facts.gen = array_new((void (*)(void *))rb_tree_free, wip->context->blocks->size);
-    wip->facts.kill = array_new((void (*)(void *))rb_tree_free, wip->context->blocks->size);
-
-    for (size_t i = 0; i < wip->context->nBlocks; i++)
-    {
-        array_emplace(wip->facts.in, i, set_new(NULL, wip->compareFacts));
-        array_emplace(wip->facts.out, i, set_new(NULL, wip->compareFacts));
-        array_emplace(wip->facts.gen, i, set_new(NULL, wip->compareFacts));
-        array_emplace(wip->facts.kill, i, set_new(NULL, wip->compareFacts));
-    }
-
+    idfa_number_facts(wip);
     idfa_analyze(wip);
 
     return wip;
 }
 
-void idfa_print_facts_for_block(struct Idfa *idfa, size_t blockIndex)
+size_t idfa_fact_number(struct Idfa *idfa, struct TACOperand *fact)
 {
-    printf("Block %zu facts:\n", blockIndex);
-
-    printf("\tGen: ");
-    Iterator *factRunner = NULL;
-    for (factRunner = set_begin(array_at(idfa->facts.gen, blockIndex)); iterator_gettable(factRunner); iterator_next(factRunner))
+    size_t *number = hash_table_find(idfa->factNumbers, fact);
+    if (number == NULL)
     {
-        char *sprintedFact = idfa->sprintFact(iterator_get(factRunner));
-        printf("[%s] ", sprintedFact);
-        free(sprintedFact);
+        char *sprintedFact = idfa->sprintFact(fact);
+        InternalError("Fact %s is not numbered in IDFA for %s", sprintedFact, idfa->context->name);
     }
-    iterator_free(factRunner);
-    factRunner = NULL;
-
-    printf("\n\tKill: ");
-    for (factRunner = set_begin(array_at(idfa->facts.kill, blockIndex)); iterator_gettable(factRunner); iterator_next(factRunner))
-    {
-        char *sprintedFact = idfa->sprintFact(iterator_get(factRunner));
-        printf("[%s] ", sprintedFact);
-        free(sprintedFact);
-    }
-    iterator_free(factRunner);
-    factRunner = NULL;
-
-    printf("\n\tIn: ");
-    for (factRunner = set_begin(array_at(idfa->facts.in, blockIndex)); iterator_gettable(factRunner); iterator_next(factRunner))
-    {
-        char *sprintedFact = idfa->sprintFact(iterator_get(factRunner));
-        printf("[%s] ", sprintedFact);
-        free(sprintedFact);
-    }
-    iterator_free(factRunner);
-    factRunner = NULL;
+    return *number;
+}
 
-    printf("\n\tOut: ");
-    for (factRunner = set_begin(array_at(idfa->facts.out, blockIndex)); iterator_gettable(factRunner); iterator_next(factRunner))
-    {
-        char *sprintedFact = idfa->sprintFact(iterator_get(factRunner));
-        printf("[%s] ", sprintedFact);
-        free(sprintedFact);
-    }
-    printf("\n\n");
-    iterator_free(factRunner);
+struct TACOperand *idfa_fact(struct Idfa *idfa, size_t number)
+{
+    return idfa->numberedFacts[number];
 }
 
-void idfa_print_facts(struct Idfa *idfa)
+// solve the analysis, visiting blocks in the given order and revisiting one only when the facts flowing into it change
+// facts flow into each block from the blocks upstream of it, are met into metFacts, and transferred into transferredFacts
+void idfa_solve(struct Idfa *idfa,
+                size_t *order,
+                size_t nOrdered,
+                size_t *(*upstream)(struct FunctionIr *ir, size_t labelNum, size_t *nUpstream),
+                size_t *(*downstream)(struct FunctionIr *ir, size_t labelNum, size_t *nDownstream),
+                struct BitVector *metFacts,
+                struct BitVector *transferredFacts)
 {
-    for (size_t blockIndex = 0; blockIndex < idfa->context->nBlocks; blockIndex++)
+    struct FunctionIr *ir = idfa->context->ir;
+    // passes over the blocks in solving order, each visiting only the blocks whose inputs changed, and transfer functions applied
+    size_t nIterations = 0;
+    size_t nVisits = 0;
+
+    // position of each block in the order, so a block whose inputs change can be marked pending in constant time
+    size_t *orderPositions = malloc(ir->nBlocks * sizeof(size_t));
+    bool *pending = malloc(nOrdered * sizeof(bool));
+    for (size_t orderIndex = 0; orderIndex < nOrdered; orderIndex++)
     {
-        idfa_print_facts_for_block(idfa, blockIndex);
+        orderPositions[order[orderIndex]] = orderIndex;
+        pending[orderIndex] = true;
     }
-}
 
-void idfa_analyze_forwards(struct Idfa *idfa)
-{
-    idfa->findGenKills(idfa);
-    size_t iteration = 0;
-    size_t nChangedOutputs = 0;
-    do
+    struct BitVector *transferred = bit_vector_array_new(1, idfa->nFacts);
+
+    bool anyPending = (nOrdered > 0);
+    while (anyPending)
     {
-        // printf("idfa iteration %zu\n", iteration);
-        nChangedOutputs = 0;
+        anyPending = false;
+        nIterations++;
 
-        // skip the entry block as we go using predecessors
-        for (size_t blockIndex = 0; blockIndex < idfa->context->nBlocks; blockIndex++)
+        for (size_t orderIndex = 0; orderIndex < nOrdered; orderIndex++)
         {
-            printf("analyze block %zu\n", blockIndex);
-            // get rid of our previous "in" facts as we will generate them again
-            // Idfa_printFactsForBlock(idfa, blockIndex);
-            Set *oldInFacts = array_at(idfa->facts.in, blockIndex);
-
-            // re-generate our "in" facts from the union of the "out" facts of all predecessors
-            Set *newInFacts = NULL;
-            Iterator *predecessorRunner = NULL;
-            for (predecessorRunner = set_begin(array_at(idfa->context->predecessors, blockIndex)); iterator_gettable(predecessorRunner); iterator_next(predecessorRunner))
+            if (!pending[orderIndex])
             {
-                struct BasicBlock *predecessor = iterator_get(predecessorRunner);
-                Set *predOuts = array_at(idfa->facts.out, predecessor->labelNum);
-                set_verify(predOuts);
+                continue;
+            }
+            pending[orderIndex] = false;
+            nVisits++;
+
+            size_t labelNum = order[orderIndex];
+            struct BitVector *met = &metFacts[labelNum];
+            bit_vector_clear_all(met);
 
-                if (newInFacts == NULL)
+            size_t nUpstream = 0;
+            size_t *upstreamLabels = upstream(ir, labelNum, &nUpstream);
+            for (size_t upstreamIndex = 0; upstreamIndex < nUpstream; upstreamIndex++)
+            {
+                struct BitVector *upstreamFacts = &transferredFacts[upstreamLabels[upstreamIndex]];
+                if (upstreamIndex == 0)
                 {
-                    idfa_print_facts_for_block(idfa, blockIndex);
-                    // idfa_print_facts(idfa);
-                    printf("\n");
-                    printf("copy predouts from %zu\n", predecessor->labelNum);
-                    fflush(stdout);
-                    newInFacts = set_copy(predOuts);
+                    bit_vector_copy(met, upstreamFacts);
                 }
                 else
                 {
-                    Set *metInFacts = idfa->fMeet(newInFacts, predOuts);
-                    set_verify(metInFacts);
-                    set_free(newInFacts);
-                    newInFacts = metInFacts;
+                    idfa->fMeet(met, upstreamFacts);
                 }
             }
-            iterator_free(predecessorRunner);
 
-            if (newInFacts == NULL)
+            idfa->fTransfer(idfa, labelNum, met, transferred);
+            if (bit_vector_equals(transferred, &transferredFacts[labelNum]))
             {
-                newInFacts = set_new(oldInFacts->freeData, oldInFacts->compareData);
+                continue;
             }
-            set_free(oldInFacts);
-            array_emplace(idfa->facts.in, blockIndex, newInFacts);
+            bit_vector_copy(&transferredFacts[labelNum], transferred);
 
-            Set *transferred = idfa->fTransfer(idfa, array_at(idfa->context->blocks, blockIndex), newInFacts);
-            set_verify(transferred);
-            if (transferred->size != ((Set *)array_at(idfa->facts.out, blockIndex))->size)
+            // blocks later in the order are picked up by this pass, earlier ones (across back edges) need another
+            size_t nDownstream = 0;
+            size_t *downstreamLabels = downstream(ir, labelNum, &nDownstream);
+            for (size_t downstreamIndex = 0; downstreamIndex < nDownstream; downstreamIndex++)
             {
-                nChangedOutputs++;
+                size_t downstreamPosition = orderPositions[downstreamLabels[downstreamIndex]];
+                pending[downstreamPosition] = true;
+                if (downstreamPosition <= orderIndex)
+                {
+                    anyPending = true;
+                }
             }
-            set_free(array_at(idfa->facts.out, blockIndex));
-            array_emplace(idfa->facts.out, blockIndex, transferred);
         }
+    }
+
+    bit_vector_array_free(transferred);
+    free(pending);
+    free(orderPositions);
+
+    log(LOG_DEBUG, "IDFA for %s reached fixpoint after %zu iterations (%zu block visits)", idfa->context->name, nIterations, nVisits);
+    time_report_count_dataflow(nIterations, nVisits);
+}
 
-        printf("END OF ITERATION %zu:\n", iteration);
-        idfa_print_facts(idfa);
-        printf("\n");
+void idfa_analyze_forwards(struct Idfa *idfa)
+{
+    idfa->findGenKills(idfa);
 
-        iteration++;
-    } while (nChangedOutputs > 0);
+    // reverse post-order visits every block after its predecessors, other than across back edges
+    struct FunctionIr *ir = idfa->context->ir;
+    size_t *order = malloc(ir->nLaidOut * sizeof(size_t));
+    for (size_t orderIndex = 0; orderIndex < ir->nLaidOut; orderIndex++)
+    {
+        order[orderIndex] = ir->postOrder[ir->nLaidOut - 1 - orderIndex];
+    }
 
-    log(LOG_WARNING, "idfa reached fixpoint");
+    idfa_solve(idfa, order, ir->nLaidOut, function_ir_predecessors, function_ir_successors, idfa->facts.in, idfa->facts.out);
+
+    free(order);
 }
 
 void idfa_analyze_backwards(struct Idfa *idfa)
 {
-    InternalError("Backwards dataflow analysis not implemented");
+    idfa->findGenKills(idfa);
+
+    // post-order visits every block after its successors, other than across back edges
+    struct FunctionIr *ir = idfa->context->ir;
+    idfa_solve(idfa, ir->postOrder, ir->nLaidOut, function_ir_successors, function_ir_predecessors, idfa->facts.out, idfa->facts.in);
 }
 
 void idfa_analyze(struct Idfa *idfa)
@@ -271,29 +244,14 @@ void idfa_analyze(struct Idfa *idfa)
 
 void idfa_redo(struct Idfa *idfa)
 {
-    for (size_t i = 0; i < idfa->context->nBlocks; i++)
-    {
-        set_free(array_at(idfa->facts.in, i));
-        array_emplace(idfa->facts.in, i, set_new(NULL, idfa->compareFacts));
-
-        set_free(array_at(idfa->facts.out, i));
-        array_emplace(idfa->facts.out, i, set_new(NULL, idfa->compareFacts));
-
-        set_free(array_at(idfa->facts.gen, i));
-        array_emplace(idfa->facts.gen, i, set_new(NULL, idfa->compareFacts));
-
-        set_free(array_at(idfa->facts.kill, i));
-        array_emplace(idfa->facts.kill, i, set_new(NULL, idfa->compareFacts));
-    }
+    // the code may have changed since the last analysis, so number its facts afresh
+    idfa_release_facts(idfa);
+    idfa_number_facts(idfa);
     idfa_analyze(idfa);
 }
 
 void idfa_free(struct Idfa *idfa)
 {
-    array_free(idfa->facts.in);
-    array_free(idfa->facts.out);
-    array_free(idfa->facts.gen);
-    array_free(idfa->facts.kill);
-
+    idfa_release_facts(idfa);
     free(idfa);
 }
@@ -1,52 +1,133 @@
 #include "idfa_livevars.h"
 
+#include "function_ir.h"
 #include "log.h"
 #include "symtab_basicblock.h"
+#include "symtab_variable.h"
 #include "util.h"
 
-Set *live_vars_transfer(struct Idfa *idfa, struct BasicBlock *block, Set *facts)
+// only variables and temps can be live - literals are never defined, and unused operands don't refer to anything
+bool live_vars_tracks_operand(struct TACOperand *operand)
 {
-    Set *transferred = set_copy(array_at(idfa->facts.gen, block->labelNum));
+    return (operand->permutation == VP_STANDARD) || (operand->permutation == VP_TEMP);
+}
+
+// liveness belongs to the storage of a variable or temp, so facts are keyed on which one an operand names the same way
+// lifetimes are, regardless of what it is cast as or its SSA number - otherwise a plain write wouldn't kill a cast read
+ssize_t live_vars_compare_facts(void *factA, void *factB)
+{
+    struct TACOperand *operandA = factA;
+    struct TACOperand *operandB = factB;
+    if (operandA->permutation != operandB->permutation)
+    {
+        return (ssize_t)operandA->permutation - (ssize_t)operandB->permutation;
+    }
+
+    switch (operandA->permutation)
+    {
+    case VP_STANDARD:
+        return (ssize_t)operandA->name.variable->nameId - (ssize_t)operandB->name.variable->nameId;
+
+    case VP_TEMP:
+        return (ssize_t)operandA->name.temp->number - (ssize_t)operandB->name.temp->number;
+
+    case VP_LITERAL_STR:
+    case VP_LITERAL_VAL:
+    case VP_UNUSED:
+        break;
+    }
+
+    // untracked operands are still numbered, but never live
+    return tac_operand_compare(factA, factB);
+}
+
+size_t live_vars_hash_fact(void *fact)
+{
+    struct TACOperand *operand = fact;
+    switch (operand->permutation)
+    {
+    case VP_STANDARD:
+        return operand->name.variable->nameId;
+
+    case VP_TEMP:
+        return operand->name.temp->number;
+
+    case VP_LITERAL_STR:
+    case VP_LITERAL_VAL:
+    case VP_UNUSED:
+        break;
+    }
+
+    return tac_operand_hash(fact);
+}
 
-    Iterator *factRunner = NULL;
-    for (factRunner = set_begin(facts); iterator_gettable(factRunner); iterator_next(factRunner))
+// apply a line's effect to the facts live after it, leaving the facts live before it
+void live_vars_step_back_over_line(struct Idfa *idfa, struct TACLine *line, struct BitVector *live)
+{
+    struct OperandUsages usages = get_operand_usages(line);
+
+    // anything written is dead before the line, unless the line also reads it
+    for (size_t writeIndex = 0; writeIndex < usages.nWrites; writeIndex++)
+    {
+        if (live_vars_tracks_operand(usages.writes[writeIndex]))
+        {
+            bit_vector_unset(live, idfa_fact_number(idfa, usages.writes[writeIndex]));
+        }
+    }
+
+    for (size_t readIndex = 0; readIndex < operand_usages_n_reads(&usages); readIndex++)
     {
-        struct TACOperand *examinedFact = iterator_get(factRunner);
-        // transfer anything not killed
-        if (set_find(array_at(idfa->facts.kill, block->labelNum), examinedFact) == NULL)
+        struct TACOperand *readOperand = operand_usages_read(&usages, readIndex);
+        if (live_vars_tracks_operand(readOperand))
         {
-            set_insert(transferred, examinedFact);
+            bit_vector_set(live, idfa_fact_number(idfa, readOperand));
         }
     }
+}
 
-    return transferred;
+void live_vars_transfer(struct Idfa *idfa, size_t labelNum, struct BitVector *facts, struct BitVector *transferred)
+{
+    // live in is everything read before being written in the block, plus everything live out which the block doesn't write
+    bit_vector_copy(transferred, facts);
+    bit_vector_difference(transferred, &idfa->facts.kill[labelNum]);
+    bit_vector_union(transferred, &idfa->facts.gen[labelNum]);
 }
 
+// gen is the set of facts read in a block before any write to them, kill the set of facts written in it
 void live_vars_find_gen_kills(struct Idfa *idfa)
 {
-    for (size_t blockIndex = 0; blockIndex < idfa->context->blocks->size; blockIndex++)
+    struct FunctionIr *ir = idfa->context->ir;
+    for (size_t blockIndex = 0; blockIndex < idfa->context->nBlocks; blockIndex++)
     {
-        struct BasicBlock *genKillBlock = array_at(idfa->context->blocks, blockIndex);
-        Iterator *tacRunner = NULL;
-        for (tacRunner = list_begin(genKillBlock->TACList); iterator_gettable(tacRunner); iterator_next(tacRunner))
+        struct IrBlock *genKillBlock = &ir->blocks[blockIndex];
+        struct BitVector *gen = &idfa->facts.gen[blockIndex];
+        struct BitVector *kill = &idfa->facts.kill[blockIndex];
+
+        // walking backwards, a read makes a fact upward-exposed until an earlier write to it is seen
+        for (size_t lineIndex = genKillBlock->firstLine + genKillBlock->nLines; lineIndex > genKillBlock->firstLine; lineIndex--)
         {
-            struct TACLine *genKillLine = iterator_get(tacRunner);
+            struct TACLine *genKillLine = ir->lines[lineIndex - 1];
             struct OperandUsages genKillLineUsages = get_operand_usages(genKillLine);
 
-            while (genKillLineUsages.reads->size > 0)
+            for (size_t writeIndex = 0; writeIndex < genKillLineUsages.nWrites; writeIndex++)
             {
-                struct TACOperand *readOperand = deque_pop_front(genKillLineUsages.reads);
-                set_insert(array_at(idfa->facts.kill, blockIndex), readOperand);
+                struct TACOperand *writtenOperand = genKillLineUsages.writes[writeIndex];
+                if (live_vars_tracks_operand(writtenOperand))
+                {
+                    size_t factNumber = idfa_fact_number(idfa, writtenOperand);
+                    bit_vector_set(kill, factNumber);
+                    bit_vector_unset(gen, factNumber);
+                }
             }
 
-            while (genKillLineUsages.writes->size > 0)
+            for (size_t readIndex = 0; readIndex < operand_usages_n_reads(&genKillLineUsages); readIndex++)
             {
-                struct TACOperand *writeOperand = deque_pop_front(genKillLineUsages.writes);
-                set_insert(array_at(idfa->facts.gen, blockIndex), writeOperand);
+                struct TACOperand *readOperand = operand_usages_read(&genKillLineUsages, readIndex);
+                if (live_vars_tracks_operand(readOperand))
+                {
+                    bit_vector_set(gen, idfa_fact_number(idfa, readOperand));
+                }
             }
-
-            deque_free(genKillLineUsages.reads);
-            deque_free(genKillLineUsages.writes);
         }
     }
 }
@@ -56,10 +137,29 @@ struct Idfa *analyze_live_vars(struct IdfaContext *context)
     struct Idfa *liveVarsIdfa = idfa_create(context,
                                             live_vars_transfer,
                                             live_vars_find_gen_kills,
-                                            D_FORWARDS,
-                                            tac_operand_compare,
+                                            D_BACKWARDS,
+                                            live_vars_compare_facts,
+                                            live_vars_hash_fact,
                                             tac_operand_sprint,
-                                            set_union);
+                                            bit_vector_union);
 
     return liveVarsIdfa;
-}
\ No newline at end of file
+}
+
+void live_vars_walk_block(struct Idfa *liveVars, size_t labelNum, void (*visitLine)(struct Idfa *liveVars, struct TACLine *line, struct BitVector *liveAfter, void *data), void *data)
+{
+    struct FunctionIr *ir = liveVars->context->ir;
+    struct IrBlock *block = &ir->blocks[labelNum];
+
+    struct BitVector *live = bit_vector_array_new(1, liveVars->nFacts);
+    bit_vector_copy(live, &liveVars->facts.out[labelNum]);
+
+    for (size_t lineIndex = block->firstLine + block->nLines; lineIndex > block->firstLine; lineIndex--)
+    {
+        struct TACLine *line = ir->lines[lineIndex - 1];
+        visitLine(liveVars, line, live, data);
+        live_vars_step_back_over_line(liveVars, line, live);
+    }
+
+    bit_vector_array_free(live);
+}
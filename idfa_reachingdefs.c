@@ -1,5 +1,6 @@
 #include "idfa_reachingdefs.h"
 
+#include "function_ir.h"
 #include "idfa_livevars.h"
 #include "symtab_basicblock.h"
 #include "util.h"
@@ -10,7 +11,7 @@ char *sprint_idfa_operand(void *data)
     struct TACOperand *operand = data;
     char *sprinted = tac_operand_sprint(operand);
     char *typename = type_get_name(tac_operand_get_non_cast_type(operand));
-    char *castTypeName = type_get_name(&operand->castAsType);
+    char *castTypeName = type_get_name(tac_operand_get_type(operand));
     char *returned = malloc(strlen(sprinted) + strlen(typename) + strlen(castTypeName) + SIZE_T_PRINT_LENGTH);
     sprintf(returned, "%s(%s) %s %zu", typename, castTypeName, sprinted, operand->ssaNumber);
     free(typename);
@@ -19,66 +20,35 @@ char *sprint_idfa_operand(void *data)
     return returned;
 }
 
-Set *reacing_defs_transfer(struct Idfa *idfa, struct BasicBlock *block, Set *facts)
+void reacing_defs_transfer(struct Idfa *idfa, size_t labelNum, struct BitVector *facts, struct BitVector *transferred)
 {
-    printf("ENTRY TO TRANSFER\n");
-    Set *transferred = set_new(facts->freeData, facts->compareData);
-
-    // transfer anything in GEN but not in KILL
-    Iterator *factRunner = NULL;
-    for (factRunner = set_begin(array_at(idfa->facts.gen, block->labelNum)); iterator_gettable(factRunner); iterator_next(factRunner))
-    {
-        struct TACOperand *examinedFact = iterator_get(factRunner);
-        if (set_find(array_at(idfa->facts.kill, block->labelNum), examinedFact) == NULL)
-        {
-            set_try_insert(transferred, examinedFact);
-        }
-    }
-    iterator_free(factRunner);
-    factRunner = NULL;
-
-    // transfer anything we get in not in KILL
-    for (factRunner = set_begin(facts); iterator_gettable(factRunner); iterator_next(factRunner))
-    {
-        struct TACOperand *examinedFact = iterator_get(factRunner);
-        // transfer anything not killed
-        if (set_find(array_at(idfa->facts.kill, block->labelNum), examinedFact) == NULL)
-        {
-            set_try_insert(transferred, examinedFact);
-        }
-    }
-    iterator_free(factRunner);
-    factRunner = NULL;
-
-    set_verify(transferred);
-
-    return transferred;
+    // transfer anything in GEN or coming in, as long as it is not in KILL
+    bit_vector_copy(transferred, facts);
+    bit_vector_union(transferred, &idfa->facts.gen[labelNum]);
+    bit_vector_difference(transferred, &idfa->facts.kill[labelNum]);
 }
 
 void reacing_defs_find_gen_kills(struct Idfa *idfa)
 {
     for (size_t blockIndex = 0; blockIndex < idfa->context->nBlocks; blockIndex++)
     {
-        struct BasicBlock *genKillBlock = array_at(idfa->context->blocks, blockIndex);
+        struct IrBlock *genKillBlock = &idfa->context->ir->blocks[blockIndex];
         Set *highestSsas = set_new(NULL, tac_operand_compare_ignore_ssa_number);
-        Iterator *tacRunner = NULL;
-        Set *killedThisBlock = array_at(idfa->facts.kill, blockIndex);
-        // killedThisBlock = set_new(NULL, killedThisBlock->compareData);
-        for (tacRunner = list_begin(genKillBlock->TACList); iterator_gettable(tacRunner); iterator_next(tacRunner))
+        struct BitVector *killedThisBlock = &idfa->facts.kill[blockIndex];
+        for (size_t lineIndex = genKillBlock->firstLine; lineIndex < genKillBlock->firstLine + genKillBlock->nLines; lineIndex++)
         {
-            struct TACLine *genKillLine = iterator_get(tacRunner);
+            struct TACLine *genKillLine = idfa->context->ir->lines[lineIndex];
 
             struct OperandUsages genKillLineUsages = get_operand_usages(genKillLine);
 
-            while (genKillLineUsages.reads->size > 0)
+            for (size_t readIndex = 0; readIndex < operand_usages_n_reads(&genKillLineUsages); readIndex++)
             {
-                struct TACOperand *readOperand = deque_pop_front(genKillLineUsages.reads);
-                set_insert(killedThisBlock, readOperand);
+                bit_vector_set(killedThisBlock, idfa_fact_number(idfa, operand_usages_read(&genKillLineUsages, readIndex)));
             }
 
-            while (genKillLineUsages.writes->size > 0)
+            for (size_t writeIndex = 0; writeIndex < genKillLineUsages.nWrites; writeIndex++)
             {
-                struct TACOperand *writtenOperand = deque_pop_front(genKillLineUsages.writes);
+                struct TACOperand *writtenOperand = genKillLineUsages.writes[writeIndex];
                 struct TACOperand *highestForThisOperand = set_find(highestSsas, writtenOperand);
                 if (highestForThisOperand == NULL)
                 {
@@ -95,12 +65,11 @@ void reacing_defs_find_gen_kills(struct Idfa *idfa)
                 }
             }
         }
-        iterator_free(tacRunner);
 
         Iterator *highestSsaRunner = NULL;
         for (highestSsaRunner = set_begin(highestSsas); iterator_gettable(highestSsaRunner); iterator_next(highestSsaRunner))
         {
-            set_insert(array_at(idfa->facts.gen, blockIndex), iterator_get(highestSsaRunner));
+            bit_vector_set(&idfa->facts.gen[blockIndex], idfa_fact_number(idfa, iterator_get(highestSsaRunner)));
         }
         iterator_free(highestSsaRunner);
 
@@ -115,8 +84,9 @@ struct Idfa *analyze_reaching_defs(struct IdfaContext *context)
                                                reacing_defs_find_gen_kills,
                                                D_FORWARDS,
                                                tac_operand_compare,
+                                               tac_operand_hash,
                                                sprint_idfa_operand,
-                                               set_union);
+                                               bit_vector_union);
 
     return reacingDefsIdfa;
 }
\ No newline at end of file
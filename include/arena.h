@@ -0,0 +1,39 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#include "substratum_defs.h"
+
+/*
+ * Bump allocator for data which all lives and dies together
+ * Allocations are carved out of a list of large chunks, and can't be freed individually - freeing the arena releases
+ * everything allocated from it at once, in time proportional to the number of chunks.
+ */
+
+struct ArenaChunk
+{
+    struct ArenaChunk *next;
+    size_t size; // usable bytes in data
+    size_t used;
+    _Alignas(max_align_t) u8 data[];
+};
+
+struct Arena
+{
+    struct ArenaChunk *chunks; // chunk being allocated from first, followed by full chunks
+    size_t chunkSize;
+    size_t nAllocations;
+    size_t bytesAllocated;
+};
+
+struct Arena *arena_new(size_t chunkSize);
+
+void arena_free(struct Arena *arena);
+
+// allocate size bytes, aligned suitably for any type
+void *arena_alloc(struct Arena *arena, size_t size);
+
+char *arena_strdup(struct Arena *arena, const char *str);
+
+#endif
@@ -4,6 +4,8 @@
 #include "substratum_defs.h"
 #include <stdio.h>
 
+struct Arena;
+
 enum TOKEN
 {
     T_IDENTIFIER,
@@ -133,9 +135,13 @@ struct Ast
     char *sourceFile;
 };
 
-// instantiate a new AST with given type and value
+// create an arena to allocate a translation unit's AST nodes from
+// there is no way to free individual nodes - the whole AST is freed at once by freeing its arena
+struct Arena *ast_arena_new();
+
+// instantiate a new AST with given type and value, allocated from arena
 // the sourceLine and sourceCol fields will be automatically populated
-struct Ast *ast_new(enum TOKEN type, char *value, char *curFile, u32 curLine, u32 curCol);
+struct Ast *ast_new(struct Arena *arena, enum TOKEN type, char *value, char *curFile, u32 curLine, u32 curCol);
 
 void ast_insert_sibling(struct Ast *tree, struct Ast *newSibling);
 
@@ -147,6 +153,4 @@ struct Ast *ast_construct_add_child(struct Ast *tree, struct Ast *newChild);
 
 void ast_print(struct Ast *tree, size_t depth);
 
-void ast_dump(FILE *outFile, struct Ast *tree);
-
-void ast_free(struct Ast *tree);
\ No newline at end of file
+void ast_dump(FILE *outFile, struct Ast *tree);
\ No newline at end of file
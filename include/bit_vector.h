@@ -0,0 +1,53 @@
+#ifndef BIT_VECTOR_H
+#define BIT_VECTOR_H
+
+#include <stddef.h>
+
+#include "substratum_defs.h"
+
+/*
+ * Dense bit vectors
+ * Fixed-size sets of small integers, one bit each, for dataflow facts numbered densely within a function. Every
+ * operation between two vectors works a word at a time in place, so both must have the same size.
+ */
+
+struct BitVector
+{
+    u64 *words;
+    size_t nWords;
+    size_t nBits;
+};
+
+// allocate nVectors zeroed vectors of nBits each, with all their words in a single allocation
+struct BitVector *bit_vector_array_new(size_t nVectors, size_t nBits);
+
+void bit_vector_array_free(struct BitVector *vectors);
+
+void bit_vector_set(struct BitVector *vector, size_t bit);
+
+void bit_vector_unset(struct BitVector *vector, size_t bit);
+
+bool bit_vector_test(struct BitVector *vector, size_t bit);
+
+void bit_vector_clear_all(struct BitVector *vector);
+
+void bit_vector_copy(struct BitVector *dest, struct BitVector *src);
+
+// dest |= src, returning whether dest changed
+bool bit_vector_union(struct BitVector *dest, struct BitVector *src);
+
+// dest &= src, returning whether dest changed
+bool bit_vector_intersect(struct BitVector *dest, struct BitVector *src);
+
+// dest &= ~src, returning whether dest changed
+bool bit_vector_difference(struct BitVector *dest, struct BitVector *src);
+
+bool bit_vector_equals(struct BitVector *vectorA, struct BitVector *vectorB);
+
+size_t bit_vector_count(struct BitVector *vector);
+
+// return the first set bit at or after from, or nBits if there is none
+// iterate with for (bit = bit_vector_next(v, 0); bit < v->nBits; bit = bit_vector_next(v, bit + 1))
+size_t bit_vector_next(struct BitVector *vector, size_t from);
+
+#endif
@@ -4,6 +4,8 @@
 
 #include "substratum_defs.h"
 
+#include "mbcl/deque.h"
+
 struct SymbolTable;
 struct CodegenState;
 struct RegallocMetadata;
@@ -47,8 +49,17 @@ void generate_code_for_function(FILE *outFile,
                                 struct FunctionEntry *function,
                                 struct MachineInfo *info,
                                 char *methodOfStructName, // NULL if not a method, otherwise the name of the struct which this function is a method of
+                                Deque *instanceFunctions, // NULL unless the function belongs to a generic instance, in which case its code is held here
                                 void (*emitPrologue)(struct CodegenState *, struct RegallocMetadata *, struct MachineInfo *),
                                 void (*emitEpilogue)(struct CodegenState *, struct RegallocMetadata *, struct MachineInfo *, char *),
                                 void (*generateCodeForBasicBlock)(struct CodegenState *, struct RegallocMetadata *, struct MachineInfo *, struct BasicBlock *, char *));
 
+Deque *codegen_instance_functions_new();
+
+// hold the code generated for a generic instance's function (without its symbol) until all instances are generated
+void codegen_add_instance_function(Deque *instanceFunctions, char *name, char *code);
+
+// emit held instance functions, each in a COMDAT group, folding those with identical code into one body with aliases
+void codegen_emit_instance_functions(FILE *outFile, Deque *instanceFunctions);
+
 #endif
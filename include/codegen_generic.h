@@ -3,6 +3,8 @@
 #include "regalloc_generic.h"
 #include "substratum_defs.h"
 
+#include "mbcl/deque.h"
+
 #define STACK_ALIGN_BYTES ((size_t)16)
 #define MAX_ASM_LINE_SIZE ((size_t)256)
 
@@ -10,6 +12,7 @@ struct CodegenState
 {
     size_t *instructionIndex;
     FILE *outFile;
+    Deque *instanceFunctions; // code generated for functions of generic instances, emitted once everything else is
 };
 
 void emit_instruction(struct TACLine *correspondingTACLine,
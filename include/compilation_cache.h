@@ -0,0 +1,69 @@
+#ifndef COMPILATION_CACHE_H
+#define COMPILATION_CACHE_H
+
+#include <stdio.h>
+
+#include "substratum_defs.h"
+#include "util.h"
+
+struct FunctionEntry;
+struct PrecompiledHeader;
+struct SymbolTable;
+struct TranslationUnit;
+
+/*
+ * Content-addressed compilation cache (--cache-dir)
+ * Whole translation units are keyed by their preprocessed text plus the compiler's identity and codegen-affecting flags.
+ * Individual functions are keyed by their linearized TAC plus a fingerprint of everything else in the TU which their
+ * generated code can depend on (struct layouts, function signatures and argument locations, globals).
+ * Functions of generic instances are keyed by their TAC plus only the layouts and callee interfaces it refers to, so that
+ * every TU instantiating the same generic shares one entry.
+ */
+
+enum COMPILATION_CACHE_KIND
+{
+    CC_UNIT,
+    CC_FUNCTION,
+    CC_INSTANCE,
+};
+
+struct CompilationCache
+{
+    char *directory;
+    char unitKey[CONTENT_HASH_STRING_LENGTH];
+    struct ContentHash unitFingerprint; // hash of the TU's function interfaces/layouts, computed after register allocation
+    size_t nFunctionHits;
+    size_t nFunctionMisses;
+};
+
+struct CompilationCache *compilation_cache_new(char *directory);
+
+void compilation_cache_free(struct CompilationCache *cache);
+
+// compute the key for a translation unit from its fully preprocessed text
+void compilation_cache_begin_unit(struct CompilationCache *cache,
+                                  struct TranslationUnit *unit,
+                                  const char *preprocessedText,
+                                  size_t preprocessedLength,
+                                  struct PrecompiledHeader *pch);
+
+// fingerprint the parts of the symbol table which per-function code generation depends on - call after register allocation
+void compilation_cache_begin_codegen(struct CompilationCache *cache, struct SymbolTable *table);
+
+// returns a key (to be freed by the caller) for the code generated for function under fullFunctionName
+char *compilation_cache_function_key(struct CompilationCache *cache, struct FunctionEntry *function, char *fullFunctionName);
+
+// returns a TU-independent key (to be freed by the caller) for the code generated for a generic instance's function
+char *compilation_cache_instance_key(struct CompilationCache *cache, struct FunctionEntry *function, char *fullFunctionName);
+
+// if an entry exists for key, copy it to outFile and return true
+bool compilation_cache_fetch(struct CompilationCache *cache, enum COMPILATION_CACHE_KIND kind, char *key, FILE *outFile);
+
+void compilation_cache_store(struct CompilationCache *cache, enum COMPILATION_CACHE_KIND kind, char *key, const char *data, size_t length);
+
+// cache used by code generation on the calling thread (NULL if caching is disabled)
+void compilation_cache_set_active(struct CompilationCache *cache);
+
+struct CompilationCache *compilation_cache_get_active();
+
+#endif
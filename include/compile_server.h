@@ -0,0 +1,25 @@
+#ifndef COMPILE_SERVER_H
+#define COMPILE_SERVER_H
+
+#include "substratum_defs.h"
+
+/*
+ * Persistent compile server - accepts compile requests over a unix socket so that repeated compilations
+ * don't pay for process startup, and keep the include cache, string interner and parsed preambles (see
+ * TranslationUnit::warmPreamble) warm between requests. Preambles aren't warmed when a compilation cache is in use,
+ * as that would change the cache key and keep server and command-line builds from sharing entries
+ *
+ * Protocol (all integers are native-endian u64s, strings are a u64 length followed by that many bytes):
+ * Request:  COMPILE_SERVER_PROTOCOL_VERSION, working directory, argc, argv[0..argc), hasStdin, [stdin contents]
+ * Response: exit status, log output, generated code (when compiling to stdout)
+ */
+
+#define COMPILE_SERVER_PROTOCOL_VERSION 1
+
+// environment variable from which sbcc-client reads the path of the server's socket
+#define COMPILE_SERVER_SOCKET_ENV "SBCC_SERVER_SOCKET"
+
+// run the compile server on socketPath until interrupted, returning the process exit status
+int compile_server_run(char *socketPath);
+
+#endif
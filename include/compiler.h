@@ -0,0 +1,111 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <stdio.h>
+
+#include "substratum_defs.h"
+
+#include "dump.h"
+
+#include "mbcl/list.h"
+
+struct Arena;
+struct Ast;
+struct CompilationCache;
+struct MachineInfo;
+struct PrecompiledHeader;
+struct Preprocessor;
+struct SourceLocationTable;
+struct SymbolTable;
+struct TypeTable;
+
+/*
+ * Compiler driver: option handling and compilation of individual translation units
+ * Shared between the command-line entry point and the compile server
+ */
+
+struct CompilerOptions
+{
+    List *includePath;
+    List *inputFiles;
+    char *outFileName;
+    char *outDir;
+    size_t nJobs;
+    bool emitStart;
+    char *serverSocket; // non-NULL if --server was given
+    char *emitPch;      // header to precompile (--emit-pch)
+    char *includePch;   // precompiled header to use (--include-pch)
+    char *cacheDir;     // directory to cache generated code in (--cache-dir)
+    struct DumpOptions dump;
+    bool timeReport;         // -ftime-report
+    bool timeTrace;          // -ftime-trace
+    char *timeTraceFileName; // -ftime-trace=file
+};
+
+// everything a translation unit owns while it is being compiled, so that it can all be freed if compilation fails partway
+struct TranslationUnitResources
+{
+    struct PrecompiledHeader *pch;
+    bool pchIsWarm; // pch is a warm preamble, belonging to the thread rather than the unit
+    struct Preprocessor *preprocessor;
+    struct CompilationCache *cache;
+    struct Arena *astArena;
+    struct SourceLocationTable *sourceLocations;
+    struct TypeTable *types;
+    struct SymbolTable *symbolTable;
+    struct MachineInfo *machineInfo;
+    FILE *outFile;      // while open
+    bool createdOutput; // whether outFileName has been opened for writing
+    FILE *codeFile;     // when caching, buffers the generated code in generatedCode
+    char *generatedCode;
+    size_t generatedCodeSize;
+};
+
+struct TranslationUnit
+{
+    char *inFileName;
+    char *outFileName;
+    FILE *outFile; // if non-NULL, generate code here instead of opening outFileName
+    bool emitStart;
+    char *pchFileName; // precompiled header to load before parsing, if any
+    bool warmPreamble; // without a precompiled header, precompile the file's leading #includes and keep them warm on this thread
+    char *cacheDir;    // compilation cache directory, if caching is enabled
+    struct DumpOptions dump;
+    bool dumpsNamedAfterOutput; // name dump files after outFileName (<out>.ast.dot) rather than ast.dot, so parallel units don't collide
+    bool timeReport;
+    char *timeTraceFileName; // write a Chrome trace of the compile here, if non-NULL
+    char *logBuffer; // log output captured while compiling in parallel
+    size_t logBufferSize;
+    int status;
+    struct TranslationUnitResources resources;
+};
+
+void usage(FILE *outFile);
+
+// parse command-line style arguments into options, returning false (after logging why) if they are invalid
+bool compiler_options_parse(struct CompilerOptions *options, int argc, char **argv);
+
+void compiler_options_deinit(struct CompilerOptions *options);
+
+// create a translation unit for each input file of options
+struct TranslationUnit *compiler_create_units(struct CompilerOptions *options, size_t *nUnitsOut);
+
+void compiler_free_units(struct TranslationUnit *units, size_t nUnits);
+
+// parse the output of a preprocessor which has already begun preprocessing inFileName, allocating the AST from astArena
+struct Ast *parse_preprocessed(struct Preprocessor *preprocessor, char *inFileName, struct Arena *astArena);
+
+void compile_translation_unit(struct TranslationUnit *unit);
+
+// compile unit with its log output captured in unit->logBuffer, marking it failed instead of exiting on fatal errors
+void compile_translation_unit_captured(struct TranslationUnit *unit);
+
+int compile_translation_units_parallel(struct TranslationUnit *units, size_t nUnits, size_t nJobs, FILE *logOutFile);
+
+// set up state which the calling thread keeps warm between translation units, if not already done
+void compiler_init_thread_state();
+
+// free state which the calling thread keeps warm between translation units
+void compiler_free_thread_state();
+
+#endif
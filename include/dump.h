@@ -0,0 +1,37 @@
+#ifndef DUMP_H
+#define DUMP_H
+
+#include "substratum_defs.h"
+
+/*
+ * Debug artifacts (--dump=ast,symtab,cfg,tac-comments and --dump-filter=<glob>)
+ * Everything is disabled by default - callers check dump_enabled()/dump_function_enabled() before doing any formatting or I/O
+ * With multiple input files, each unit's dump files are prefixed with its output file name (see compiler_dump_file_name)
+ */
+
+enum DUMP_KIND
+{
+    DUMP_AST = 1 << 0,          // ast.dot
+    DUMP_SYMTAB = 1 << 1,       // symtab.dot
+    DUMP_CFG = 1 << 2,          // control-flows/<function>.dot
+    DUMP_TAC_COMMENTS = 1 << 3, // #<tac line> comments in generated assembly
+};
+
+struct DumpOptions
+{
+    u32 enabled;          // bitwise or of DUMP_KIND values
+    char *functionFilter; // glob which function names must match for per-function dumps (NULL for all functions)
+};
+
+// add the comma-separated dump kinds in list to options, returning false (after logging why) if any are unrecognized
+bool dump_options_parse(struct DumpOptions *options, char *list);
+
+// use options for dumps on the calling thread (NULL to disable all dumps)
+void dump_set_options(struct DumpOptions *options);
+
+bool dump_enabled(enum DUMP_KIND kind);
+
+// is kind enabled for the function named functionName? (NULL for code outside of any function)
+bool dump_function_enabled(enum DUMP_KIND kind, char *functionName);
+
+#endif
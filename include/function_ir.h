@@ -0,0 +1,58 @@
+#ifndef FUNCTION_IR_H
+#define FUNCTION_IR_H
+
+#include <stddef.h>
+
+#include "substratum_defs.h"
+
+struct BasicBlock;
+struct FunctionEntry;
+struct TACLine;
+
+/*
+ * Flat per-function IR
+ * A contiguous view of a function's code and control flow for the passes which walk it without changing it - dataflow
+ * analysis, SSA, register allocation, and code generation. Every line of the function lives in one array with each
+ * block a range of it, and the control flow edges live in compressed sparse row form.
+ *
+ * The basic blocks' TAC lists remain the form code is built and edited in, so an IR is only valid until they change.
+ */
+
+struct IrBlock
+{
+    struct BasicBlock *block;
+    size_t firstLine; // index of the block's first line in FunctionIr::lines
+    size_t nLines;
+};
+
+struct FunctionIr
+{
+    struct TACLine **lines; // every line of the function, block by block in layout order
+    size_t nLines;
+
+    struct IrBlock *blocks; // indexed by block label number, with NULL block for any label which has no block
+    size_t nBlocks;         // one more than the largest label number
+    size_t *layout;         // label numbers of the blocks, in the order their code is laid out
+    size_t nLaidOut;
+    size_t *postOrder;      // label numbers of all nLaidOut blocks in post-order of a depth-first walk from the entry block, with any blocks it can't reach walked afterwards
+
+    // indexed by block label number - the successors of block b are successors[successorStarts[b]] up to successors[successorStarts[b + 1]]
+    // predecessors likewise, and both always describe the same set of edges
+    size_t *successorStarts;
+    size_t *successors;
+    size_t *predecessorStarts;
+    size_t *predecessors;
+};
+
+// build the IR of the function's code as it currently stands in its basic blocks
+struct FunctionIr *function_ir_build(struct FunctionEntry *function);
+
+void function_ir_free(struct FunctionIr *ir);
+
+// return a pointer to the label numbers of the successors of the given block, setting nSuccessors to how many there are
+size_t *function_ir_successors(struct FunctionIr *ir, size_t labelNum, size_t *nSuccessors);
+
+// return a pointer to the label numbers of the predecessors of the given block, setting nPredecessors to how many there are
+size_t *function_ir_predecessors(struct FunctionIr *ir, size_t labelNum, size_t *nPredecessors);
+
+#endif
@@ -1,22 +1,19 @@
 #ifndef Idfa_H
 #define Idfa_H
 
+#include "bit_vector.h"
 #include "util.h"
 
-#include "mbcl/array.h"
-#include "mbcl/set.h"
+#include "mbcl/hash_table.h"
 
-struct BasicBlock;
+struct FunctionIr;
+struct TACOperand;
 
 struct IdfaContext
 {
     char *name;
-    size_t nBlocks; // number of basic blocks
-    Array *blocks;  // array of pointers to basic blocks, indexed by block label number
-    // indexed by block label number - successors[i] contains the Set of blocks which blocks[i] sends control flow directly to
-    Array *successors;
-    // indexed by block label number - predecessors[i] contains the Set of blocks which send control flow directly to blocks[i]
-    Array *predecessors;
+    size_t nBlocks;        // number of basic blocks
+    struct FunctionIr *ir; // code and control flow edges of the function being analyzed, with blocks indexed by label number
 };
 
 enum IDFA_ANALYSIS_DIRECTION
@@ -25,17 +22,18 @@ enum IDFA_ANALYSIS_DIRECTION
     D_BACKWARDS,
 };
 
-struct IdfaContext *idfa_context_create(char *name, List *blocks);
+// the context refers to ir, which must outlive it
+struct IdfaContext *idfa_context_create(char *name, struct FunctionIr *ir);
 
 void idfa_context_free(struct IdfaContext *context);
 
 struct IdfaFacts
 {
-    // arrays of set pointers, indexed by block
-    Array *in;
-    Array *out;
-    Array *gen;
-    Array *kill;
+    // bit vectors over the numbered facts of the analysis, indexed by block label number
+    struct BitVector *in;
+    struct BitVector *out;
+    struct BitVector *gen;
+    struct BitVector *kill;
 };
 
 struct Idfa
@@ -43,27 +41,41 @@ struct Idfa
     struct IdfaContext *context;
 
     ssize_t (*compareFacts)(void *factA, void *factB);
+    size_t (*hashFact)(void *fact); // must agree with compareFacts
     char *(*sprintFact)(void *factData);
+
+    // every operand read or written in the function is numbered, with operands equal under compareFacts sharing a
+    // number, so that fact n is bit n of each of the vectors in facts
+    HashTable *factNumbers;            // operand -> size_t * number
+    struct TACOperand **numberedFacts; // the first operand seen with each number
+    size_t nFacts;
+
     struct IdfaFacts facts;
     enum IDFA_ANALYSIS_DIRECTION direction;
 
-    // pointer to function returning a Set
-    Set *(*fTransfer)(struct Idfa *idfa, struct BasicBlock *block, Set *facts);
+    // pointer to function computing the facts leaving the block with the given label (out for a forwards analysis, in for
+    // a backwards one) from those entering it, writing them to transferred
+    void (*fTransfer)(struct Idfa *idfa, size_t labelNum, struct BitVector *facts, struct BitVector *transferred);
     // pointer to function to find the gen and kill set for all basic blocks
     void (*findGenKills)(struct Idfa *idfa);
-    // pionter to function taking 2 sets and returning a new set with the meet of them (union or intersection)
-    Set *(*fMeet)(Set *factsA, Set *factsB);
+    // pointer to function meeting src into dest in place (bit_vector_union or bit_vector_intersect), returning whether dest changed
+    bool (*fMeet)(struct BitVector *dest, struct BitVector *src);
 };
 
 struct Idfa *idfa_create(struct IdfaContext *context,
-                         Set *(*fTransfer)(struct Idfa *idfa, struct BasicBlock *block, Set *facts), // transfer function
-                         void (*findGenKills)(struct Idfa *idfa),                                    // findGenKills function
-                         enum IDFA_ANALYSIS_DIRECTION direction,                                     // direction which data flows in the analysis
-                         ssize_t (*compareFacts)(void *factA, void *factB),                          // compare function for facts in the domain of the analysis
-                         char *(*sprintFact)(void *factData),                                        // print function for facts in the domain of the analysis, returning a string of the printed data
-                         Set *(*fMeet)(Set *factsA, Set *factsB));                                   // set operation used to collect data from predecessor/successor blocks
-
-void idfa_print_facts(struct Idfa *idfa);
+                         void (*fTransfer)(struct Idfa *idfa, size_t labelNum, struct BitVector *facts, struct BitVector *transferred), // transfer function
+                         void (*findGenKills)(struct Idfa *idfa),                                                                       // findGenKills function
+                         enum IDFA_ANALYSIS_DIRECTION direction,                                                                        // direction which data flows in the analysis
+                         ssize_t (*compareFacts)(void *factA, void *factB),                                                             // compare function for facts in the domain of the analysis
+                         size_t (*hashFact)(void *fact),                                                                                // hash function for facts in the domain of the analysis
+                         char *(*sprintFact)(void *factData),                                                                           // print function for facts in the domain of the analysis, returning a string of the printed data
+                         bool (*fMeet)(struct BitVector *dest, struct BitVector *src));                                                 // operation used to collect data from predecessor/successor blocks
+
+// number of the fact equal to the given operand
+size_t idfa_fact_number(struct Idfa *idfa, struct TACOperand *fact);
+
+// operand standing for the given fact number
+struct TACOperand *idfa_fact(struct Idfa *idfa, size_t number);
 
 void idfa_analyze_forwards(struct Idfa *idfa);
 
@@ -3,6 +3,13 @@
 
 #include "idfa.h"
 
+struct TACLine;
+
+// backwards analysis of which variables and temps are live into (in) and out of (out) each block
 struct Idfa *analyze_live_vars(struct IdfaContext *context);
 
+// walk the lines of a block from last to first, calling visitLine with the facts live immediately after each one
+// liveAfter is only valid for the duration of the call
+void live_vars_walk_block(struct Idfa *liveVars, size_t labelNum, void (*visitLine)(struct Idfa *liveVars, struct TACLine *line, struct BitVector *liveAfter, void *data), void *data);
+
 #endif
@@ -22,7 +22,8 @@ void reserve_and_store_stack_args(struct Ast *callTree,
                                   struct BasicBlock *block,
                                   size_t *tacIndex);
 
-struct SymbolTable *walk_program(struct Ast *program);
+// walk the program's AST, generating its code and populating programTable (from symbol_table_new) with everything it declares
+void walk_program(struct SymbolTable *programTable, struct Ast *program);
 
 void walk_type_name(struct Ast *tree, struct Scope *scope,
                     struct Type *populateTypeTo,
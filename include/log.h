@@ -1,6 +1,10 @@
 #ifndef LOG_H
 #define LOG_H
 
+#include <setjmp.h>
+#include <stdio.h>
+
+#include "source_location.h"
 #include "substratum_defs.h"
 
 struct Ast;
@@ -16,14 +20,34 @@ enum LOG_LEVEL
 
 void set_log_level(enum LOG_LEVEL newLevel);
 
+enum LOG_LEVEL get_log_level();
+
+// redirect log output from the calling thread (NULL for stdout)
+void log_set_output(FILE *output);
+
+// log output destination of the calling thread
+FILE *log_output();
+
+// on the calling thread, longjmp to handler on fatal errors instead of exiting (NULL to exit)
+void log_set_fatal_handler(jmp_buf *handler);
+
+// the calling thread's fatal error handler, if any
+jmp_buf *log_get_fatal_handler();
+
+// flush logs and either exit or jump to the calling thread's fatal error handler
+_Noreturn void log_fatal_exit();
+
 void log_function(const char *file, size_t line, enum LOG_LEVEL level, const char *format, ...);
 
 void log_tree_function(const char *file, size_t line, enum LOG_LEVEL level, struct Ast *tree, const char *format, ...);
 
+void log_loc_function(const char *file, size_t line, enum LOG_LEVEL level, SourceLoc loc, const char *format, ...);
+
 #define log(level, format, ...) log_function(__FILE__, __LINE__, level, format, ##__VA_ARGS__)
 #define log_tree(level, tree, format, ...) log_tree_function(__FILE__, __LINE__, level, tree, format, ##__VA_ARGS__)
+#define log_loc(level, loc, format, ...) log_loc_function(__FILE__, __LINE__, level, loc, format, ##__VA_ARGS__)
 #define InternalError(format, ...)                                      \
     log_function(__FILE__, __LINE__, LOG_FATAL, format, ##__VA_ARGS__); \
-    exit(1)
+    log_fatal_exit()
 
 #endif
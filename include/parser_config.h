@@ -1,7 +1,9 @@
 #ifndef PARSER_BASE_H
 #define PARSER_BASE_H
 
+#include "preprocessor.h"
 #include "substratum_defs.h"
+#include "util.h"
 struct LinkedList;
 struct ParseProgress;
 
@@ -19,17 +21,17 @@ void set_current_file(struct ParseProgress *auxil, char *preprocessorLine, u32 l
 #define CHARS_THIS_LINE(auxil) (*(size_t *)((auxil)->charsRemainingPerLine->head->data))
 #define CHARS_LAST_LINE(auxil) (*(size_t *)((auxil)->charsRemainingPerLine->tail->data))
 
-#define PCC_GETCHAR(auxil) ({             \
-    int inChar = fgetc((auxil)->f);       \
-    if ((inChar) == EOF)                  \
-    {                                     \
-        (auxil)->eofReceived = 1;         \
-    }                                     \
-    else                                  \
-    {                                     \
-        track_character(auxil, (inChar)); \
-    }                                     \
-    (inChar);                             \
+#define PCC_GETCHAR(auxil) ({                              \
+    int inChar = preprocessor_getc((auxil)->preprocessor); \
+    if ((inChar) == EOF)                                   \
+    {                                                      \
+        (auxil)->eofReceived = 1;                          \
+    }                                                      \
+    else                                                   \
+    {                                                      \
+        track_character(auxil, (inChar));                  \
+    }                                                      \
+    (inChar);                                              \
 })
 
 #define PCC_ERROR(auxil)                                                   \
@@ -62,11 +64,11 @@ void set_current_file(struct ParseProgress *auxil, char *preprocessorLine, u32 l
 
 #define AST_S(original, newrightmost) ast_construct_add_sibling(original, newrightmost)
 #define AST_C(parent, child) ast_construct_add_child(parent, child)
-#define AST_N(auxil, token, value, location)                                                                                                            \
-    ({                                                                                                                                                  \
-        struct Ast *created = ast_new(token, dictionary_lookup_or_insert((auxil)->dict, (value)), (auxil)->curFile, (auxil)->curLine, (auxil)->curCol); \
-        manage_source_location(auxil, value);                                                                                                           \
-        created;                                                                                                                                        \
+#define AST_N(auxil, token, value, location)                                                                                                                                    \
+    ({                                                                                                                                                                          \
+        struct Ast *created = ast_new((auxil)->astArena, token, string_interner_intern((auxil)->interner, (value), NULL), (auxil)->curFile, (auxil)->curLine, (auxil)->curCol); \
+        manage_source_location(auxil, value);                                                                                                                                   \
+        created;                                                                                                                                                                \
     })
 
 #endif
@@ -0,0 +1,104 @@
+#ifndef PCH_H
+#define PCH_H
+
+#include "substratum_defs.h"
+
+#include "ast.h"
+#include "preprocessor.h"
+
+/*
+ * Precompiled headers (.sbpch)
+ * A precompiled header holds the parsed AST of a header along with the preprocessor state (macros and included files)
+ * left behind by it, so that later compiles can skip preprocessing and parsing the header entirely.
+ *
+ * The file is a flat image of fixed-size records which is memory-mapped when loaded - strings in the loaded AST point
+ * directly into the mapping, so it must outlive the AST and anything (such as the symbol table) built from it.
+ */
+
+#define PCH_MAGIC "SBPCH\0\0"
+#define PCH_VERSION 1
+
+// references into the string table are byte offsets - this one means "no string"
+#define PCH_NO_STRING U32_MAX
+// references to other nodes are index + 1, with 0 meaning no node
+#define PCH_NO_NODE 0
+
+struct PchFileHeader
+{
+    char magic[8];
+    u32 version;
+    u32 nNodes;
+    u32 nMacros;
+    u32 nMacroParameters;
+    u32 nDependencies;
+    u32 rootNode;
+    u64 stringTableSize;
+    // followed by: dependencies, nodes, macros, macro parameters, string table
+};
+
+struct PchNode
+{
+    u32 value;
+    u32 type;
+    u32 child;
+    u32 sibling;
+    u32 sourceLine;
+    u32 sourceCol;
+    u32 sourceFile;
+};
+
+struct PchMacro
+{
+    u32 name;
+    u32 body;
+    u32 firstParameter;
+    u32 nParameters; // U32_MAX for object-like macros
+};
+
+// a file read while preprocessing the header, checked for modification when the PCH is loaded
+struct PchDependency
+{
+    u32 path;
+    u32 guardMacro;
+    u32 pragmaOnce;
+    u32 padding;
+    i64 modifiedSec;
+    i64 modifiedNsec;
+    i64 size;
+};
+
+struct PrecompiledHeader
+{
+    char *fileName;
+    u8 *mapping;
+    size_t mappingSize;
+    bool isMapped; // false if the image was built in memory (see pch_precompile_preamble)
+    struct PchFileHeader *header;
+    struct PchNode *nodes;
+    struct PchMacro *macros;
+    u32 *macroParameters;
+    struct PchDependency *dependencies;
+    char *strings;
+};
+
+// preprocess and parse headerFileName, writing the result to outFileName - returns false on failure
+bool pch_emit(char *headerFileName, char *outFileName);
+
+// precompile the first preambleLength bytes of mainFile (see preprocessor_preamble_length) in memory, returning NULL on failure
+struct PrecompiledHeader *pch_precompile_preamble(struct IncludedFile *mainFile, size_t preambleLength);
+
+// whether every file the precompiled header was built from is unchanged since
+bool pch_is_up_to_date(struct PrecompiledHeader *pch);
+
+// map a precompiled header, returning NULL (after logging why) if it is invalid or out of date
+struct PrecompiledHeader *pch_load(char *fileName);
+
+void pch_free(struct PrecompiledHeader *pch);
+
+// define the header's macros and mark its files as included, as if the header had been #included by preprocessor
+void pch_apply_to_preprocessor(struct PrecompiledHeader *pch, struct Preprocessor *preprocessor);
+
+// rebuild the header's AST with nodes allocated from arena - node values and source files point into the mapping
+struct Ast *pch_build_ast(struct PrecompiledHeader *pch, struct Arena *arena);
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef PREPROCESSOR_H
+#define PREPROCESSOR_H
+
+#include <sys/stat.h>
+
+#include "substratum_defs.h"
+
+#include "mbcl/hash_table.h"
+#include "mbcl/list.h"
+#include "mbcl/stack.h"
+
+/*
+ * In-process preprocessor which streams preprocessed text directly into the parser
+ * Supports #include (with -I search paths), object-like and function-like #defines, #undef, conditionals and #pragma once
+ * Emits gcc-style line markers so that the parser's existing file/line tracking works unchanged
+ */
+
+// a file known to the include cache - each file is read from disk at most once per cache
+struct IncludedFile
+{
+    char *path;
+    char *contents; // NULL if the file doesn't exist (negative cache entry for include path searches)
+    size_t length;
+    char *guardMacro; // if the entire file is wrapped in #ifndef X/#define X/#endif, X
+    bool pragmaOnce; // file contains #pragma once
+    struct timespec modified; // modification time and size when read, for revalidation by long-lived caches
+    off_t size;
+};
+
+struct IncludeCache
+{
+    HashTable *files; // path -> struct IncludedFile
+};
+
+struct IncludeCache *include_cache_new();
+
+void include_cache_free(struct IncludeCache *cache);
+
+// look up (reading from disk on first use) the file at path
+struct IncludedFile *include_cache_lookup(struct IncludeCache *cache, char *path);
+
+// drop any entries whose files have changed (or appeared/disappeared) on disk since they were read
+void include_cache_revalidate(struct IncludeCache *cache);
+
+struct Macro
+{
+    char *name;
+    List *parameters; // NULL for object-like macros
+    char *body;
+    bool isDefined;
+    bool isExpanding; // set while rescanning this macro's own expansion to prevent infinite recursion
+};
+
+enum INCLUDE_GUARD_STATE
+{
+    IGS_START,        // haven't seen anything significant in the file yet
+    IGS_INSIDE_GUARD, // first significant line was #ifndef X, and we are within it
+    IGS_AFTER_GUARD,  // the #ifndef X has been closed, only whitespace may follow
+    IGS_NONE,         // file isn't wrapped in an include guard
+};
+
+// a file currently being read by the preprocessor
+struct PreprocessorSource
+{
+    struct IncludedFile *file;
+    size_t position;
+    size_t line; // line number of the next physical line to read
+    size_t conditionalDepth; // depth of the conditional stack when this file was entered
+    enum INCLUDE_GUARD_STATE guardState;
+    char *guardCandidate;
+};
+
+struct PreprocessorBuffer
+{
+    char *data;
+    size_t length;
+    size_t capacity;
+};
+
+struct Preprocessor
+{
+    List *includePath;
+    struct IncludeCache *includeCache;
+    HashTable *macros;   // name -> struct Macro
+    Stack *sources;      // stack of struct PreprocessorSource
+    Stack *conditionals; // stack of struct PreprocessorConditional
+    HashTable *includedFiles; // path -> struct IncludedFile for every file included so far by this preprocessor
+    struct PreprocessorBuffer lineBuffer;
+    struct PreprocessorBuffer output;
+    size_t outputPosition;
+    size_t expandingLine; // line number reported by __LINE__
+};
+
+struct Preprocessor *preprocessor_new(List *includePath, struct IncludeCache *includeCache);
+
+void preprocessor_free(struct Preprocessor *preprocessor);
+
+// (re)define a macro - name, parameters, and body are owned by the macro table after this call
+void preprocessor_define_macro(struct Preprocessor *preprocessor, char *name, List *parameters, char *body);
+
+// record that path has already been included (with the given guard macro/pragma once state), as when restoring a precompiled header
+void preprocessor_mark_included(struct Preprocessor *preprocessor, char *path, char *guardMacro, bool pragmaOnce);
+
+// begin preprocessing fileName ("stdin" to read from standard input)
+void preprocessor_begin(struct Preprocessor *preprocessor, char *fileName);
+
+// begin preprocessing a file which isn't in the include cache (such as a preamble split off of another file), owned by the caller
+// unlike preprocessor_begin, the file isn't recorded as included
+void preprocessor_begin_detached(struct Preprocessor *preprocessor, struct IncludedFile *file);
+
+// skip over the first length bytes (nLines lines) of the file which has just been begun, as when they have been precompiled
+void preprocessor_skip(struct Preprocessor *preprocessor, size_t length, size_t nLines);
+
+// length of the preamble of a file - the leading lines which are only #include directives, comments, or blank
+// nLinesOut receives the number of lines the preamble spans
+size_t preprocessor_preamble_length(const char *contents, size_t length, size_t *nLinesOut);
+
+// get the next character of preprocessed output, or EOF once all input is consumed
+int preprocessor_getc(struct Preprocessor *preprocessor);
+
+// preprocess all remaining input up front so that preprocessor->output holds the entire preprocessed text
+// subsequent calls to preprocessor_getc will consume it as usual
+void preprocessor_read_all(struct Preprocessor *preprocessor);
+
+#endif
@@ -15,6 +15,8 @@ struct TACOperand;
 struct TACLine;
 struct LinkedList;
 struct Scope;
+struct RegallocMetadata;
+struct VariableEntry;
 
 enum WRITEBACK_LOCATION
 {
@@ -28,7 +30,8 @@ struct Lifetime
 {
     size_t start, end, nwrites, nreads;
     char *name;
-    struct Type type;
+    size_t index; // dense index of this lifetime within its function (see RegallocMetadata::lifetimes), which lifetimes are compared by
+    struct Type *type; // canonical (see type_table.h)
     enum WRITEBACK_LOCATION wbLocation;
     union
     {
@@ -38,9 +41,11 @@ struct Lifetime
     u8 isArgument;
 };
 
-struct Lifetime *lifetime_find_by_name(Set *allLifetimes, char *lifetimeName);
+// find the lifetime of a variable (such as an argument) by its name, without needing an operand which refers to it
+struct Lifetime *lifetime_find_for_variable(struct RegallocMetadata *metadata, struct VariableEntry *variable);
 
-struct Lifetime *lifetime_find(Set *allLifetimes, struct TACOperand *operand);
+// find the lifetime of the variable or temp operand refers to (NULL for literals)
+struct Lifetime *lifetime_find(struct RegallocMetadata *metadata, struct TACOperand *operand);
 
 struct Lifetime *lifetime_new(char *name,
                               struct Type *type,
@@ -57,9 +62,9 @@ bool lifetime_is_live_at_index(struct Lifetime *lifetime, size_t index);
 bool lifetime_is_live_after_index(struct Lifetime *lifetime, size_t index);
 
 // update the lifetime start/end indices
-// returns pointer to the lifetime corresponding to the passed variable name
-struct Lifetime *update_or_insert_lifetime(Set *lifetimes,
-                                           char *name,
+// returns pointer to the lifetime corresponding to the passed variable
+struct Lifetime *update_or_insert_lifetime(struct RegallocMetadata *metadata,
+                                           struct VariableEntry *variable,
                                            struct Type *type,
                                            size_t newEnd,
                                            u8 isGlobal,
@@ -67,19 +72,20 @@ struct Lifetime *update_or_insert_lifetime(Set *lifetimes,
 
 // wrapper function for updateOrInsertLifetime
 //  increments write count for the given variable
-void record_variable_write(Set *lifetimes,
+void record_variable_write(struct RegallocMetadata *metadata,
                            struct TACOperand *writtenOperand,
-                           struct Scope *scope,
                            size_t newEnd);
 
 // wrapper function for updateOrInsertLifetime
 //  increments read count for the given variable
-void record_variable_read(Set *lifetimes,
+void record_variable_read(struct RegallocMetadata *metadata,
                           struct TACOperand *readOperand,
-                          struct Scope *scope,
                           size_t newEnd);
 
-Set *find_lifetimes(struct Scope *scope, List *basicBlockList);
+// populate metadata->lifetimes and metadata->lifetimesByName from the function's arguments and TAC (walked through its IR, which must be built)
+// the lifetime index of each variable and temp operand in the TAC is set as it is seen
+// each lifetime spans from the first to the last TAC index at which its variable or temp is referenced or live
+void find_lifetimes(struct RegallocMetadata *metadata);
 
 struct Register
 {
@@ -131,12 +137,31 @@ struct Register *find_register_by_name(struct MachineInfo *info, char *name);
 
 // things more related to codegen than specifically register allocation
 
+// open-addressed hash of a function's variable lifetimes by the interned id of the variable's name
+struct LifetimeNameSlot
+{
+    struct Lifetime *lifetime; // NULL for an empty slot
+    u32 nameId;
+};
+
+struct LifetimeNameIndex
+{
+    struct LifetimeNameSlot *slots;
+    size_t nSlots; // always a power of two
+    size_t nUsed;
+};
+
 struct RegallocMetadata
 {
     struct FunctionEntry *function; // symbol table entry for the function the register allocation data is for
     struct Scope *scope;            // scope at which we are generating (identical to function->mainScope if in a function)
 
-    Set *allLifetimes; // every lifetime that exists within this function based on variables and TAC operands (puplated during regalloc)
+    // every lifetime that exists within this function based on variables and TAC operands (populated during regalloc),
+    // indexed by lifetime index - NULL at index 0 (no lifetime), then the function's temps by number, then variables
+    struct Lifetime **lifetimes;
+    size_t nLifetimes;
+    size_t lifetimesCapacity;
+    struct LifetimeNameIndex lifetimesByName; // the variable lifetimes again, by name
 
     Set *touchedRegisters;
 
@@ -147,4 +172,7 @@ struct RegallocMetadata
     ssize_t localStackSize;
 };
 
+// free the lifetimes and other register allocation results for a function
+void regalloc_metadata_deinit(struct RegallocMetadata *metadata);
+
 #endif
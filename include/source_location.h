@@ -0,0 +1,55 @@
+#ifndef SOURCE_LOCATION_H
+#define SOURCE_LOCATION_H
+
+#include "substratum_defs.h"
+
+struct Ast;
+
+/*
+ * Compact source locations
+ * Rather than carrying a copy of the AST node they came from, TAC lines and functions refer to their position in the
+ * source by a 32-bit handle into the location table of the translation unit being compiled on the calling thread.
+ */
+
+typedef u32 SourceLoc;
+
+// handle for which no location is known
+#define SOURCE_LOC_NONE ((SourceLoc)0)
+
+struct SourceLocation
+{
+    u32 fileId;
+    u32 line;
+    u32 col;
+};
+
+struct SourceLocationTable
+{
+    char **fileNames; // indexed by fileId
+    size_t nFiles;
+    size_t filesCapacity;
+    struct SourceLocation *locations; // indexed by SourceLoc
+    size_t nLocations;
+    size_t locationsCapacity;
+    char *lastFileName; // file name pointer most recently looked up, and its id - locations tend to come in runs
+    u32 lastFileId;
+};
+
+struct SourceLocationTable *source_location_table_new();
+
+void source_location_table_free(struct SourceLocationTable *table);
+
+// look up and record locations in table on the calling thread (NULL when not compiling)
+void source_location_table_set_active(struct SourceLocationTable *table);
+
+// get a handle for the location of tree in the active table
+SourceLoc source_location_of(struct Ast *tree);
+
+struct SourceLocation *source_location_get(SourceLoc loc);
+
+char *source_location_file_name(SourceLoc loc);
+
+// populate the location fields of tree from loc, for interfaces which report errors against an AST
+void source_location_populate_ast(SourceLoc loc, struct Ast *tree);
+
+#endif
@@ -21,6 +21,7 @@ struct SymbolTable
 {
     char *name;
     struct Scope *globalScope;
+    struct Arena *tacArena; // TAC of global code
 };
 /*
  * the create/lookup functions that use an AST (with simpler names) are the primary functions which should be used
@@ -43,12 +44,9 @@ void symbol_table_dump_dot(FILE *outFile,
 
 void symbol_table_print_cfgs(struct SymbolTable *table, char *outDir);
 
-Set *symbol_table_collapse_scopes_rec(struct Scope *scope,
-                                      struct Dictionary *dict,
-                                      size_t depth);
-
+// flatten the scopes within each function into its main scope, hoisting global variables to the global scope
 void symbol_table_collapse_scopes(struct SymbolTable *table,
-                                  struct Dictionary *dict);
+                                  struct StringInterner *interner);
 
 void symbol_table_free(struct SymbolTable *table);
 
@@ -8,6 +8,7 @@
 #include "mbcl/set.h"
 
 #define FUNCTION_EXIT_BLOCK_LABEL ((ssize_t)0)
+#define FUNCTION_ENTRY_BLOCK_LABEL (FUNCTION_EXIT_BLOCK_LABEL + 1)
 
 struct StructDesc;
 
@@ -4,7 +4,9 @@
 #include "substratum_defs.h"
 
 #include "ast.h"
+#include "function_ir.h"
 #include "regalloc_generic.h"
+#include "source_location.h"
 #include "symtab_scope.h"
 #include "type.h"
 
@@ -20,8 +22,10 @@ struct FunctionEntry
     char *name;                       // duplicate pointer from ScopeMember for ease of use
     struct TypeEntry *implementedFor; // if this function is part of an implementation for a type, points to which type
     List *BasicBlockList;
-    struct Ast correspondingTree;
-    size_t tempNum;
+    struct Arena *tacArena; // TAC lines and operands of this function's basic blocks, NULL once released after codegen
+    struct FunctionIr *ir;  // flat view of the function's final code for regalloc and codegen, NULL until built by regalloc
+    SourceLoc location;
+    Deque *temps; // TempVariables created by the linearizer, indexed by their number
     u8 isDefined;
     u8 isAsmFun;
     u8 callsOtherFunction; // is it possible this function calls another function? (need to store return address on stack)
@@ -33,6 +37,21 @@ struct FunctionEntry *function_entry_new(struct Scope *parentScope, struct Ast *
 
 void function_entry_free(struct FunctionEntry *function);
 
+// create a new temp of the given type, numbered after the function's existing temps
+struct TempVariable *function_entry_new_temp(struct FunctionEntry *function, struct Type *type);
+
+// clone all of toClone's temps into cloned, which must not have any temps yet - numbers are preserved
+void function_entry_clone_temps(struct FunctionEntry *cloned, struct FunctionEntry *toClone);
+
+// resolve generic parameters in the function's return type, temps, and scopes
+void function_entry_resolve_generics(struct FunctionEntry *function, HashTable *paramsMap, char *resolvedStructName, List *resolvedParams);
+
+// resolve VT_SELF in the function's return type, temps, and scopes
+void function_entry_resolve_capital_self(struct FunctionEntry *function, struct TypeEntry *theType);
+
+// free the function's TAC once nothing will read it again (after its code is generated), leaving its basic blocks empty
+void function_entry_release_tac(struct FunctionEntry *function);
+
 void function_entry_print_cfg(struct FunctionEntry *function, FILE *outFile);
 
 char *sprint_function_signature(struct FunctionEntry *function);
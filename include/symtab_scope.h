@@ -7,6 +7,7 @@
 #include "type.h"
 #include <stdio.h>
 
+#include "mbcl/deque.h"
 #include "mbcl/hash_table.h"
 #include "mbcl/list.h"
 #include "mbcl/set.h"
@@ -34,20 +35,48 @@ enum ACCESS
 struct ScopeMember
 {
     char *name;
+    u32 nameId; // id of name in the string interner, which members are compared by
     void *entry;
     enum SCOPE_MEMBER_TYPE type;
     enum ACCESS accessibility;
 };
 
+// open-addressed hash of scope members by (name id, member type)
+struct ScopeIndexSlot
+{
+    struct ScopeMember *member; // NULL for a cached lookup which found nothing
+    u32 nameId;
+    u32 typePlusOne; // 0 for an empty slot
+    u64 generation;  // for lookup cache slots, the scope generation as of when the lookup was done
+};
+
+struct ScopeIndex
+{
+    struct ScopeIndexSlot *slots;
+    size_t nSlots; // always a power of two
+    size_t nUsed;
+};
+
 struct Scope
 {
     struct Scope *parentScope;
     struct FunctionEntry *parentFunction;
-    Set *entries;
+    Deque *entries;                // ScopeMember pointers, in the order they were inserted
+    struct ScopeIndex members;     // the same members, hashed for lookup
+    struct ScopeIndex lookupCache; // results of scope_lookup() from this scope which had to search parent scopes
     u8 subScopeCount;
     char *name; // duplicate pointer from ScopeMember for ease of use
 };
 
+// orders members by type, then by interned name id
+ssize_t scope_member_compare(struct ScopeMember *memberA, struct ScopeMember *memberB);
+
+// free a member along with whatever it refers to
+void scope_member_free(struct ScopeMember *member);
+
+// release the per-thread bookkeeping used to validate cached lookups
+void scope_free_lookup_generations();
+
 // scope functions
 struct Scope *scope_new(struct Scope *parentScope,
                         char *name,
@@ -75,6 +104,12 @@ void scope_remove(struct Scope *scope,
                   char *name,
                   enum SCOPE_MEMBER_TYPE type);
 
+// insert an existing member (such as one lifted out of a subscope)
+void scope_insert_member(struct Scope *scope, struct ScopeMember *member);
+
+// remove every member in toRemove (a set ordered by scope_member_compare) from the scope without freeing them
+void scope_remove_members(struct Scope *scope, Set *toRemove);
+
 struct Scope *scope_create_sub_scope(struct Scope *scope);
 
 // create an argument within the given scope
@@ -186,6 +221,9 @@ struct TraitEntry *scope_lookup_trait(struct Scope *scope, struct Ast *nameTree)
 
 void scope_clone_to(struct Scope *clonedTo, struct Scope *toClone, struct TypeEntry *newImplementedFor);
 
+// deep copy of toClone (including its TAC) whose main scope is a child of cloneTo - the caller is responsible for inserting it
+struct FunctionEntry *function_entry_clone(struct FunctionEntry *toClone, struct Scope *cloneTo, struct TypeEntry *newImplementedFor);
+
 void scope_resolve_capital_self(struct Scope *scope, struct TypeEntry *theType);
 
 void scope_resolve_generics(struct Scope *scope, HashTable *paramsMap, char *resolvedStructName, List *resolvedParams);
@@ -13,6 +13,14 @@ enum TYPE_PERMUTATION
     TP_ENUM,
 };
 
+// size and alignment of a struct or enum, computed once its fields are final (see type_entry_get_layout)
+struct TypeLayout
+{
+    bool computed;
+    u8 alignment;
+    size_t size;
+};
+
 struct TypeEntry
 {
     char *baseName;
@@ -33,13 +41,15 @@ struct TypeEntry
         } base;
         struct
         {
-            List *parameters; // list of types which are the actual types of the generic parameters
+            List *parameters;      // list of types which are the actual types of the generic parameters
+            struct TypeEntry *base; // generic base this is an instance of, whose implemented functions are cloned on demand
         } instance;
     } generic;
     struct Scope *parentScope;
     Set *traits;
     struct Scope *implemented;
     HashTable *implementedByName;
+    struct TypeLayout layout;
 };
 
 struct TypeEntry *type_entry_new_primitive(struct Scope *parentScope, enum BASIC_TYPES basicType);
@@ -77,8 +87,21 @@ struct FunctionEntry *type_entry_lookup_associated_function(struct TypeEntry *ty
 
 void type_entry_resolve_capital_self(struct TypeEntry *typeEntry);
 
+// returns the size and alignment of a struct or enum type, memoizing them unless the type still has unresolved generics
+struct TypeLayout *type_entry_get_layout(struct TypeEntry *typeEntry);
+
+// forget any memoized layout - must be called whenever field types, offsets, or union sizes of typeEntry change
+void type_entry_invalidate_layout(struct TypeEntry *typeEntry);
+
 void type_entry_resolve_generics(struct TypeEntry *instance, List *paramNames, List *paramTypes);
 
+// return the implemented function called name of a generic instance, cloning and resolving it from the base if this is its first use
+// returns NULL if the base implements no such function
+struct FunctionEntry *type_entry_instantiate_implemented(struct TypeEntry *instance, char *name);
+
+// instantiate everything a concrete function calls on generic instances - must be called again if TAC containing new calls is added to it
+void type_entry_instantiate_callees(struct FunctionEntry *function);
+
 struct TypeEntry *type_entry_get_or_create_generic_instantiation(struct TypeEntry *baseType, List *paramsList);
 
 void type_entry_verify_trait(struct Ast *implTree,
@@ -10,7 +10,8 @@ struct VariableEntry
 {
     ssize_t stackOffset;
     char *name; // duplicate pointer from ScopeMember for ease of use
-    struct Type type;
+    u32 nameId; // id of name in the string interner
+    struct Type *type; // canonical (see type_table.h) - to change it, intern a modified copy
     // if this variable has the address-of operator used on it or is a global variable
     // we need to denote that it *must* live in memory so it isn't lost
     // and can have an address
@@ -18,8 +19,12 @@ struct VariableEntry
     bool isGlobal;
     bool isExtern;
     bool isStringLiteral;
+    // initial values of globals, which live here rather than in the type because canonical types carry no initializers
+    u8 *initializeTo;         // non-array globals
+    void **initializeArrayTo; // array globals such as string literals, one allocation per element
 };
 
+// type is interned rather than taken over, so the caller still owns it
 struct VariableEntry *variable_entry_new(char *name,
                                          struct Type *type,
                                          bool isGlobal,
@@ -32,4 +37,6 @@ void variable_entry_print(struct VariableEntry *variable, FILE *outFile, size_t
 
 void variable_entry_try_resolve_generic(struct VariableEntry *variable, HashTable *paramsMap, char *resolvedStructName, List *resolvedParams);
 
+void variable_entry_resolve_vt_self(struct VariableEntry *variable, struct TypeEntry *theType);
+
 #endif
@@ -1,7 +1,9 @@
 #ifndef TAC_H
 #define TAC_H
 
+#include "arena.h"
 #include "ast.h"
+#include "source_location.h"
 #include "tac_operand.h"
 #include "type.h"
 
@@ -230,11 +232,9 @@ struct TacDrop
 
 struct TACLine
 {
-    char *allocFile;
-    int allocLine;
-    // store the actual tree because some trees are manually generated and do not exist in the true parse tree
+    // location of the tree this line was generated from, which may not exist in the true parse tree
     // such as the += operator (a += b is transformed into a tree corresponding to a = a + b)
-    struct Ast correspondingTree;
+    SourceLoc location;
     union
     {
         struct TacAsm asm_;
@@ -274,24 +274,48 @@ void print_tac_line(struct TACLine *line);
 
 char *sprint_tac_line(struct TACLine *line);
 
-struct TACLine *new_tac_line_function(enum TAC_TYPE operation, struct Ast *correspondingTree, char *file, int line);
-#define new_tac_line(operation, correspondingTree) new_tac_line_function((operation), (correspondingTree), __FILE__, __LINE__)
+// create an arena to allocate one function's (or a translation unit's global) TAC from
+struct Arena *tac_arena_new();
+
+// allocate TAC lines and operands created by the calling thread from arena, returning the previously set arena
+// each function's TAC lives in its own arena (see FunctionEntry), so callers set it before emitting TAC and restore the previous arena after
+struct Arena *tac_set_arena(struct Arena *arena);
+
+// allocate a zeroed operand from the current TAC arena, for operands referenced by pointer (such as call arguments)
+struct TACOperand *tac_operand_new();
+
+struct TACLine *new_tac_line(enum TAC_TYPE operation, struct Ast *correspondingTree);
+
+struct TACLine *new_tac_line_at(enum TAC_TYPE operation, SourceLoc location);
 
 bool tac_line_is_jump(struct TACLine *line);
 
 ssize_t tac_get_jump_target(struct TACLine *line);
 
-void free_tac(struct TACLine *line);
+void tac_line_deinit(struct TACLine *line);
 
-// Enum denoting how a particular TAC operand is used
+#define TAC_LINE_MAX_FIXED_READS 3
+#define TAC_LINE_MAX_WRITES 3
+
+// The operands a TAC line reads and writes, filled in place without allocating
+// call arguments and phi sources are not copied - variadicReads points at the line's own deque of them
 struct OperandUsages
 {
-    Deque *reads;
-    Deque *writes;
+    struct TACOperand *reads[TAC_LINE_MAX_FIXED_READS];
+    struct TACOperand *writes[TAC_LINE_MAX_WRITES];
+    u8 nReads;
+    u8 nWrites;
+    Deque *variadicReads; // NULL if the line has no arguments or sources
 };
 
 struct OperandUsages get_operand_usages(struct TACLine *line);
 
+// total number of operands read, including any call arguments or phi sources
+size_t operand_usages_n_reads(struct OperandUsages *usages);
+
+// the fixed reads come first, followed by the call arguments or phi sources
+struct TACOperand *operand_usages_read(struct OperandUsages *usages, size_t index);
+
 struct LinearizationResult
 {
     struct BasicBlock *block;
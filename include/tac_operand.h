@@ -2,10 +2,12 @@
 #define TAC_OPERAND_H
 
 #include "type.h"
+#include "type_table.h"
 
 #include <mbcl/deque.h>
 
 struct VariableEntry;
+struct TypeEntry;
 struct EnumDesc;
 struct Ast;
 
@@ -18,18 +20,31 @@ enum VARIABLE_PERMUTATIONS
     VP_LITERAL_VAL,
 };
 
+// a temporary created by the linearizer - a numbered virtual register owned by its function rather than by any scope
+struct TempVariable
+{
+    char *name;    // interned ".tN" name, used for lifetimes and printing
+    size_t number; // index of this temp in its function's temps
+    struct Type type;
+    bool mustSpill;
+};
+
+void temp_variable_free(struct TempVariable *temp);
+
 struct TACOperand
 {
     union nameUnion // name of variable as char*, or literal value as int
     {
         // TODO: come up with a better naming scheme than this...
-        struct VariableEntry *variable;
+        struct VariableEntry *variable; // VP_STANDARD
+        struct TempVariable *temp;      // VP_TEMP
         char *str;
         size_t val;
     } name;
 
     size_t ssaNumber;
-    struct Type castAsType;
+    size_t lifetimeIndex;    // index of the variable's lifetime in its function (see RegallocMetadata::lifetimes), set by find_lifetimes
+    struct Type *castAsType; // canonical type (see type_table.h) the operand is treated as, NULL to use the type of the variable
     enum VARIABLE_PERMUTATIONS permutation; // enum of permutation (standard/temp/literal)
 };
 
@@ -39,10 +54,19 @@ struct Type *tac_operand_get_type(struct TACOperand *operand);
 
 struct Type *tac_operand_get_non_cast_type(struct TACOperand *operand);
 
+// name of the variable or temp the operand refers to
+char *tac_operand_get_variable_name(struct TACOperand *operand);
+
+// require the variable or temp the operand refers to to live on the stack (for instance because its address is taken)
+void tac_operand_mark_must_spill(struct TACOperand *operand);
+
 ssize_t tac_operand_compare(void *dataA, void *dataB);
 
 ssize_t tac_operand_compare_ignore_ssa_number(void *dataA, void *dataB);
 
+// hash consistent with tac_operand_compare - operands which compare equal always hash the same
+size_t tac_operand_hash(void *data);
+
 void tac_operand_populate_from_variable(struct TACOperand *operandToPopulate, struct VariableEntry *populateFrom);
 
 void tac_operand_populate_as_temp(struct Scope *scope, struct TACOperand *operandToPopulate, struct Type *type);
@@ -53,4 +77,12 @@ void tac_operand_copy_decay_arrays(struct TACOperand *dest, struct TACOperand *s
 // copy over only the type and castAsType fields, decaying array sizes to simple pointer types
 void tac_operand_copy_type_decay_arrays(struct TACOperand *dest, struct TACOperand *src);
 
+// resolve VT_SELF or generic parameters in the operand's cast type (if it has one)
+void tac_operand_resolve_cast_vt_self(struct TACOperand *operand, struct TypeEntry *typeEntry);
+
+void tac_operand_resolve_cast_generics(struct TACOperand *operand, HashTable *paramsMap, char *resolvedStructName, List *resolvedParams);
+
+// increment the pointer level of the operand's type - that of its cast if it has one, otherwise that of its variable
+void tac_operand_increment_pointer_level(struct TACOperand *operand);
+
 #endif
@@ -0,0 +1,75 @@
+#ifndef TIME_REPORT_H
+#define TIME_REPORT_H
+
+#include <stdio.h>
+
+#include "substratum_defs.h"
+
+#include "mbcl/deque.h"
+#include "mbcl/stack.h"
+
+/*
+ * Compile-time instrumentation (-ftime-report, -ftime-trace)
+ * Records wall time, thread CPU time, allocations, and peak RSS for each compiler phase and for each function within
+ * the per-function phases. Events nest - a phase is open from time_report_begin() until the matching time_report_end().
+ *
+ * Allocations are counted by wrapping malloc/calloc/realloc at link time (-Wl,--wrap=...), so only allocations made
+ * directly by sbcc itself are seen - not those made internally by libc or by the shared mbcl library, so the counts are
+ * a lower bound. Peak RSS comes from getrusage(RUSAGE_SELF), which only reports on the whole process: with -j, the
+ * figure printed for one unit includes the memory of every unit compiled alongside it. The printed report says both.
+ */
+
+struct TimeReportSample
+{
+    u64 wallNs;
+    u64 cpuNs;
+    u64 nAllocations;
+    u64 allocatedBytes;
+};
+
+struct TimeReportEvent
+{
+    char *name;
+    struct TimeReportEvent *parent; // enclosing event, NULL for top-level phases
+    struct TimeReportSample start;
+    struct TimeReportSample elapsed;
+    long peakRssKb; // peak RSS of the whole process as of the end of this event
+};
+
+struct TimeReport
+{
+    Deque *events;     // every event, in the order it began
+    Stack *openEvents; // events which have begun but not yet ended
+    u64 originWallNs;
+
+    // work done by the dataflow solver (see idfa.c) across every analysis run while the report was active
+    u64 nDataflowAnalyses;
+    u64 nDataflowIterations; // passes over the blocks in solving order
+    u64 nDataflowVisits;     // transfer functions applied
+};
+
+struct TimeReport *time_report_new();
+
+void time_report_free(struct TimeReport *report);
+
+// record events begun/ended on the calling thread in report (NULL to stop recording)
+void time_report_set_active(struct TimeReport *report);
+
+struct TimeReport *time_report_get_active();
+
+// begin an event nested in the innermost open event - does nothing if no report is active on this thread
+void time_report_begin(const char *name);
+
+// end the innermost open event
+void time_report_end();
+
+// add one dataflow analysis reaching its fixpoint to the active report - does nothing if no report is active on this thread
+void time_report_count_dataflow(size_t nIterations, size_t nVisits);
+
+// print a table of per-phase figures, followed by the most expensive functions of each per-function phase
+void time_report_print(struct TimeReport *report, FILE *outFile);
+
+// write the report's events in Chrome's trace event format (chrome://tracing, Perfetto) - returns false on failure
+bool time_report_write_trace(struct TimeReport *report, char *fileName);
+
+#endif
@@ -97,6 +97,9 @@ struct Type *type_duplicate(struct Type *type);
 
 struct Type type_duplicate_non_pointer(struct Type *type);
 
+// entry of the struct or enum named by type, looked up only once for canonical types
+struct TypeEntry *type_lookup_entry(struct Type *type, struct Scope *scope);
+
 // gets the byte size (not aligned) of a given type
 size_t type_get_size(struct Type *type, struct Scope *scope);
 
@@ -0,0 +1,63 @@
+#ifndef TYPE_TABLE_H
+#define TYPE_TABLE_H
+
+#include "substratum_defs.h"
+#include "type.h"
+
+#include "mbcl/deque.h"
+
+/*
+ * Hash-consed types
+ * Each distinct type seen by the translation unit being compiled on the calling thread is stored once in its type
+ * table, so canonical types can be shared by pointer and compared for identity with ==. Canonical types are owned by
+ * the table and must never be modified or freed - to change one, copy it, modify the copy, and intern the result.
+ *
+ * Canonical types never carry initializer data, and their generic parameters and array element types are themselves
+ * canonical.
+ */
+
+struct TypeEntry;
+
+struct TypeTableSlot
+{
+    u32 hash;
+    struct Type *type; // NULL for an empty slot
+};
+
+// canonical types indexed by address, so whether a type is canonical can be checked without hashing its contents
+struct TypeTableEntrySlot
+{
+    struct Type *type;       // NULL for an empty slot
+    struct TypeEntry *entry; // struct or enum entry named by type, once looked up (see type_table_entry_cache)
+};
+
+struct TypeTable
+{
+    struct Arena *storage; // the canonical types and their names
+    Deque *paramLists;     // generic parameter lists of canonical types
+    struct TypeTableSlot *slots;
+    struct TypeTableEntrySlot *entrySlots; // as many as slots
+    size_t nSlots;                         // always a power of two
+    size_t nTypes;
+};
+
+struct TypeTable *type_table_new();
+
+void type_table_free(struct TypeTable *table);
+
+// intern types into table on the calling thread (NULL when not compiling)
+void type_table_set_active(struct TypeTable *table);
+
+// return the canonical copy of type from the active type table, adding it if it hasn't been seen before
+struct Type *type_intern(struct Type *type);
+
+// canonical type of a primitive with the given pointer level
+struct Type *type_intern_basic(enum BASIC_TYPES basicType, size_t pointerLevel);
+
+// canonical type of a pointer to type
+struct Type *type_intern_pointer_to(struct Type *type);
+
+// where to cache the struct or enum entry named by type, or NULL if type is not canonical (or no type table is active)
+struct TypeEntry **type_table_entry_cache(struct Type *type);
+
+#endif
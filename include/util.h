@@ -17,6 +17,9 @@ enum COMPILER_ERRORS
     ERROR_INTERNAL,
 };
 
+struct Arena;
+struct Preprocessor;
+
 struct ParseProgress
 {
     size_t curLine;
@@ -24,8 +27,9 @@ struct ParseProgress
     char *curFile;
     size_t curLineRaw;
     size_t curColRaw;
-    FILE *f;
-    struct Dictionary *dict;
+    struct Preprocessor *preprocessor;
+    struct StringInterner *interner;
+    struct Arena *astArena; // AST nodes are allocated here (their values are interned)
     List *charsRemainingPerLine;
     size_t lastMatchLocation; // location of last parser match relative to pcc buffer
     char eofReceived;
@@ -50,30 +54,65 @@ size_t parse_hex_constant(char *hexConstant);
  *
  */
 
+size_t hash_string(void *data);
+
 /*
- * Dictionary for tracking strings
- * Economizes heap space by only storing strings once each
- * Uses a simple hash table which supports different bucket counts
+ * String interner
+ * Stores each distinct string once, giving it a pointer and a dense u32 id which are both stable for the lifetime of the
+ * interner. Two strings from the same interner are equal exactly when their pointers (or ids) are.
+ * An interner lives as long as the thread using it, so which id a string gets depends on everything that thread has
+ * compiled before - ids may be used for equality and hashing, but nothing may depend on their order.
  */
-struct Dictionary
+struct StringInternerSlot
 {
-    void *(*duplicateFunction)(void *data);
-    HashTable *table;
+    u32 hash;
+    u32 idPlusOne; // 0 for an empty slot
 };
 
-size_t hash_string(void *data);
+struct StringInterner
+{
+    struct Arena *storage; // the strings themselves
+    char **strings;        // indexed by id
+    size_t nStrings;
+    size_t stringsCapacity;
+    struct StringInternerSlot *slots;
+    size_t nSlots; // always a power of two
+};
+
+struct StringInterner *string_interner_new();
+
+void string_interner_free(struct StringInterner *interner);
+
+// return the interned copy of str, adding it if it hasn't been seen before - if id is non-NULL, it receives the string's id
+char *string_interner_intern(struct StringInterner *interner, const char *str, u32 *id);
+
+// like string_interner_intern, but returns NULL instead of adding str if it hasn't been seen before
+char *string_interner_find(struct StringInterner *interner, const char *str, u32 *id);
+
+char *string_interner_get(struct StringInterner *interner, u32 id);
+
+/*
+ * 128-bit content hash for content-addressed caching
+ * Two independent 64-bit lanes (FNV-1a and a multiply-xorshift mix) which can be updated incrementally
+ */
+struct ContentHash
+{
+    u64 lanes[2];
+};
+
+#define CONTENT_HASH_STRING_LENGTH 33
+
+void content_hash_init(struct ContentHash *hash);
 
-struct Dictionary *dictionary_new(MBCL_DATA_FREE_FUNCTION freeData,
-                                  MBCL_DATA_COMPARE_FUNCTION compareKey,
-                                  size_t (*hashData)(void *data),
-                                  size_t nBuckets,
-                                  void *(*duplicateFunction)(void *));
+void content_hash_update(struct ContentHash *hash, const void *data, size_t length);
 
-void *dictionary_insert(struct Dictionary *dict, void *value);
+// hash a string including its terminator, so that consecutive strings can't run together
+void content_hash_update_string(struct ContentHash *hash, const char *str);
 
-void *dictionary_lookup_or_insert(struct Dictionary *dict, void *value);
+void content_hash_update_u64(struct ContentHash *hash, u64 value);
 
-void dictionary_free(struct Dictionary *dict);
+// print the hash as hex to str, which must hold at least CONTENT_HASH_STRING_LENGTH characters
+void content_hash_sprint(struct ContentHash *hash, char *str);
 
 /*
  * Unordered List data structure
@@ -15,12 +15,13 @@
 /*
  * These functions Walk the AST and convert it to three-address code
  */
-struct TempList *temps;
-extern struct Dictionary *parseDict;
+_Thread_local struct TempList *temps;
+extern _Thread_local struct StringInterner *stringInterner;
 const u8 TYPE_DICT_SIZE = 100;
-struct SymbolTable *walk_program(struct Ast *program)
+void walk_program(struct SymbolTable *programTable, struct Ast *program)
 {
-    struct SymbolTable *programTable = symbol_table_new("Program");
+    // global code, and anything else not emitted on behalf of a particular function, lives as long as the symbol table
+    tac_set_arena(programTable->tacArena);
     struct BasicBlock *globalBlock = scope_lookup(programTable->globalScope, "globalblock", E_BASICBLOCK)->entry;
     struct BasicBlock *asmBlock = basic_block_new(1);
     scope_add_basic_block(programTable->globalScope, asmBlock);
@@ -85,8 +86,6 @@ struct SymbolTable *walk_program(struct Ast *program)
         }
         programRunner = programRunner->sibling;
     }
-
-    return programTable;
 }
 
 void check_any_type_use(struct Type *type, struct Ast *typeTree)
@@ -341,6 +340,7 @@ struct VariableEntry *walk_variable_declaration(struct Ast *tree,
                                                  (scope->parentScope == NULL),
                                                  A_PUBLIC);
     }
+    type_deinit(&declaredType);
 
     return declaredVariable;
 }
@@ -380,6 +380,7 @@ struct VariableEntry *walk_field_declaration(struct Ast *tree,
                                              &declaredType,
                                              (scope->parentScope == NULL),
                                              accessibility);
+    type_deinit(&declaredType);
 
     return declaredVariable;
 }
@@ -421,7 +422,7 @@ void verify_function_signatures(struct Ast *tree, struct FunctionEntry *existing
             struct VariableEntry *parsedArg = deque_at(parsedFunc->arguments, argIndex);
             // ensure all arguments in order have same name, type, indirection level
             if ((strcmp(existingArg->name, parsedArg->name) != 0) ||
-                (type_compare(&existingArg->type, &parsedArg->type)))
+                (type_compare(existingArg->type, parsedArg->type)))
             {
                 mismatch = 1;
                 break;
@@ -446,7 +447,7 @@ void verify_function_signatures(struct Ast *tree, struct FunctionEntry *existing
         {
             struct VariableEntry *existingArg = deque_at(existingFunc->arguments, argIndex);
 
-            char *argType = type_get_name(&existingArg->type);
+            char *argType = type_get_name(existingArg->type);
             printf("%s %s", argType, existingArg->name);
             free(argType);
 
@@ -467,7 +468,7 @@ void verify_function_signatures(struct Ast *tree, struct FunctionEntry *existing
         {
             struct VariableEntry *parsedArg = deque_at(parsedFunc->arguments, argIndex);
 
-            char *argType = type_get_name(&parsedArg->type);
+            char *argType = type_get_name(parsedArg->type);
             printf("%s %s", argType, parsedArg->name);
             free(argType);
 
@@ -685,8 +686,10 @@ void walk_function_definition(struct Ast *tree,
         log_tree(LOG_FATAL, tree, "Wrong AST (%s) passed to walk_function_definition!", token_get_name(tree->type));
     }
 
+    struct Arena *previousTacArena = tac_set_arena(fun->tacArena);
+
     size_t tacIndex = 0;
-    ssize_t labelNum = FUNCTION_EXIT_BLOCK_LABEL + 1;
+    ssize_t labelNum = FUNCTION_ENTRY_BLOCK_LABEL;
     struct BasicBlock *exitBlock = basic_block_new(FUNCTION_EXIT_BLOCK_LABEL);
 
     struct BasicBlock *entryBlock = basic_block_new(labelNum);
@@ -708,6 +711,8 @@ void walk_function_definition(struct Ast *tree,
         basic_block_append(entryBlock, jumpToExit, &tacIndex);
     }
     scope_add_basic_block(fun->mainScope, exitBlock);
+
+    tac_set_arena(previousTacArena);
 }
 
 struct FunctionEntry *walk_implemented_function(struct Ast *tree,
@@ -735,8 +740,8 @@ struct FunctionEntry *walk_implemented_function(struct Ast *tree,
             potentialSelfArg = deque_at(walkedMethod->arguments, 1);
         }
 
-        if ((potentialSelfArg->type.basicType == VT_SELF) ||
-            ((potentialSelfArg->type.basicType == VT_STRUCT) && (strcmp(potentialSelfArg->type.nonArray.complexType.name, implementedFor->baseName) == 0)))
+        if ((potentialSelfArg->type->basicType == VT_SELF) ||
+            ((potentialSelfArg->type->basicType == VT_STRUCT) && (strcmp(potentialSelfArg->type->nonArray.complexType.name, implementedFor->baseName) == 0)))
         {
             if (strcmp(potentialSelfArg->name, "self") == 0)
             {
@@ -964,6 +969,7 @@ struct StructDesc *walk_struct_declaration(struct Ast *tree,
         log(LOG_DEBUG, "Resolving capital 'Self' and assigning offsets to fields for non-generic-base struct %s ", declaredStruct->name);
         type_entry_resolve_capital_self(declaredType);
         struct_assign_offsets_to_fields(declaredStruct);
+        type_entry_invalidate_layout(declaredType);
     }
 
     return declaredStruct;
@@ -1146,6 +1152,7 @@ void walk_enum_declaration(struct Ast *tree,
         log(LOG_DEBUG, "Resolving capital 'Self' and calculating union size to fields for non-generic-base enum %s ", declaredEnum->name);
         type_entry_resolve_capital_self(declaredType);
         enum_desc_calculate_union_size(declaredEnum);
+        type_entry_invalidate_layout(declaredType);
     }
 }
 
@@ -1541,7 +1548,7 @@ struct BasicBlock *walk_condition_check(struct Ast *tree,
         condFalseJump->operation = TT_BEQ;
         walk_sub_expression(tree, block, scope, tacIndex, &condFalseJump->operands.conditionalBranch.sourceA);
 
-        condFalseJump->operands.conditionalBranch.sourceB.castAsType.basicType = VT_U8;
+        condFalseJump->operands.conditionalBranch.sourceB.castAsType = type_intern_basic(VT_U8, 0);
         condFalseJump->operands.conditionalBranch.sourceB.permutation = VP_LITERAL_VAL;
         condFalseJump->operands.conditionalBranch.sourceB.name.str = 0;
     }
@@ -1899,11 +1906,11 @@ void walk_enum_match_arm(struct Ast *matchedValueTree,
         struct TACLine *matchJump = new_tac_line(TT_BEQ, matchedValueTree);
 
         matchJump->operands.conditionalBranch.sourceA.name.val = *matchedValuePointer;
-        matchJump->operands.conditionalBranch.sourceA.castAsType = *tac_operand_get_type(matchedAgainstNumerical);
+        matchJump->operands.conditionalBranch.sourceA.castAsType = type_intern(tac_operand_get_type(matchedAgainstNumerical));
         matchJump->operands.conditionalBranch.sourceA.permutation = VP_LITERAL_VAL;
 
         matchJump->operands.conditionalBranch.sourceB = *matchedAgainstNumerical;
-        matchJump->operands.conditionalBranch.sourceB.castAsType.basicType = VT_U64; // TODO: size_t definition?
+        matchJump->operands.conditionalBranch.sourceB.castAsType = type_intern_basic(VT_U64, 0); // TODO: size_t definition?
 
         basic_block_append(block, matchJump, tacIndex);
 
@@ -1934,7 +1941,7 @@ void walk_enum_match_arm(struct Ast *matchedValueTree,
             // the actual data of the enum is at base + sizeof(size_t), so compute that address
             compAddrOfEnumData->operands.arithmetic.sourceB.name.val = sizeof(size_t);
             compAddrOfEnumData->operands.arithmetic.sourceB.permutation = VP_LITERAL_VAL;
-            compAddrOfEnumData->operands.arithmetic.sourceB.castAsType.basicType = select_variable_type_for_number(sizeof(size_t));
+            compAddrOfEnumData->operands.arithmetic.sourceB.castAsType = type_intern_basic(select_variable_type_for_number(sizeof(size_t)), 0);
 
             tac_operand_populate_as_temp(armScope, &compAddrOfEnumData->operands.arithmetic.destination, tac_operand_get_type(&compAddrOfEnumData->operands.arithmetic.sourceA));
             basic_block_append(caseBlock, compAddrOfEnumData, tacIndex);
@@ -1944,8 +1951,7 @@ void walk_enum_match_arm(struct Ast *matchedValueTree,
             tac_operand_populate_from_variable(&dataExtractionLine->operands.load.destination, dataVariable);
 
             dataExtractionLine->operands.load.address = compAddrOfEnumData->operands.addrof.destination;
-            dataExtractionLine->operands.load.address.castAsType = matchedMember->type;
-            dataExtractionLine->operands.load.address.castAsType.pointerLevel++;
+            dataExtractionLine->operands.load.address.castAsType = type_intern_pointer_to(&matchedMember->type);
 
             basic_block_append(caseBlock, dataExtractionLine, tacIndex);
         }
@@ -2022,7 +2028,7 @@ void walk_non_enum_match_arm(struct Ast *matchedValueTree,
         // TODO: tac_operand_populate_as_literal
         matchJump->operands.conditionalBranch.sourceA.permutation = VP_LITERAL_VAL;
         matchJump->operands.conditionalBranch.sourceA.name.val = matchedValue;
-        matchJump->operands.conditionalBranch.sourceA.castAsType = *tac_operand_get_type(matchedAgainstNumerical);
+        matchJump->operands.conditionalBranch.sourceA.castAsType = type_intern(tac_operand_get_type(matchedAgainstNumerical));
 
         matchJump->operands.conditionalBranch.sourceB = *matchedAgainstNumerical;
 
@@ -2073,8 +2079,7 @@ void walk_match_statement(struct Ast *tree,
     if (type_is_enum_object(tac_operand_get_type(&matchedAgainst)))
     {
         struct TACOperand *addrOfMatchedAgainst = get_addr_of_operand(tree, block, scope, tacIndex, &matchedAgainst);
-        addrOfMatchedAgainst->castAsType.basicType = VT_U64; // TODO: size_t define
-        addrOfMatchedAgainst->castAsType.pointerLevel = 1;
+        addrOfMatchedAgainst->castAsType = type_intern_basic(VT_U64, 1); // TODO: size_t define
 
         struct TACLine *loadMatchedAgainst = new_tac_line(TT_LOAD, tree);
 
@@ -2089,8 +2094,7 @@ void walk_match_statement(struct Ast *tree,
     else // not matching against an enum, so just cast to a size_t
     {
         matchedAgainstNumerical = matchedAgainst;
-        matchedAgainstNumerical.castAsType.basicType = VT_U64; // TODO: size_t define
-        matchedAgainstNumerical.castAsType.pointerLevel = 0;
+        matchedAgainstNumerical.castAsType = type_intern_basic(VT_U64, 0); // TODO: size_t define
     }
 
     struct Type *matchedType = tac_operand_get_type(&matchedAgainst);
@@ -2288,9 +2292,9 @@ void walk_assignment(struct Ast *tree,
         tac_operand_populate_from_variable(&assignment->operands.assign.destination, assignedVariable);
         assignment->operands.assign.source = assignedValue;
 
-        if (assignedVariable->type.basicType == VT_ARRAY)
+        if (assignedVariable->type->basicType == VT_ARRAY)
         {
-            char *arrayName = type_get_name(&assignedVariable->type);
+            char *arrayName = type_get_name(assignedVariable->type);
             log_tree(LOG_FATAL, tree, "Assignment to local array variable %s with type %s is not allowed!", assignedVariable->name, arrayName);
         }
         break;
@@ -2454,7 +2458,7 @@ void walk_assignment(struct Ast *tree,
             struct StructField *writtenField = struct_lookup_field(writtenStruct, lhs->child->sibling, scope);
             check_assignment_operand_types(tree,
                                            tac_operand_get_type(&assignment->operands.fieldStore.source),
-                                           &writtenField->variable->type);
+                                           writtenField->variable->type);
         }
         break;
 
@@ -2594,7 +2598,7 @@ void ensure_all_fields_initialized(struct Ast *tree, size_t initFieldIdx, struct
         {
             struct StructField *unInitField = deque_at(initializedStruct->fieldLocations, initFieldIdx);
 
-            char *unInitTypeName = type_get_name(&unInitField->variable->type);
+            char *unInitTypeName = type_get_name(unInitField->variable->type);
             size_t origLen = strlen(fieldsString);
             size_t addlSize = strlen(unInitTypeName) + strlen(unInitField->variable->name) + 2;
             char *separatorString = "";
@@ -2662,7 +2666,7 @@ void walk_struct_initializer(struct Ast *tree,
         if (initToTree->type == T_INITIALIZER)
         {
             // we are initializing the field directly from its address, recurse
-            tac_operand_populate_as_temp(scope, &fieldStore->operands.fieldStore.source, &initializedField->variable->type);
+            tac_operand_populate_as_temp(scope, &fieldStore->operands.fieldStore.source, initializedField->variable->type);
             walk_initializer(initToTree, block, scope, tacIndex, &fieldStore->operands.fieldStore.source);
         }
         else
@@ -2670,9 +2674,9 @@ void walk_struct_initializer(struct Ast *tree,
             walk_sub_expression(initToTree, block, scope, tacIndex, &fieldStore->operands.fieldStore.source);
 
             // make sure the subexpression has a sane type to be stored in the field we are initializing
-            if (type_compare_allow_implicit_widening(tac_operand_get_type(&fieldStore->operands.fieldStore.source), &initializedField->variable->type))
+            if (type_compare_allow_implicit_widening(tac_operand_get_type(&fieldStore->operands.fieldStore.source), initializedField->variable->type))
             {
-                log_tree(LOG_FATAL, initToTree, "Initializer expression for field %s.%s has type %s but expected type %s", initializedStruct->name, initializedField->variable->name, type_get_name(tac_operand_get_type(&fieldStore->operands.fieldStore.source)), type_get_name(&initializedField->variable->type));
+                log_tree(LOG_FATAL, initToTree, "Initializer expression for field %s.%s has type %s but expected type %s", initializedStruct->name, initializedField->variable->name, type_get_name(tac_operand_get_type(&fieldStore->operands.fieldStore.source)), type_get_name(initializedField->variable->type));
             }
         }
         basic_block_append(block, fieldStore, tacIndex);
@@ -2701,12 +2705,11 @@ void walk_enum_initializer(struct Ast *tree,
     writeEnumNumericalLine->operands.store.address = *destAddr;
 
     writeEnumNumericalLine->operands.store.source.name.val = fromMember->numerical;
-    writeEnumNumericalLine->operands.store.source.castAsType.basicType = select_variable_type_for_number(fromMember->numerical); // TODO: define for size_t
+    writeEnumNumericalLine->operands.store.source.castAsType = type_intern_basic(select_variable_type_for_number(fromMember->numerical), 0); // TODO: define for size_t
     writeEnumNumericalLine->operands.store.source.permutation = VP_LITERAL_VAL;
 
     // treat our enum dest addr as actually a pointer to the numerical index of what member it is
-    writeEnumNumericalLine->operands.store.address.castAsType = *tac_operand_get_type(&writeEnumNumericalLine->operands.store.source);
-    writeEnumNumericalLine->operands.store.address.castAsType.pointerLevel++;
+    writeEnumNumericalLine->operands.store.address.castAsType = type_intern_pointer_to(tac_operand_get_type(&writeEnumNumericalLine->operands.store.source));
     basic_block_append(block, writeEnumNumericalLine, tacIndex);
 
     // if there is some sort of initializer for the data tagged to this enum member
@@ -2729,7 +2732,7 @@ void walk_enum_initializer(struct Ast *tree,
 
         enumDataAddrCompLine->operands.arithmetic.sourceB.permutation = VP_LITERAL_VAL;
         enumDataAddrCompLine->operands.arithmetic.sourceB.name.val = sizeof(size_t);
-        enumDataAddrCompLine->operands.arithmetic.sourceB.castAsType.basicType = select_variable_type_for_number(sizeof(size_t));
+        enumDataAddrCompLine->operands.arithmetic.sourceB.castAsType = type_intern_basic(select_variable_type_for_number(sizeof(size_t)), 0);
 
         basic_block_append(block, enumDataAddrCompLine, tacIndex);
 
@@ -2743,8 +2746,7 @@ void walk_enum_initializer(struct Ast *tree,
         {
             struct TACLine *enumDataAssignLine = new_tac_line(TT_STORE, tree);
             enumDataAssignLine->operands.store.address = enumDataAddrCompLine->operands.arithmetic.destination;
-            enumDataAssignLine->operands.store.address.castAsType = fromMember->type;
-            enumDataAssignLine->operands.store.address.castAsType.pointerLevel++;
+            enumDataAssignLine->operands.store.address.castAsType = type_intern_pointer_to(&fromMember->type);
 
             walk_sub_expression(tree, block, scope, tacIndex, &enumDataAssignLine->operands.store.source);
             struct Type *subExprDataType = tac_operand_get_type(&enumDataAssignLine->operands.store.source);
@@ -2908,9 +2910,8 @@ void walk_sub_expression(struct Ast *tree,
 
     // FIXME: there exists some code path where we can reach this point with garbage in types, resulting in a crash when printing TAC operand types
     case T_CONSTANT:
-        type_init(&destinationOperand->castAsType);
         destinationOperand->name.str = tree->value;
-        destinationOperand->castAsType.basicType = select_variable_type_for_literal(tree->value);
+        destinationOperand->castAsType = type_intern_basic(select_variable_type_for_literal(tree->value), 0);
         destinationOperand->permutation = VP_LITERAL_STR;
         break;
 
@@ -2976,8 +2977,8 @@ void walk_sub_expression(struct Ast *tree,
             log_tree(LOG_FATAL, tree, "Saw T_CHAR_LITERAL with string length of %lu (value '%s')!", literalLen, tree->value);
         }
 
-        destinationOperand->name.str = dictionary_lookup_or_insert(parseDict, literalAsNumber);
-        destinationOperand->castAsType.basicType = VT_U8;
+        destinationOperand->name.str = string_interner_intern(stringInterner, literalAsNumber, NULL);
+        destinationOperand->castAsType = type_intern_basic(VT_U8, 0);
         destinationOperand->permutation = VP_LITERAL_STR;
     }
     break;
@@ -3083,9 +3084,9 @@ void walk_sub_expression(struct Ast *tree,
         walk_type_name(tree->child, scope, &castTo, NULL);
 
         // TODO: allow casting to arrays?
-        if (type_is_object(&expressionResult.castAsType))
+        if ((expressionResult.castAsType != NULL) && type_is_object(expressionResult.castAsType))
         {
-            char *castToType = type_get_name(&expressionResult.castAsType);
+            char *castToType = type_get_name(expressionResult.castAsType);
             log_tree(LOG_FATAL, tree->child, "Casting to an object (%s) is not allowed!", castToType);
         }
 
@@ -3102,7 +3103,7 @@ void walk_sub_expression(struct Ast *tree,
             // construct the bit pattern we will use in order to properly mask off the extra bits (TODO: will not hold for unsigned types)
             // TODO: rectify to use VP_LITERAL_VAL
             castBitManipulation->operands.arithmetic.sourceB.permutation = VP_LITERAL_VAL;
-            castBitManipulation->operands.arithmetic.sourceB.castAsType.basicType = VT_U64; // TODO: define for size_t type
+            castBitManipulation->operands.arithmetic.sourceB.castAsType = type_intern_basic(VT_U64, 0); // TODO: define for size_t type
 
             size_t castToWidth = type_get_size(&castTo, scope);
             switch (castToWidth)
@@ -3130,13 +3131,13 @@ void walk_sub_expression(struct Ast *tree,
             // attach our bit manipulation operation to the end of the basic block
             basic_block_append(block, castBitManipulation, tacIndex);
             // set the destination operation of this subexpression to read the manipulated value we just wrote
-            castBitManipulation->operands.arithmetic.destination.castAsType = castTo;
+            castBitManipulation->operands.arithmetic.destination.castAsType = type_intern(&castTo);
             *destinationOperand = castBitManipulation->operands.arithmetic.destination;
         }
         else
         {
             // no bit manipulation required, simply set the destination operand to the result of the casted subexpression (with cast as type set by us)
-            expressionResult.castAsType = castTo;
+            expressionResult.castAsType = type_intern(&castTo);
             *destinationOperand = expressionResult;
         }
     }
@@ -3222,7 +3223,7 @@ Deque *walk_argument_pushes(struct Ast *argumentRunner,
     while (argumentTrees->size > 0)
     {
         struct Ast *pushedArgument = deque_pop_front(argumentTrees);
-        struct TACOperand *argOperand = malloc(sizeof(struct TACOperand));
+        struct TACOperand *argOperand = tac_operand_new();
         memset(argOperand, 0, sizeof(struct TACOperand));
         deque_push_back(argumentPushes, argOperand);
         walk_sub_expression(pushedArgument, block, scope, tacIndex, argOperand);
@@ -3230,27 +3231,27 @@ Deque *walk_argument_pushes(struct Ast *argumentRunner,
         struct VariableEntry *expectedArgument = iterator_get(calledFunctionArgumentIterator);
         iterator_next(calledFunctionArgumentIterator);
 
-        if (type_compare_allow_implicit_widening(tac_operand_get_type(argOperand), &expectedArgument->type))
+        if (type_compare_allow_implicit_widening(tac_operand_get_type(argOperand), expectedArgument->type))
         {
             log_tree(LOG_FATAL, pushedArgument,
                      "Error in argument %s passed to function %s!\n\tExpected %s, got %s",
                      expectedArgument->name,
                      calledFunction->name,
-                     type_get_name(&expectedArgument->type),
+                     type_get_name(expectedArgument->type),
                      type_get_name(tac_operand_get_type(argOperand)));
         }
 
-        if (!((tac_operand_get_type(argOperand)->basicType == VT_GENERIC_PARAM) || (expectedArgument->type.basicType == VT_GENERIC_PARAM)))
+        if (!((tac_operand_get_type(argOperand)->basicType == VT_GENERIC_PARAM) || (expectedArgument->type->basicType == VT_GENERIC_PARAM)))
         {
             // allow us to automatically widen if neither are generic params
-            if (type_get_size(tac_operand_get_type(argOperand), scope) <= type_get_size(&expectedArgument->type, scope))
+            if (type_get_size(tac_operand_get_type(argOperand), scope) <= type_get_size(expectedArgument->type, scope))
             {
                 argOperand->castAsType = expectedArgument->type;
             }
             else
             {
                 char *convertFromType = type_get_name(tac_operand_get_type(argOperand));
-                char *convertToType = type_get_name(&expectedArgument->type);
+                char *convertToType = type_get_name(expectedArgument->type);
                 log_tree(LOG_FATAL, pushedArgument,
                          "Potential narrowing conversion passed to argument %s of function %s\n\tConversion from %s to %s",
                          expectedArgument->name,
@@ -3283,7 +3284,7 @@ bool handle_struct_return(struct Ast *callTree,
 
     log(LOG_DEBUG, "handleStructReturn for called function %s", calledFunction->name);
 
-    struct TACOperand *outPointerArg = malloc(sizeof(struct TACOperand));
+    struct TACOperand *outPointerArg = tac_operand_new();
     memset(outPointerArg, 0, sizeof(struct TACOperand));
 
     // if we actually use the return value of the function
@@ -3369,7 +3370,7 @@ void walk_method_call(struct Ast *tree,
     struct Ast *structTree = tree->child->child;
     struct Ast *callTree = tree->child->child->sibling;
 
-    struct TACOperand *calledOnOperand = malloc(sizeof(struct TACOperand));
+    struct TACOperand *calledOnOperand = tac_operand_new();
 
     switch (structTree->type)
     {
@@ -3671,7 +3672,7 @@ struct TACLine *walk_field_access(struct Ast *tree,
         // if we are dotting an identifier, insert an address-of if it is not a pointer already
         struct VariableEntry *dottedVariable = scope_lookup_var(scope, lhs);
 
-        if (dottedVariable->type.pointerLevel == 0)
+        if (dottedVariable->type->pointerLevel == 0)
         {
             struct TACOperand dottedOperand = {0};
 
@@ -3717,7 +3718,7 @@ struct TACLine *walk_field_access(struct Ast *tree,
     struct StructField *accessedField = struct_lookup_field(accessedStruct, rhs, scope);
 
     // populate type information (use cast for the first operand as we are treating a struct as a pointer to something else with a given offset)
-    tac_operand_populate_as_temp(scope, &accessLine->operands.fieldLoad.destination, &accessedField->variable->type);
+    tac_operand_populate_as_temp(scope, &accessLine->operands.fieldLoad.destination, accessedField->variable->type);
 
     accessLine->operands.fieldLoad.fieldName = accessedField->variable->name;
 
@@ -3852,7 +3853,7 @@ struct TACOperand *walk_expression(struct Ast *tree,
         // TODO: explicitly disallow arithmetic on array types?
         if (tac_operand_get_type(&expression->operands.arithmetic.sourceA)->pointerLevel > 0)
         {
-            struct TACOperand offset;
+            struct TACOperand offset = {0};
 
             walk_sub_expression(tree->child->sibling, block, scope, tacIndex, &offset);
             struct TACLine *scaleMultiply = set_up_scale_multiplication(tree, block, scope, tacIndex, tac_operand_get_type(&expression->operands.arithmetic.sourceA), tac_operand_get_type(&offset));
@@ -4055,7 +4056,7 @@ struct TACOperand *walk_addr_of(struct Ast *tree,
     case T_IDENTIFIER:
     {
         struct VariableEntry *addrTakenOf = scope_lookup_var(scope, tree->child);
-        if (addrTakenOf->type.basicType == VT_ARRAY)
+        if (addrTakenOf->type->basicType == VT_ARRAY)
         {
             log_tree(LOG_FATAL, tree->child, "Can't take address of local array %s!", addrTakenOf->name);
         }
@@ -4069,9 +4070,9 @@ struct TACOperand *walk_addr_of(struct Ast *tree,
         struct TACLine *arrayRefLine = walk_array_read(tree->child, block, scope, tacIndex);
         convert_array_load_to_lea(arrayRefLine, NULL);
         // early return, no need for explicit address-of TAC
-        free_tac(addrOfLine);
+        tac_line_deinit(addrOfLine);
         addrOfLine = NULL;
-        arrayRefLine->operands.arrayLoad.array.name.variable->mustSpill = true;
+        tac_operand_mark_must_spill(&arrayRefLine->operands.arrayLoad.array);
         return &arrayRefLine->operands.arrayLoad.destination;
     }
     break;
@@ -4083,9 +4084,9 @@ struct TACOperand *walk_addr_of(struct Ast *tree,
         struct TACLine *fieldAccessLine = walk_field_access(tree->child, block, scope, tacIndex, &addrOfLine->operands.addrof.source, 0);
         convert_field_load_to_lea(fieldAccessLine, &addrOfLine->operands.addrof.source);
         // free the line created at the top of this function and return early
-        free_tac(addrOfLine);
+        tac_line_deinit(addrOfLine);
 
-        fieldAccessLine->operands.fieldLoad.source.name.variable->mustSpill = true;
+        tac_operand_mark_must_spill(&fieldAccessLine->operands.fieldLoad.source);
         return &fieldAccessLine->operands.fieldLoad.destination;
     }
     break;
@@ -4094,7 +4095,7 @@ struct TACOperand *walk_addr_of(struct Ast *tree,
         log_tree(LOG_FATAL, tree, "Address of operator is not supported for non-identifiers! Saw %s", token_get_name(tree->child->type));
     }
 
-    addrOfLine->operands.addrof.source.name.variable->mustSpill = 1;
+    tac_operand_mark_must_spill(&addrOfLine->operands.addrof.source);
 
     struct Type typeOfAddress = *tac_operand_get_type(&addrOfLine->operands.addrof.source);
     typeOfAddress.pointerLevel++;
@@ -4249,7 +4250,7 @@ void walk_string_literal(struct Ast *tree,
     if (existingMember == NULL)
     {
         char *origStringName = stringName;
-        stringName = dictionary_lookup_or_insert(parseDict, stringName);
+        stringName = string_interner_intern(stringInterner, stringName, NULL);
         free(origStringName);
 
         struct Ast fakeStringTree;
@@ -4268,14 +4269,14 @@ void walk_string_literal(struct Ast *tree,
 
         stringLiteralEntry = scope_create_variable(scope, &fakeStringTree, &stringType, true, A_PUBLIC);
         stringLiteralEntry->isStringLiteral = true;
+        type_deinit(&stringType);
 
-        struct Type *realStringType = &stringLiteralEntry->type;
-        if (realStringType->array.initializeArrayTo != NULL)
+        if (stringLiteralEntry->initializeArrayTo != NULL)
         {
             InternalError("String literal already initialized!");
         }
-        realStringType->array.initializeArrayTo = malloc(stringLength * sizeof(char *));
-        char **strArray = (char **)realStringType->array.initializeArrayTo;
+        stringLiteralEntry->initializeArrayTo = malloc(stringLength * sizeof(char *));
+        char **strArray = (char **)stringLiteralEntry->initializeArrayTo;
         for (size_t charIndex = 0; charIndex < stringLength; charIndex++)
         {
             strArray[charIndex] = malloc(sizeof(char));
@@ -4320,7 +4321,7 @@ void walk_sizeof(struct Ast *tree,
         struct VariableEntry *lookedUpVariable = scope_lookup_var_by_string(scope, tree->child->value);
         if (lookedUpVariable != NULL)
         {
-            operands->type = type_duplicate_non_pointer(&lookedUpVariable->type);
+            operands->type = type_duplicate_non_pointer(lookedUpVariable->type);
         }
         else
         {
@@ -38,9 +38,9 @@ enum BASIC_TYPES select_variable_type_for_literal(char *literal)
     return select_variable_type_for_number(literalAsNumber);
 }
 
-extern struct Dictionary *parseDict;
+extern _Thread_local struct StringInterner *stringInterner;
 
-extern struct TempList *temps;
+extern _Thread_local struct TempList *temps;
 
 struct TACOperand *get_sizeof_type(struct Ast *tree,
                                    struct BasicBlock *block,
@@ -66,7 +66,7 @@ struct TACOperand *get_addr_of_operand(struct Ast *tree,
 {
     struct TACLine *addrOfLine = new_tac_line(TT_ADDROF, tree);
 
-    getAddrOf->name.variable->mustSpill = true;
+    tac_operand_mark_must_spill(getAddrOf);
     addrOfLine->operands.addrof.source = *getAddrOf;
     struct TacAddrOf *operands = &addrOfLine->operands.addrof;
     operands->source = *getAddrOf;
@@ -75,10 +75,7 @@ struct TACOperand *get_addr_of_operand(struct Ast *tree,
     typeOfAddress.pointerLevel++;
 
     tac_operand_populate_as_temp(scope, &operands->destination, &typeOfAddress);
-
-    *tac_operand_get_type(&operands->destination) = *tac_operand_get_type(&operands->source);
-
-    tac_operand_get_type(&operands->destination)->pointerLevel++;
+    type_deinit(&typeOfAddress);
     basic_block_append(block, addrOfLine, tacIndex);
 
     return &operands->destination;
@@ -131,7 +128,6 @@ void check_accessed_struct_for_dot(struct Ast *tree, struct Scope *scope, struct
 bool convert_array_load_to_lea(struct TACLine *loadLine, struct TACOperand *dest)
 {
     bool changed = false;
-    struct Type *loaded = tac_operand_get_type(&loadLine->operands.arrayLoad.destination);
     // if we have a load instruction, convert it to the corresponding lea instrutcion
     // leave existing lea instructions alone
     switch (loadLine->operation)
@@ -140,7 +136,7 @@ bool convert_array_load_to_lea(struct TACLine *loadLine, struct TACOperand *dest
         loadLine->operation = TT_ARRAY_LEA;
         // increment indirection level as we just converted from a load to a lea
         // if pointing into a variable (such as in the case of temporaries), will update the type of the temp itself
-        loaded->pointerLevel++;
+        tac_operand_increment_pointer_level(&loadLine->operands.arrayLoad.destination);
         changed = true;
         break;
 
@@ -153,9 +149,9 @@ bool convert_array_load_to_lea(struct TACLine *loadLine, struct TACOperand *dest
     }
 
     // in case we are converting struct.member_which_is_struct.a, special case so that both operands guaranteed to have pointer type and thus be primitives for codegen
-    if (loadLine->operands.arrayLoad.array.castAsType.basicType == VT_STRUCT)
+    if ((loadLine->operands.arrayLoad.array.castAsType != NULL) && (loadLine->operands.arrayLoad.array.castAsType->basicType == VT_STRUCT))
     {
-        loadLine->operands.arrayLoad.array.castAsType.pointerLevel++;
+        loadLine->operands.arrayLoad.array.castAsType = type_intern_pointer_to(loadLine->operands.arrayLoad.array.castAsType);
     }
 
     if (dest != NULL)
@@ -171,12 +167,11 @@ bool convert_field_load_to_lea(struct TACLine *loadLine, struct TACOperand *dest
     bool changed = false;
     // if we have a load instruction, convert it to the corresponding lea instrutcion
     // leave existing lea instructions alone
-    struct Type *loaded = tac_operand_get_type(&loadLine->operands.fieldLoad.destination);
     switch (loadLine->operation)
     {
     case TT_FIELD_LOAD:
         loadLine->operation = TT_FIELD_LEA;
-        loaded->pointerLevel++;
+        tac_operand_increment_pointer_level(&loadLine->operands.fieldLoad.destination);
         changed = true;
         break;
 
@@ -189,9 +184,9 @@ bool convert_field_load_to_lea(struct TACLine *loadLine, struct TACOperand *dest
     }
 
     // in case we are converting struct.member_which_is_struct.a, special case so that both operands guaranteed to have pointer type and thus be primitives for codegen
-    if (loadLine->operands.fieldLoad.source.castAsType.basicType == VT_STRUCT)
+    if ((loadLine->operands.fieldLoad.source.castAsType != NULL) && (loadLine->operands.fieldLoad.source.castAsType->basicType == VT_STRUCT))
     {
-        loadLine->operands.fieldLoad.source.castAsType.pointerLevel++;
+        loadLine->operands.fieldLoad.source.castAsType = type_intern_pointer_to(loadLine->operands.fieldLoad.source.castAsType);
     }
 
     if (dest != NULL)
@@ -1,12 +1,20 @@
 #include "log.h"
 
+#include <setjmp.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "ast.h"
 
 enum LOG_LEVEL logLevel = LOG_WARNING;
 
+// per-thread log destination - stdout if NULL
+_Thread_local FILE *logOutput = NULL;
+
+// if set, fatal errors on this thread jump here instead of exiting the process
+_Thread_local jmp_buf *fatalErrorHandler = NULL;
+
 char *logLevelNames[LOG_FATAL + 1] =
     {
         "DEBUG",
@@ -21,21 +29,56 @@ void set_log_level(enum LOG_LEVEL newLevel)
     log(LOG_INFO, "Set log level to %s", logLevelNames[newLevel]);
 }
 
+enum LOG_LEVEL get_log_level()
+{
+    return logLevel;
+}
+
+void log_set_output(FILE *output)
+{
+    logOutput = output;
+}
+
+void log_set_fatal_handler(jmp_buf *handler)
+{
+    fatalErrorHandler = handler;
+}
+
+jmp_buf *log_get_fatal_handler()
+{
+    return fatalErrorHandler;
+}
+
+FILE *log_output()
+{
+    return (logOutput != NULL) ? logOutput : stdout;
+}
+
+_Noreturn void log_fatal_exit()
+{
+    fflush(log_output());
+    if (fatalErrorHandler != NULL)
+    {
+        longjmp(*fatalErrorHandler, 1);
+    }
+    exit(1);
+}
+
 void print_log_level(enum LOG_LEVEL level, const char *file, size_t line)
 {
     switch (level)
     {
     case LOG_DEBUG:
-        printf("[  DEBUG] ");
+        fprintf(log_output(), "[  DEBUG] ");
         break;
     case LOG_INFO:
-        printf("[   INFO] ");
+        fprintf(log_output(), "[   INFO] ");
         break;
     case LOG_WARNING:
-        printf("[WARNING] ");
+        fprintf(log_output(), "[WARNING] ");
         break;
     case LOG_ERROR:
-        printf("[  ERROR] ");
+        fprintf(log_output(), "[  ERROR] ");
         break;
     case LOG_FATAL:
         // TODO: only log as [ FATAL ] if configured to do so
@@ -54,13 +97,27 @@ void log_function(const char *file, size_t line, enum LOG_LEVEL level, const cha
     va_list args;
     va_start(args, format);
     print_log_level(level, file, line);
-    vprintf(format, args);
-    putc('\n', stdout);
+    vfprintf(log_output(), format, args);
+    putc('\n', log_output());
     va_end(args);
 
     if (level == LOG_FATAL)
     {
-        exit(1);
+        log_fatal_exit();
+    }
+}
+
+void log_located(const char *file, size_t line, enum LOG_LEVEL level, char *sourceFile, u32 sourceLine, u32 sourceCol, const char *format, va_list args)
+{
+    print_log_level(level, file, line);
+    // TODO: option to print tree even on fatal
+    fprintf(log_output(), "%s:%d:%d: ", sourceFile, sourceLine, sourceCol);
+    vfprintf(log_output(), format, args);
+    putc('\n', log_output());
+
+    if (level == LOG_FATAL)
+    {
+        log_fatal_exit();
     }
 }
 
@@ -73,15 +130,20 @@ void log_tree_function(const char *file, size_t line, enum LOG_LEVEL level, stru
 
     va_list args;
     va_start(args, format);
-    print_log_level(level, file, line);
-    // TODO: option to print tree even on fatal
-    printf("%s:%d:%d: ", tree->sourceFile, tree->sourceLine, tree->sourceCol);
-    vprintf(format, args);
-    putc('\n', stdout);
+    log_located(file, line, level, tree->sourceFile, tree->sourceLine, tree->sourceCol, format, args);
     va_end(args);
+}
 
-    if (level == LOG_FATAL)
+void log_loc_function(const char *file, size_t line, enum LOG_LEVEL level, SourceLoc loc, const char *format, ...)
+{
+    if (level < logLevel)
     {
-        exit(1);
+        return;
     }
+
+    struct SourceLocation *location = source_location_get(loc);
+    va_list args;
+    va_start(args, format);
+    log_located(file, line, level, source_location_file_name(loc), location->line, location->col, format, args);
+    va_end(args);
 }
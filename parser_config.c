@@ -8,8 +8,8 @@
 #include "mbcl/list.h"
 #include "mbcl/stack.h"
 
-extern struct Dictionary *parseDict;
-extern Stack *parsedAsts;
+extern _Thread_local struct StringInterner *stringInterner;
+extern _Thread_local Stack *parsedAsts;
 extern List *includePath;
 
 void print_chars_per_line(List *charsRemaining)
@@ -100,7 +100,7 @@ void set_current_file(struct ParseProgress *auxil, char *preprocessorLine, u32 l
                       preprocessorLine);
     }
 
-    auxil->curFile = dictionary_lookup_or_insert(parseDict, fileName);
+    auxil->curFile = string_interner_intern(stringInterner, fileName, NULL);
     auxil->curLine = lineNum;
     auxil->curCol = 1;
 }
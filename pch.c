@@ -0,0 +1,578 @@
+#include "pch.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "arena.h"
+#include "compiler.h"
+#include "log.h"
+#include "util.h"
+
+extern _Thread_local struct IncludeCache *includeCache;
+extern List *includePath;
+
+/*
+ * Emission
+ */
+
+struct PchWriter
+{
+    struct PchNode *nodes;
+    u32 nNodes;
+    u32 nodesCapacity;
+    u32 *macroParameters;
+    u32 nMacroParameters;
+    u32 macroParametersCapacity;
+    HashTable *stringOffsets; // string -> offset within the string table (deduplicates strings)
+    FILE *strings;
+    char *stringTable;
+    size_t stringTableSize;
+};
+
+u32 pch_writer_add_string(struct PchWriter *writer, char *str)
+{
+    if (str == NULL)
+    {
+        return PCH_NO_STRING;
+    }
+
+    // offsets are stored +1 in the table so that offset 0 isn't confused with a failed lookup
+    size_t existingOffset = (size_t)hash_table_find(writer->stringOffsets, str);
+    if (existingOffset != 0)
+    {
+        return existingOffset - 1;
+    }
+
+    size_t offset = ftell(writer->strings);
+    fwrite(str, 1, strlen(str) + 1, writer->strings);
+    hash_table_insert(writer->stringOffsets, strdup(str), (void *)(offset + 1));
+    return offset;
+}
+
+u32 pch_writer_new_node(struct PchWriter *writer)
+{
+    if (writer->nNodes == writer->nodesCapacity)
+    {
+        writer->nodesCapacity = (writer->nodesCapacity > 0) ? (writer->nodesCapacity * 2) : 256;
+        writer->nodes = realloc(writer->nodes, writer->nodesCapacity * sizeof(struct PchNode));
+    }
+    return writer->nNodes++;
+}
+
+// add a tree and all of its siblings, returning the node reference for tree
+u32 pch_writer_add_tree(struct PchWriter *writer, struct Ast *tree)
+{
+    u32 firstNode = PCH_NO_NODE;
+    u32 previousNode = PCH_NO_NODE;
+    for (struct Ast *runner = tree; runner != NULL; runner = runner->sibling)
+    {
+        u32 nodeIndex = pch_writer_new_node(writer);
+        struct PchNode *node = &writer->nodes[nodeIndex];
+        node->value = pch_writer_add_string(writer, runner->value);
+        node->type = runner->type;
+        node->child = PCH_NO_NODE;
+        node->sibling = PCH_NO_NODE;
+        node->sourceLine = runner->sourceLine;
+        node->sourceCol = runner->sourceCol;
+        node->sourceFile = pch_writer_add_string(writer, runner->sourceFile);
+
+        if (previousNode == PCH_NO_NODE)
+        {
+            firstNode = nodeIndex + 1;
+        }
+        else
+        {
+            writer->nodes[previousNode - 1].sibling = nodeIndex + 1;
+        }
+        previousNode = nodeIndex + 1;
+
+        // adding the child may move the node array, so don't hold on to node across it
+        u32 childNode = pch_writer_add_tree(writer, runner->child);
+        writer->nodes[nodeIndex].child = childNode;
+    }
+
+    return firstNode;
+}
+
+void pch_writer_add_macro_parameter(struct PchWriter *writer, char *parameter)
+{
+    if (writer->nMacroParameters == writer->macroParametersCapacity)
+    {
+        writer->macroParametersCapacity = (writer->macroParametersCapacity > 0) ? (writer->macroParametersCapacity * 2) : 64;
+        writer->macroParameters = realloc(writer->macroParameters, writer->macroParametersCapacity * sizeof(u32));
+    }
+    writer->macroParameters[writer->nMacroParameters++] = pch_writer_add_string(writer, parameter);
+}
+
+bool pch_write(struct Preprocessor *preprocessor, struct Ast *parsed, FILE *outFile)
+{
+    struct PchWriter writer;
+    memset(&writer, 0, sizeof(struct PchWriter));
+    writer.stringOffsets = hash_table_new(free, NULL, (ssize_t(*)(void *, void *))strcmp, hash_string, 1024);
+    writer.strings = open_memstream(&writer.stringTable, &writer.stringTableSize);
+
+    struct PchFileHeader header;
+    memset(&header, 0, sizeof(struct PchFileHeader));
+    memcpy(header.magic, PCH_MAGIC, sizeof(header.magic));
+    header.version = PCH_VERSION;
+    header.rootNode = pch_writer_add_tree(&writer, parsed);
+    header.nNodes = writer.nNodes;
+
+    // macros and dependencies are variable in number, so build their sections up in memory before writing anything
+    char *macroSection = NULL;
+    size_t macroSectionSize = 0;
+    FILE *macros = open_memstream(&macroSection, &macroSectionSize);
+    Iterator *macroIter = NULL;
+    for (macroIter = hash_table_begin(preprocessor->macros); iterator_gettable(macroIter); iterator_next(macroIter))
+    {
+        HashTableEntry *thisEntry = iterator_get(macroIter);
+        struct Macro *thisMacro = thisEntry->value;
+        if (!thisMacro->isDefined)
+        {
+            continue;
+        }
+
+        struct PchMacro written;
+        written.name = pch_writer_add_string(&writer, thisMacro->name);
+        written.body = pch_writer_add_string(&writer, thisMacro->body);
+        written.firstParameter = writer.nMacroParameters;
+        written.nParameters = U32_MAX;
+        if (thisMacro->parameters != NULL)
+        {
+            written.nParameters = thisMacro->parameters->size;
+            Iterator *parameterIter = NULL;
+            for (parameterIter = list_begin(thisMacro->parameters); iterator_gettable(parameterIter); iterator_next(parameterIter))
+            {
+                pch_writer_add_macro_parameter(&writer, iterator_get(parameterIter));
+            }
+            iterator_free(parameterIter);
+        }
+        fwrite(&written, sizeof(struct PchMacro), 1, macros);
+        header.nMacros++;
+    }
+    iterator_free(macroIter);
+    fclose(macros);
+    header.nMacroParameters = writer.nMacroParameters;
+
+    char *dependencySection = NULL;
+    size_t dependencySectionSize = 0;
+    FILE *dependencies = open_memstream(&dependencySection, &dependencySectionSize);
+    Iterator *fileIter = NULL;
+    for (fileIter = hash_table_begin(preprocessor->includedFiles); iterator_gettable(fileIter); iterator_next(fileIter))
+    {
+        HashTableEntry *thisEntry = iterator_get(fileIter);
+        struct IncludedFile *thisFile = thisEntry->value;
+
+        struct PchDependency written;
+        memset(&written, 0, sizeof(struct PchDependency));
+        written.path = pch_writer_add_string(&writer, thisFile->path);
+        written.guardMacro = pch_writer_add_string(&writer, thisFile->guardMacro);
+        written.pragmaOnce = thisFile->pragmaOnce;
+        written.modifiedSec = thisFile->modified.tv_sec;
+        written.modifiedNsec = thisFile->modified.tv_nsec;
+        written.size = thisFile->size;
+        fwrite(&written, sizeof(struct PchDependency), 1, dependencies);
+        header.nDependencies++;
+    }
+    iterator_free(fileIter);
+    fclose(dependencies);
+
+    fclose(writer.strings);
+    header.stringTableSize = writer.stringTableSize;
+
+    // sections are ordered so that the 8-byte aligned records come first
+    fwrite(&header, sizeof(struct PchFileHeader), 1, outFile);
+    fwrite(dependencySection, 1, dependencySectionSize, outFile);
+    fwrite(writer.nodes, sizeof(struct PchNode), writer.nNodes, outFile);
+    fwrite(macroSection, 1, macroSectionSize, outFile);
+    fwrite(writer.macroParameters, sizeof(u32), writer.nMacroParameters, outFile);
+    fwrite(writer.stringTable, 1, writer.stringTableSize, outFile);
+    bool succeeded = (ferror(outFile) == 0);
+
+    free(dependencySection);
+    free(macroSection);
+    free(writer.stringTable);
+    free(writer.macroParameters);
+    free(writer.nodes);
+    hash_table_free(writer.stringOffsets);
+
+    return succeeded;
+}
+
+bool pch_emit(char *headerFileName, char *outFileName)
+{
+    log(LOG_INFO, "Precompiling header %s to %s", headerFileName, outFileName);
+    compiler_init_thread_state();
+
+    struct Preprocessor *preprocessor = preprocessor_new(includePath, includeCache);
+    preprocessor_begin(preprocessor, headerFileName);
+    struct Arena *astArena = ast_arena_new();
+    struct Ast *parsed = parse_preprocessed(preprocessor, headerFileName, astArena);
+
+    bool succeeded = false;
+    FILE *outFile = fopen(outFileName, "wb");
+    if (outFile == NULL)
+    {
+        log(LOG_ERROR, "Unable to open precompiled header output file %s: %s", outFileName, strerror(errno));
+    }
+    else
+    {
+        succeeded = pch_write(preprocessor, parsed, outFile);
+        succeeded &= (fclose(outFile) == 0);
+    }
+
+    arena_free(astArena);
+    preprocessor_free(preprocessor);
+    return succeeded;
+}
+
+/*
+ * Preambles
+ * The leading #includes of a file precompiled in memory, so that a compile server can keep them warm between requests
+ */
+
+struct PrecompiledHeader *pch_open_image(char *fileName, u8 *image, size_t imageSize, bool isMapped);
+
+struct PrecompiledHeader *pch_precompile_preamble(struct IncludedFile *mainFile, size_t preambleLength)
+{
+    log(LOG_INFO, "Precompiling the preamble (%zu bytes) of %s", preambleLength, mainFile->path);
+    compiler_init_thread_state();
+
+    // the preamble stands in for the start of the file itself, so that quoted includes are found relative to it
+    struct IncludedFile preamble;
+    memset(&preamble, 0, sizeof(struct IncludedFile));
+    preamble.path = mainFile->path;
+    preamble.contents = strndup(mainFile->contents, preambleLength);
+    preamble.length = preambleLength;
+
+    struct Preprocessor *preprocessor = preprocessor_new(includePath, includeCache);
+    preprocessor_begin_detached(preprocessor, &preamble);
+    struct Arena *astArena = ast_arena_new();
+    struct Ast *parsed = parse_preprocessed(preprocessor, mainFile->path, astArena);
+
+    u8 *image = NULL;
+    size_t imageSize = 0;
+    FILE *imageFile = open_memstream((char **)&image, &imageSize);
+    bool succeeded = pch_write(preprocessor, parsed, imageFile);
+    succeeded &= (fclose(imageFile) == 0);
+
+    arena_free(astArena);
+    preprocessor_free(preprocessor);
+    free(preamble.contents);
+    free(preamble.guardMacro);
+
+    if (!succeeded)
+    {
+        log(LOG_WARNING, "Unable to precompile the preamble of %s", mainFile->path);
+        free(image);
+        return NULL;
+    }
+
+    char *name = malloc(strlen("preamble of ") + strlen(mainFile->path) + 1);
+    sprintf(name, "preamble of %s", mainFile->path);
+    struct PrecompiledHeader *pch = pch_open_image(name, image, imageSize, false);
+    free(name);
+    return pch;
+}
+
+/*
+ * Loading
+ */
+
+char *pch_string(struct PrecompiledHeader *pch, u32 offset)
+{
+    if (offset == PCH_NO_STRING)
+    {
+        return NULL;
+    }
+    return pch->strings + offset;
+}
+
+bool pch_string_is_valid(struct PrecompiledHeader *pch, u32 offset)
+{
+    // the string table ends in a NUL, so any offset within it starts a terminated string
+    return (offset == PCH_NO_STRING) || (offset < pch->header->stringTableSize);
+}
+
+// strings and parameter ranges of every macro must be in bounds, and names and bodies must be present
+bool pch_validate_macros(struct PrecompiledHeader *pch)
+{
+    for (u32 macroIndex = 0; macroIndex < pch->header->nMacros; macroIndex++)
+    {
+        struct PchMacro *macro = &pch->macros[macroIndex];
+        if ((macro->name == PCH_NO_STRING) || !pch_string_is_valid(pch, macro->name) ||
+            (macro->body == PCH_NO_STRING) || !pch_string_is_valid(pch, macro->body))
+        {
+            return false;
+        }
+
+        if (macro->nParameters == U32_MAX)
+        {
+            continue;
+        }
+
+        if ((macro->firstParameter > pch->header->nMacroParameters) ||
+            (macro->nParameters > (pch->header->nMacroParameters - macro->firstParameter)))
+        {
+            return false;
+        }
+
+        for (u32 parameterIndex = 0; parameterIndex < macro->nParameters; parameterIndex++)
+        {
+            u32 parameter = pch->macroParameters[macro->firstParameter + parameterIndex];
+            if ((parameter == PCH_NO_STRING) || !pch_string_is_valid(pch, parameter))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// node strings and types must be in bounds, and child and sibling references must point forwards so the tree can't cycle
+bool pch_validate_nodes(struct PrecompiledHeader *pch)
+{
+    if (pch->header->rootNode > pch->header->nNodes)
+    {
+        return false;
+    }
+
+    for (u32 nodeIndex = 0; nodeIndex < pch->header->nNodes; nodeIndex++)
+    {
+        struct PchNode *node = &pch->nodes[nodeIndex];
+        u32 nodeRef = nodeIndex + 1;
+        if ((node->type > T_EOF) || !pch_string_is_valid(pch, node->value) || !pch_string_is_valid(pch, node->sourceFile))
+        {
+            return false;
+        }
+
+        if ((node->child != PCH_NO_NODE) && ((node->child <= nodeRef) || (node->child > pch->header->nNodes)))
+        {
+            return false;
+        }
+
+        if ((node->sibling != PCH_NO_NODE) && ((node->sibling <= nodeRef) || (node->sibling > pch->header->nNodes)))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool pch_validate_dependencies(struct PrecompiledHeader *pch)
+{
+    for (u32 dependencyIndex = 0; dependencyIndex < pch->header->nDependencies; dependencyIndex++)
+    {
+        struct PchDependency *dependency = &pch->dependencies[dependencyIndex];
+        if ((dependency->path == PCH_NO_STRING) || !pch_string_is_valid(pch, dependency->path) || !pch_string_is_valid(pch, dependency->guardMacro))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool pch_is_up_to_date(struct PrecompiledHeader *pch)
+{
+    for (u32 dependencyIndex = 0; dependencyIndex < pch->header->nDependencies; dependencyIndex++)
+    {
+        struct PchDependency *dependency = &pch->dependencies[dependencyIndex];
+        char *path = pch_string(pch, dependency->path);
+        struct stat fileStat;
+        if ((stat(path, &fileStat) != 0) ||
+            (fileStat.st_size != dependency->size) ||
+            (fileStat.st_mtim.tv_sec != dependency->modifiedSec) ||
+            (fileStat.st_mtim.tv_nsec != dependency->modifiedNsec))
+        {
+            log(LOG_INFO, "Precompiled header %s is out of date (%s has changed)", pch->fileName, path);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// check that everything in the mapped file is in bounds so that later accesses don't need to
+bool pch_validate(struct PrecompiledHeader *pch)
+{
+    if ((pch->mappingSize < sizeof(struct PchFileHeader)) ||
+        (memcmp(pch->header->magic, PCH_MAGIC, sizeof(pch->header->magic)) != 0))
+    {
+        log(LOG_WARNING, "%s is not a precompiled header", pch->fileName);
+        return false;
+    }
+
+    if (pch->header->version != PCH_VERSION)
+    {
+        log(LOG_WARNING, "Precompiled header %s has version %u, expected %u", pch->fileName, pch->header->version, PCH_VERSION);
+        return false;
+    }
+
+    // checked on its own first so the sum below can't overflow
+    if (pch->header->stringTableSize > pch->mappingSize)
+    {
+        log(LOG_WARNING, "Precompiled header %s is truncated or corrupt", pch->fileName);
+        return false;
+    }
+
+    size_t expectedSize = sizeof(struct PchFileHeader) +
+                          (pch->header->nNodes * sizeof(struct PchNode)) +
+                          (pch->header->nMacros * sizeof(struct PchMacro)) +
+                          (pch->header->nMacroParameters * sizeof(u32)) +
+                          (pch->header->nDependencies * sizeof(struct PchDependency)) +
+                          pch->header->stringTableSize;
+    if ((expectedSize != pch->mappingSize) || (pch->header->stringTableSize == 0) || (pch->strings[pch->header->stringTableSize - 1] != '\0'))
+    {
+        log(LOG_WARNING, "Precompiled header %s is truncated or corrupt", pch->fileName);
+        return false;
+    }
+
+    if (!pch_validate_macros(pch) || !pch_validate_nodes(pch) || !pch_validate_dependencies(pch))
+    {
+        log(LOG_WARNING, "Precompiled header %s is corrupt (out-of-bounds reference)", pch->fileName);
+        return false;
+    }
+
+    return pch_is_up_to_date(pch);
+}
+
+// set up a PCH for an image which has been read into memory or mapped, returning NULL (after logging why) if it is invalid
+struct PrecompiledHeader *pch_open_image(char *fileName, u8 *image, size_t imageSize, bool isMapped)
+{
+    struct PrecompiledHeader *pch = malloc(sizeof(struct PrecompiledHeader));
+    memset(pch, 0, sizeof(struct PrecompiledHeader));
+    // an image in memory is owned by the PCH, as is its name
+    pch->fileName = isMapped ? fileName : strdup(fileName);
+    pch->mapping = image;
+    pch->mappingSize = imageSize;
+    pch->isMapped = isMapped;
+    pch->header = (struct PchFileHeader *)image;
+
+    if (pch->mappingSize >= sizeof(struct PchFileHeader))
+    {
+        u8 *cursor = image + sizeof(struct PchFileHeader);
+        pch->dependencies = (struct PchDependency *)cursor;
+        cursor += pch->header->nDependencies * sizeof(struct PchDependency);
+        pch->nodes = (struct PchNode *)cursor;
+        cursor += pch->header->nNodes * sizeof(struct PchNode);
+        pch->macros = (struct PchMacro *)cursor;
+        cursor += pch->header->nMacros * sizeof(struct PchMacro);
+        pch->macroParameters = (u32 *)cursor;
+        cursor += pch->header->nMacroParameters * sizeof(u32);
+        pch->strings = (char *)cursor;
+    }
+
+    if (!pch_validate(pch))
+    {
+        pch_free(pch);
+        return NULL;
+    }
+
+    log(LOG_INFO, "Loaded precompiled header %s (%u AST nodes, %u macros)", fileName, pch->header->nNodes, pch->header->nMacros);
+    return pch;
+}
+
+struct PrecompiledHeader *pch_load(char *fileName)
+{
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+    {
+        log(LOG_WARNING, "Unable to open precompiled header %s: %s", fileName, strerror(errno));
+        return NULL;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0)
+    {
+        log(LOG_WARNING, "Unable to stat precompiled header %s: %s", fileName, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    u8 *mapping = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        log(LOG_WARNING, "Unable to map precompiled header %s: %s", fileName, strerror(errno));
+        return NULL;
+    }
+
+    return pch_open_image(fileName, mapping, fileStat.st_size, true);
+}
+
+void pch_free(struct PrecompiledHeader *pch)
+{
+    if (pch->isMapped)
+    {
+        munmap(pch->mapping, pch->mappingSize);
+    }
+    else
+    {
+        free(pch->mapping);
+        free(pch->fileName);
+    }
+    free(pch);
+}
+
+void pch_apply_to_preprocessor(struct PrecompiledHeader *pch, struct Preprocessor *preprocessor)
+{
+    for (u32 macroIndex = 0; macroIndex < pch->header->nMacros; macroIndex++)
+    {
+        struct PchMacro *macro = &pch->macros[macroIndex];
+        List *parameters = NULL;
+        if (macro->nParameters != U32_MAX)
+        {
+            parameters = list_new(free, NULL);
+            for (u32 parameterIndex = 0; parameterIndex < macro->nParameters; parameterIndex++)
+            {
+                list_append(parameters, strdup(pch_string(pch, pch->macroParameters[macro->firstParameter + parameterIndex])));
+            }
+        }
+        preprocessor_define_macro(preprocessor, strdup(pch_string(pch, macro->name)), parameters, strdup(pch_string(pch, macro->body)));
+    }
+
+    for (u32 dependencyIndex = 0; dependencyIndex < pch->header->nDependencies; dependencyIndex++)
+    {
+        struct PchDependency *dependency = &pch->dependencies[dependencyIndex];
+        preprocessor_mark_included(preprocessor, pch_string(pch, dependency->path), pch_string(pch, dependency->guardMacro), dependency->pragmaOnce);
+    }
+}
+
+// pch_validate has checked every reference is in bounds and points forwards, so this terminates
+struct Ast *pch_build_tree(struct PrecompiledHeader *pch, u32 nodeRef, struct Arena *arena)
+{
+    struct Ast *first = NULL;
+    struct Ast *previous = NULL;
+    while (nodeRef != PCH_NO_NODE)
+    {
+        struct PchNode *node = &pch->nodes[nodeRef - 1];
+        struct Ast *built = ast_new(arena, node->type, pch_string(pch, node->value), pch_string(pch, node->sourceFile), node->sourceLine, node->sourceCol);
+        built->child = pch_build_tree(pch, node->child, arena);
+
+        if (previous == NULL)
+        {
+            first = built;
+        }
+        else
+        {
+            previous->sibling = built;
+        }
+        previous = built;
+        nodeRef = node->sibling;
+    }
+
+    return first;
+}
+
+struct Ast *pch_build_ast(struct PrecompiledHeader *pch, struct Arena *arena)
+{
+    return pch_build_tree(pch, pch->header->rootNode, arena);
+}
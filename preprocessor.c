@@ -0,0 +1,1735 @@
+#include "preprocessor.h"
+
+#include <ctype.h>
+#include <string.h>
+
+#include "log.h"
+#include "util.h"
+
+struct PreprocessorConditional
+{
+    bool parentActive;   // whether the region containing this conditional is active
+    bool isActive;       // whether the current branch of this conditional is active
+    bool anyBranchTaken; // whether any branch of this conditional has been taken so far
+    bool seenElse;
+};
+
+/*
+ * Output/scratch text buffers
+ */
+
+const size_t PREPROCESSOR_BUFFER_INITIAL_CAPACITY = 256;
+
+void preprocessor_buffer_reserve(struct PreprocessorBuffer *buffer, size_t nAdditional)
+{
+    if (buffer->length + nAdditional + 1 > buffer->capacity)
+    {
+        size_t newCapacity = (buffer->capacity > 0) ? buffer->capacity : PREPROCESSOR_BUFFER_INITIAL_CAPACITY;
+        while (buffer->length + nAdditional + 1 > newCapacity)
+        {
+            newCapacity *= 2;
+        }
+        buffer->data = realloc(buffer->data, newCapacity);
+        buffer->capacity = newCapacity;
+    }
+}
+
+void preprocessor_buffer_append_n(struct PreprocessorBuffer *buffer, const char *str, size_t n)
+{
+    preprocessor_buffer_reserve(buffer, n);
+    memcpy(buffer->data + buffer->length, str, n);
+    buffer->length += n;
+    buffer->data[buffer->length] = '\0';
+}
+
+void preprocessor_buffer_append(struct PreprocessorBuffer *buffer, const char *str)
+{
+    preprocessor_buffer_append_n(buffer, str, strlen(str));
+}
+
+void preprocessor_buffer_append_char(struct PreprocessorBuffer *buffer, char c)
+{
+    preprocessor_buffer_append_n(buffer, &c, 1);
+}
+
+// empty the buffer, making sure it holds a valid (empty) string
+void preprocessor_buffer_clear(struct PreprocessorBuffer *buffer)
+{
+    buffer->length = 0;
+    preprocessor_buffer_reserve(buffer, 0);
+    buffer->data[0] = '\0';
+}
+
+void preprocessor_buffer_deinit(struct PreprocessorBuffer *buffer)
+{
+    free(buffer->data);
+    memset(buffer, 0, sizeof(struct PreprocessorBuffer));
+}
+
+/*
+ * Include cache
+ */
+
+void included_file_free(struct IncludedFile *file)
+{
+    free(file->path);
+    free(file->contents);
+    free(file->guardMacro);
+    free(file);
+}
+
+struct IncludeCache *include_cache_new()
+{
+    struct IncludeCache *wip = malloc(sizeof(struct IncludeCache));
+    wip->files = hash_table_new(NULL, (MBCL_DATA_FREE_FUNCTION)included_file_free, (ssize_t(*)(void *, void *))strcmp, hash_string, 64);
+    return wip;
+}
+
+void include_cache_free(struct IncludeCache *cache)
+{
+    hash_table_free(cache->files);
+    free(cache);
+}
+
+char *read_entire_file(FILE *inFile, size_t *lengthOut)
+{
+    struct PreprocessorBuffer contents = {0};
+    char readBuf[4096];
+    size_t nRead = 0;
+    while ((nRead = fread(readBuf, 1, sizeof(readBuf), inFile)) > 0)
+    {
+        preprocessor_buffer_append_n(&contents, readBuf, nRead);
+    }
+    // make sure we always have a (possibly empty) string to work with
+    preprocessor_buffer_reserve(&contents, 0);
+    contents.data[contents.length] = '\0';
+
+    *lengthOut = contents.length;
+    return contents.data;
+}
+
+struct IncludedFile *include_cache_lookup(struct IncludeCache *cache, char *path)
+{
+    struct IncludedFile *file = hash_table_find(cache->files, path);
+    if (file != NULL)
+    {
+        return file;
+    }
+
+    file = malloc(sizeof(struct IncludedFile));
+    memset(file, 0, sizeof(struct IncludedFile));
+    file->path = strdup(path);
+
+    FILE *inFile = fopen(path, "rb");
+    if (inFile != NULL)
+    {
+        struct stat fileStat;
+        if (fstat(fileno(inFile), &fileStat) == 0)
+        {
+            file->modified = fileStat.st_mtim;
+            file->size = fileStat.st_size;
+        }
+        file->contents = read_entire_file(inFile, &file->length);
+        fclose(inFile);
+    }
+
+    hash_table_insert(cache->files, file->path, file);
+    return file;
+}
+
+bool included_file_is_stale(struct IncludedFile *file)
+{
+    struct stat fileStat;
+    if (stat(file->path, &fileStat) != 0)
+    {
+        // stale if the file has disappeared since it was read
+        return (file->contents != NULL);
+    }
+
+    if (file->contents == NULL)
+    {
+        return true;
+    }
+
+    return (fileStat.st_size != file->size) ||
+           (fileStat.st_mtim.tv_sec != file->modified.tv_sec) ||
+           (fileStat.st_mtim.tv_nsec != file->modified.tv_nsec);
+}
+
+void include_cache_revalidate(struct IncludeCache *cache)
+{
+    Stack *stalePaths = stack_new(NULL);
+    Iterator *fileIter = NULL;
+    for (fileIter = hash_table_begin(cache->files); iterator_gettable(fileIter); iterator_next(fileIter))
+    {
+        HashTableEntry *thisEntry = iterator_get(fileIter);
+        struct IncludedFile *thisFile = thisEntry->value;
+        // stdin is never the same twice
+        if ((strcmp(thisFile->path, "<stdin>") == 0) || included_file_is_stale(thisFile))
+        {
+            stack_push(stalePaths, thisFile->path);
+        }
+    }
+    iterator_free(fileIter);
+
+    while (stalePaths->size > 0)
+    {
+        hash_table_remove(cache->files, stack_pop(stalePaths));
+    }
+    stack_free(stalePaths);
+}
+
+/*
+ * Macros
+ */
+
+void macro_free(struct Macro *macro)
+{
+    free(macro->name);
+    if (macro->parameters != NULL)
+    {
+        list_free(macro->parameters);
+    }
+    free(macro->body);
+    free(macro);
+}
+
+struct Macro *preprocessor_lookup_macro(struct Preprocessor *preprocessor, char *name)
+{
+    struct Macro *macro = hash_table_find(preprocessor->macros, name);
+    if ((macro != NULL) && (!macro->isDefined))
+    {
+        return NULL;
+    }
+    return macro;
+}
+
+struct Macro *preprocessor_lookup_macro_n(struct Preprocessor *preprocessor, const char *name, size_t nameLength)
+{
+    char nameBuf[nameLength + 1];
+    memcpy(nameBuf, name, nameLength);
+    nameBuf[nameLength] = '\0';
+    return preprocessor_lookup_macro(preprocessor, nameBuf);
+}
+
+// (re)define a macro - name, parameters, and body are owned by the macro table after this call
+void preprocessor_define_macro(struct Preprocessor *preprocessor, char *name, List *parameters, char *body)
+{
+    struct Macro *macro = hash_table_find(preprocessor->macros, name);
+    if (macro != NULL)
+    {
+        // redefinition - swap the definition out in place as the key string is owned by the macro
+        free(name);
+        if (macro->parameters != NULL)
+        {
+            list_free(macro->parameters);
+        }
+        free(macro->body);
+    }
+    else
+    {
+        macro = malloc(sizeof(struct Macro));
+        macro->name = name;
+        macro->isExpanding = false;
+        hash_table_insert(preprocessor->macros, macro->name, macro);
+    }
+
+    macro->parameters = parameters;
+    macro->body = body;
+    macro->isDefined = true;
+}
+
+/*
+ * Lexing helpers
+ */
+
+bool preprocessor_is_identifier_start(char c)
+{
+    return isalpha((unsigned char)c) || (c == '_');
+}
+
+bool preprocessor_is_identifier_char(char c)
+{
+    return isalnum((unsigned char)c) || (c == '_');
+}
+
+const char *preprocessor_skip_whitespace(const char *str)
+{
+    while ((*str == ' ') || (*str == '\t') || (*str == '\v') || (*str == '\f') || (*str == '\r'))
+    {
+        str++;
+    }
+    return str;
+}
+
+// returns the end of the string or char literal starting at str (which points to the opening quote)
+const char *preprocessor_skip_literal(const char *str, const char *end)
+{
+    char quote = *str++;
+    while ((str < end) && (*str != quote) && (*str != '\n'))
+    {
+        if ((*str == '\\') && ((str + 1) < end))
+        {
+            str++;
+        }
+        str++;
+    }
+
+    if ((str < end) && (*str == quote))
+    {
+        str++;
+    }
+    return str;
+}
+
+char *preprocessor_strndup_trimmed(const char *start, const char *end)
+{
+    start = preprocessor_skip_whitespace(start);
+    while ((end > start) && isspace((unsigned char)end[-1]))
+    {
+        end--;
+    }
+    return strndup(start, end - start);
+}
+
+/*
+ * Sources (stack of files currently being read)
+ */
+
+struct PreprocessorSource *preprocessor_current_source(struct Preprocessor *preprocessor)
+{
+    if (preprocessor->sources->size == 0)
+    {
+        return NULL;
+    }
+    return stack_peek(preprocessor->sources);
+}
+
+void preprocessor_emit_line_marker(struct Preprocessor *preprocessor, struct PreprocessorSource *source, bool enteringFile)
+{
+    char lineNumStr[sprintedNumberLength];
+    snprintf(lineNumStr, sprintedNumberLength, "# %zu \"", source->line);
+    preprocessor_buffer_append(&preprocessor->output, lineNumStr);
+    preprocessor_buffer_append(&preprocessor->output, source->file->path);
+    // as with gcc, flag 1 indicates the start of a new file
+    // when resuming a file after an include, no flag is emitted as the parser only cares about the line number
+    preprocessor_buffer_append(&preprocessor->output, enteringFile ? "\" 1\n" : "\"\n");
+}
+
+void preprocessor_push_source(struct Preprocessor *preprocessor, struct IncludedFile *file)
+{
+    struct PreprocessorSource *source = malloc(sizeof(struct PreprocessorSource));
+    source->file = file;
+    source->position = 0;
+    source->line = 1;
+    source->conditionalDepth = preprocessor->conditionals->size;
+    source->guardState = IGS_START;
+    source->guardCandidate = NULL;
+    stack_push(preprocessor->sources, source);
+
+    preprocessor_emit_line_marker(preprocessor, source, true);
+}
+
+void preprocessor_pop_source(struct Preprocessor *preprocessor)
+{
+    struct PreprocessorSource *finished = stack_pop(preprocessor->sources);
+
+    if (preprocessor->conditionals->size > finished->conditionalDepth)
+    {
+        log(LOG_FATAL, "%s:%zu: unterminated conditional directive", finished->file->path, finished->line);
+    }
+
+    // the whole file was wrapped in #ifndef X ... #endif - remember X so the file need never be re-read
+    if ((finished->guardState == IGS_AFTER_GUARD) && (finished->file->guardMacro == NULL))
+    {
+        log(LOG_DEBUG, "Detected include guard %s for %s", finished->guardCandidate, finished->file->path);
+        finished->file->guardMacro = finished->guardCandidate;
+        finished->guardCandidate = NULL;
+    }
+    free(finished->guardCandidate);
+    free(finished);
+
+    struct PreprocessorSource *resumed = preprocessor_current_source(preprocessor);
+    if (resumed != NULL)
+    {
+        preprocessor_emit_line_marker(preprocessor, resumed, false);
+    }
+}
+
+// read one logical line (joining backslash-continued lines and replacing comments with a single space) into line
+// returns the number of physical lines consumed
+size_t preprocessor_read_logical_line(struct PreprocessorSource *source, struct PreprocessorBuffer *line)
+{
+    const char *contents = source->file->contents;
+    const char *end = contents + source->file->length;
+    const char *cursor = contents + source->position;
+    size_t nPhysicalLines = 1;
+
+    preprocessor_buffer_clear(line);
+
+    while ((cursor < end) && (*cursor != '\n'))
+    {
+        if ((cursor[0] == '\\') && ((cursor + 1) < end) && (cursor[1] == '\n'))
+        {
+            cursor += 2;
+            nPhysicalLines++;
+        }
+        else if ((cursor[0] == '/') && ((cursor + 1) < end) && (cursor[1] == '/'))
+        {
+            while ((cursor < end) && (*cursor != '\n'))
+            {
+                cursor++;
+            }
+            preprocessor_buffer_append_char(line, ' ');
+        }
+        else if ((cursor[0] == '/') && ((cursor + 1) < end) && (cursor[1] == '*'))
+        {
+            cursor += 2;
+            while ((cursor < end) && !((cursor[0] == '*') && ((cursor + 1) < end) && (cursor[1] == '/')))
+            {
+                if (*cursor == '\n')
+                {
+                    nPhysicalLines++;
+                }
+                cursor++;
+            }
+
+            if (cursor >= end)
+            {
+                log(LOG_FATAL, "%s:%zu: unterminated comment", source->file->path, source->line);
+            }
+            cursor += 2;
+            preprocessor_buffer_append_char(line, ' ');
+        }
+        else if ((*cursor == '"') || (*cursor == '\''))
+        {
+            const char *literalEnd = preprocessor_skip_literal(cursor, end);
+            preprocessor_buffer_append_n(line, cursor, literalEnd - cursor);
+            cursor = literalEnd;
+        }
+        else
+        {
+            preprocessor_buffer_append_char(line, *cursor);
+            cursor++;
+        }
+    }
+
+    if (cursor < end)
+    {
+        // consume the newline
+        cursor++;
+    }
+
+    source->position = cursor - contents;
+    return nPhysicalLines;
+}
+
+bool preprocessor_is_active(struct Preprocessor *preprocessor)
+{
+    if (preprocessor->conditionals->size == 0)
+    {
+        return true;
+    }
+    struct PreprocessorConditional *top = stack_peek(preprocessor->conditionals);
+    return top->isActive;
+}
+
+/*
+ * Macro expansion
+ */
+
+enum PREPROCESSOR_EXPAND_RESULT
+{
+    PER_OK,
+    PER_INCOMPLETE, // a function-like macro invocation's argument list runs past the end of the text
+};
+
+enum PREPROCESSOR_EXPAND_RESULT preprocessor_expand(struct Preprocessor *preprocessor, const char *text, size_t length, struct PreprocessorBuffer *out);
+
+// parse the argument list of a function-like macro invocation - argsStart points to the opening paren
+// returns a pointer to one past the closing paren, or NULL if the closing paren isn't found
+const char *preprocessor_collect_arguments(const char *argsStart, const char *end, List *arguments)
+{
+    const char *cursor = argsStart + 1;
+    const char *argStart = cursor;
+    size_t depth = 0;
+    while (cursor < end)
+    {
+        switch (*cursor)
+        {
+        case '"':
+        case '\'':
+            cursor = preprocessor_skip_literal(cursor, end);
+            continue;
+
+        case '(':
+            depth++;
+            break;
+
+        case ')':
+            if (depth == 0)
+            {
+                char *argument = preprocessor_strndup_trimmed(argStart, cursor);
+                // don't treat "()" as a single empty argument
+                if ((arguments->size > 0) || (strlen(argument) > 0))
+                {
+                    list_append(arguments, argument);
+                }
+                else
+                {
+                    free(argument);
+                }
+                return cursor + 1;
+            }
+            depth--;
+            break;
+
+        case ',':
+            if (depth == 0)
+            {
+                list_append(arguments, preprocessor_strndup_trimmed(argStart, cursor));
+                argStart = cursor + 1;
+            }
+            break;
+
+        default:
+            break;
+        }
+        cursor++;
+    }
+
+    return NULL;
+}
+
+// returns the index of name within the macro's parameter list, or -1 if name isn't a parameter
+ssize_t macro_parameter_index(struct Macro *macro, const char *name, size_t nameLength)
+{
+    if (macro->parameters == NULL)
+    {
+        return -1;
+    }
+
+    ssize_t index = 0;
+    Iterator *paramIter = NULL;
+    for (paramIter = list_begin(macro->parameters); iterator_gettable(paramIter); iterator_next(paramIter))
+    {
+        char *param = iterator_get(paramIter);
+        if ((strlen(param) == nameLength) && (strncmp(param, name, nameLength) == 0))
+        {
+            iterator_free(paramIter);
+            return index;
+        }
+        index++;
+    }
+    iterator_free(paramIter);
+    return -1;
+}
+
+char *list_at_index(List *list, size_t index)
+{
+    char *found = NULL;
+    Iterator *listIter = NULL;
+    for (listIter = list_begin(list); iterator_gettable(listIter); iterator_next(listIter))
+    {
+        if (index-- == 0)
+        {
+            found = iterator_get(listIter);
+            break;
+        }
+    }
+    iterator_free(listIter);
+    return found;
+}
+
+void preprocessor_stringify(struct PreprocessorBuffer *out, const char *argument)
+{
+    preprocessor_buffer_append_char(out, '"');
+    while (*argument)
+    {
+        if ((*argument == '"') || (*argument == '\\'))
+        {
+            preprocessor_buffer_append_char(out, '\\');
+        }
+        preprocessor_buffer_append_char(out, *argument);
+        argument++;
+    }
+    preprocessor_buffer_append_char(out, '"');
+}
+
+// substitute the (raw) arguments into the body of a macro, handling # and ##
+void preprocessor_substitute(struct Preprocessor *preprocessor, struct Macro *macro, List *arguments, struct PreprocessorBuffer *out)
+{
+    const char *body = macro->body;
+    const char *end = body + strlen(body);
+    const char *cursor = body;
+
+    while (cursor < end)
+    {
+        if ((cursor[0] == '#') && ((cursor + 1) < end) && (cursor[1] == '#'))
+        {
+            // token pasting - remove the ## along with any surrounding whitespace
+            while ((out->length > 0) && isspace((unsigned char)out->data[out->length - 1]))
+            {
+                out->data[--out->length] = '\0';
+            }
+            cursor = preprocessor_skip_whitespace(cursor + 2);
+            // pasted arguments are not macro-expanded
+            if (preprocessor_is_identifier_start(*cursor))
+            {
+                const char *identEnd = cursor;
+                while ((identEnd < end) && preprocessor_is_identifier_char(*identEnd))
+                {
+                    identEnd++;
+                }
+                ssize_t paramIndex = macro_parameter_index(macro, cursor, identEnd - cursor);
+                if (paramIndex >= 0)
+                {
+                    preprocessor_buffer_append(out, list_at_index(arguments, paramIndex));
+                    cursor = identEnd;
+                }
+            }
+        }
+        else if ((cursor[0] == '#') && (macro->parameters != NULL))
+        {
+            const char *identStart = preprocessor_skip_whitespace(cursor + 1);
+            const char *identEnd = identStart;
+            while ((identEnd < end) && preprocessor_is_identifier_char(*identEnd))
+            {
+                identEnd++;
+            }
+            ssize_t paramIndex = macro_parameter_index(macro, identStart, identEnd - identStart);
+            if (paramIndex < 0)
+            {
+                log(LOG_FATAL, "'#' is not followed by a macro parameter in definition of macro %s", macro->name);
+            }
+            preprocessor_stringify(out, list_at_index(arguments, paramIndex));
+            cursor = identEnd;
+        }
+        else if ((*cursor == '"') || (*cursor == '\''))
+        {
+            const char *literalEnd = preprocessor_skip_literal(cursor, end);
+            preprocessor_buffer_append_n(out, cursor, literalEnd - cursor);
+            cursor = literalEnd;
+        }
+        else if (preprocessor_is_identifier_start(*cursor))
+        {
+            const char *identEnd = cursor;
+            while ((identEnd < end) && preprocessor_is_identifier_char(*identEnd))
+            {
+                identEnd++;
+            }
+
+            ssize_t paramIndex = macro_parameter_index(macro, cursor, identEnd - cursor);
+            const char *next = preprocessor_skip_whitespace(identEnd);
+            bool beforePaste = (next[0] == '#') && (next[1] == '#');
+            if (paramIndex < 0)
+            {
+                preprocessor_buffer_append_n(out, cursor, identEnd - cursor);
+            }
+            else if (beforePaste)
+            {
+                preprocessor_buffer_append(out, list_at_index(arguments, paramIndex));
+            }
+            else
+            {
+                // arguments are fully macro-expanded before substitution
+                char *argument = list_at_index(arguments, paramIndex);
+                preprocessor_expand(preprocessor, argument, strlen(argument), out);
+            }
+            cursor = identEnd;
+        }
+        else
+        {
+            preprocessor_buffer_append_char(out, *cursor);
+            cursor++;
+        }
+    }
+}
+
+// expand a single identifier at cursor which is known to name a defined macro
+// returns pointer past the invocation, or NULL if the invocation is incomplete
+const char *preprocessor_expand_invocation(struct Preprocessor *preprocessor, struct Macro *macro, const char *identEnd, const char *end, struct PreprocessorBuffer *out)
+{
+    const char *afterInvocation = identEnd;
+    List *arguments = NULL;
+
+    if (macro->parameters != NULL)
+    {
+        const char *argsStart = preprocessor_skip_whitespace(identEnd);
+        if ((argsStart >= end) || (*argsStart != '('))
+        {
+            // function-like macro name not followed by an argument list is not an invocation
+            preprocessor_buffer_append(out, macro->name);
+            return identEnd;
+        }
+
+        arguments = list_new(free, NULL);
+        afterInvocation = preprocessor_collect_arguments(argsStart, end, arguments);
+        if (afterInvocation == NULL)
+        {
+            list_free(arguments);
+            return NULL;
+        }
+
+        if (arguments->size != macro->parameters->size)
+        {
+            struct PreprocessorSource *source = preprocessor_current_source(preprocessor);
+            log(LOG_FATAL, "%s:%zu: macro %s expects %zu arguments, but %zu given", source->file->path, preprocessor->expandingLine, macro->name, macro->parameters->size, arguments->size);
+        }
+    }
+
+    struct PreprocessorBuffer substituted = {0};
+    preprocessor_buffer_clear(&substituted);
+    preprocessor_substitute(preprocessor, macro, arguments, &substituted);
+
+    // rescan the substituted text for further macros, with this macro disabled
+    macro->isExpanding = true;
+    preprocessor_expand(preprocessor, substituted.data, substituted.length, out);
+    macro->isExpanding = false;
+
+    preprocessor_buffer_deinit(&substituted);
+    if (arguments != NULL)
+    {
+        list_free(arguments);
+    }
+
+    return afterInvocation;
+}
+
+enum PREPROCESSOR_EXPAND_RESULT preprocessor_expand(struct Preprocessor *preprocessor, const char *text, size_t length, struct PreprocessorBuffer *out)
+{
+    const char *cursor = text;
+    const char *end = text + length;
+
+    while (cursor < end)
+    {
+        if ((*cursor == '"') || (*cursor == '\''))
+        {
+            const char *literalEnd = preprocessor_skip_literal(cursor, end);
+            preprocessor_buffer_append_n(out, cursor, literalEnd - cursor);
+            cursor = literalEnd;
+        }
+        else if (preprocessor_is_identifier_start(*cursor))
+        {
+            const char *identEnd = cursor;
+            while ((identEnd < end) && preprocessor_is_identifier_char(*identEnd))
+            {
+                identEnd++;
+            }
+            size_t identLength = identEnd - cursor;
+
+            struct PreprocessorSource *source = preprocessor_current_source(preprocessor);
+            if ((identLength == strlen("__FILE__")) && (strncmp(cursor, "__FILE__", identLength) == 0))
+            {
+                preprocessor_buffer_append_char(out, '"');
+                for (const char *pathChar = source->file->path; *pathChar; pathChar++)
+                {
+                    if ((*pathChar == '"') || (*pathChar == '\\'))
+                    {
+                        preprocessor_buffer_append_char(out, '\\');
+                    }
+                    preprocessor_buffer_append_char(out, *pathChar);
+                }
+                preprocessor_buffer_append_char(out, '"');
+                cursor = identEnd;
+                continue;
+            }
+
+            if ((identLength == strlen("__LINE__")) && (strncmp(cursor, "__LINE__", identLength) == 0))
+            {
+                char lineStr[sprintedNumberLength];
+                // source->line has already been advanced past the line being expanded
+                snprintf(lineStr, sprintedNumberLength, "%zu", preprocessor->expandingLine);
+                preprocessor_buffer_append(out, lineStr);
+                cursor = identEnd;
+                continue;
+            }
+
+            struct Macro *macro = preprocessor_lookup_macro_n(preprocessor, cursor, identLength);
+            if ((macro == NULL) || macro->isExpanding)
+            {
+                preprocessor_buffer_append_n(out, cursor, identLength);
+                cursor = identEnd;
+                continue;
+            }
+
+            const char *afterInvocation = preprocessor_expand_invocation(preprocessor, macro, identEnd, end, out);
+            if (afterInvocation == NULL)
+            {
+                return PER_INCOMPLETE;
+            }
+            cursor = afterInvocation;
+        }
+        else if (isdigit((unsigned char)*cursor))
+        {
+            // don't treat suffixes of numeric constants (eg 0xFF) as identifiers
+            while ((cursor < end) && preprocessor_is_identifier_char(*cursor))
+            {
+                preprocessor_buffer_append_char(out, *cursor);
+                cursor++;
+            }
+        }
+        else
+        {
+            preprocessor_buffer_append_char(out, *cursor);
+            cursor++;
+        }
+    }
+
+    return PER_OK;
+}
+
+/*
+ * #if expression evaluation
+ */
+
+struct PreprocessorExpression
+{
+    const char *cursor;
+    struct PreprocessorSource *source;
+};
+
+i64 preprocessor_evaluate_ternary(struct PreprocessorExpression *expr);
+
+void preprocessor_expression_skip_whitespace(struct PreprocessorExpression *expr)
+{
+    expr->cursor = preprocessor_skip_whitespace(expr->cursor);
+}
+
+bool preprocessor_expression_accept(struct PreprocessorExpression *expr, const char *token)
+{
+    preprocessor_expression_skip_whitespace(expr);
+    size_t tokenLength = strlen(token);
+    if (strncmp(expr->cursor, token, tokenLength) == 0)
+    {
+        expr->cursor += tokenLength;
+        return true;
+    }
+    return false;
+}
+
+i64 preprocessor_evaluate_primary(struct PreprocessorExpression *expr)
+{
+    preprocessor_expression_skip_whitespace(expr);
+
+    if (preprocessor_expression_accept(expr, "("))
+    {
+        i64 value = preprocessor_evaluate_ternary(expr);
+        if (!preprocessor_expression_accept(expr, ")"))
+        {
+            log(LOG_FATAL, "%s:%zu: expected ')' in preprocessor expression", expr->source->file->path, expr->source->line);
+        }
+        return value;
+    }
+
+    if (preprocessor_expression_accept(expr, "!"))
+    {
+        return !preprocessor_evaluate_primary(expr);
+    }
+
+    if (preprocessor_expression_accept(expr, "-"))
+    {
+        return -preprocessor_evaluate_primary(expr);
+    }
+
+    if (preprocessor_expression_accept(expr, "~"))
+    {
+        return ~preprocessor_evaluate_primary(expr);
+    }
+
+    if (isdigit((unsigned char)*expr->cursor))
+    {
+        char *numberEnd = NULL;
+        i64 value = strtoll(expr->cursor, &numberEnd, 0);
+        expr->cursor = numberEnd;
+        // ignore integer suffixes
+        while (preprocessor_is_identifier_char(*expr->cursor))
+        {
+            expr->cursor++;
+        }
+        return value;
+    }
+
+    if (preprocessor_is_identifier_start(*expr->cursor))
+    {
+        // identifiers remaining after macro expansion evaluate to 0
+        while (preprocessor_is_identifier_char(*expr->cursor))
+        {
+            expr->cursor++;
+        }
+        return 0;
+    }
+
+    log(LOG_FATAL, "%s:%zu: unexpected '%c' in preprocessor expression", expr->source->file->path, expr->source->line, *expr->cursor);
+    return 0;
+}
+
+i64 preprocessor_evaluate_multiplicative(struct PreprocessorExpression *expr)
+{
+    i64 value = preprocessor_evaluate_primary(expr);
+    while (true)
+    {
+        if (preprocessor_expression_accept(expr, "*"))
+        {
+            value *= preprocessor_evaluate_primary(expr);
+        }
+        else if (preprocessor_expression_accept(expr, "/") || preprocessor_expression_accept(expr, "%"))
+        {
+            bool isModulo = (expr->cursor[-1] == '%');
+            i64 divisor = preprocessor_evaluate_primary(expr);
+            if (divisor == 0)
+            {
+                log(LOG_FATAL, "%s:%zu: division by zero in preprocessor expression", expr->source->file->path, expr->source->line);
+            }
+            value = isModulo ? (value % divisor) : (value / divisor);
+        }
+        else
+        {
+            return value;
+        }
+    }
+}
+
+i64 preprocessor_evaluate_additive(struct PreprocessorExpression *expr)
+{
+    i64 value = preprocessor_evaluate_multiplicative(expr);
+    while (true)
+    {
+        if (preprocessor_expression_accept(expr, "+"))
+        {
+            value += preprocessor_evaluate_multiplicative(expr);
+        }
+        else if (preprocessor_expression_accept(expr, "-"))
+        {
+            value -= preprocessor_evaluate_multiplicative(expr);
+        }
+        else
+        {
+            return value;
+        }
+    }
+}
+
+i64 preprocessor_evaluate_shift(struct PreprocessorExpression *expr)
+{
+    i64 value = preprocessor_evaluate_additive(expr);
+    while (true)
+    {
+        bool isLeft = preprocessor_expression_accept(expr, "<<");
+        if (isLeft || preprocessor_expression_accept(expr, ">>"))
+        {
+            i64 amount = preprocessor_evaluate_additive(expr);
+            if ((amount < 0) || (amount >= (i64)(sizeof(i64) * 8)))
+            {
+                log(LOG_FATAL, "%s:%zu: shift by %ld in preprocessor expression is out of range", expr->source->file->path, expr->source->line, amount);
+            }
+            value = isLeft ? (i64)((u64)value << amount) : (value >> amount);
+        }
+        else
+        {
+            return value;
+        }
+    }
+}
+
+i64 preprocessor_evaluate_relational(struct PreprocessorExpression *expr)
+{
+    i64 value = preprocessor_evaluate_shift(expr);
+    while (true)
+    {
+        if (preprocessor_expression_accept(expr, "<="))
+        {
+            value = value <= preprocessor_evaluate_shift(expr);
+        }
+        else if (preprocessor_expression_accept(expr, ">="))
+        {
+            value = value >= preprocessor_evaluate_shift(expr);
+        }
+        else if (preprocessor_expression_accept(expr, "<"))
+        {
+            value = value < preprocessor_evaluate_shift(expr);
+        }
+        else if (preprocessor_expression_accept(expr, ">"))
+        {
+            value = value > preprocessor_evaluate_shift(expr);
+        }
+        else
+        {
+            return value;
+        }
+    }
+}
+
+i64 preprocessor_evaluate_equality(struct PreprocessorExpression *expr)
+{
+    i64 value = preprocessor_evaluate_relational(expr);
+    while (true)
+    {
+        if (preprocessor_expression_accept(expr, "=="))
+        {
+            value = value == preprocessor_evaluate_relational(expr);
+        }
+        else if (preprocessor_expression_accept(expr, "!="))
+        {
+            value = value != preprocessor_evaluate_relational(expr);
+        }
+        else
+        {
+            return value;
+        }
+    }
+}
+
+// accept a single-character bitwise operator without consuming the first character of its logical counterpart
+bool preprocessor_expression_accept_bitwise(struct PreprocessorExpression *expr, char op)
+{
+    preprocessor_expression_skip_whitespace(expr);
+    if ((expr->cursor[0] == op) && (expr->cursor[1] != op))
+    {
+        expr->cursor++;
+        return true;
+    }
+    return false;
+}
+
+i64 preprocessor_evaluate_bitwise_and(struct PreprocessorExpression *expr)
+{
+    i64 value = preprocessor_evaluate_equality(expr);
+    while (preprocessor_expression_accept_bitwise(expr, '&'))
+    {
+        value &= preprocessor_evaluate_equality(expr);
+    }
+    return value;
+}
+
+i64 preprocessor_evaluate_bitwise_xor(struct PreprocessorExpression *expr)
+{
+    i64 value = preprocessor_evaluate_bitwise_and(expr);
+    while (preprocessor_expression_accept(expr, "^"))
+    {
+        value ^= preprocessor_evaluate_bitwise_and(expr);
+    }
+    return value;
+}
+
+i64 preprocessor_evaluate_bitwise_or(struct PreprocessorExpression *expr)
+{
+    i64 value = preprocessor_evaluate_bitwise_xor(expr);
+    while (preprocessor_expression_accept_bitwise(expr, '|'))
+    {
+        value |= preprocessor_evaluate_bitwise_xor(expr);
+    }
+    return value;
+}
+
+i64 preprocessor_evaluate_logical_and(struct PreprocessorExpression *expr)
+{
+    i64 value = preprocessor_evaluate_bitwise_or(expr);
+    while (preprocessor_expression_accept(expr, "&&"))
+    {
+        i64 rhs = preprocessor_evaluate_bitwise_or(expr);
+        value = value && rhs;
+    }
+    return value;
+}
+
+i64 preprocessor_evaluate_logical_or(struct PreprocessorExpression *expr)
+{
+    i64 value = preprocessor_evaluate_logical_and(expr);
+    while (preprocessor_expression_accept(expr, "||"))
+    {
+        i64 rhs = preprocessor_evaluate_logical_and(expr);
+        value = value || rhs;
+    }
+    return value;
+}
+
+i64 preprocessor_evaluate_ternary(struct PreprocessorExpression *expr)
+{
+    i64 condition = preprocessor_evaluate_logical_or(expr);
+    if (preprocessor_expression_accept(expr, "?"))
+    {
+        i64 ifTrue = preprocessor_evaluate_ternary(expr);
+        if (!preprocessor_expression_accept(expr, ":"))
+        {
+            log(LOG_FATAL, "%s:%zu: expected ':' in preprocessor expression", expr->source->file->path, expr->source->line);
+        }
+        i64 ifFalse = preprocessor_evaluate_ternary(expr);
+        return condition ? ifTrue : ifFalse;
+    }
+    return condition;
+}
+
+// evaluate the condition of an #if or #elif directive
+bool preprocessor_evaluate_condition(struct Preprocessor *preprocessor, struct PreprocessorSource *source, const char *condition)
+{
+    // replace defined(X) and defined X before macro expansion
+    struct PreprocessorBuffer definedReplaced = {0};
+    preprocessor_buffer_clear(&definedReplaced);
+
+    const char *cursor = condition;
+    while (*cursor)
+    {
+        if ((strncmp(cursor, "defined", strlen("defined")) == 0) && !preprocessor_is_identifier_char(cursor[strlen("defined")]) &&
+            ((cursor == condition) || !preprocessor_is_identifier_char(cursor[-1])))
+        {
+            cursor = preprocessor_skip_whitespace(cursor + strlen("defined"));
+            bool parenthesized = (*cursor == '(');
+            if (parenthesized)
+            {
+                cursor = preprocessor_skip_whitespace(cursor + 1);
+            }
+
+            const char *nameStart = cursor;
+            while (preprocessor_is_identifier_char(*cursor))
+            {
+                cursor++;
+            }
+            bool isDefined = preprocessor_lookup_macro_n(preprocessor, nameStart, cursor - nameStart) != NULL;
+            preprocessor_buffer_append_char(&definedReplaced, isDefined ? '1' : '0');
+
+            if (parenthesized)
+            {
+                cursor = preprocessor_skip_whitespace(cursor);
+                if (*cursor != ')')
+                {
+                    log(LOG_FATAL, "%s:%zu: missing ')' after \"defined\"", source->file->path, source->line);
+                }
+                cursor++;
+            }
+        }
+        else
+        {
+            preprocessor_buffer_append_char(&definedReplaced, *cursor);
+            cursor++;
+        }
+    }
+
+    struct PreprocessorBuffer expanded = {0};
+    preprocessor_buffer_clear(&expanded);
+    preprocessor_expand(preprocessor, definedReplaced.data, definedReplaced.length, &expanded);
+
+    struct PreprocessorExpression expr = {0};
+    expr.cursor = expanded.data;
+    expr.source = source;
+    i64 value = preprocessor_evaluate_ternary(&expr);
+    preprocessor_expression_skip_whitespace(&expr);
+    if (*expr.cursor != '\0')
+    {
+        log(LOG_FATAL, "%s:%zu: unexpected \"%s\" in preprocessor expression", source->file->path, source->line, expr.cursor);
+    }
+
+    preprocessor_buffer_deinit(&definedReplaced);
+    preprocessor_buffer_deinit(&expanded);
+    return value != 0;
+}
+
+/*
+ * Directives
+ */
+
+void preprocessor_push_conditional(struct Preprocessor *preprocessor, bool condition)
+{
+    struct PreprocessorConditional *conditional = malloc(sizeof(struct PreprocessorConditional));
+    conditional->parentActive = preprocessor_is_active(preprocessor);
+    conditional->isActive = conditional->parentActive && condition;
+    conditional->anyBranchTaken = conditional->isActive;
+    conditional->seenElse = false;
+    stack_push(preprocessor->conditionals, conditional);
+}
+
+struct PreprocessorConditional *preprocessor_current_conditional(struct Preprocessor *preprocessor, struct PreprocessorSource *source, char *directive)
+{
+    if (preprocessor->conditionals->size <= source->conditionalDepth)
+    {
+        log(LOG_FATAL, "%s:%zu: #%s without #if", source->file->path, source->line, directive);
+    }
+    return stack_peek(preprocessor->conditionals);
+}
+
+// pull an identifier out of a directive's arguments, returning a newly allocated string
+char *preprocessor_directive_identifier(struct PreprocessorSource *source, const char *args, const char **after, char *directive)
+{
+    args = preprocessor_skip_whitespace(args);
+    const char *nameEnd = args;
+    while (preprocessor_is_identifier_char(*nameEnd))
+    {
+        nameEnd++;
+    }
+
+    if ((nameEnd == args) || !preprocessor_is_identifier_start(*args))
+    {
+        log(LOG_FATAL, "%s:%zu: macro name must be an identifier in #%s", source->file->path, source->line, directive);
+    }
+
+    if (after != NULL)
+    {
+        *after = nameEnd;
+    }
+    return strndup(args, nameEnd - args);
+}
+
+void preprocessor_handle_define(struct Preprocessor *preprocessor, struct PreprocessorSource *source, const char *args)
+{
+    const char *cursor = NULL;
+    char *name = preprocessor_directive_identifier(source, args, &cursor, "define");
+
+    List *parameters = NULL;
+    // function-like only if the paren immediately follows the name
+    if (*cursor == '(')
+    {
+        parameters = list_new(free, NULL);
+        cursor++;
+        while (true)
+        {
+            cursor = preprocessor_skip_whitespace(cursor);
+            if (*cursor == ')')
+            {
+                cursor++;
+                break;
+            }
+
+            const char *paramStart = cursor;
+            while (preprocessor_is_identifier_char(*cursor))
+            {
+                cursor++;
+            }
+            if (cursor == paramStart)
+            {
+                log(LOG_FATAL, "%s:%zu: expected parameter name in definition of macro %s", source->file->path, source->line, name);
+            }
+            list_append(parameters, strndup(paramStart, cursor - paramStart));
+
+            cursor = preprocessor_skip_whitespace(cursor);
+            if (*cursor == ',')
+            {
+                cursor++;
+            }
+            else if (*cursor != ')')
+            {
+                log(LOG_FATAL, "%s:%zu: expected ',' or ')' in parameter list of macro %s", source->file->path, source->line, name);
+            }
+        }
+    }
+
+    char *body = preprocessor_strndup_trimmed(cursor, cursor + strlen(cursor));
+    log(LOG_DEBUG, "#define %s %s", name, body);
+    preprocessor_define_macro(preprocessor, name, parameters, body);
+}
+
+void preprocessor_handle_undef(struct Preprocessor *preprocessor, struct PreprocessorSource *source, const char *args)
+{
+    char *name = preprocessor_directive_identifier(source, args, NULL, "undef");
+    struct Macro *macro = hash_table_find(preprocessor->macros, name);
+    if (macro != NULL)
+    {
+        macro->isDefined = false;
+    }
+    free(name);
+}
+
+char *preprocessor_join_path(const char *directory, size_t directoryLength, const char *fileName)
+{
+    char *joined = malloc(directoryLength + strlen(fileName) + 2);
+    memcpy(joined, directory, directoryLength);
+    joined[directoryLength] = '/';
+    strcpy(joined + directoryLength + 1, fileName);
+    return joined;
+}
+
+// search for an included file - "quoted" includes search the including file's directory before the include path
+struct IncludedFile *preprocessor_find_include(struct Preprocessor *preprocessor, struct PreprocessorSource *source, char *fileName, bool isQuoted)
+{
+    if (fileName[0] == '/')
+    {
+        struct IncludedFile *absolute = include_cache_lookup(preprocessor->includeCache, fileName);
+        return (absolute->contents != NULL) ? absolute : NULL;
+    }
+
+    if (isQuoted)
+    {
+        char *lastSlash = strrchr(source->file->path, '/');
+        struct IncludedFile *sibling = NULL;
+        if (lastSlash != NULL)
+        {
+            char *siblingPath = preprocessor_join_path(source->file->path, lastSlash - source->file->path, fileName);
+            sibling = include_cache_lookup(preprocessor->includeCache, siblingPath);
+            free(siblingPath);
+        }
+        else
+        {
+            sibling = include_cache_lookup(preprocessor->includeCache, fileName);
+        }
+
+        if (sibling->contents != NULL)
+        {
+            return sibling;
+        }
+    }
+
+    struct IncludedFile *found = NULL;
+    Iterator *includePathIter = NULL;
+    for (includePathIter = list_begin(preprocessor->includePath); iterator_gettable(includePathIter); iterator_next(includePathIter))
+    {
+        char *includeDir = iterator_get(includePathIter);
+        char *candidatePath = preprocessor_join_path(includeDir, strlen(includeDir), fileName);
+        struct IncludedFile *candidate = include_cache_lookup(preprocessor->includeCache, candidatePath);
+        free(candidatePath);
+        if (candidate->contents != NULL)
+        {
+            found = candidate;
+            break;
+        }
+    }
+    iterator_free(includePathIter);
+
+    return found;
+}
+
+// returns true if a new source was pushed (meaning a line marker has already been emitted for it)
+bool preprocessor_handle_include(struct Preprocessor *preprocessor, struct PreprocessorSource *source, const char *args)
+{
+    args = preprocessor_skip_whitespace(args);
+    char closer = '\0';
+    switch (*args)
+    {
+    case '"':
+        closer = '"';
+        break;
+    case '<':
+        closer = '>';
+        break;
+    default:
+        log(LOG_FATAL, "%s:%zu: #include expects \"FILENAME\" or <FILENAME>", source->file->path, source->line);
+    }
+
+    const char *nameEnd = strchr(args + 1, closer);
+    if (nameEnd == NULL)
+    {
+        log(LOG_FATAL, "%s:%zu: missing terminating %c character in #include", source->file->path, source->line, closer);
+    }
+
+    char *fileName = strndup(args + 1, nameEnd - (args + 1));
+    struct IncludedFile *included = preprocessor_find_include(preprocessor, source, fileName, (closer == '"'));
+    if (included == NULL)
+    {
+        log(LOG_FATAL, "%s:%zu: %s: No such file or directory", source->file->path, source->line, fileName);
+    }
+    free(fileName);
+
+    // skip files we know would expand to nothing without even looking at their contents
+    bool alreadyIncluded = (hash_table_find(preprocessor->includedFiles, included->path) != NULL);
+    if ((alreadyIncluded && included->pragmaOnce) ||
+        ((included->guardMacro != NULL) && (preprocessor_lookup_macro(preprocessor, included->guardMacro) != NULL)))
+    {
+        log(LOG_DEBUG, "Skipping re-inclusion of guarded file %s", included->path);
+        return false;
+    }
+
+    if (!alreadyIncluded)
+    {
+        hash_table_insert(preprocessor->includedFiles, included->path, included);
+    }
+    preprocessor_push_source(preprocessor, included);
+    return true;
+}
+
+// track whether a file is wrapped entirely by an include guard
+void preprocessor_track_include_guard(struct Preprocessor *preprocessor, struct PreprocessorSource *source, char *directive, const char *args)
+{
+    switch (source->guardState)
+    {
+    case IGS_START:
+        if (strcmp(directive, "ifndef") == 0)
+        {
+            source->guardState = IGS_INSIDE_GUARD;
+            source->guardCandidate = preprocessor_directive_identifier(source, args, NULL, directive);
+        }
+        else
+        {
+            source->guardState = IGS_NONE;
+        }
+        break;
+
+    case IGS_INSIDE_GUARD:
+        if ((strcmp(directive, "endif") == 0) && (preprocessor->conditionals->size == source->conditionalDepth))
+        {
+            source->guardState = IGS_AFTER_GUARD;
+        }
+        else if (((strcmp(directive, "else") == 0) || (strcmp(directive, "elif") == 0)) && (preprocessor->conditionals->size == source->conditionalDepth + 1))
+        {
+            // an #else on the guard conditional means the file isn't simply guarded
+            source->guardState = IGS_NONE;
+        }
+        break;
+
+    case IGS_AFTER_GUARD:
+        source->guardState = IGS_NONE;
+        break;
+
+    case IGS_NONE:
+        break;
+    }
+}
+
+// process a directive line, returns true if a line marker was emitted (so no blank line is needed in its place)
+bool preprocessor_handle_directive(struct Preprocessor *preprocessor, struct PreprocessorSource *source, const char *directiveLine)
+{
+    const char *cursor = preprocessor_skip_whitespace(directiveLine);
+    const char *directiveEnd = cursor;
+    while (preprocessor_is_identifier_char(*directiveEnd))
+    {
+        directiveEnd++;
+    }
+
+    // null directive
+    if (directiveEnd == cursor)
+    {
+        return false;
+    }
+
+    char *directive = strndup(cursor, directiveEnd - cursor);
+    const char *args = directiveEnd;
+    bool markerEmitted = false;
+    bool active = preprocessor_is_active(preprocessor);
+
+    if (!strcmp(directive, "ifdef") || !strcmp(directive, "ifndef"))
+    {
+        preprocessor_track_include_guard(preprocessor, source, directive, args);
+        bool condition = false;
+        if (active)
+        {
+            char *name = preprocessor_directive_identifier(source, args, NULL, directive);
+            condition = (preprocessor_lookup_macro(preprocessor, name) != NULL) == (directive[2] == 'd');
+            free(name);
+        }
+        preprocessor_push_conditional(preprocessor, condition);
+    }
+    else if (!strcmp(directive, "if"))
+    {
+        preprocessor_track_include_guard(preprocessor, source, directive, args);
+        preprocessor_push_conditional(preprocessor, active && preprocessor_evaluate_condition(preprocessor, source, args));
+    }
+    else if (!strcmp(directive, "elif"))
+    {
+        preprocessor_track_include_guard(preprocessor, source, directive, args);
+        struct PreprocessorConditional *conditional = preprocessor_current_conditional(preprocessor, source, directive);
+        if (conditional->seenElse)
+        {
+            log(LOG_FATAL, "%s:%zu: #elif after #else", source->file->path, source->line);
+        }
+
+        if (conditional->parentActive && !conditional->anyBranchTaken)
+        {
+            conditional->isActive = preprocessor_evaluate_condition(preprocessor, source, args);
+            conditional->anyBranchTaken = conditional->isActive;
+        }
+        else
+        {
+            conditional->isActive = false;
+        }
+    }
+    else if (!strcmp(directive, "else"))
+    {
+        preprocessor_track_include_guard(preprocessor, source, directive, args);
+        struct PreprocessorConditional *conditional = preprocessor_current_conditional(preprocessor, source, directive);
+        if (conditional->seenElse)
+        {
+            log(LOG_FATAL, "%s:%zu: #else after #else", source->file->path, source->line);
+        }
+        conditional->seenElse = true;
+        conditional->isActive = conditional->parentActive && !conditional->anyBranchTaken;
+        conditional->anyBranchTaken = true;
+    }
+    else if (!strcmp(directive, "endif"))
+    {
+        preprocessor_current_conditional(preprocessor, source, directive);
+        free(stack_pop(preprocessor->conditionals));
+        preprocessor_track_include_guard(preprocessor, source, directive, args);
+    }
+    else if (active)
+    {
+        preprocessor_track_include_guard(preprocessor, source, directive, args);
+        if (!strcmp(directive, "define"))
+        {
+            preprocessor_handle_define(preprocessor, source, args);
+        }
+        else if (!strcmp(directive, "undef"))
+        {
+            preprocessor_handle_undef(preprocessor, source, args);
+        }
+        else if (!strcmp(directive, "include"))
+        {
+            markerEmitted = preprocessor_handle_include(preprocessor, source, args);
+        }
+        else if (!strcmp(directive, "pragma"))
+        {
+            const char *pragma = preprocessor_skip_whitespace(args);
+            if ((strncmp(pragma, "once", strlen("once")) == 0) && !preprocessor_is_identifier_char(pragma[strlen("once")]))
+            {
+                source->file->pragmaOnce = true;
+            }
+        }
+        else if (!strcmp(directive, "error"))
+        {
+            log(LOG_FATAL, "%s:%zu: #error%s", source->file->path, source->line, args);
+        }
+        else if (!strcmp(directive, "warning"))
+        {
+            log(LOG_WARNING, "%s:%zu: #warning%s", source->file->path, source->line, args);
+        }
+        else
+        {
+            log(LOG_FATAL, "%s:%zu: invalid preprocessing directive #%s", source->file->path, source->line, directive);
+        }
+    }
+
+    free(directive);
+    return markerEmitted;
+}
+
+/*
+ * Driver
+ */
+
+// process the next logical line of input, appending its result to the output buffer
+// returns false once there is no more input
+bool preprocessor_process_line(struct Preprocessor *preprocessor)
+{
+    struct PreprocessorSource *source = preprocessor_current_source(preprocessor);
+    if (source == NULL)
+    {
+        return false;
+    }
+
+    if (source->position >= source->file->length)
+    {
+        preprocessor_pop_source(preprocessor);
+        return true;
+    }
+
+    struct PreprocessorBuffer *line = &preprocessor->lineBuffer;
+    size_t lineNum = source->line;
+    size_t nPhysicalLines = preprocessor_read_logical_line(source, line);
+    source->line += nPhysicalLines;
+
+    const char *firstNonBlank = preprocessor_skip_whitespace(line->data);
+    if (*firstNonBlank == '#')
+    {
+        // restore the line number of the directive itself for error messages
+        size_t nextLine = source->line;
+        source->line = lineNum;
+        preprocessor->expandingLine = lineNum;
+        bool markerEmitted = preprocessor_handle_directive(preprocessor, source, firstNonBlank + 1);
+        source->line = nextLine;
+        if (!markerEmitted)
+        {
+            for (size_t i = 0; i < nPhysicalLines; i++)
+            {
+                preprocessor_buffer_append_char(&preprocessor->output, '\n');
+            }
+        }
+        return true;
+    }
+
+    if (!preprocessor_is_active(preprocessor))
+    {
+        for (size_t i = 0; i < nPhysicalLines; i++)
+        {
+            preprocessor_buffer_append_char(&preprocessor->output, '\n');
+        }
+        return true;
+    }
+
+    if ((*firstNonBlank != '\0') && (source->guardState != IGS_INSIDE_GUARD))
+    {
+        source->guardState = IGS_NONE;
+    }
+
+    // a function-like macro invocation may have its arguments span multiple lines - pull in more lines until it completes
+    preprocessor->expandingLine = lineNum;
+    size_t outputLengthBefore = preprocessor->output.length;
+    while (preprocessor_expand(preprocessor, line->data, line->length, &preprocessor->output) == PER_INCOMPLETE)
+    {
+        preprocessor->output.length = outputLengthBefore;
+        if (source->position >= source->file->length)
+        {
+            log(LOG_FATAL, "%s:%zu: unterminated argument list invoking macro", source->file->path, lineNum);
+        }
+
+        struct PreprocessorBuffer continuation = {0};
+        size_t nContinuationLines = preprocessor_read_logical_line(source, &continuation);
+        source->line += nContinuationLines;
+        nPhysicalLines += nContinuationLines;
+        preprocessor_buffer_append_char(line, ' ');
+        preprocessor_buffer_append_n(line, continuation.data, continuation.length);
+        preprocessor_buffer_deinit(&continuation);
+    }
+
+    // keep line numbers in sync with the input when multiple physical lines were joined
+    for (size_t i = 0; i < nPhysicalLines; i++)
+    {
+        preprocessor_buffer_append_char(&preprocessor->output, '\n');
+    }
+
+    return true;
+}
+
+struct Preprocessor *preprocessor_new(List *includePath, struct IncludeCache *includeCache)
+{
+    struct Preprocessor *wip = malloc(sizeof(struct Preprocessor));
+    memset(wip, 0, sizeof(struct Preprocessor));
+    wip->includePath = includePath;
+    wip->includeCache = includeCache;
+    wip->macros = hash_table_new(NULL, (MBCL_DATA_FREE_FUNCTION)macro_free, (ssize_t(*)(void *, void *))strcmp, hash_string, 256);
+    wip->sources = stack_new(NULL);
+    wip->conditionals = stack_new(free);
+    wip->includedFiles = hash_table_new(NULL, NULL, (ssize_t(*)(void *, void *))strcmp, hash_string, 64);
+    return wip;
+}
+
+void preprocessor_free(struct Preprocessor *preprocessor)
+{
+    while (preprocessor->sources->size > 0)
+    {
+        struct PreprocessorSource *source = stack_pop(preprocessor->sources);
+        free(source->guardCandidate);
+        free(source);
+    }
+    stack_free(preprocessor->sources);
+    stack_free(preprocessor->conditionals);
+    hash_table_free(preprocessor->macros);
+    hash_table_free(preprocessor->includedFiles);
+    preprocessor_buffer_deinit(&preprocessor->output);
+    preprocessor_buffer_deinit(&preprocessor->lineBuffer);
+    free(preprocessor);
+}
+
+void preprocessor_mark_included(struct Preprocessor *preprocessor, char *path, char *guardMacro, bool pragmaOnce)
+{
+    struct IncludedFile *file = include_cache_lookup(preprocessor->includeCache, path);
+    if (file->contents == NULL)
+    {
+        return;
+    }
+
+    if ((file->guardMacro == NULL) && (guardMacro != NULL))
+    {
+        file->guardMacro = strdup(guardMacro);
+    }
+    file->pragmaOnce |= pragmaOnce;
+
+    if (hash_table_find(preprocessor->includedFiles, file->path) == NULL)
+    {
+        hash_table_insert(preprocessor->includedFiles, file->path, file);
+    }
+}
+
+void preprocessor_begin(struct Preprocessor *preprocessor, char *fileName)
+{
+    struct IncludedFile *mainFile = NULL;
+    if (strcmp(fileName, "stdin") == 0)
+    {
+        // stdin can only be read once - cache it under a name no real file will collide with
+        mainFile = include_cache_lookup(preprocessor->includeCache, "<stdin>");
+        if (mainFile->contents == NULL)
+        {
+            mainFile->contents = read_entire_file(stdin, &mainFile->length);
+        }
+    }
+    else
+    {
+        mainFile = include_cache_lookup(preprocessor->includeCache, fileName);
+        if (mainFile->contents == NULL)
+        {
+            log(LOG_FATAL, "Unable to open input file %s", fileName);
+        }
+    }
+
+    hash_table_insert(preprocessor->includedFiles, mainFile->path, mainFile);
+    preprocessor_push_source(preprocessor, mainFile);
+}
+
+void preprocessor_begin_detached(struct Preprocessor *preprocessor, struct IncludedFile *file)
+{
+    preprocessor_push_source(preprocessor, file);
+}
+
+void preprocessor_skip(struct Preprocessor *preprocessor, size_t length, size_t nLines)
+{
+    struct PreprocessorSource *source = preprocessor_current_source(preprocessor);
+    source->position += length;
+    source->line += nLines;
+    preprocessor_emit_line_marker(preprocessor, source, false);
+}
+
+size_t preprocessor_preamble_length(const char *contents, size_t length, size_t *nLinesOut)
+{
+    const char *end = contents + length;
+    const char *cursor = contents;
+    size_t nLines = 0;
+    size_t preambleLength = 0;
+    size_t preambleLines = 0;
+
+    while (cursor < end)
+    {
+        const char *lineEnd = memchr(cursor, '\n', end - cursor);
+        if (lineEnd == NULL)
+        {
+            // the preamble only ever covers whole lines
+            break;
+        }
+
+        const char *text = preprocessor_skip_whitespace(cursor);
+        if ((lineEnd > cursor) && (lineEnd[-1] == '\\'))
+        {
+            break;
+        }
+
+        if (*text == '#')
+        {
+            const char *directive = preprocessor_skip_whitespace(text + 1);
+            if ((strncmp(directive, "include", strlen("include")) != 0) || preprocessor_is_identifier_char(directive[strlen("include")]))
+            {
+                break;
+            }
+        }
+        else if ((text != lineEnd) && (strncmp(text, "//", 2) != 0))
+        {
+            break;
+        }
+
+        cursor = lineEnd + 1;
+        nLines++;
+        if (*text == '#')
+        {
+            preambleLength = cursor - contents;
+            preambleLines = nLines;
+        }
+    }
+
+    *nLinesOut = preambleLines;
+    return preambleLength;
+}
+
+int preprocessor_getc(struct Preprocessor *preprocessor)
+{
+    while (preprocessor->outputPosition >= preprocessor->output.length)
+    {
+        preprocessor_buffer_clear(&preprocessor->output);
+        preprocessor->outputPosition = 0;
+        if (!preprocessor_process_line(preprocessor))
+        {
+            return EOF;
+        }
+    }
+
+    return (unsigned char)preprocessor->output.data[preprocessor->outputPosition++];
+}
+
+void preprocessor_read_all(struct Preprocessor *preprocessor)
+{
+    while (preprocessor_process_line(preprocessor))
+    {
+    }
+}
@@ -6,6 +6,7 @@
 #include "log.h"
 #include "regalloc_generic.h"
 #include "symtab.h"
+#include "time_report.h"
 #include "util.h"
 
 #include "mbcl/list.h"
@@ -45,23 +46,37 @@ size_t lifetime_heuristic(struct Lifetime *lifetime)
     return heuristic;
 }
 
-size_t find_max_tac_index(Set *lifetimes)
+size_t find_max_tac_index(struct RegallocMetadata *metadata)
 {
     size_t maxIndex = 0;
-    Iterator *ltRunner = NULL;
-    for (ltRunner = set_begin(lifetimes); iterator_gettable(ltRunner); iterator_next(ltRunner))
+    for (size_t lifetimeIndex = 0; lifetimeIndex < metadata->nLifetimes; lifetimeIndex++)
     {
-        struct Lifetime *examinedLifetime = iterator_get(ltRunner);
-        if (examinedLifetime->end > maxIndex)
+        struct Lifetime *examinedLifetime = metadata->lifetimes[lifetimeIndex];
+        if ((examinedLifetime != NULL) && (examinedLifetime->end > maxIndex))
         {
             maxIndex = examinedLifetime->end;
         }
     }
-    iterator_free(ltRunner);
 
     return maxIndex;
 }
 
+// return a set (ordered by lifetime index) of every lifetime in the function which satisfies the predicate, or all of them if it is NULL
+Set *lifetimes_to_set(struct RegallocMetadata *metadata, bool (*predicate)(struct Lifetime *lifetime))
+{
+    Set *lifetimes = set_new(NULL, (ssize_t(*)(void *, void *))lifetime_compare);
+    for (size_t lifetimeIndex = 0; lifetimeIndex < metadata->nLifetimes; lifetimeIndex++)
+    {
+        struct Lifetime *examinedLifetime = metadata->lifetimes[lifetimeIndex];
+        if ((examinedLifetime != NULL) && ((predicate == NULL) || predicate(examinedLifetime)))
+        {
+            set_insert(lifetimes, examinedLifetime);
+        }
+    }
+
+    return lifetimes;
+}
+
 // return an array of sets, indexed by TAC index
 Array *find_lifetime_overlaps(Set *lifetimes, size_t largestTACIndex)
 {
@@ -145,8 +160,8 @@ void setup_local_stack(struct RegallocMetadata *metadata, struct MachineInfo *in
     for (localIterator = list_begin(localStackLifetimes); iterator_gettable(localIterator); iterator_next(localIterator))
     {
         struct Lifetime *printedStackLt = iterator_get(localIterator);
-        localOffset -= (ssize_t)type_get_size(&printedStackLt->type, metadata->function->mainScope);
-        localOffset -= (ssize_t)scope_compute_padding_for_alignment(metadata->function->mainScope, &printedStackLt->type, localOffset);
+        localOffset -= (ssize_t)type_get_size(printedStackLt->type, metadata->function->mainScope);
+        localOffset -= (ssize_t)scope_compute_padding_for_alignment(metadata->function->mainScope, printedStackLt->type, localOffset);
         printedStackLt->writebackInfo.stackOffset = localOffset;
 
         log(LOG_DEBUG, "Assign stack offset %zd to lifetime %s", printedStackLt->writebackInfo.stackOffset, printedStackLt->name);
@@ -174,9 +189,9 @@ void setup_argument_stack(struct RegallocMetadata *metadata, List *argumentStack
     for (argIterator = list_begin(argumentStackLifetimes); iterator_gettable(argIterator); iterator_next(argIterator))
     {
         struct Lifetime *printedStackLt = iterator_get(argIterator);
-        argOffset += (ssize_t)scope_compute_padding_for_alignment(metadata->function->mainScope, &printedStackLt->type, argOffset);
+        argOffset += (ssize_t)scope_compute_padding_for_alignment(metadata->function->mainScope, printedStackLt->type, argOffset);
         printedStackLt->writebackInfo.stackOffset = argOffset;
-        argOffset += (ssize_t)type_get_size(&printedStackLt->type, metadata->function->mainScope);
+        argOffset += (ssize_t)type_get_size(printedStackLt->type, metadata->function->mainScope);
 
         log(LOG_DEBUG, "Assign stack offset %zd to argument lifetime %s", printedStackLt->writebackInfo.stackOffset, printedStackLt->name);
     }
@@ -216,16 +231,14 @@ List *get_sorted_stack_lifetimes(struct RegallocMetadata *metadata)
     List *lifetimesPlusSizes = list_new(free, lifetime_plus_size_compare);
 
     // go over all lifetimes, if they have a stack writeback location we need to deal with them
-    Iterator *ltRunner = NULL;
-    for (ltRunner = set_begin(metadata->allLifetimes); iterator_gettable(ltRunner); iterator_next(ltRunner))
+    for (size_t lifetimeIndex = 0; lifetimeIndex < metadata->nLifetimes; lifetimeIndex++)
     {
-        struct Lifetime *examinedLt = iterator_get(ltRunner);
-        if (examinedLt->wbLocation == WB_STACK)
+        struct Lifetime *examinedLt = metadata->lifetimes[lifetimeIndex];
+        if ((examinedLt != NULL) && (examinedLt->wbLocation == WB_STACK))
         {
-            list_append(lifetimesPlusSizes, package_lifetime_and_size(examinedLt, type_get_size(&examinedLt->type, metadata->scope)));
+            list_append(lifetimesPlusSizes, package_lifetime_and_size(examinedLt, type_get_size(examinedLt->type, metadata->scope)));
         }
     }
-    iterator_free(ltRunner);
 
     list_sort(lifetimesPlusSizes);
 
@@ -303,7 +316,7 @@ Set *pre_select_register_contention_lifetimes(Set *selectFrom, struct Scope *sco
 
         case WB_UNKNOWN:
             // if we are potentially going to assign a register to this lifetime, make sure it is small enough to fit in a register
-            if (type_get_size(&examinedLt->type, scope) > MACHINE_REGISTER_SIZE_BYTES)
+            if (type_get_size(examinedLt->type, scope) > MACHINE_REGISTER_SIZE_BYTES)
             {
                 set_insert(selectFrom, examinedLt);
             }
@@ -423,21 +436,15 @@ Set *select_register_lifetimes(struct RegallocMetadata *metadata, Set *selectFro
     return registerContentionLifetimes;
 }
 
-void allocate_argument_registers(struct RegallocMetadata *metadata, struct MachineInfo *machineInfo)
+bool lifetime_is_argument(struct Lifetime *lifetime)
 {
-    Set *argumentLifetimes = set_new(NULL, metadata->allLifetimes->compareData);
+    return lifetime->isArgument;
+}
 
+void allocate_argument_registers(struct RegallocMetadata *metadata, struct MachineInfo *machineInfo)
+{
+    Set *argumentLifetimes = lifetimes_to_set(metadata, lifetime_is_argument);
     Iterator *ltRunner = NULL;
-    for (ltRunner = set_begin(metadata->allLifetimes); iterator_gettable(ltRunner); iterator_next(ltRunner))
-    {
-        struct Lifetime *potentialArgumentLt = iterator_get(ltRunner);
-        if (potentialArgumentLt->isArgument)
-        {
-            set_insert(argumentLifetimes, potentialArgumentLt);
-        }
-    }
-    iterator_free(ltRunner);
-    ltRunner = NULL;
 
     Stack *argumentRegisterPool = stack_new(NULL);
 
@@ -465,8 +472,7 @@ void allocate_argument_registers(struct RegallocMetadata *metadata, struct Machi
 
 void allocate_general_registers(struct RegallocMetadata *metadata, struct MachineInfo *machineInfo)
 {
-    Set *registerContentionLifetimes = set_copy(metadata->allLifetimes);
-    registerContentionLifetimes->freeData = NULL;
+    Set *registerContentionLifetimes = lifetimes_to_set(metadata, NULL);
 
     Stack *registerPool = stack_new(NULL);
 
@@ -500,6 +506,7 @@ void allocate_general_registers(struct RegallocMetadata *metadata, struct Machin
 void allocate_registers(struct RegallocMetadata *metadata, struct MachineInfo *info)
 {
     log(LOG_INFO, "Allocate registers for %s", metadata->function->name);
+    time_report_begin(metadata->function->name);
 
     // register pointers are unique and only one should exist for a given register
     metadata->touchedRegisters = set_new(NULL, register_compare);
@@ -514,9 +521,16 @@ void allocate_registers(struct RegallocMetadata *metadata, struct MachineInfo *i
         set_insert(metadata->touchedRegisters, info->framePointer);
     }
 
-    metadata->allLifetimes = find_lifetimes(metadata->function->mainScope, metadata->function->BasicBlockList);
+    // the function's code is final by now, so flatten it for the walks of regalloc and codegen
+    if (metadata->function->ir != NULL)
+    {
+        function_ir_free(metadata->function->ir);
+    }
+    metadata->function->ir = function_ir_build(metadata->function);
+
+    find_lifetimes(metadata);
 
-    metadata->largestTacIndex = find_max_tac_index(metadata->allLifetimes);
+    metadata->largestTacIndex = find_max_tac_index(metadata);
 
     allocate_argument_registers(metadata, info);
     allocate_general_registers(metadata, info);
@@ -524,12 +538,15 @@ void allocate_registers(struct RegallocMetadata *metadata, struct MachineInfo *i
     allocate_stack_space(metadata, info);
 
     char *ltLengthString = malloc(metadata->largestTacIndex + 3);
-    Iterator *ltRunner = NULL;
-    for (ltRunner = set_begin(metadata->allLifetimes); iterator_gettable(ltRunner); iterator_next(ltRunner))
+    for (size_t lifetimeIndex = 0; lifetimeIndex < metadata->nLifetimes; lifetimeIndex++)
     {
         const u8 LOC_STR_LEN = 16;
         char location[LOC_STR_LEN + 1];
-        struct Lifetime *printedLt = iterator_get(ltRunner);
+        struct Lifetime *printedLt = metadata->lifetimes[lifetimeIndex];
+        if (printedLt == NULL)
+        {
+            continue;
+        }
         switch (printedLt->wbLocation)
         {
         case WB_GLOBAL:
@@ -561,8 +578,9 @@ void allocate_registers(struct RegallocMetadata *metadata, struct MachineInfo *i
 
         log(LOG_INFO, "%40s:%s:%s", printedLt->name, location, ltLengthString);
     }
-    iterator_free(ltRunner);
     free(ltLengthString);
+
+    time_report_end();
 }
 
 void allocate_registers_for_scope(struct Scope *scope, struct MachineInfo *info);
@@ -572,7 +590,7 @@ void allocate_registers_for_type(struct TypeEntry *theType, struct MachineInfo *
 void allocate_registers_for_type_non_generic(struct TypeEntry *theType, struct MachineInfo *info)
 {
     Iterator *implementedIter = NULL;
-    for (implementedIter = set_begin(theType->implemented->entries); iterator_gettable(implementedIter); iterator_next(implementedIter))
+    for (implementedIter = deque_front(theType->implemented->entries); iterator_gettable(implementedIter); iterator_next(implementedIter))
     {
         struct ScopeMember *entry = iterator_get(implementedIter);
         if (entry->type != E_FUNCTION)
@@ -619,7 +637,7 @@ void allocate_registers_for_type(struct TypeEntry *theType, struct MachineInfo *
 void allocate_registers_for_scope(struct Scope *scope, struct MachineInfo *info)
 {
     Iterator *entryIterator = NULL;
-    for (entryIterator = set_begin(scope->entries); iterator_gettable(entryIterator); iterator_next(entryIterator))
+    for (entryIterator = deque_front(scope->entries); iterator_gettable(entryIterator); iterator_next(entryIterator))
     {
         struct ScopeMember *thisMember = iterator_get(entryIterator);
 
@@ -1,40 +1,124 @@
 #include "regalloc_generic.h"
 
+#include "function_ir.h"
+#include "idfa_livevars.h"
 #include "log.h"
 #include "symtab.h"
 #include "tac.h"
+#include "type_table.h"
 #include "util.h"
-#include <mbcl/stack.h>
 #include <string.h>
 
-struct Lifetime *lifetime_find_by_name(Set *allLifetimes, char *lifetimeName)
+const size_t LIFETIME_INDEX_FIRST_TEMP = 1;
+
+/*
+ * Lifetimes by name
+ * Open addressing with linear probing on the id of the variable's interned name, so that finding the lifetime of a
+ * variable never needs to look at the name itself
+ */
+
+const size_t LIFETIME_NAME_INDEX_INITIAL_SLOTS = 16;
+
+size_t lifetime_name_index_hash(u32 nameId)
+{
+    const u64 LIFETIME_NAME_INDEX_HASH_MULTIPLIER = 0x9e3779b97f4a7c15;
+    return ((u64)nameId * LIFETIME_NAME_INDEX_HASH_MULTIPLIER) >> 32;
+}
+
+// find the slot which either holds the lifetime for nameId or is the empty slot where it would be inserted
+struct LifetimeNameSlot *lifetime_name_index_probe(struct LifetimeNameIndex *index, u32 nameId)
+{
+    size_t slotIndex = lifetime_name_index_hash(nameId) & (index->nSlots - 1);
+    while ((index->slots[slotIndex].lifetime != NULL) && (index->slots[slotIndex].nameId != nameId))
+    {
+        slotIndex = (slotIndex + 1) & (index->nSlots - 1);
+    }
+    return &index->slots[slotIndex];
+}
+
+void lifetime_name_index_init(struct LifetimeNameIndex *index, size_t expectedLifetimes)
+{
+    index->nSlots = LIFETIME_NAME_INDEX_INITIAL_SLOTS;
+    while (index->nSlots < (expectedLifetimes * 2))
+    {
+        index->nSlots *= 2;
+    }
+    index->slots = calloc(index->nSlots, sizeof(struct LifetimeNameSlot));
+    index->nUsed = 0;
+}
+
+struct Lifetime *lifetime_name_index_find(struct LifetimeNameIndex *index, u32 nameId)
+{
+    if (index->nSlots == 0)
+    {
+        return NULL;
+    }
+    return lifetime_name_index_probe(index, nameId)->lifetime;
+}
+
+void lifetime_name_index_insert(struct LifetimeNameIndex *index, u32 nameId, struct Lifetime *lifetime)
+{
+    // keep the index at most half full so probe sequences stay short
+    if ((index->nUsed + 1) * 2 > index->nSlots)
+    {
+        struct LifetimeNameSlot *oldSlots = index->slots;
+        size_t oldNSlots = index->nSlots;
+        index->nSlots *= 2;
+        index->slots = calloc(index->nSlots, sizeof(struct LifetimeNameSlot));
+        for (size_t slotIndex = 0; slotIndex < oldNSlots; slotIndex++)
+        {
+            if (oldSlots[slotIndex].lifetime != NULL)
+            {
+                *lifetime_name_index_probe(index, oldSlots[slotIndex].nameId) = oldSlots[slotIndex];
+            }
+        }
+        free(oldSlots);
+    }
+
+    struct LifetimeNameSlot *slot = lifetime_name_index_probe(index, nameId);
+    slot->nameId = nameId;
+    slot->lifetime = lifetime;
+    index->nUsed++;
+}
+
+void lifetime_name_index_deinit(struct LifetimeNameIndex *index)
+{
+    free(index->slots);
+    memset(index, 0, sizeof(struct LifetimeNameIndex));
+}
+
+struct Lifetime *lifetime_find_for_variable(struct RegallocMetadata *metadata, struct VariableEntry *variable)
 {
-    struct Lifetime dummy = {0};
-    dummy.name = lifetimeName;
-    return set_find(allLifetimes, &dummy);
+    return lifetime_name_index_find(&metadata->lifetimesByName, variable->nameId);
 }
 
-struct Lifetime *lifetime_find(Set *allLifetimes, struct TACOperand *operand)
+struct Lifetime *lifetime_find(struct RegallocMetadata *metadata, struct TACOperand *operand)
 {
-    if (operand->permutation == VP_LITERAL_STR || operand->permutation == VP_LITERAL_VAL)
+    if ((operand->permutation != VP_STANDARD) && (operand->permutation != VP_TEMP))
     {
         return NULL;
     }
 
-    return lifetime_find_by_name(allLifetimes, operand->name.variable->name);
+    if (operand->lifetimeIndex >= metadata->nLifetimes)
+    {
+        InternalError("Lifetime index %zu of %s is out of range (%s has %zu lifetimes)", operand->lifetimeIndex, tac_operand_get_variable_name(operand), metadata->function->name, metadata->nLifetimes);
+    }
+
+    return metadata->lifetimes[operand->lifetimeIndex];
 }
 
 struct Lifetime *lifetime_new(char *name, struct Type *type, size_t start, u8 isGlobal, u8 mustSpill)
 {
     struct Lifetime *wip = malloc(sizeof(struct Lifetime));
     wip->name = name;
-    wip->type = *type;
+    wip->type = type_intern(type);
     wip->start = start;
     wip->end = start;
     wip->writebackInfo.stackOffset = 0;
     wip->isArgument = 0;
     wip->nwrites = 0;
     wip->nreads = 0;
+    wip->index = 0;
     if (isGlobal)
     {
         wip->wbLocation = WB_GLOBAL;
@@ -60,7 +144,7 @@ size_t lifetime_hash(struct Lifetime *lifetime)
 
 ssize_t lifetime_compare(struct Lifetime *lifetimeA, struct Lifetime *lifetimeB)
 {
-    return strcmp(lifetimeA->name, lifetimeB->name);
+    return (ssize_t)lifetimeA->index - (ssize_t)lifetimeB->index;
 }
 
 // whether or not the lifetime is live at the given index
@@ -75,24 +159,42 @@ bool lifetime_is_live_after_index(struct Lifetime *lifetime, size_t index)
     return (lifetime->start <= index) && (lifetime->end > index);
 }
 
+// add a new lifetime to the function's lifetimes at the given index, growing the lifetime array if necessary
+void lifetime_add_indexed(struct RegallocMetadata *metadata, struct Lifetime *lifetime, size_t index)
+{
+    if (index >= metadata->lifetimesCapacity)
+    {
+        size_t newCapacity = MAX(metadata->lifetimesCapacity * 2, index + 1);
+        metadata->lifetimes = realloc(metadata->lifetimes, newCapacity * sizeof(struct Lifetime *));
+        memset(metadata->lifetimes + metadata->lifetimesCapacity, 0, (newCapacity - metadata->lifetimesCapacity) * sizeof(struct Lifetime *));
+        metadata->lifetimesCapacity = newCapacity;
+    }
+
+    lifetime->index = index;
+    metadata->lifetimes[index] = lifetime;
+    metadata->nLifetimes = MAX(metadata->nLifetimes, index + 1);
+}
+
 // search through the list of existing lifetimes
 // update the lifetime if it exists, insert if it doesn't
-// returns pointer to the lifetime corresponding to the passed variable name
-struct Lifetime *update_or_insert_lifetime(Set *lifetimes,
-                                           char *name,
+// returns pointer to the lifetime corresponding to the passed variable
+struct Lifetime *update_or_insert_lifetime(struct RegallocMetadata *metadata,
+                                           struct VariableEntry *variable,
                                            struct Type *type,
                                            size_t newEnd,
                                            u8 isGlobal,
                                            u8 mustSpill)
 {
-    struct Lifetime *thisLt = lifetime_find_by_name(lifetimes, name);
+    char *name = variable->name;
+    struct Lifetime *thisLt = lifetime_name_index_find(&metadata->lifetimesByName, variable->nameId);
     if (thisLt != NULL)
     {
         // this should never fire with well-formed TAC
         // may be helpful when adding/troubleshooting new TAC generation
-        if (type_compare(&thisLt->type, type))
+        // the types of variables and lifetimes are both canonical, so the same type is the same pointer
+        if (thisLt->type != type)
         {
-            char *expectedTypename = type_get_name(&thisLt->type);
+            char *expectedTypename = type_get_name(thisLt->type);
             char *typename = type_get_name(type);
             InternalError("Type mismatch between identically named variables [%s] expected %s, saw %s!", name, expectedTypename, typename);
         }
@@ -107,164 +209,209 @@ struct Lifetime *update_or_insert_lifetime(Set *lifetimes,
         log(LOG_DEBUG, "Create lifetime starting at %zu for %s %s: global? %d mustspill? %d", newEnd, typeName, name, isGlobal, mustSpill);
         free(typeName);
         thisLt = lifetime_new(name, type, newEnd, isGlobal, mustSpill);
-        set_insert(lifetimes, thisLt);
+        lifetime_add_indexed(metadata, thisLt, metadata->nLifetimes);
+        lifetime_name_index_insert(&metadata->lifetimesByName, variable->nameId, thisLt);
     }
 
     return thisLt;
 }
 
+// temps are only ever referred to by number, and their lifetimes are indexed directly by it
+struct Lifetime *update_or_insert_temp_lifetime(struct RegallocMetadata *metadata, struct TempVariable *temp, size_t newEnd)
+{
+    size_t tempLifetimeIndex = LIFETIME_INDEX_FIRST_TEMP + temp->number;
+    struct Lifetime *thisLt = metadata->lifetimes[tempLifetimeIndex];
+    if (thisLt != NULL)
+    {
+        if (newEnd > thisLt->end)
+        {
+            thisLt->end = newEnd;
+        }
+    }
+    else
+    {
+        log(LOG_DEBUG, "Create lifetime starting at %zu for temp %s: mustspill? %d", newEnd, temp->name, temp->mustSpill);
+        thisLt = lifetime_new(temp->name, &temp->type, newEnd, 0, temp->mustSpill);
+        lifetime_add_indexed(metadata, thisLt, tempLifetimeIndex);
+    }
+
+    return thisLt;
+}
+
+struct Lifetime *update_or_insert_lifetime_for_operand(struct RegallocMetadata *metadata, struct TACOperand *operand, size_t newEnd)
+{
+    struct Lifetime *updatedLifetime = NULL;
+    switch (operand->permutation)
+    {
+    case VP_STANDARD:
+    {
+        struct VariableEntry *recordedVariable = operand->name.variable;
+        // always use ->type as we don't care what it's cast as to determine its lifetime
+        updatedLifetime = update_or_insert_lifetime(metadata, recordedVariable, tac_operand_get_non_cast_type(operand), newEnd, recordedVariable->isGlobal, recordedVariable->mustSpill);
+    }
+    break;
+
+    case VP_TEMP:
+        updatedLifetime = update_or_insert_temp_lifetime(metadata, operand->name.temp, newEnd);
+        break;
+
+    case VP_LITERAL_STR:
+    case VP_LITERAL_VAL:
+    case VP_UNUSED:
+        InternalError("Attempt to record lifetime of non-variable operand");
+    }
+
+    // remember the index so later lookups for this operand are a single array access
+    operand->lifetimeIndex = updatedLifetime->index;
+    return updatedLifetime;
+}
+
 // wrapper function for updateOrInsertLifetime
 //  increments write count for the given variable
-void record_variable_write(Set *lifetimes,
+void record_variable_write(struct RegallocMetadata *metadata,
                            struct TACOperand *writtenOperand,
-                           struct Scope *scope,
                            size_t newEnd)
 {
-    log(LOG_DEBUG, "Record variable write for %s at index %zu", writtenOperand->name.variable->name, newEnd);
-
-    u8 isGlobal = 0;
-    u8 mustSpill = 0;
-    struct VariableEntry *recordedVariable = writtenOperand->name.variable;
-    isGlobal = recordedVariable->isGlobal;
-    mustSpill = recordedVariable->mustSpill;
+    log(LOG_DEBUG, "Record variable write for %s at index %zu", tac_operand_get_variable_name(writtenOperand), newEnd);
 
-    // always use ->type as we don't care what it's cast as to determine its lifetime
-    struct Lifetime *updatedLifetime = update_or_insert_lifetime(lifetimes, recordedVariable->name, tac_operand_get_non_cast_type(writtenOperand), newEnd, isGlobal, mustSpill);
+    struct Lifetime *updatedLifetime = update_or_insert_lifetime_for_operand(metadata, writtenOperand, newEnd);
     updatedLifetime->nwrites += 1;
 }
 
 // wrapper function for updateOrInsertLifetime
 //  increments read count for the given variable
-void record_variable_read(Set *lifetimes,
+void record_variable_read(struct RegallocMetadata *metadata,
                           struct TACOperand *readOperand,
-                          struct Scope *scope,
                           size_t newEnd)
 {
-    log(LOG_DEBUG, "Record variable read for %s at index %zu", readOperand->name.variable->name, newEnd);
-
-    u8 isGlobal = 0;
-    u8 mustSpill = 0;
+    log(LOG_DEBUG, "Record variable read for %s at index %zu", tac_operand_get_variable_name(readOperand), newEnd);
 
-    struct VariableEntry *recordedVariable = readOperand->name.variable;
-    isGlobal = recordedVariable->isGlobal;
-    mustSpill = recordedVariable->mustSpill;
-
-    // always use ->type as we don't care what it's cast as to determine its lifetime
-    struct Lifetime *updatedLifetime = update_or_insert_lifetime(lifetimes, recordedVariable->name, tac_operand_get_non_cast_type(readOperand), newEnd, isGlobal, mustSpill);
+    struct Lifetime *updatedLifetime = update_or_insert_lifetime_for_operand(metadata, readOperand, newEnd);
     updatedLifetime->nreads += 1;
 }
 
-void record_lifetime_write_for_operand(Set *lifetimes, struct TACOperand *operand, struct Scope *scope, size_t tacIndex)
+void record_lifetime_write_for_operand(struct RegallocMetadata *metadata, struct TACOperand *operand, size_t tacIndex)
 {
     if ((tac_operand_get_type(operand)->basicType != VT_NULL) &&
         (operand->permutation != VP_LITERAL_STR) &&
         (operand->permutation != VP_LITERAL_VAL))
     {
-        record_variable_write(lifetimes, operand, scope, tacIndex);
+        record_variable_write(metadata, operand, tacIndex);
     }
 }
 
-void record_lifetime_read_for_operand(Set *lifetimes, struct TACOperand *operand, struct Scope *scope, size_t tacIndex)
+void record_lifetime_read_for_operand(struct RegallocMetadata *metadata, struct TACOperand *operand, size_t tacIndex)
 {
     if ((tac_operand_get_type(operand)->basicType != VT_NULL) &&
         (operand->permutation != VP_LITERAL_STR) &&
         (operand->permutation != VP_LITERAL_VAL))
     {
-        record_variable_read(lifetimes, operand, scope, tacIndex);
+        record_variable_read(metadata, operand, tacIndex);
     }
 }
 
-void find_lifetimes_for_tac(Set *lifetimes, struct Scope *scope, struct TACLine *line, Stack *doDepth)
+void find_lifetimes_for_tac(struct RegallocMetadata *metadata, struct TACLine *line)
 {
-    // handle tt_do/tt_enddo stack and lifetime extension
-    switch (line->operation)
+    struct OperandUsages lineUsages = get_operand_usages(line);
+    for (size_t readIndex = 0; readIndex < operand_usages_n_reads(&lineUsages); readIndex++)
     {
-    case TT_DO:
-        stack_push(doDepth, (void *)(long int)line->index);
-        break;
+        record_lifetime_read_for_operand(metadata, operand_usages_read(&lineUsages, readIndex), line->index);
+    }
 
-    case TT_ENDDO:
+    for (size_t writeIndex = 0; writeIndex < lineUsages.nWrites; writeIndex++)
     {
-        size_t extendTo = line->index;
-        size_t extendFrom = (size_t)stack_pop(doDepth);
+        record_lifetime_write_for_operand(metadata, lineUsages.writes[writeIndex], line->index);
+    }
+}
 
-        Iterator *lifetimeRunner = NULL;
-        for (lifetimeRunner = set_begin(lifetimes); iterator_gettable(lifetimeRunner); iterator_next(lifetimeRunner))
+// stretch the lifetime of everything live after a line to cover it
+void extend_lifetimes_live_after_line(struct Idfa *liveVars, struct TACLine *line, struct BitVector *liveAfter, void *data)
+{
+    struct RegallocMetadata *metadata = data;
+    for (size_t factNumber = bit_vector_next(liveAfter, 0); factNumber < liveAfter->nBits; factNumber = bit_vector_next(liveAfter, factNumber + 1))
+    {
+        // operands with no type get no lifetime
+        struct Lifetime *liveLifetime = lifetime_find(metadata, idfa_fact(liveVars, factNumber));
+        if (liveLifetime == NULL)
         {
-            struct Lifetime *examinedLifetime = iterator_get(lifetimeRunner);
-            if (examinedLifetime->end >= extendFrom && examinedLifetime->end < extendTo)
-            {
-                if (examinedLifetime->name[0] != '.')
-                {
-                    examinedLifetime->end = extendTo + 1;
-                }
-            }
+            continue;
         }
-        iterator_free(lifetimeRunner);
-    }
-    break;
 
-    default:
-        break;
+        liveLifetime->start = MIN(liveLifetime->start, line->index);
+        // live after the line means live after its index (see lifetime_is_live_after_index)
+        liveLifetime->end = MAX(liveLifetime->end, line->index + 1);
     }
+}
 
-    struct OperandUsages lineUsages = get_operand_usages(line);
-    while (lineUsages.reads->size > 0)
-    {
-        struct TACOperand *readOperand = deque_pop_front(lineUsages.reads);
-        record_lifetime_read_for_operand(lifetimes, readOperand, scope, line->index);
-    }
+// lifetimes cover every index at which their variable or temp is referenced, but may also need to cover indices in
+// between where it is only live - in particular across a loop's back edge, where it is read near the top of the loop
+// and must survive the rest of the body to be read again
+void extend_lifetimes_by_liveness(struct RegallocMetadata *metadata)
+{
+    struct FunctionIr *ir = metadata->function->ir;
+    struct IdfaContext *context = idfa_context_create(metadata->function->name, ir);
+    struct Idfa *liveVars = analyze_live_vars(context);
 
-    while (lineUsages.writes->size > 0)
+    for (size_t layoutIndex = 0; layoutIndex < ir->nLaidOut; layoutIndex++)
     {
-        struct TACOperand *writeOperand = deque_pop_front(lineUsages.writes);
-        record_lifetime_write_for_operand(lifetimes, writeOperand, scope, line->index);
+        live_vars_walk_block(liveVars, ir->layout[layoutIndex], extend_lifetimes_live_after_line, metadata);
     }
 
-    deque_free(lineUsages.reads);
-    deque_free(lineUsages.writes);
+    idfa_free(liveVars);
+    idfa_context_free(context);
 }
 
-void add_argument_lifetimes_for_scope(Set *lifetimes, struct Scope *scope)
+void add_argument_lifetimes_for_scope(struct RegallocMetadata *metadata, struct Scope *scope)
 {
     Iterator *entryIterator = NULL;
-    for (entryIterator = set_begin(scope->entries); iterator_gettable(entryIterator); iterator_next(entryIterator))
+    for (entryIterator = deque_front(scope->entries); iterator_gettable(entryIterator); iterator_next(entryIterator))
     {
         struct ScopeMember *thisMember = iterator_get(entryIterator);
         if (thisMember->type == E_ARGUMENT)
         {
             struct VariableEntry *theArgument = thisMember->entry;
             // arguments can be mustSpill too - if they are used in an address-of it will be required not to ever load them into registers
-            update_or_insert_lifetime(lifetimes, thisMember->name, &theArgument->type, 0, 0, theArgument->mustSpill)->isArgument = 1;
+            update_or_insert_lifetime(metadata, theArgument, theArgument->type, 0, 0, theArgument->mustSpill)->isArgument = 1;
         }
     }
     iterator_free(entryIterator);
 }
 
-Set *find_lifetimes(struct Scope *scope, List *basicBlockList)
+void find_lifetimes(struct RegallocMetadata *metadata)
 {
-    Set *lifetimes = set_new(free, (ssize_t(*)(void *, void *))lifetime_compare);
+    struct FunctionEntry *function = metadata->function;
+
+    // index 0 means no lifetime, then temps take their own numbers, then variables are numbered as they are discovered
+    metadata->nLifetimes = LIFETIME_INDEX_FIRST_TEMP + function->temps->size;
+    metadata->lifetimesCapacity = metadata->nLifetimes * 2;
+    metadata->lifetimes = calloc(metadata->lifetimesCapacity, sizeof(struct Lifetime *));
+    // after scope collapse, nearly every variable the function refers to is a member of its main scope
+    lifetime_name_index_init(&metadata->lifetimesByName, function->mainScope->entries->size);
 
-    add_argument_lifetimes_for_scope(lifetimes, scope);
+    add_argument_lifetimes_for_scope(metadata, function->mainScope);
 
-    Stack *doDepth = stack_new(NULL);
-    Iterator *blockRunner = NULL;
-    for (blockRunner = list_begin(basicBlockList); iterator_gettable(blockRunner); iterator_next(blockRunner))
+    struct FunctionIr *ir = function->ir;
+    for (size_t lineIndex = 0; lineIndex < ir->nLines; lineIndex++)
     {
-        struct BasicBlock *thisBlock = iterator_get(blockRunner);
-        Iterator *tacRunner = NULL;
-        for (tacRunner = list_begin(thisBlock->TACList); iterator_gettable(tacRunner); iterator_next(tacRunner))
-        {
-            struct TACLine *thisLine = iterator_get(tacRunner);
-            find_lifetimes_for_tac(lifetimes, scope, thisLine, doDepth);
-        }
-        iterator_free(tacRunner);
+        find_lifetimes_for_tac(metadata, ir->lines[lineIndex]);
     }
-    iterator_free(blockRunner);
 
-    stack_free(doDepth);
+    extend_lifetimes_by_liveness(metadata);
+}
+
+void regalloc_metadata_deinit(struct RegallocMetadata *metadata)
+{
+    for (size_t lifetimeIndex = 0; lifetimeIndex < metadata->nLifetimes; lifetimeIndex++)
+    {
+        free(metadata->lifetimes[lifetimeIndex]);
+    }
+    free(metadata->lifetimes);
+    lifetime_name_index_deinit(&metadata->lifetimesByName);
 
-    return lifetimes;
+    if (metadata->touchedRegisters != NULL)
+    {
+        set_free(metadata->touchedRegisters);
+    }
 }
 
 /*
@@ -0,0 +1,141 @@
+#include "source_location.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "log.h"
+
+_Thread_local struct SourceLocationTable *activeSourceLocations = NULL;
+
+const size_t SOURCE_LOCATION_TABLE_INITIAL_CAPACITY = 1024;
+const size_t SOURCE_LOCATION_TABLE_INITIAL_FILES = 8;
+
+struct SourceLocationTable *source_location_table_new()
+{
+    struct SourceLocationTable *wip = malloc(sizeof(struct SourceLocationTable));
+    wip->nFiles = 0;
+    wip->filesCapacity = SOURCE_LOCATION_TABLE_INITIAL_FILES;
+    wip->fileNames = malloc(wip->filesCapacity * sizeof(char *));
+    wip->nLocations = 0;
+    wip->locationsCapacity = SOURCE_LOCATION_TABLE_INITIAL_CAPACITY;
+    wip->locations = malloc(wip->locationsCapacity * sizeof(struct SourceLocation));
+    wip->lastFileName = NULL;
+    wip->lastFileId = 0;
+
+    // file and location 0 stand in for unknown locations
+    wip->fileNames[wip->nFiles++] = strdup("<unknown>");
+    struct SourceLocation none = {0, 0, 0};
+    wip->locations[wip->nLocations++] = none;
+    return wip;
+}
+
+void source_location_table_free(struct SourceLocationTable *table)
+{
+    for (size_t fileIndex = 0; fileIndex < table->nFiles; fileIndex++)
+    {
+        free(table->fileNames[fileIndex]);
+    }
+    free(table->fileNames);
+    free(table->locations);
+    free(table);
+}
+
+void source_location_table_set_active(struct SourceLocationTable *table)
+{
+    activeSourceLocations = table;
+}
+
+struct SourceLocationTable *source_location_active_table()
+{
+    if (activeSourceLocations == NULL)
+    {
+        InternalError("No source location table active");
+    }
+    return activeSourceLocations;
+}
+
+u32 source_location_file_id(struct SourceLocationTable *table, char *fileName)
+{
+    if (fileName == table->lastFileName)
+    {
+        return table->lastFileId;
+    }
+
+    // file names are copied into the table (so they outlive the AST), so distinct pointers may still name a known file
+    u32 fileId = 0;
+    for (fileId = 0; fileId < table->nFiles; fileId++)
+    {
+        if (strcmp(table->fileNames[fileId], fileName) == 0)
+        {
+            break;
+        }
+    }
+
+    if (fileId == table->nFiles)
+    {
+        if (table->nFiles == table->filesCapacity)
+        {
+            table->filesCapacity *= 2;
+            table->fileNames = realloc(table->fileNames, table->filesCapacity * sizeof(char *));
+        }
+        table->fileNames[table->nFiles++] = strdup(fileName);
+    }
+
+    table->lastFileName = fileName;
+    table->lastFileId = fileId;
+    return fileId;
+}
+
+SourceLoc source_location_of(struct Ast *tree)
+{
+    struct SourceLocationTable *table = source_location_active_table();
+
+    u32 fileId = 0;
+    if (tree->sourceFile != NULL)
+    {
+        fileId = source_location_file_id(table, tree->sourceFile);
+    }
+
+    // consecutive TAC lines are usually generated from the same tree, so reuse the most recent location when it matches
+    struct SourceLocation *latest = &table->locations[table->nLocations - 1];
+    if ((latest->fileId == fileId) && (latest->line == tree->sourceLine) && (latest->col == tree->sourceCol))
+    {
+        return table->nLocations - 1;
+    }
+
+    if (table->nLocations == table->locationsCapacity)
+    {
+        table->locationsCapacity *= 2;
+        table->locations = realloc(table->locations, table->locationsCapacity * sizeof(struct SourceLocation));
+    }
+
+    struct SourceLocation *location = &table->locations[table->nLocations];
+    location->fileId = fileId;
+    location->line = tree->sourceLine;
+    location->col = tree->sourceCol;
+    return table->nLocations++;
+}
+
+struct SourceLocation *source_location_get(SourceLoc loc)
+{
+    struct SourceLocationTable *table = source_location_active_table();
+    if (loc >= table->nLocations)
+    {
+        InternalError("Source location %u out of range (%zu locations)", loc, table->nLocations);
+    }
+    return &table->locations[loc];
+}
+
+char *source_location_file_name(SourceLoc loc)
+{
+    return activeSourceLocations->fileNames[source_location_get(loc)->fileId];
+}
+
+void source_location_populate_ast(SourceLoc loc, struct Ast *tree)
+{
+    struct SourceLocation *location = source_location_get(loc);
+    tree->sourceFile = source_location_file_name(loc);
+    tree->sourceLine = location->line;
+    tree->sourceCol = location->col;
+}
@@ -22,28 +22,31 @@ size_t hash_tac_operand(void *operand)
 
 void print_control_flows_as_dot(struct Idfa *idfa, char *functionName, FILE *outFile)
 {
+    struct FunctionIr *ir = idfa->context->ir;
     fprintf(outFile, "digraph %s{\nedge[dir=forward]\nnode[shape=plaintext,style=filled]\n", functionName);
-    for (size_t blockIndex = 0; blockIndex < idfa->context->blocks->size; blockIndex++)
+    for (size_t blockIndex = 0; blockIndex < idfa->context->nBlocks; blockIndex++)
     {
-        Iterator *flowRunner = NULL;
-        for (flowRunner = set_begin(array_at(idfa->context->successors, blockIndex)); iterator_gettable(flowRunner); iterator_next(flowRunner))
+        struct IrBlock *thisBlock = &ir->blocks[blockIndex];
+        if (thisBlock->block == NULL)
         {
-            struct BasicBlock *destinationBlock = iterator_get(flowRunner);
-            fprintf(outFile, "%s_%zu:s->%s_%zu:n\n", functionName, blockIndex, functionName, destinationBlock->labelNum);
+            continue;
         }
-        iterator_free(flowRunner);
 
-        struct BasicBlock *thisBlock = array_at(idfa->context->blocks, blockIndex);
-        fprintf(outFile, "%s_%zu[label=<%s_%zu<BR />\n", functionName, thisBlock->labelNum, functionName, thisBlock->labelNum);
+        size_t nSuccessors = 0;
+        size_t *successors = function_ir_successors(ir, blockIndex, &nSuccessors);
+        for (size_t successorIndex = 0; successorIndex < nSuccessors; successorIndex++)
+        {
+            fprintf(outFile, "%s_%zu:s->%s_%zu:n\n", functionName, blockIndex, functionName, successors[successorIndex]);
+        }
 
-        Iterator *tacRunner = NULL;
-        for (tacRunner = list_begin(thisBlock->TACList); iterator_gettable(tacRunner); iterator_next(tacRunner))
+        fprintf(outFile, "%s_%zu[label=<%s_%zu<BR />\n", functionName, blockIndex, functionName, blockIndex);
+
+        for (size_t lineIndex = thisBlock->firstLine; lineIndex < thisBlock->firstLine + thisBlock->nLines; lineIndex++)
         {
-            char *tacString = sprint_tac_line(iterator_get(tacRunner));
+            char *tacString = sprint_tac_line(ir->lines[lineIndex]);
             fprintf(outFile, "%s<BR />\n", tacString);
             free(tacString);
         }
-        iterator_free(tacRunner);
         fprintf(outFile, ">]\n");
     }
 
@@ -65,8 +68,8 @@ struct TACOperand *ssa_operand_lookup_or_insert(List *ssaOperands, struct TACOpe
 }
 
 // iterate over all blocks in the order to which they are reachable from the entry block
-// call operationOnBlock for each block, passing the specific block and the generic data pointer to the function
-void traverse_blocks_hierarchically(struct IdfaContext *context, void (*operationOnBlock)(struct BasicBlock *, void *data), void *data)
+// call operationOnBlock for each block, passing the function's IR, the block's label number, and the generic data pointer to the function
+void traverse_blocks_hierarchically(struct IdfaContext *context, void (*operationOnBlock)(struct FunctionIr *ir, size_t labelNum, void *data), void *data)
 {
     // nothing to do if there are no blocks
     if (context->nBlocks == 0)
@@ -74,69 +77,66 @@ void traverse_blocks_hierarchically(struct IdfaContext *context, void (*operatio
         return;
     }
 
-    List *blocksToTraverse = list_new(NULL, NULL);
+    struct FunctionIr *ir = context->ir;
+    Deque *blocksToTraverse = deque_new(NULL);
 
     // block 0 is always the entry of the function, so as long as we start with it we will be fine
-    list_append(blocksToTraverse, array_at(context->blocks, 0));
-    Set *visited = set_new(NULL, pointer_compare);
+    deque_push_back(blocksToTraverse, (void *)(size_t)0);
+    bool *visited = calloc(context->nBlocks, sizeof(bool));
 
-    Set *stronglyConnectedComponent = set_new(NULL, pointer_compare);
+    // number of blocks in a row which have been put back on the queue without visiting anything
+    size_t nRequeuedInARow = 0;
 
     while (blocksToTraverse->size > 0)
     {
         // grab the block at the front of the queue
-        struct BasicBlock *thisBlock = list_pop_front(blocksToTraverse);
+        size_t thisBlock = (size_t)deque_pop_front(blocksToTraverse);
 
         // figure out if we have visited all predecessors of this block
-        u8 sawAllPredecessors = 1;
-        Iterator *predRunner = NULL;
-        for (predRunner = set_begin(array_at(context->predecessors, thisBlock->labelNum)); iterator_gettable(predRunner); iterator_next(predRunner))
+        bool sawAllPredecessors = true;
+        size_t nPredecessors = 0;
+        size_t *predecessors = function_ir_predecessors(ir, thisBlock, &nPredecessors);
+        for (size_t predecessorIndex = 0; predecessorIndex < nPredecessors; predecessorIndex++)
         {
-            struct BasicBlock *predecessorBlock = iterator_get(predRunner);
-
-            if (set_find(visited, predecessorBlock) == NULL)
+            if (!visited[predecessors[predecessorIndex]])
             {
-                sawAllPredecessors = 0;
+                sawAllPredecessors = false;
                 break;
             }
         }
-        iterator_free(predRunner);
 
         // if we have not yet visited all predecessors of this block, put it back on the list to be traversed later
         if (!sawAllPredecessors)
         {
-            // if the strongly connected component is the entire blocksToTraverseList, forcibly override to visit this block next loop
-            if (stronglyConnectedComponent->size != blocksToTraverse->size)
+            // if every block in the queue has been put back since we last visited anything, forcibly override to visit this block next loop
+            if (nRequeuedInARow != blocksToTraverse->size)
             {
-                set_insert(stronglyConnectedComponent, thisBlock);
-                list_append(blocksToTraverse, thisBlock);
+                nRequeuedInARow++;
+                deque_push_back(blocksToTraverse, (void *)thisBlock);
                 continue;
             }
         }
-        operationOnBlock(thisBlock, data);
+        operationOnBlock(ir, thisBlock, data);
 
         // if we successfully visited a block, we may have satisfied a predecessor requirement to visit some other block
-        // thus, we should always clear the strongly connected component whenever we visit
-        set_clear(stronglyConnectedComponent);
+        nRequeuedInARow = 0;
 
         // mark this block as visited if it hasn't been already
-        set_try_insert(visited, thisBlock);
+        visited[thisBlock] = true;
 
-        Iterator *successorRunner = NULL;
-        for (successorRunner = set_begin(array_at(context->successors, thisBlock->labelNum)); iterator_gettable(successorRunner); iterator_next(successorRunner))
+        size_t nSuccessors = 0;
+        size_t *successors = function_ir_successors(ir, thisBlock, &nSuccessors);
+        for (size_t successorIndex = 0; successorIndex < nSuccessors; successorIndex++)
         {
-            struct BasicBlock *successorBlock = iterator_get(successorRunner);
-            if (set_find(visited, successorBlock) == NULL)
+            if (!visited[successors[successorIndex]])
             {
-                list_append(blocksToTraverse, successorBlock);
+                deque_push_back(blocksToTraverse, (void *)successors[successorIndex]);
             }
         }
-        iterator_free(successorRunner);
     }
 
-    list_free(blocksToTraverse);
-    set_free(visited);
-    set_free(stronglyConnectedComponent);
+    deque_free(blocksToTraverse);
+    free(visited);
 }
 
 struct PhiContext
@@ -145,8 +145,9 @@ struct PhiContext
     List *ssaNumbers;
 };
 
-void insert_phi_functions_for_block(struct BasicBlock *block, void *data)
+void insert_phi_functions_for_block(struct FunctionIr *ir, size_t labelNum, void *data)
 {
+    struct IrBlock *block = &ir->blocks[labelNum];
     struct Ast fakePhiTree;
     memset(&fakePhiTree, 0, sizeof(struct Ast));
 
@@ -155,24 +156,24 @@ void insert_phi_functions_for_block(struct BasicBlock *block, void *data)
     struct Idfa *reachingDefs = context->reachingDefs;
 
     size_t blockEntryTacIndex = 0;
-    if (block->TACList->size > 0)
+    if (block->nLines > 0)
     {
-        blockEntryTacIndex = ((struct TACLine *)block->TACList->head->data)->index;
+        blockEntryTacIndex = ir->lines[block->firstLine]->index;
     }
 
     // hash table to map from TAC operand -> count of number of predecessor blocks the variable is live out from
     // struct HashTable *phiVars = hash_table_new(1, hash_tac_operand, tac_operand_compare_ignore_ssa_number, NULL, (void (*)(void *))set_free);
-    HashTable *phiVars = hash_table_new(NULL, (void (*)(void *))set_free, tac_operand_compare_ignore_ssa_number, hash_tac_operand, block->TACList->size + 1);
+    HashTable *phiVars = hash_table_new(NULL, (void (*)(void *))set_free, tac_operand_compare_ignore_ssa_number, hash_tac_operand, block->nLines + 1);
     // iterate all predecessor blocks
-    Iterator *predecessorRunner = NULL;
-    for (predecessorRunner = set_begin(array_at(reachingDefs->context->predecessors, block->labelNum)); iterator_gettable(predecessorRunner); iterator_next(predecessorRunner))
+    size_t nPredecessors = 0;
+    size_t *predecessors = function_ir_predecessors(ir, labelNum, &nPredecessors);
+    for (size_t predecessorIndex = 0; predecessorIndex < nPredecessors; predecessorIndex++)
     {
-        struct BasicBlock *predecessorBlock = iterator_get(predecessorRunner);
         // iterate all live vars out facts from the predecessor
-        Iterator *liveVarRunner = NULL;
-        for (liveVarRunner = set_begin(array_at(reachingDefs->facts.out, predecessorBlock->labelNum)); iterator_gettable(liveVarRunner); iterator_next(liveVarRunner))
+        struct BitVector *predecessorOuts = &reachingDefs->facts.out[predecessors[predecessorIndex]];
+        for (size_t factNumber = bit_vector_next(predecessorOuts, 0); factNumber < predecessorOuts->nBits; factNumber = bit_vector_next(predecessorOuts, factNumber + 1))
         {
-            struct TACOperand *liveOut = iterator_get(liveVarRunner);
+            struct TACOperand *liveOut = idfa_fact(reachingDefs, factNumber);
 
             Set *ssasLiveOut = hash_table_find(phiVars, liveOut);
             if (ssasLiveOut == NULL)
@@ -183,9 +184,7 @@ void insert_phi_functions_for_block(struct BasicBlock *block, void *data)
 
             set_try_insert(ssasLiveOut, liveOut);
         }
-        iterator_free(liveVarRunner);
     }
-    iterator_free(predecessorRunner);
 
     // TODO: implement hash table stuff
     // iterate all entries in the hash table we created in the loop above
@@ -232,29 +231,28 @@ void insert_phi_functions(struct Idfa *reachingDefs, List *ssaNumbers)
 }
 
 // rename all operands which are written to in the block to have unique SSA numbers
-void rename_written_tac_operands_for_block(struct BasicBlock *block, void *data)
+void rename_written_tac_operands_for_block(struct FunctionIr *ir, size_t labelNum, void *data)
 {
     // set of all operands which are ever written in the IdfaContext
     List *ssaOperands = data;
 
     // iterate all TAC in the block
-    Iterator *tacRunner = NULL;
-    for (tacRunner = list_begin(block->TACList); iterator_gettable(tacRunner); iterator_next(tacRunner))
+    struct IrBlock *block = &ir->blocks[labelNum];
+    for (size_t lineIndex = block->firstLine; lineIndex < block->firstLine + block->nLines; lineIndex++)
     {
-        struct TACLine *thisTac = iterator_get(tacRunner);
+        struct TACLine *thisTac = ir->lines[lineIndex];
 
         struct OperandUsages renameUsages = get_operand_usages(thisTac);
 
-        while (renameUsages.writes->size > 0)
+        for (size_t writeIndex = 0; writeIndex < renameUsages.nWrites; writeIndex++)
         {
-            struct TACOperand *thisOperand = deque_pop_front(renameUsages.writes);
+            struct TACOperand *thisOperand = renameUsages.writes[writeIndex];
 
             // assign a unique SSA number to the operand
             struct TACOperand *ssaOperand = ssa_operand_lookup_or_insert(ssaOperands, thisOperand);
             thisOperand->ssaNumber = ssaOperand->ssaNumber++;
         }
     }
-    iterator_free(tacRunner);
 }
 
 // go over all TAC operands which are assigned to and give them unique SSA numbers
@@ -271,10 +269,10 @@ Set *find_highest_ssa_live_ins(struct Idfa *liveVars, size_t blockIndex)
 {
     Set *highestSsaLiveIns = set_new(NULL, tac_operand_compare_ignore_ssa_number);
 
-    Iterator *liveInRunner = NULL;
-    for (liveInRunner = set_begin(array_at(liveVars->facts.in, blockIndex)); iterator_gettable(liveInRunner); iterator_next(liveInRunner))
+    struct BitVector *liveIns = &liveVars->facts.in[blockIndex];
+    for (size_t factNumber = bit_vector_next(liveIns, 0); factNumber < liveIns->nBits; factNumber = bit_vector_next(liveIns, factNumber + 1))
     {
-        struct TACOperand *thisLiveIn = iterator_get(liveInRunner);
+        struct TACOperand *thisLiveIn = idfa_fact(liveVars, factNumber);
         struct TACOperand *highestLiveIn = set_find(highestSsaLiveIns, thisLiveIn);
         if (highestLiveIn == NULL)
         {
@@ -286,7 +284,6 @@ Set *find_highest_ssa_live_ins(struct Idfa *liveVars, size_t blockIndex)
             set_insert(highestSsaLiveIns, thisLiveIn);
         }
     }
-    iterator_free(liveInRunner);
 
     return highestSsaLiveIns;
 }
@@ -296,14 +293,14 @@ Set *find_unused_ssa_reaching_defs(struct Idfa *reachingDefs, size_t blockIndex,
 {
     Set *matchingOperands = set_new(NULL, tac_operand_compare);
 
-    Iterator *reachingDefRunner = NULL;
-    for (reachingDefRunner = set_begin(array_at(reachingDefs->facts.in, blockIndex)); iterator_gettable(reachingDefRunner); iterator_next(reachingDefRunner))
+    struct BitVector *reachingIns = &reachingDefs->facts.in[blockIndex];
+    for (size_t factNumber = bit_vector_next(reachingIns, 0); factNumber < reachingIns->nBits; factNumber = bit_vector_next(reachingIns, factNumber + 1))
     {
-        struct TACOperand *reachingDef = iterator_get(reachingDefRunner);
+        struct TACOperand *reachingDef = idfa_fact(reachingDefs, factNumber);
         if (tac_operand_compare_ignore_ssa_number(operand, reachingDef) == 0)
         {
             // only include operands which are not killed in the block
-            if (set_find(array_at(reachingDefs->facts.kill, blockIndex), reachingDef) == NULL)
+            if (!bit_vector_test(&reachingDefs->facts.kill[blockIndex], factNumber))
             {
                 set_insert(matchingOperands, reachingDef);
             }
@@ -329,26 +326,26 @@ struct TACOperand *lookup_most_recent_ssa_assignment(Set *highestSsaLiveIns, Set
     return mostRecentAssignment;
 }
 
-void rename_read_tac_operands_in_block(struct BasicBlock *block, void *data)
+void rename_read_tac_operands_in_block(struct FunctionIr *ir, size_t labelNum, void *data)
 {
     struct Idfa *liveVars = data;
 
     // the highest SSA numbers that live in to this basic block
-    Set *highestSsaLiveIns = find_highest_ssa_live_ins(liveVars, block->labelNum);
+    Set *highestSsaLiveIns = find_highest_ssa_live_ins(liveVars, labelNum);
     // any SSA operands which are assigned to within the block
     Set *ssaLivesFromThisBlock = set_new(NULL, tac_operand_compare_ignore_ssa_number);
 
     // iterate all TAC in the block
-    Iterator *tacRunner = NULL;
-    for (tacRunner = list_begin(block->TACList); iterator_gettable(tacRunner); iterator_next(tacRunner))
+    struct IrBlock *block = &ir->blocks[labelNum];
+    for (size_t lineIndex = block->firstLine; lineIndex < block->firstLine + block->nLines; lineIndex++)
     {
-        struct TACLine *thisTac = iterator_get(tacRunner);
+        struct TACLine *thisTac = ir->lines[lineIndex];
 
         struct OperandUsages renameUsages = get_operand_usages(thisTac);
 
-        while (renameUsages.reads->size > 0)
+        for (size_t readIndex = 0; readIndex < operand_usages_n_reads(&renameUsages); readIndex++)
         {
-            struct TACOperand *readOperand = deque_pop_front(renameUsages.reads);
+            struct TACOperand *readOperand = operand_usages_read(&renameUsages, readIndex);
             struct TACOperand *mostRecentAssignment = lookup_most_recent_ssa_assignment(highestSsaLiveIns, ssaLivesFromThisBlock, readOperand);
             if (mostRecentAssignment != NULL)
             {
@@ -356,9 +353,9 @@ void rename_read_tac_operands_in_block(struct BasicBlock *block, void *data)
             }
         }
 
-        while (renameUsages.writes->size > 0)
+        for (size_t writeIndex = 0; writeIndex < renameUsages.nWrites; writeIndex++)
         {
-            struct TACOperand *writtenOperand = deque_pop_front(renameUsages.writes);
+            struct TACOperand *writtenOperand = renameUsages.writes[writeIndex];
             if ((writtenOperand->permutation == VP_LITERAL_STR) || (writtenOperand->permutation == VP_LITERAL_VAL))
             {
                 InternalError("Written operand with permutation VP_LITERAL_STR or VP_LITERAL_VAL seen in renameReadTacOperands!");
@@ -370,7 +367,6 @@ void rename_read_tac_operands_in_block(struct BasicBlock *block, void *data)
             set_insert(ssaLivesFromThisBlock, writtenOperand);
         }
     }
-    iterator_free(tacRunner);
 
     set_free(highestSsaLiveIns);
     set_free(ssaLivesFromThisBlock);
@@ -422,7 +418,9 @@ void do_fun_checks(struct IdfaContext *context)
 void generate_ssa_for_function(struct FunctionEntry *function)
 {
     log(LOG_DEBUG, "Generate ssa for function %s", function->name);
-    struct IdfaContext *context = idfa_context_create(function->name, function->BasicBlockList);
+    struct Arena *previousTacArena = tac_set_arena(function->tacArena);
+    struct FunctionIr *ir = function_ir_build(function);
+    struct IdfaContext *context = idfa_context_create(function->name, ir);
 
     List *ssaNumbers = rename_written_tac_operands(context);
 
@@ -438,6 +436,8 @@ void generate_ssa_for_function(struct FunctionEntry *function)
     // doFunChecks(context);
 
     idfa_context_free(context);
+    function_ir_free(ir);
+    tac_set_arena(previousTacArena);
 }
 
 void generate_ssa(struct SymbolTable *theTable)
@@ -445,7 +445,7 @@ void generate_ssa(struct SymbolTable *theTable)
     log(LOG_INFO, "Generate ssa for %s", theTable->name);
 
     Iterator *entryIterator = NULL;
-    for (entryIterator = set_begin(theTable->globalScope->entries); iterator_gettable(entryIterator); iterator_next(entryIterator))
+    for (entryIterator = deque_front(theTable->globalScope->entries); iterator_gettable(entryIterator); iterator_next(entryIterator))
     {
         struct ScopeMember *thisMember = iterator_get(entryIterator);
         switch (thisMember->type)
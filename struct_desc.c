@@ -7,6 +7,8 @@
 #include "symtab_type.h"
 #include "util.h"
 
+extern _Thread_local struct StringInterner *stringInterner;
+
 struct StructDesc *struct_desc_new(struct Scope *parentScope,
                                    char *name)
 {
@@ -40,8 +42,7 @@ struct StructDesc *struct_desc_clone(struct StructDesc *toClone, char *name)
         // TODO: rework accessibility to just be sets for public/private members instead of the hokey "structs have scopes" thing
         struct ScopeMember *accessed = scope_lookup(toClone->members, field->variable->name, E_VARIABLE);
 
-        struct Type dupVarType = type_duplicate_non_pointer(&field->variable->type);
-        struct VariableEntry *clonedVariable = variable_entry_new(field->variable->name, &dupVarType, field->variable->isGlobal, false, accessed->accessibility);
+        struct VariableEntry *clonedVariable = variable_entry_new(field->variable->name, field->variable->type, field->variable->isGlobal, false, accessed->accessibility);
         scope_insert(cloned->members, clonedVariable->name, clonedVariable, E_VARIABLE, accessed->accessibility);
         struct_add_field(cloned, clonedVariable);
     }
@@ -64,12 +65,13 @@ void struct_add_field(struct StructDesc *memberOf,
 
 void struct_assign_offsets_to_fields(struct StructDesc *theStruct)
 {
+    theStruct->totalSize = 0;
     Iterator *fieldIter = NULL;
     for (fieldIter = deque_front(theStruct->fieldLocations); iterator_gettable(fieldIter); iterator_next(fieldIter))
     {
         struct StructField *handledField = iterator_get(fieldIter);
         // add the padding to the total size of the struct
-        theStruct->totalSize += scope_compute_padding_for_alignment(theStruct->members, &handledField->variable->type, theStruct->totalSize);
+        theStruct->totalSize += scope_compute_padding_for_alignment(theStruct->members, handledField->variable->type, theStruct->totalSize);
 
         // place the new member at the (now aligned) current max size of the struct
         if (theStruct->totalSize > I64_MAX)
@@ -80,7 +82,7 @@ void struct_assign_offsets_to_fields(struct StructDesc *theStruct)
         handledField->offset = (ssize_t)theStruct->totalSize;
 
         // add the size of the member we just added to the total size of the struct
-        theStruct->totalSize += type_get_size(&handledField->variable->type, theStruct->members);
+        theStruct->totalSize += type_get_size(handledField->variable->type, theStruct->members);
         log(LOG_DEBUG, "Assign offset %zu to member variable %s of struct %s - total struct size is now %zu", handledField->offset, handledField->variable->name, theStruct->name, theStruct->totalSize);
     }
     iterator_free(fieldIter);
@@ -234,11 +236,13 @@ struct StructField *struct_lookup_field_by_name(struct StructDesc *theStruct,
                                                 struct Scope *scope)
 {
     struct StructField *returnedField = NULL;
+    // variable names are interned, so they can be compared by pointer (and a name which was never interned can't match any field)
+    char *internedName = string_interner_find(stringInterner, name, NULL);
     Iterator *fieldIterator = NULL;
-    for (fieldIterator = deque_front(theStruct->fieldLocations); iterator_gettable(fieldIterator); iterator_next(fieldIterator))
+    for (fieldIterator = deque_front(theStruct->fieldLocations); (internedName != NULL) && iterator_gettable(fieldIterator); iterator_next(fieldIterator))
     {
         struct StructField *field = iterator_get(fieldIterator);
-        if (!strcmp(field->variable->name, name))
+        if (field->variable->name == internedName)
         {
             returnedField = field;
             break;
@@ -279,7 +283,7 @@ void struct_desc_resolve_generics(struct StructDesc *theStruct, HashTable *param
     for (fieldIter = deque_front(theStruct->fieldLocations); iterator_gettable(fieldIter); iterator_next(fieldIter))
     {
         struct StructField *field = iterator_get(fieldIter);
-        type_try_resolve_generic(&field->variable->type, paramsMap, name, params);
+        variable_entry_try_resolve_generic(field->variable, paramsMap, name, params);
     }
     iterator_free(fieldIter);
 
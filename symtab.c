@@ -4,12 +4,12 @@
 #include "codegen_generic.h"
 #include "symtab.h"
 #include "symtab_scope.h"
-#include <mbcl/stack.h>
 
 #include "drop.h"
+#include "dump.h"
 #include "log.h"
 
-extern struct Dictionary *parseDict;
+extern _Thread_local struct StringInterner *stringInterner;
 
 void scope_print_member(struct ScopeMember *toPrint, bool printTac, size_t depth, FILE *outFile);
 
@@ -30,6 +30,7 @@ struct SymbolTable *symbol_table_new(char *name)
     struct SymbolTable *wip = malloc(sizeof(struct SymbolTable));
     wip->name = name;
     wip->globalScope = scope_new(NULL, "Global", NULL);
+    wip->tacArena = tac_arena_new();
     struct BasicBlock *globalBlock = basic_block_new(0);
 
     // manually insert a basic block for global code so we can give it the custom name of "globalblock"
@@ -63,13 +64,13 @@ void scope_print_cfgs(struct Scope *scope, char *outDir)
     struct stat st = {0};
     if (stat(outDir, &st) == -1)
     {
-        if (mkdir(outDir, 0777) == -1)
+        if ((mkdir(outDir, 0777) == -1) && (errno != EEXIST)) // another TU may have created it in the meantime
         {
             InternalError("Couldn't create cfg directory %s: %s", outDir, strerror(errno));
         }
     }
     Iterator *memberIterator = NULL;
-    for (memberIterator = set_begin(scope->entries); iterator_gettable(memberIterator); iterator_next(memberIterator))
+    for (memberIterator = deque_front(scope->entries); iterator_gettable(memberIterator); iterator_next(memberIterator))
     {
         struct ScopeMember *thisMember = iterator_get(memberIterator);
 
@@ -78,6 +79,10 @@ void scope_print_cfgs(struct Scope *scope, char *outDir)
         case E_FUNCTION:
         {
             struct FunctionEntry *thisFunction = thisMember->entry;
+            if (!dump_function_enabled(DUMP_CFG, thisFunction->name))
+            {
+                break;
+            }
             char *cfgFileName = malloc(strlen(outDir) + strlen(thisFunction->name) + 7);
             sprintf(cfgFileName, "%s/%s.dot", outDir, thisFunction->name);
             FILE *cfgFile = fopen(cfgFileName, "w");
@@ -101,16 +106,21 @@ void scope_print_cfgs(struct Scope *scope, char *outDir)
         case E_TYPE:
         {
             struct TypeEntry *thisType = thisMember->entry;
-            char *typeCfgDirName = malloc(strlen(outDir) + strlen(thisType->baseName) + 3);
-
-            sprintf(typeCfgDirName, "%s/%s", outDir, thisType->baseName);
             Iterator *implementedIter = NULL;
             for (implementedIter = hash_table_begin(thisType->implementedByName); iterator_gettable(implementedIter); iterator_next(implementedIter))
             {
                 HashTableEntry *thisEntry = iterator_get(implementedIter);
                 struct FunctionEntry *implementedFunction = thisEntry->value;
-                char *cfgFileName = malloc(strlen(typeCfgDirName) + strlen(implementedFunction->name) + 7);
-                sprintf(cfgFileName, "%s_%s.dot", typeCfgDirName, implementedFunction->name);
+                char *functionName = malloc(strlen(thisType->baseName) + strlen(implementedFunction->name) + 2);
+                sprintf(functionName, "%s_%s", thisType->baseName, implementedFunction->name);
+                if (!dump_function_enabled(DUMP_CFG, functionName))
+                {
+                    free(functionName);
+                    continue;
+                }
+                char *cfgFileName = malloc(strlen(outDir) + strlen(functionName) + 7);
+                sprintf(cfgFileName, "%s/%s.dot", outDir, functionName);
+                free(functionName);
                 FILE *cfgFile = fopen(cfgFileName, "w");
                 if (cfgFile == NULL)
                 {
@@ -121,7 +131,6 @@ void scope_print_cfgs(struct Scope *scope, char *outDir)
                 free(cfgFileName);
             }
             iterator_free(implementedIter);
-            free(typeCfgDirName);
         }
         break;
 
@@ -137,177 +146,161 @@ void symbol_table_print_cfgs(struct SymbolTable *table, char *outDir)
     scope_print_cfgs(table->globalScope, outDir);
 }
 
-char *symbol_table_mangle_name(struct Scope *scope, struct Dictionary *dict, char *toMangle)
-{
-    char *scopeName = scope->name;
+/*
+ * Scope collapse
+ * Every scope nested within a function is flattened into the function's main scope in a single walk of the scope tree.
+ * Variables from nested scopes are renamed after the path of scope names leading to them ("00.01.x") so that they stay
+ * unique, and global variables (such as string literals) declared anywhere are hoisted to the global scope.
+ */
 
-    char *mangledName = malloc(strlen(toMangle) + strlen(scopeName) + 2);
-    sprintf(mangledName, "%s.%s", scopeName, toMangle);
-    char *newName = dictionary_lookup_or_insert(dict, mangledName);
+// name of a member of the scope at scopePath once it is flattened into the enclosing function's main scope
+char *symbol_table_mangle_name(char *scopePath, struct StringInterner *interner, char *toMangle, u32 *mangledId)
+{
+    char *mangledName = malloc(strlen(scopePath) + strlen(toMangle) + 2);
+    sprintf(mangledName, "%s.%s", scopePath, toMangle);
+    char *newName = string_interner_intern(interner, mangledName, mangledId);
     free(mangledName);
     return newName;
 }
 
-void scope_lift_from_sub_scopes(struct Scope *scope, struct Dictionary *dict, size_t depth)
+// move everything within subScope (which has already been removed from its parent) into flattenInto, then free subScope
+void symbol_table_flatten_sub_scope(struct Scope *flattenInto,
+                                    struct Scope *globalScope,
+                                    struct Scope *subScope,
+                                    char *parentPath,
+                                    struct StringInterner *interner)
 {
-    log(LOG_DEBUG, "%*s%zu lifting subscopes/functions/structs from within scope %s", depth * 4, "", depth, scope->name);
+    char *scopePath = subScope->name;
+    if (parentPath != NULL)
+    {
+        scopePath = symbol_table_mangle_name(parentPath, interner, subScope->name, NULL);
+    }
 
-    Set *moveToThisScope = set_new(NULL, scope->entries->compareData);
-    Set *deletedSubScopes = set_new(NULL, scope->entries->compareData);
-    Iterator *memberIterator = NULL;
-    for (memberIterator = set_begin(scope->entries); iterator_gettable(memberIterator); iterator_next(memberIterator))
+    while (subScope->entries->size > 0)
     {
-        struct ScopeMember *thisMember = iterator_get(memberIterator);
-        switch (thisMember->type)
-        {
-        case E_SCOPE: // recurse to subscopes
+        struct ScopeMember *member = deque_pop_front(subScope->entries);
+        switch (member->type)
         {
-            moveToThisScope = set_union_destructive(moveToThisScope, symbol_table_collapse_scopes_rec(thisMember->entry, dict, depth + 1));
-            set_insert(deletedSubScopes, thisMember);
-        }
-        break;
+        case E_SCOPE:
+            symbol_table_flatten_sub_scope(flattenInto, globalScope, member->entry, scopePath, interner);
+            free(member);
+            break;
 
-        case E_FUNCTION: // recurse to functions
+        case E_VARIABLE:
+        case E_ARGUMENT:
         {
-            if (depth > 0)
+            struct VariableEntry *variable = member->entry;
+            if (variable->isGlobal)
             {
-                InternalError("Saw function at depth > 0 when collapsing scopes!");
+                scope_insert_member(globalScope, member);
+            }
+            else
+            {
+                member->name = symbol_table_mangle_name(scopePath, interner, member->name, &member->nameId);
+                variable->name = member->name;
+                variable->nameId = member->nameId;
+                scope_insert_member(flattenInto, member);
             }
-            struct FunctionEntry *thisFunction = thisMember->entry;
-            moveToThisScope = set_union_destructive(moveToThisScope, symbol_table_collapse_scopes_rec(thisFunction->mainScope, dict, 0));
-        }
-        break;
-
-        case E_TYPE:
-        {
-            struct TypeEntry *recursedType = thisMember->entry;
-            moveToThisScope = set_union_destructive(moveToThisScope, symbol_table_collapse_scopes_rec(recursedType->implemented, dict, 0));
         }
         break;
 
-        // skip everything else
-        case E_VARIABLE:
-        case E_ARGUMENT:
         case E_BASICBLOCK:
-        case E_TRAIT:
+            scope_insert_member(flattenInto, member);
             break;
-        }
-    }
-    iterator_free(memberIterator);
 
-    Iterator *moveHereIterator = NULL;
-    for (moveHereIterator = set_begin(moveToThisScope); iterator_gettable(moveHereIterator); iterator_next(moveHereIterator))
-    {
-        struct ScopeMember *toMoveHere = iterator_get(moveHereIterator);
-        set_insert(scope->entries, toMoveHere);
-    }
-    iterator_free(moveHereIterator);
-    set_free(moveToThisScope);
+        case E_FUNCTION:
+            InternalError("Saw function %s within subscope %s when collapsing scopes!", member->name, scopePath);
+            break;
 
-    Iterator *removeFromHereIterator = NULL;
-    for (removeFromHereIterator = set_begin(deletedSubScopes); iterator_gettable(removeFromHereIterator); iterator_next(removeFromHereIterator))
-    {
-        struct ScopeMember *removedMember = iterator_get(removeFromHereIterator);
-        log(LOG_DEBUG, "%*s%zu Subscope %s is no longer needed - delete it", depth * 4, "", depth, removedMember->name);
-        set_remove(scope->entries, removedMember);
+        // nothing can refer to these once the scope declaring them is gone
+        case E_TYPE:
+        case E_TRAIT:
+            scope_member_free(member);
+            break;
+        }
     }
-    iterator_free(removeFromHereIterator);
-    set_free(deletedSubScopes);
 
-    log(LOG_DEBUG, "%*s%zu DONE lifting subscopes/functions/structs from within scope %s", depth * 4, "", depth, scope->name);
+    scope_free(subScope);
 }
 
-Set *symbol_table_collapse_scopes_rec(struct Scope *scope, struct Dictionary *dict, size_t depth)
+// flatten all subscopes of root into it, recursing to the main scopes of functions and implementations of types within it
+void symbol_table_collapse_root_scope(struct Scope *root, struct Scope *globalScope, struct StringInterner *interner)
 {
-    log(LOG_DEBUG, "%*s%zu Collapsing scopes recursively for scope %s", depth * 4, "", depth, scope->name);
-
-    scope_lift_from_sub_scopes(scope, dict, depth);
+    log(LOG_DEBUG, "Collapsing scopes within %s", root->name);
 
+    Set *removed = set_new(NULL, (MBCL_DATA_COMPARE_FUNCTION)scope_member_compare);
     Iterator *memberIterator = NULL;
-    Stack *moveOutOfThisScope = stack_new(NULL);
-    // perform all recursive operations first
-    for (memberIterator = set_begin(scope->entries); iterator_gettable(memberIterator); iterator_next(memberIterator))
+    for (memberIterator = deque_front(root->entries); iterator_gettable(memberIterator); iterator_next(memberIterator))
     {
         struct ScopeMember *thisMember = iterator_get(memberIterator);
         switch (thisMember->type)
         {
         case E_SCOPE:
-        case E_FUNCTION:
+            set_insert(removed, thisMember);
             break;
 
-        case E_BASICBLOCK:
+        case E_FUNCTION:
         {
-            if ((depth > 0) && (scope->parentScope != NULL))
-            {
-                stack_push(moveOutOfThisScope, thisMember);
-            }
+            struct FunctionEntry *thisFunction = thisMember->entry;
+            symbol_table_collapse_root_scope(thisFunction->mainScope, globalScope, interner);
+        }
+        break;
+
+        case E_TYPE:
+        {
+            struct TypeEntry *thisType = thisMember->entry;
+            symbol_table_collapse_root_scope(thisType->implemented, globalScope, interner);
         }
         break;
 
         case E_VARIABLE:
         case E_ARGUMENT:
         {
-            struct VariableEntry *variableToMove = thisMember->entry;
-
-            if (((depth > 0) || variableToMove->isGlobal) && scope->parentScope != NULL)
+            struct VariableEntry *thisVariable = thisMember->entry;
+            if (thisVariable->isGlobal && (root != globalScope))
             {
-                stack_push(moveOutOfThisScope, thisMember);
+                set_insert(removed, thisMember);
             }
         }
         break;
 
-        case E_TYPE:
+        case E_BASICBLOCK:
         case E_TRAIT:
             break;
         }
     }
-
-    log(LOG_DEBUG, "%*s%zu Moving %zu elements out of scope", depth * 4, "", depth, moveOutOfThisScope->size);
     iterator_free(memberIterator);
-    MBCL_DATA_FREE_FUNCTION oldFree = scope->entries->freeData;
-    scope->entries->freeData = NULL;
 
-    Set *renamedAndMoved = set_new(NULL, scope->entries->compareData);
+    // remove everything leaving root in one go, before flattening appends to it
+    scope_remove_members(root, removed);
 
-    while (moveOutOfThisScope->size > 0)
+    Iterator *removedIterator = NULL;
+    for (removedIterator = set_begin(removed); iterator_gettable(removedIterator); iterator_next(removedIterator))
     {
-        struct ScopeMember *moved = stack_pop(moveOutOfThisScope);
-        log(LOG_DEBUG, "%*s%zu moving %s", depth * 4, "", depth, moved->name);
-        set_remove(scope->entries, moved);
-        // TODO: actually mangle names
-        // mangle all non-global names (want to mangle everything except for string literal names)
-        if ((moved->type == E_VARIABLE) || (moved->type == E_ARGUMENT))
+        struct ScopeMember *removedMember = iterator_get(removedIterator);
+        if (removedMember->type == E_SCOPE)
         {
-            struct VariableEntry *variableToMove = moved->entry;
-            // we will only ever do anything if we are depth >0 or need to kick a global variable up a scope
-            if ((depth > 0) && (!variableToMove->isGlobal))
-            {
-                moved->name = symbol_table_mangle_name(scope, dict, moved->name);
-                variableToMove->name = moved->name;
-            }
+            symbol_table_flatten_sub_scope(root, globalScope, removedMember->entry, NULL, interner);
+            free(removedMember);
+        }
+        else
+        {
+            scope_insert_member(globalScope, removedMember);
         }
-        set_insert(renamedAndMoved, moved);
     }
-    scope->entries->freeData = oldFree;
-    stack_free(moveOutOfThisScope);
-
-    log(LOG_DEBUG, "%*s%zu DONE collapsing scopes recursively for scope %s", depth * 4, "", depth, scope->name);
-    return renamedAndMoved;
+    iterator_free(removedIterator);
+    set_free(removed);
 }
 
-void symbol_table_collapse_scopes(struct SymbolTable *table, struct Dictionary *dict)
+void symbol_table_collapse_scopes(struct SymbolTable *table, struct StringInterner *interner)
 {
-    Set *topLevelMoved = symbol_table_collapse_scopes_rec(table->globalScope, parseDict, 0);
-    if (topLevelMoved->size > 0)
-    {
-        InternalError("Saw %zu elements to be moved up from global scope", topLevelMoved->size);
-    }
-    set_free(topLevelMoved);
+    symbol_table_collapse_root_scope(table->globalScope, table->globalScope, interner);
 }
 
 void symbol_table_free(struct SymbolTable *table)
 {
     scope_free(table->globalScope);
+    arena_free(table->tacArena);
     free(table);
 }
 
@@ -7,7 +7,7 @@ struct BasicBlock *basic_block_new(ssize_t labelNum)
 {
     struct BasicBlock *wip = malloc(sizeof(struct BasicBlock));
     wip->successors = set_new(free, ssizet_compare);
-    wip->TACList = list_new((void (*)(void *))free_tac, NULL);
+    wip->TACList = list_new((void (*)(void *))tac_line_deinit, NULL);
     wip->labelNum = labelNum;
     return wip;
 }
@@ -98,25 +98,20 @@ void basic_block_resolve_capital_self(struct BasicBlock *block, struct TypeEntry
         struct TACLine *line = iterator_get(blockIter);
 
         struct OperandUsages operandUsages = get_operand_usages(line);
-        while (operandUsages.reads->size > 0)
+        for (size_t readIndex = 0; readIndex < operand_usages_n_reads(&operandUsages); readIndex++)
         {
-            struct TACOperand *readOperand = deque_pop_front(operandUsages.reads);
-            type_try_resolve_vt_self(&readOperand->castAsType, typeEntry);
+            tac_operand_resolve_cast_vt_self(operand_usages_read(&operandUsages, readIndex), typeEntry);
         }
 
-        while (operandUsages.writes->size > 0)
+        for (size_t writeIndex = 0; writeIndex < operandUsages.nWrites; writeIndex++)
         {
-            struct TACOperand *writtenOperand = deque_pop_front(operandUsages.writes);
-            type_try_resolve_vt_self(&writtenOperand->castAsType, typeEntry);
+            tac_operand_resolve_cast_vt_self(operandUsages.writes[writeIndex], typeEntry);
         }
 
         if (line->operation == TT_SIZEOF)
         {
             type_try_resolve_vt_self(&line->operands.sizeof_.type, typeEntry);
         }
-
-        deque_free(operandUsages.reads);
-        deque_free(operandUsages.writes);
     }
     iterator_free(blockIter);
 }
@@ -128,25 +123,20 @@ void basic_block_resolve_generics(struct BasicBlock *block, HashTable *paramsMap
     {
         struct TACLine *resolvedLine = iterator_get(tacRunner);
         struct OperandUsages operandUsages = get_operand_usages(resolvedLine);
-        while (operandUsages.reads->size > 0)
+        for (size_t readIndex = 0; readIndex < operand_usages_n_reads(&operandUsages); readIndex++)
         {
-            struct TACOperand *readOperand = deque_pop_front(operandUsages.reads);
-            type_try_resolve_generic(&readOperand->castAsType, paramsMap, resolvedStructName, resolvedParams);
+            tac_operand_resolve_cast_generics(operand_usages_read(&operandUsages, readIndex), paramsMap, resolvedStructName, resolvedParams);
         }
 
-        while (operandUsages.writes->size > 0)
+        for (size_t writeIndex = 0; writeIndex < operandUsages.nWrites; writeIndex++)
         {
-            struct TACOperand *writtenOperand = deque_pop_front(operandUsages.writes);
-            type_try_resolve_generic(&writtenOperand->castAsType, paramsMap, resolvedStructName, resolvedParams);
+            tac_operand_resolve_cast_generics(operandUsages.writes[writeIndex], paramsMap, resolvedStructName, resolvedParams);
         }
 
         if (resolvedLine->operation == TT_SIZEOF)
         {
             type_try_resolve_generic(&resolvedLine->operands.sizeof_.type, paramsMap, resolvedStructName, resolvedParams);
         }
-
-        deque_free(operandUsages.reads);
-        deque_free(operandUsages.writes);
     }
     iterator_free(tacRunner);
 }
@@ -7,15 +7,21 @@
 #include "symtab_basicblock.h"
 #include "symtab_scope.h"
 #include "symtab_variable.h"
+#include "tac_operand.h"
+
+extern _Thread_local struct StringInterner *stringInterner;
+extern _Thread_local struct TempList *temps;
 
 struct FunctionEntry *function_entry_new(struct Scope *parentScope, struct Ast *nameTree, struct TypeEntry *implementedFor)
 {
     struct FunctionEntry *newFunction = malloc(sizeof(struct FunctionEntry));
     memset(newFunction, 0, sizeof(struct FunctionEntry));
     newFunction->arguments = deque_new(NULL);
+    newFunction->temps = deque_new((MBCL_DATA_FREE_FUNCTION)temp_variable_free);
     newFunction->mainScope = scope_new(parentScope, nameTree->value, newFunction);
     newFunction->BasicBlockList = list_new(NULL, NULL);
-    newFunction->correspondingTree = *nameTree;
+    newFunction->tacArena = tac_arena_new();
+    newFunction->location = source_location_of(nameTree);
     newFunction->mainScope->parentFunction = newFunction;
     type_init(&newFunction->returnType);
     newFunction->name = nameTree->value;
@@ -33,19 +39,93 @@ struct FunctionEntry *function_entry_new(struct Scope *parentScope, struct Ast *
 void function_entry_free(struct FunctionEntry *function)
 {
     deque_free(function->arguments);
+    deque_free(function->temps);
     list_free(function->BasicBlockList);
     scope_free(function->mainScope);
     type_deinit(&function->returnType);
+    if (function->tacArena != NULL)
+    {
+        arena_free(function->tacArena);
+    }
 
-    if (function->regalloc.allLifetimes != NULL)
+    if (function->ir != NULL)
     {
-        set_free(function->regalloc.allLifetimes);
-        set_free(function->regalloc.touchedRegisters);
+        function_ir_free(function->ir);
     }
 
+    regalloc_metadata_deinit(&function->regalloc);
     free(function);
 }
 
+struct TempVariable *function_entry_new_temp(struct FunctionEntry *function, struct Type *type)
+{
+    struct TempVariable *temp = malloc(sizeof(struct TempVariable));
+    temp->number = function->temps->size;
+    temp->name = string_interner_intern(stringInterner, temp_list_get(temps, temp->number), NULL);
+    temp->type = type_duplicate_non_pointer(type);
+    temp->mustSpill = false;
+    deque_push_back(function->temps, temp);
+    return temp;
+}
+
+void function_entry_clone_temps(struct FunctionEntry *cloned, struct FunctionEntry *toClone)
+{
+    if (cloned->temps->size > 0)
+    {
+        InternalError("Attempt to clone temps of %s into a function which already has temps", toClone->name);
+    }
+
+    for (size_t tempIndex = 0; tempIndex < toClone->temps->size; tempIndex++)
+    {
+        struct TempVariable *tempToClone = deque_at(toClone->temps, tempIndex);
+        struct TempVariable *clonedTemp = function_entry_new_temp(cloned, &tempToClone->type);
+        clonedTemp->mustSpill = tempToClone->mustSpill;
+    }
+}
+
+void function_entry_resolve_generics(struct FunctionEntry *function, HashTable *paramsMap, char *resolvedStructName, List *resolvedParams)
+{
+    type_try_resolve_generic(&function->returnType, paramsMap, resolvedStructName, resolvedParams);
+    for (size_t tempIndex = 0; tempIndex < function->temps->size; tempIndex++)
+    {
+        struct TempVariable *temp = deque_at(function->temps, tempIndex);
+        type_try_resolve_generic(&temp->type, paramsMap, resolvedStructName, resolvedParams);
+    }
+    scope_resolve_generics(function->mainScope, paramsMap, resolvedStructName, resolvedParams);
+}
+
+void function_entry_resolve_capital_self(struct FunctionEntry *function, struct TypeEntry *theType)
+{
+    type_try_resolve_vt_self(&function->returnType, theType);
+    for (size_t tempIndex = 0; tempIndex < function->temps->size; tempIndex++)
+    {
+        struct TempVariable *temp = deque_at(function->temps, tempIndex);
+        type_try_resolve_vt_self(&temp->type, theType);
+    }
+    scope_resolve_capital_self(function->mainScope, theType);
+}
+
+void function_entry_release_tac(struct FunctionEntry *function)
+{
+    if (function->ir != NULL)
+    {
+        function_ir_free(function->ir);
+        function->ir = NULL;
+    }
+
+    Iterator *blockRunner = NULL;
+    for (blockRunner = list_begin(function->BasicBlockList); iterator_gettable(blockRunner); iterator_next(blockRunner))
+    {
+        struct BasicBlock *block = iterator_get(blockRunner);
+        list_free(block->TACList);
+        block->TACList = list_new((void (*)(void *))tac_line_deinit, NULL);
+    }
+    iterator_free(blockRunner);
+
+    arena_free(function->tacArena);
+    function->tacArena = NULL;
+}
+
 void print_graphviz_string(char *str, FILE *outFile)
 {
     while (*str != '\0')
@@ -171,7 +251,7 @@ char *sprint_function_signature(struct FunctionEntry *function)
         }
 
         struct VariableEntry *argument = deque_at(function->arguments, argIndex);
-        char *argType = type_get_name(&argument->type);
+        char *argType = type_get_name(argument->type);
 
         funcName = realloc(funcName, strlen(funcName) + strlen(argType) + strlen(argument->name) + 3);
         strcat(funcName, argType);
@@ -215,7 +295,7 @@ ssize_t function_entry_compare(void *dataA, void *dataB)
             diff = strcmp(argA->name, argB->name);
             if (!diff)
             {
-                diff = type_compare_allow_self(&argA->type, funcA, &argB->type, funcB);
+                diff = type_compare_allow_self(argA->type, funcA, argB->type, funcB);
             }
 
             if (diff)
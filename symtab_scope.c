@@ -10,14 +10,14 @@
 #include "symtab_variable.h"
 #include "util.h"
 
-extern struct Dictionary *parseDict;
+extern _Thread_local struct StringInterner *stringInterner;
 
 ssize_t scope_member_compare(struct ScopeMember *memberA, struct ScopeMember *memberB)
 {
     ssize_t cmpVal = 0;
     if (memberA->type == memberB->type)
     {
-        cmpVal = strcmp(memberA->name, memberB->name);
+        cmpVal = (ssize_t)memberA->nameId - (ssize_t)memberB->nameId;
     }
     else
     {
@@ -58,6 +58,186 @@ void scope_member_free(struct ScopeMember *member)
     free(member);
 }
 
+/*
+ * Scope member indices
+ * Open addressing with linear probing, keyed by (name id, member type)
+ */
+
+const size_t SCOPE_INDEX_INITIAL_SLOTS = 8;
+// a scope's lookup cache is emptied rather than grown past this many entries
+const size_t SCOPE_LOOKUP_CACHE_MAX_ENTRIES = 256;
+
+void scope_index_init(struct ScopeIndex *index)
+{
+    index->slots = NULL;
+    index->nSlots = 0;
+    index->nUsed = 0;
+}
+
+void scope_index_deinit(struct ScopeIndex *index)
+{
+    free(index->slots);
+}
+
+// empty the index, keeping its slots allocated
+void scope_index_clear(struct ScopeIndex *index)
+{
+    if (index->nSlots > 0)
+    {
+        memset(index->slots, 0, index->nSlots * sizeof(struct ScopeIndexSlot));
+    }
+    index->nUsed = 0;
+}
+
+size_t scope_index_hash(u32 nameId, enum SCOPE_MEMBER_TYPE type)
+{
+    const u64 SCOPE_INDEX_HASH_MULTIPLIER = 0x9e3779b97f4a7c15;
+    return (((u64)nameId << 3) ^ type) * SCOPE_INDEX_HASH_MULTIPLIER >> 32;
+}
+
+// find the slot for a key, or NULL if the key isn't present
+struct ScopeIndexSlot *scope_index_find(struct ScopeIndex *index, u32 nameId, enum SCOPE_MEMBER_TYPE type)
+{
+    if (index->nSlots == 0)
+    {
+        return NULL;
+    }
+
+    size_t slotIndex = scope_index_hash(nameId, type) & (index->nSlots - 1);
+    while (index->slots[slotIndex].typePlusOne != 0)
+    {
+        struct ScopeIndexSlot *slot = &index->slots[slotIndex];
+        if ((slot->nameId == nameId) && (slot->typePlusOne == (type + 1)))
+        {
+            return slot;
+        }
+        slotIndex = (slotIndex + 1) & (index->nSlots - 1);
+    }
+    return NULL;
+}
+
+void scope_index_grow(struct ScopeIndex *index);
+
+// find the slot for a key, claiming an empty one if the key isn't present
+struct ScopeIndexSlot *scope_index_find_or_claim(struct ScopeIndex *index, u32 nameId, enum SCOPE_MEMBER_TYPE type)
+{
+    // keep the index at most half full so probe sequences stay short
+    if ((index->nUsed + 1) * 2 > index->nSlots)
+    {
+        scope_index_grow(index);
+    }
+
+    size_t slotIndex = scope_index_hash(nameId, type) & (index->nSlots - 1);
+    while (index->slots[slotIndex].typePlusOne != 0)
+    {
+        struct ScopeIndexSlot *slot = &index->slots[slotIndex];
+        if ((slot->nameId == nameId) && (slot->typePlusOne == (type + 1)))
+        {
+            return slot;
+        }
+        slotIndex = (slotIndex + 1) & (index->nSlots - 1);
+    }
+
+    struct ScopeIndexSlot *claimed = &index->slots[slotIndex];
+    claimed->nameId = nameId;
+    claimed->typePlusOne = type + 1;
+    claimed->member = NULL;
+    claimed->generation = 0;
+    index->nUsed++;
+    return claimed;
+}
+
+void scope_index_grow(struct ScopeIndex *index)
+{
+    struct ScopeIndexSlot *oldSlots = index->slots;
+    size_t oldNSlots = index->nSlots;
+
+    index->nSlots = (oldNSlots == 0) ? SCOPE_INDEX_INITIAL_SLOTS : (oldNSlots * 2);
+    index->slots = calloc(index->nSlots, sizeof(struct ScopeIndexSlot));
+    index->nUsed = 0;
+    for (size_t slotIndex = 0; slotIndex < oldNSlots; slotIndex++)
+    {
+        struct ScopeIndexSlot *oldSlot = &oldSlots[slotIndex];
+        if (oldSlot->typePlusOne != 0)
+        {
+            *scope_index_find_or_claim(index, oldSlot->nameId, oldSlot->typePlusOne - 1) = *oldSlot;
+        }
+    }
+    free(oldSlots);
+}
+
+void scope_index_remove(struct ScopeIndex *index, u32 nameId, enum SCOPE_MEMBER_TYPE type)
+{
+    struct ScopeIndexSlot *removed = scope_index_find(index, nameId, type);
+    if (removed == NULL)
+    {
+        return;
+    }
+
+    // backward-shift deletion: pull later members of the probe sequence into the hole so that lookups never stop early
+    size_t holeIndex = removed - index->slots;
+    size_t slotIndex = holeIndex;
+    while (true)
+    {
+        slotIndex = (slotIndex + 1) & (index->nSlots - 1);
+        struct ScopeIndexSlot *slot = &index->slots[slotIndex];
+        if (slot->typePlusOne == 0)
+        {
+            break;
+        }
+
+        size_t homeIndex = scope_index_hash(slot->nameId, slot->typePlusOne - 1) & (index->nSlots - 1);
+        // the slot can fill the hole only if its home isn't cyclically within (hole, slot]
+        bool homeBetween = (holeIndex <= slotIndex) ? ((holeIndex < homeIndex) && (homeIndex <= slotIndex))
+                                                    : ((holeIndex < homeIndex) || (homeIndex <= slotIndex));
+        if (!homeBetween)
+        {
+            index->slots[holeIndex] = *slot;
+            holeIndex = slotIndex;
+        }
+    }
+    memset(&index->slots[holeIndex], 0, sizeof(struct ScopeIndexSlot));
+    index->nUsed--;
+}
+
+/*
+ * Lookup caching
+ * Every insertion or removal of a name bumps a generation counter and records it against the name's id. A cached lookup
+ * is valid as long as nothing with its name has been inserted or removed anywhere since the lookup was done.
+ */
+
+_Thread_local u64 scopeGeneration = 0;
+_Thread_local u64 *nameGenerations = NULL; // indexed by interned name id
+_Thread_local size_t nameGenerationsCapacity = 0;
+
+void scope_name_changed(u32 nameId)
+{
+    if (nameId >= nameGenerationsCapacity)
+    {
+        size_t newCapacity = (nameGenerationsCapacity == 0) ? 1024 : nameGenerationsCapacity;
+        while (newCapacity <= nameId)
+        {
+            newCapacity *= 2;
+        }
+        nameGenerations = realloc(nameGenerations, newCapacity * sizeof(u64));
+        memset(nameGenerations + nameGenerationsCapacity, 0, (newCapacity - nameGenerationsCapacity) * sizeof(u64));
+        nameGenerationsCapacity = newCapacity;
+    }
+    nameGenerations[nameId] = ++scopeGeneration;
+}
+
+u64 scope_name_generation(u32 nameId)
+{
+    return (nameId < nameGenerationsCapacity) ? nameGenerations[nameId] : 0;
+}
+
+void scope_free_lookup_generations()
+{
+    free(nameGenerations);
+    nameGenerations = NULL;
+    nameGenerationsCapacity = 0;
+}
+
 /*
  * Scope functions
  *
@@ -65,7 +245,9 @@ void scope_member_free(struct ScopeMember *member)
 struct Scope *scope_new(struct Scope *parentScope, char *name, struct FunctionEntry *parentFunction)
 {
     struct Scope *wip = malloc(sizeof(struct Scope));
-    wip->entries = set_new((void (*)(void *))scope_member_free, (ssize_t(*)(void *, void *))scope_member_compare);
+    wip->entries = deque_new((void (*)(void *))scope_member_free);
+    scope_index_init(&wip->members);
+    scope_index_init(&wip->lookupCache);
 
     wip->parentScope = parentScope;
     wip->parentFunction = parentFunction;
@@ -76,7 +258,9 @@ struct Scope *scope_new(struct Scope *parentScope, char *name, struct FunctionEn
 
 void scope_free(struct Scope *scope)
 {
-    set_free(scope->entries);
+    deque_free(scope->entries);
+    scope_index_deinit(&scope->members);
+    scope_index_deinit(&scope->lookupCache);
     free(scope);
 }
 
@@ -192,7 +376,7 @@ void scope_print_member(struct ScopeMember *toPrint, bool printTac, size_t depth
 void scope_print(struct Scope *scope, FILE *outFile, size_t depth, bool printTac)
 {
     Iterator *memberIterator = NULL;
-    for (memberIterator = set_begin(scope->entries); iterator_gettable(memberIterator); iterator_next(memberIterator))
+    for (memberIterator = deque_front(scope->entries); iterator_gettable(memberIterator); iterator_next(memberIterator))
     {
         struct ScopeMember *thisMember = iterator_get(memberIterator);
         scope_print_member(thisMember, printTac, depth + 1, outFile);
@@ -205,7 +389,7 @@ Stack *scope_get_all_members_of_type(struct Scope *scope, enum SCOPE_MEMBER_TYPE
 {
     Stack *result = stack_new(NULL);
     Iterator *entryIter = NULL;
-    for (entryIter = set_begin(scope->entries); iterator_gettable(entryIter); iterator_next(entryIter))
+    for (entryIter = deque_front(scope->entries); iterator_gettable(entryIter); iterator_next(entryIter))
     {
         struct ScopeMember *thisMember = iterator_get(entryIter);
         if (thisMember->type == type)
@@ -315,7 +499,7 @@ void scope_dump_arguments_dot(FILE *outFile, struct Scope *scope, size_t depth)
         struct VariableEntry *dumped = stack_pop(argsToDump);
         dump_start_row(outFile, depth, NULL);
 
-        char *typeName = type_get_name(&dumped->type);
+        char *typeName = type_get_name(dumped->type);
         fprintf(outFile, "%s %s", typeName, dumped->name);
         free(typeName);
         dump_end_row(outFile, depth);
@@ -345,7 +529,7 @@ void scope_dump_variables_dot(FILE *outFile, struct Scope *scope, size_t depth)
         struct VariableEntry *dumped = stack_pop(varsToDump);
 
         dump_start_row(outFile, depth, NULL);
-        char *typeName = type_get_name(&dumped->type);
+        char *typeName = type_get_name(dumped->type);
         fprintf(outFile, "%s %s", typeName, dumped->name);
         free(typeName);
         dump_end_row(outFile, depth);
@@ -551,7 +735,7 @@ void scope_dump_dot(FILE *outFile, struct Scope *scope, size_t depth, bool print
     fprintf(outFile, ">]\n");
 
     Iterator *entryIter = NULL;
-    for (entryIter = set_begin(scope->entries); iterator_gettable(entryIter); iterator_next(entryIter))
+    for (entryIter = deque_front(scope->entries); iterator_gettable(entryIter); iterator_next(entryIter))
     {
         struct ScopeMember *thisMember = iterator_get(entryIter);
         switch (thisMember->type)
@@ -598,19 +782,75 @@ void scope_insert(struct Scope *scope, char *name, void *newEntry, enum SCOPE_ME
         InternalError("Error defining symbol [%s] - name already exists!", name);
     }
     struct ScopeMember *wipMember = malloc(sizeof(struct ScopeMember));
-    wipMember->name = name;
+    wipMember->name = string_interner_intern(stringInterner, name, &wipMember->nameId);
     wipMember->entry = newEntry;
     wipMember->type = type;
     wipMember->accessibility = accessibility;
-    set_insert(scope->entries, wipMember);
+    scope_insert_member(scope, wipMember);
+}
+
+void scope_insert_member(struct Scope *scope, struct ScopeMember *member)
+{
+    struct ScopeIndexSlot *slot = scope_index_find_or_claim(&scope->members, member->nameId, member->type);
+    if (slot->member != NULL)
+    {
+        InternalError("Error inserting symbol [%s] - name already exists!", member->name);
+    }
+    slot->member = member;
+    deque_push_back(scope->entries, member);
+    scope_name_changed(member->nameId);
+}
+
+void scope_remove_members(struct Scope *scope, Set *toRemove)
+{
+    if (toRemove->size == 0)
+    {
+        return;
+    }
+
+    Iterator *removeIterator = NULL;
+    for (removeIterator = set_begin(toRemove); iterator_gettable(removeIterator); iterator_next(removeIterator))
+    {
+        struct ScopeMember *removed = iterator_get(removeIterator);
+        scope_index_remove(&scope->members, removed->nameId, removed->type);
+        scope_name_changed(removed->nameId);
+    }
+    iterator_free(removeIterator);
+
+    // rebuild the entries in one pass to keep the remaining members in insertion order
+    Deque *remaining = deque_new((void (*)(void *))scope_member_free);
+    while (scope->entries->size > 0)
+    {
+        struct ScopeMember *member = deque_pop_front(scope->entries);
+        if (set_find(toRemove, member) == NULL)
+        {
+            deque_push_back(remaining, member);
+        }
+    }
+    deque_free(scope->entries);
+    scope->entries = remaining;
+}
+
+// populate a dummy member to search scopes for name with - returns false if no scope can contain name because it has never been interned
+bool scope_member_key(struct ScopeMember *key, char *name, enum SCOPE_MEMBER_TYPE type)
+{
+    memset(key, 0, sizeof(struct ScopeMember));
+    key->name = string_interner_find(stringInterner, name, &key->nameId);
+    key->type = type;
+    return (key->name != NULL);
 }
 
 void scope_remove(struct Scope *scope, char *name, enum SCOPE_MEMBER_TYPE type)
 {
-    struct ScopeMember dummyMember = {0};
-    dummyMember.name = name;
-    dummyMember.type = type;
-    set_remove(scope->entries, &dummyMember);
+    struct ScopeMember *removed = scope_lookup_no_parent(scope, name, type);
+    if (removed != NULL)
+    {
+        Set *toRemove = set_new(NULL, (MBCL_DATA_COMPARE_FUNCTION)scope_member_compare);
+        set_insert(toRemove, removed);
+        scope_remove_members(scope, toRemove);
+        set_free(toRemove);
+        scope_member_free(removed);
+    }
 }
 
 // create and return a child scope of the scope provided as an argument
@@ -622,7 +862,7 @@ struct Scope *scope_create_sub_scope(struct Scope *parent_scope)
     }
     char *helpStr = malloc(2 + strlen(parent_scope->name) + 1);
     sprintf(helpStr, "%02x", parent_scope->subScopeCount);
-    char *newScopeName = dictionary_lookup_or_insert(parseDict, helpStr);
+    char *newScopeName = string_interner_intern(stringInterner, helpStr, NULL);
     free(helpStr);
     parent_scope->subScopeCount++;
 
@@ -756,34 +996,66 @@ struct TraitEntry *scope_create_trait(struct Scope *scope,
 
 bool scope_contains(struct Scope *scope, char *name, enum SCOPE_MEMBER_TYPE type)
 {
-    struct ScopeMember dummyMember = {0};
-    dummyMember.name = name;
-    dummyMember.type = type;
-    return (set_find(scope->entries, &dummyMember) != NULL);
+    return (scope_lookup_no_parent(scope, name, type) != NULL);
+}
+
+struct ScopeMember *scope_lookup_member_no_parent(struct Scope *scope, struct ScopeMember *key)
+{
+    struct ScopeIndexSlot *slot = scope_index_find(&scope->members, key->nameId, key->type);
+    return (slot != NULL) ? slot->member : NULL;
 }
 
 struct ScopeMember *scope_lookup_no_parent(struct Scope *scope, char *name, enum SCOPE_MEMBER_TYPE type)
 {
-    struct ScopeMember dummyMember = {0};
-    dummyMember.name = name;
-    dummyMember.type = type;
-    return set_find(scope->entries, &dummyMember);
+    struct ScopeMember key;
+    if (!scope_member_key(&key, name, type))
+    {
+        return NULL;
+    }
+    return scope_lookup_member_no_parent(scope, &key);
+}
+
+// search scope and its parents for the member matching key, caching the result in scope if it took a search of parent scopes to find
+struct ScopeMember *scope_lookup_member(struct Scope *scope, struct ScopeMember *key)
+{
+    struct ScopeMember *found = scope_lookup_member_no_parent(scope, key);
+    if ((found != NULL) || (scope->parentScope == NULL))
+    {
+        return found;
+    }
+
+    struct ScopeIndexSlot *cached = scope_index_find(&scope->lookupCache, key->nameId, key->type);
+    if ((cached != NULL) && (cached->generation >= scope_name_generation(key->nameId)))
+    {
+        return cached->member;
+    }
+
+    for (struct Scope *searched = scope->parentScope; (searched != NULL) && (found == NULL); searched = searched->parentScope)
+    {
+        found = scope_lookup_member_no_parent(searched, key);
+    }
+
+    // stale entries are overwritten in place, but every distinct name looked up claims a new one - start over at the cap so the cache stays bounded
+    if ((cached == NULL) && (scope->lookupCache.nUsed >= SCOPE_LOOKUP_CACHE_MAX_ENTRIES))
+    {
+        scope_index_clear(&scope->lookupCache);
+    }
+    cached = scope_index_find_or_claim(&scope->lookupCache, key->nameId, key->type);
+    cached->member = found;
+    cached->generation = scopeGeneration;
+    return found;
 }
 
 // if a member with the given name exists in this scope or any of its parents, return it
 // also looks up entries from deeper scopes, but only as their mangled names specify
 struct ScopeMember *scope_lookup(struct Scope *scope, char *name, enum SCOPE_MEMBER_TYPE type)
 {
-    while (scope != NULL)
+    struct ScopeMember key;
+    if (!scope_member_key(&key, name, type))
     {
-        struct ScopeMember *foundThisScope = scope_lookup_no_parent(scope, name, type);
-        if (foundThisScope != NULL)
-        {
-            return foundThisScope;
-        }
-        scope = scope->parentScope;
+        return NULL;
     }
-    return NULL;
+    return scope_lookup_member(scope, &key);
 }
 
 void scope_add_basic_block(struct Scope *scope, struct BasicBlock *block)
@@ -791,7 +1063,7 @@ void scope_add_basic_block(struct Scope *scope, struct BasicBlock *block)
     const u8 BASIC_BLOCK_NAME_STR_SIZE = 10; // TODO: manage this better
     char *blockName = malloc(BASIC_BLOCK_NAME_STR_SIZE);
     sprintf(blockName, "Block%zu", block->labelNum);
-    char *dictBlockName = dictionary_lookup_or_insert(parseDict, blockName);
+    char *dictBlockName = string_interner_intern(stringInterner, blockName, NULL);
     free(blockName);
     scope_insert(scope, dictBlockName, block, E_BASICBLOCK, A_PUBLIC);
 
@@ -803,8 +1075,15 @@ void scope_add_basic_block(struct Scope *scope, struct BasicBlock *block)
 
 struct VariableEntry *scope_lookup_var_by_string(struct Scope *scope, char *name)
 {
-    struct ScopeMember *lookedUpVar = scope_lookup(scope, name, E_VARIABLE);
-    struct ScopeMember *lookedUpArg = scope_lookup(scope, name, E_ARGUMENT);
+    // resolve the name once for both lookups
+    struct ScopeMember key;
+    if (!scope_member_key(&key, name, E_VARIABLE))
+    {
+        return NULL;
+    }
+    struct ScopeMember *lookedUpVar = scope_lookup_member(scope, &key);
+    key.type = E_ARGUMENT;
+    struct ScopeMember *lookedUpArg = scope_lookup_member(scope, &key);
     if ((lookedUpVar == NULL) && (lookedUpArg == NULL))
     {
         return NULL;
@@ -908,6 +1187,28 @@ struct StructDesc *scope_lookup_struct(struct Scope *scope,
     return NULL;
 }
 
+// instance of genericBase with the given params, creating it if needed
+// a new instance takes over the params list it is created with, but types keep their own (those of canonical types
+// belong to the type table), so it is only ever handed a copy
+struct TypeEntry *scope_lookup_generic_instance(struct TypeEntry *genericBase, List *genericParams)
+{
+    struct TypeEntry *instance = hash_table_find(genericBase->generic.base.instances, genericParams);
+    if (instance != NULL)
+    {
+        return instance;
+    }
+
+    List *instanceParams = list_new((void (*)(void *))type_free, NULL);
+    Iterator *paramIter = NULL;
+    for (paramIter = list_begin(genericParams); iterator_gettable(paramIter); iterator_next(paramIter))
+    {
+        list_append(instanceParams, type_duplicate(iterator_get(paramIter)));
+    }
+    iterator_free(paramIter);
+
+    return type_entry_get_or_create_generic_instantiation(genericBase, instanceParams);
+}
+
 struct StructDesc *scope_lookup_struct_by_type(struct Scope *scope,
                                                struct Type *type)
 {
@@ -953,7 +1254,7 @@ struct StructDesc *scope_lookup_struct_by_type(struct Scope *scope,
     {
         if (type->nonArray.complexType.genericParams != NULL)
         {
-            lookedUpType = type_entry_get_or_create_generic_instantiation(lookedUpType, type->nonArray.complexType.genericParams);
+            lookedUpType = scope_lookup_generic_instance(lookedUpType, type->nonArray.complexType.genericParams);
             lookedUpStruct = lookedUpType->data.asStruct;
         }
     }
@@ -1087,7 +1388,7 @@ struct EnumDesc *scope_lookup_enum_by_type(struct Scope *scope,
         {
             if (type->nonArray.complexType.genericParams != NULL)
             {
-                lookedUpType = type_entry_get_or_create_generic_instantiation(lookedUpType, type->nonArray.complexType.genericParams);
+                lookedUpType = scope_lookup_generic_instance(lookedUpType, type->nonArray.complexType.genericParams);
             }
         }
     }
@@ -1106,7 +1407,7 @@ struct EnumDesc *scope_lookup_enum_by_member_name(struct Scope *scope,
     while (scope != NULL)
     {
         Iterator *memberIterator = NULL;
-        for (memberIterator = set_begin(scope->entries); iterator_gettable(memberIterator); iterator_next(memberIterator))
+        for (memberIterator = deque_front(scope->entries); iterator_gettable(memberIterator); iterator_next(memberIterator))
         {
             struct ScopeMember *member = iterator_get(memberIterator);
             if (member->type == E_TYPE)
@@ -1157,14 +1458,23 @@ struct BasicBlock *scope_lookup_block_by_number_in_subscopes(struct Scope *scope
 struct FunctionEntry *function_entry_clone(struct FunctionEntry *toClone, struct Scope *cloneTo, struct TypeEntry *newImplementedFor)
 {
     log(LOG_DEBUG, "function_entry_clone: %s", toClone->name);
-    struct FunctionEntry *cloned = function_entry_new(cloneTo, &toClone->correspondingTree, newImplementedFor);
+    struct Ast nameTree = {0};
+    source_location_populate_ast(toClone->location, &nameTree);
+    nameTree.type = T_IDENTIFIER;
+    nameTree.value = toClone->name;
+    struct FunctionEntry *cloned = function_entry_new(cloneTo, &nameTree, newImplementedFor);
     cloned->returnType = type_duplicate_non_pointer(&toClone->returnType);
     cloned->callsOtherFunction = toClone->callsOtherFunction;
     cloned->isAsmFun = toClone->isAsmFun;
     cloned->isDefined = toClone->isDefined;
     cloned->isMethod = toClone->isMethod;
 
+    // temps first, as the operands of the cloned basic blocks are remapped to them by number
+    function_entry_clone_temps(cloned, toClone);
+
+    struct Arena *previousTacArena = tac_set_arena(cloned->tacArena);
     scope_clone_to(cloned->mainScope, toClone->mainScope, newImplementedFor);
+    tac_set_arena(previousTacArena);
 
     log(LOG_DEBUG, "initialize arguments list for clone of function %s", toClone->name);
     Iterator *argIter = NULL;
@@ -1207,7 +1517,7 @@ Deque *clone_function_arguments(Deque *toClone)
     for (argIter = deque_front(toClone); iterator_gettable(argIter); iterator_next(argIter))
     {
         struct TACOperand *oldArg = iterator_get(argIter);
-        struct TACOperand *newArg = malloc(sizeof(struct TACOperand));
+        struct TACOperand *newArg = tac_operand_new();
         memcpy(newArg, oldArg, sizeof(struct TACOperand));
         deque_push_back(cloned, newArg);
     }
@@ -1226,10 +1536,8 @@ struct BasicBlock *basic_block_clone(struct BasicBlock *toClone, struct Scope *c
         struct TACLine *lineToClone = iterator_get(tacRunner);
 
         // TODO: tac_line_duplicate
-        struct TACLine *clonedLine = new_tac_line(lineToClone->operation, &lineToClone->correspondingTree);
+        struct TACLine *clonedLine = new_tac_line_at(lineToClone->operation, lineToClone->location);
         memcpy(clonedLine, lineToClone, sizeof(struct TACLine));
-        clonedLine->allocFile = __FILE__;
-        clonedLine->allocLine = __LINE__;
 
         switch (clonedLine->operation)
         {
@@ -1263,13 +1571,12 @@ struct BasicBlock *basic_block_clone(struct BasicBlock *toClone, struct Scope *c
         }
 
         struct OperandUsages operandUsages = get_operand_usages(clonedLine);
-        while (operandUsages.reads->size > 0)
+        for (size_t readIndex = 0; readIndex < operand_usages_n_reads(&operandUsages); readIndex++)
         {
-            struct TACOperand *readOperand = deque_pop_front(operandUsages.reads);
+            struct TACOperand *readOperand = operand_usages_read(&operandUsages, readIndex);
             switch (readOperand->permutation)
             {
             case VP_STANDARD:
-            case VP_TEMP:
             {
                 struct VariableEntry *actualReadVar = scope_lookup_var_by_string(clonedTo, readOperand->name.variable->name);
                 if (actualReadVar == NULL)
@@ -1280,18 +1587,21 @@ struct BasicBlock *basic_block_clone(struct BasicBlock *toClone, struct Scope *c
             }
             break;
 
+            case VP_TEMP:
+                readOperand->name.temp = deque_at(clonedTo->parentFunction->temps, readOperand->name.temp->number);
+                break;
+
             default:
                 break;
             }
         }
 
-        while (operandUsages.writes->size > 0)
+        for (size_t writeIndex = 0; writeIndex < operandUsages.nWrites; writeIndex++)
         {
-            struct TACOperand *writtenOperand = deque_pop_front(operandUsages.writes);
+            struct TACOperand *writtenOperand = operandUsages.writes[writeIndex];
             switch (writtenOperand->permutation)
             {
             case VP_STANDARD:
-            case VP_TEMP:
             {
                 struct VariableEntry *actualWrittenVar = scope_lookup_var_by_string(clonedTo, writtenOperand->name.variable->name);
                 if (actualWrittenVar == NULL)
@@ -1302,14 +1612,15 @@ struct BasicBlock *basic_block_clone(struct BasicBlock *toClone, struct Scope *c
             }
             break;
 
+            case VP_TEMP:
+                writtenOperand->name.temp = deque_at(clonedTo->parentFunction->temps, writtenOperand->name.temp->number);
+                break;
+
             default:
                 break;
             }
         }
 
-        deque_free(operandUsages.reads);
-        deque_free(operandUsages.writes);
-
         size_t tacIndex = lineToClone->index;
         basic_block_append(clone, clonedLine, &tacIndex);
     }
@@ -1322,7 +1633,7 @@ void scope_clone_to(struct Scope *clonedTo, struct Scope *toClone, struct TypeEn
 {
     log(LOG_DEBUG, "scope_clone_to %s<-%s", clonedTo->name, toClone->name);
     Iterator *memberIterator = NULL;
-    for (memberIterator = set_begin(toClone->entries); iterator_gettable(memberIterator); iterator_next(memberIterator))
+    for (memberIterator = deque_front(toClone->entries); iterator_gettable(memberIterator); iterator_next(memberIterator))
     {
         struct ScopeMember *memberToClone = iterator_get(memberIterator);
         void *entry = NULL;
@@ -1331,16 +1642,14 @@ void scope_clone_to(struct Scope *clonedTo, struct Scope *toClone, struct TypeEn
         case E_VARIABLE:
         {
             struct VariableEntry *variableToClone = memberToClone->entry;
-            struct Type dupType = type_duplicate_non_pointer(&variableToClone->type);
-            entry = variable_entry_new(variableToClone->name, &dupType, variableToClone->isGlobal, false, memberToClone->accessibility);
+            entry = variable_entry_new(variableToClone->name, variableToClone->type, variableToClone->isGlobal, false, memberToClone->accessibility);
         }
         break;
 
         case E_ARGUMENT:
         {
             struct VariableEntry *argumentToClone = memberToClone->entry;
-            struct Type dupType = type_duplicate_non_pointer(&argumentToClone->type);
-            entry = variable_entry_new(argumentToClone->name, &dupType, argumentToClone->isGlobal, true, memberToClone->accessibility);
+            entry = variable_entry_new(argumentToClone->name, argumentToClone->type, argumentToClone->isGlobal, true, memberToClone->accessibility);
         }
         break;
 
@@ -1359,7 +1668,7 @@ void scope_clone_to(struct Scope *clonedTo, struct Scope *toClone, struct TypeEn
     }
     iterator_free(memberIterator);
 
-    for (memberIterator = set_begin(toClone->entries); iterator_gettable(memberIterator); iterator_next(memberIterator))
+    for (memberIterator = deque_front(toClone->entries); iterator_gettable(memberIterator); iterator_next(memberIterator))
     {
         struct ScopeMember *memberToClone = iterator_get(memberIterator);
         void *entry = NULL;
@@ -1416,7 +1725,7 @@ void scope_clone_to(struct Scope *clonedTo, struct Scope *toClone, struct TypeEn
 void scope_resolve_generics(struct Scope *scope, HashTable *paramsMap, char *resolvedStructName, List *resolvedParams)
 {
     Iterator *memberIterator = NULL;
-    for (memberIterator = set_begin(scope->entries); iterator_gettable(memberIterator); iterator_next(memberIterator))
+    for (memberIterator = deque_front(scope->entries); iterator_gettable(memberIterator); iterator_next(memberIterator))
     {
         struct ScopeMember *memberToResolve = iterator_get(memberIterator);
         switch (memberToResolve->type)
@@ -1432,8 +1741,7 @@ void scope_resolve_generics(struct Scope *scope, HashTable *paramsMap, char *res
         case E_FUNCTION:
         {
             struct FunctionEntry *resolved = memberToResolve->entry;
-            type_try_resolve_generic(&resolved->returnType, paramsMap, resolvedStructName, resolvedParams);
-            scope_resolve_generics(resolved->mainScope, paramsMap, resolvedStructName, resolvedParams);
+            function_entry_resolve_generics(resolved, paramsMap, resolvedStructName, resolvedParams);
         }
         break;
 
@@ -1551,7 +1859,7 @@ struct TypeEntry *scope_lookup_type(struct Scope *scope, struct Type *type)
             {
             case G_BASE:
             {
-                lookedUp = type_entry_get_or_create_generic_instantiation(lookedUp, type->nonArray.complexType.genericParams);
+                lookedUp = scope_lookup_generic_instance(lookedUp, type->nonArray.complexType.genericParams);
             }
             break;
 
@@ -1609,7 +1917,7 @@ void scope_resolve_capital_self(struct Scope *scope, struct TypeEntry *theType)
 {
     log(LOG_DEBUG, "Resolving capital self for scope %s", scope->name);
     Iterator *entryIter = NULL;
-    for (entryIter = set_begin(scope->entries); iterator_gettable(entryIter); iterator_next(entryIter))
+    for (entryIter = deque_front(scope->entries); iterator_gettable(entryIter); iterator_next(entryIter))
     {
         struct ScopeMember *member = iterator_get(entryIter);
 
@@ -1618,8 +1926,7 @@ void scope_resolve_capital_self(struct Scope *scope, struct TypeEntry *theType)
         case E_VARIABLE:
         case E_ARGUMENT:
         {
-            struct VariableEntry *variable = member->entry;
-            type_try_resolve_vt_self(&variable->type, theType);
+            variable_entry_resolve_vt_self(member->entry, theType);
         }
         break;
 
@@ -1627,8 +1934,7 @@ void scope_resolve_capital_self(struct Scope *scope, struct TypeEntry *theType)
         {
             log(LOG_DEBUG, "Resolving capital self for function %s", member->name);
             struct FunctionEntry *function = member->entry;
-            type_try_resolve_vt_self(&function->returnType, theType);
-            scope_resolve_capital_self(function->mainScope, theType);
+            function_entry_resolve_capital_self(function, theType);
         }
         break;
 
@@ -2,8 +2,10 @@
 #include "enum_desc.h"
 #include "log.h"
 #include "struct_desc.h"
+#include "symtab_basicblock.h"
 #include "symtab_function.h"
 #include "symtab_trait.h"
+#include "tac.h"
 #include "util.h"
 
 ssize_t compare_generic_params_lists(void *paramsListDataA, void *paramsListDataB)
@@ -55,7 +57,7 @@ size_t hash_generic_params_list(void *paramsListData)
     return hash;
 }
 
-extern struct Dictionary *parseDict;
+extern _Thread_local struct StringInterner *stringInterner;
 struct TypeEntry *type_entry_new(struct Scope *parentScope,
                                  enum TYPE_PERMUTATION permutation,
                                  struct Type type,
@@ -73,7 +75,7 @@ struct TypeEntry *type_entry_new(struct Scope *parentScope,
     wipType->baseName = type_get_name(&type);
     char *typeImplementedScopeName = malloc(strlen(wipType->baseName) + 13);
     sprintf(typeImplementedScopeName, "%s_implemented", wipType->baseName);
-    wipType->implemented = scope_new(parentScope, dictionary_lookup_or_insert(parseDict, typeImplementedScopeName), NULL);
+    wipType->implemented = scope_new(parentScope, string_interner_intern(stringInterner, typeImplementedScopeName, NULL), NULL);
     free(typeImplementedScopeName);
 
     if ((genericParamNames != NULL) && (genericType != G_BASE))
@@ -243,11 +245,24 @@ struct TraitEntry *type_entry_lookup_trait(struct TypeEntry *typeEntry, char *na
 {
     struct TraitEntry dummyTrait = {0};
     dummyTrait.name = name;
-    return set_find(typeEntry->traits, &dummyTrait);
+    struct TraitEntry *found = set_find(typeEntry->traits, &dummyTrait);
+
+    // traits are implemented on the generic base, so instances implement whatever their base does
+    if ((found == NULL) && (typeEntry->genericType == G_INSTANCE))
+    {
+        found = set_find(typeEntry->generic.instance.base->traits, &dummyTrait);
+    }
+
+    return found;
 }
 
 struct FunctionEntry *type_entry_lookup_implemented(struct TypeEntry *typeEntry, struct Scope *scope, struct Ast *nameTree)
 {
+    if (typeEntry->genericType == G_INSTANCE)
+    {
+        type_entry_instantiate_implemented(typeEntry, nameTree->value);
+    }
+
     struct ScopeMember *implementedMember = scope_lookup(typeEntry->implemented, nameTree->value, E_FUNCTION);
     if (implementedMember == NULL)
     {
@@ -274,16 +289,8 @@ struct TypeEntry *struct_type_entry_clone_generic_base_as_instance(struct TypeEn
     struct_desc_free(clonedTypeEntry->data.asStruct);
     clonedTypeEntry->data.asStruct = clonedStruct;
 
-    scope_clone_to(clonedTypeEntry->implemented, toClone->implemented, clonedTypeEntry);
-
-    Iterator *implementedIter = NULL;
-    for (implementedIter = hash_table_begin(toClone->implementedByName); iterator_gettable(implementedIter); iterator_next(implementedIter))
-    {
-        HashTableEntry *implementedEntry = iterator_get(implementedIter);
-        struct ScopeMember *implementedMember = implementedEntry->value;
-        type_entry_add_implemented(clonedTypeEntry, scope_lookup(clonedTypeEntry->implemented, implementedEntry->key, E_FUNCTION)->entry, implementedMember->accessibility);
-    }
-    iterator_free(implementedIter);
+    // implemented functions are cloned individually as they are used (see type_entry_instantiate_implemented)
+    clonedTypeEntry->generic.instance.base = toClone;
 
     return clonedTypeEntry;
 }
@@ -301,16 +308,8 @@ struct TypeEntry *enum_type_entry_clone_generic_base_as_instance(struct TypeEntr
     enum_desc_free(clonedTypeEntry->data.asEnum);
     clonedTypeEntry->data.asEnum = clonedEnum;
 
-    scope_clone_to(clonedTypeEntry->implemented, toClone->implemented, clonedTypeEntry);
-    Iterator *implementedIter = NULL;
-    for (implementedIter = hash_table_begin(toClone->implementedByName); iterator_gettable(implementedIter); iterator_next(implementedIter))
-    {
-        HashTableEntry *implementedEntry = iterator_get(implementedIter);
-        struct ScopeMember *implementedMember = implementedEntry->value;
-        type_entry_add_implemented(clonedTypeEntry, scope_lookup(clonedTypeEntry->implemented, implementedEntry->key, E_FUNCTION)->entry, implementedMember->accessibility);
-    }
-
-    iterator_free(implementedIter);
+    // implemented functions are cloned individually as they are used (see type_entry_instantiate_implemented)
+    clonedTypeEntry->generic.instance.base = toClone;
 
     return clonedTypeEntry;
 }
@@ -346,6 +345,11 @@ struct FunctionEntry *type_entry_lookup_method(struct TypeEntry *typeEntry,
                                                struct Ast *nameTree,
                                                struct Scope *scope)
 {
+    if (typeEntry->genericType == G_INSTANCE)
+    {
+        type_entry_instantiate_implemented(typeEntry, nameTree->value);
+    }
+
     struct FunctionEntry *method = hash_table_find(typeEntry->implementedByName, nameTree->value);
     if (method == NULL)
     {
@@ -366,6 +370,11 @@ struct FunctionEntry *type_entry_lookup_associated_function(struct TypeEntry *ty
                                                             struct Ast *nameTree,
                                                             struct Scope *scope)
 {
+    if (typeEntry->genericType == G_INSTANCE)
+    {
+        type_entry_instantiate_implemented(typeEntry, nameTree->value);
+    }
+
     struct FunctionEntry *associatedFunction = hash_table_find(typeEntry->implementedByName, nameTree->value);
 
     if (associatedFunction == NULL)
@@ -392,13 +401,61 @@ void type_entry_resolve_capital_self(struct TypeEntry *typeEntry)
     scope_resolve_capital_self(typeEntry->implemented, typeEntry);
 }
 
-void type_entry_resolve_generics(struct TypeEntry *instance, List *paramNames, List *paramTypes)
+struct TypeLayout *type_entry_get_layout(struct TypeEntry *typeEntry)
 {
-    if (instance->genericType != G_INSTANCE)
+    if (typeEntry->layout.computed)
     {
-        InternalError("type_entry_resolve_generics called with non-instance type %s", instance->baseName);
+        return &typeEntry->layout;
+    }
+
+    struct TypeLayout layout = {0};
+    switch (typeEntry->permutation)
+    {
+    case TP_PRIMITIVE:
+        InternalError("type_entry_get_layout called for primitive type %s", typeEntry->baseName);
+        break;
+
+    case TP_STRUCT:
+    {
+        struct StructDesc *theStruct = typeEntry->data.asStruct;
+        layout.size = theStruct->totalSize;
+
+        Iterator *fieldIter = NULL;
+        for (fieldIter = deque_front(theStruct->fieldLocations); iterator_gettable(fieldIter); iterator_next(fieldIter))
+        {
+            struct StructField *field = iterator_get(fieldIter);
+            u8 fieldAlignment = type_get_alignment(field->variable->type, theStruct->members);
+            if (fieldAlignment > layout.alignment)
+            {
+                layout.alignment = fieldAlignment;
+            }
+        }
+        iterator_free(fieldIter);
     }
+    break;
+
+    case TP_ENUM:
+        // numerical value of the enum followed by the union of member data
+        layout.size = sizeof(size_t) + typeEntry->data.asEnum->unionSize;
+        layout.alignment = align_size(layout.size);
+        break;
+    }
+
+    // generic bases (and instances parameterized by other generics) have no layout of their own yet, so recompute for them every time
+    layout.computed = (typeEntry->genericType != G_BASE) && !type_is_generic(&typeEntry->type);
+    typeEntry->layout = layout;
+
+    return &typeEntry->layout;
+}
+
+void type_entry_invalidate_layout(struct TypeEntry *typeEntry)
+{
+    memset(&typeEntry->layout, 0, sizeof(struct TypeLayout));
+}
 
+// map from the names of generic parameters to the types they are instantiated with
+HashTable *type_entry_generic_params_map(struct TypeEntry *instance, List *paramNames, List *paramTypes)
+{
     HashTable *paramsMap = hash_table_new(NULL, NULL, (ssize_t(*)(void *, void *))strcmp, hash_string, paramTypes->size);
 
     Iterator *paramNameIter = list_begin(paramNames);
@@ -425,6 +482,18 @@ void type_entry_resolve_generics(struct TypeEntry *instance, List *paramNames, L
     iterator_free(paramNameIter);
     iterator_free(paramTypeIter);
 
+    return paramsMap;
+}
+
+void type_entry_resolve_generics(struct TypeEntry *instance, List *paramNames, List *paramTypes)
+{
+    if (instance->genericType != G_INSTANCE)
+    {
+        InternalError("type_entry_resolve_generics called with non-instance type %s", instance->baseName);
+    }
+
+    HashTable *paramsMap = type_entry_generic_params_map(instance, paramNames, paramTypes);
+
     switch (instance->permutation)
     {
     case TP_PRIMITIVE:
@@ -443,6 +512,125 @@ void type_entry_resolve_generics(struct TypeEntry *instance, List *paramNames, L
     hash_table_free(paramsMap);
 
     type_entry_resolve_capital_self(instance);
+
+    type_entry_invalidate_layout(instance);
+}
+
+// instantiate the implemented function name of the type calledOnType refers to if it is a concrete generic instance
+void type_entry_instantiate_callee(struct Scope *scope, struct Type *calledOnType, char *name)
+{
+    if (((calledOnType->basicType != VT_STRUCT) && (calledOnType->basicType != VT_ENUM)) || type_is_generic(calledOnType))
+    {
+        return;
+    }
+
+    struct TypeEntry *calledOn = scope_lookup_type_remove_pointer(scope, calledOnType);
+    if (calledOn->genericType == G_INSTANCE)
+    {
+        type_entry_instantiate_implemented(calledOn, name);
+    }
+}
+
+// instantiate everything an instantiated function calls on generic instances, so that all of it exists by the time code is generated
+void type_entry_instantiate_callees(struct FunctionEntry *function)
+{
+    Iterator *blockIter = NULL;
+    for (blockIter = list_begin(function->BasicBlockList); iterator_gettable(blockIter); iterator_next(blockIter))
+    {
+        struct BasicBlock *block = iterator_get(blockIter);
+        Iterator *tacIter = NULL;
+        for (tacIter = list_begin(block->TACList); iterator_gettable(tacIter); iterator_next(tacIter))
+        {
+            struct TACLine *line = iterator_get(tacIter);
+            switch (line->operation)
+            {
+            case TT_METHOD_CALL:
+                type_entry_instantiate_callee(function->mainScope, tac_operand_get_type(&line->operands.methodCall.calledOn), line->operands.methodCall.methodName);
+                break;
+
+            case TT_ASSOCIATED_CALL:
+                type_entry_instantiate_callee(function->mainScope, &line->operands.associatedCall.associatedWith, line->operands.associatedCall.functionName);
+                break;
+
+            default:
+                break;
+            }
+        }
+        iterator_free(tacIter);
+    }
+    iterator_free(blockIter);
+}
+
+struct FunctionEntry *type_entry_instantiate_implemented(struct TypeEntry *instance, char *name)
+{
+    if (instance->genericType != G_INSTANCE)
+    {
+        InternalError("type_entry_instantiate_implemented called with non-instance type %s", instance->baseName);
+    }
+
+    struct FunctionEntry *instantiated = hash_table_find(instance->implementedByName, name);
+    if (instantiated != NULL)
+    {
+        return instantiated;
+    }
+
+    struct TypeEntry *base = instance->generic.instance.base;
+    struct FunctionEntry *baseFunction = hash_table_find(base->implementedByName, name);
+    if (baseFunction == NULL)
+    {
+        return NULL;
+    }
+    struct ScopeMember *baseMember = scope_lookup_no_parent(base->implemented, name, E_FUNCTION);
+
+    log(LOG_DEBUG, "Instantiate %s::%s on first use", instance->baseName, name);
+    instantiated = function_entry_clone(baseFunction, instance->implemented, instance);
+
+    // instances parameterized by other generics are only ever referred to from generic code, so leave them unresolved as their base is
+    bool concrete = !type_is_generic(&instance->type);
+    if (concrete)
+    {
+        List *paramTypes = instance->generic.instance.parameters;
+        HashTable *paramsMap = type_entry_generic_params_map(instance, base->generic.base.paramNames, paramTypes);
+        function_entry_resolve_generics(instantiated, paramsMap, instance->baseName, paramTypes);
+        hash_table_free(paramsMap);
+
+        function_entry_resolve_capital_self(instantiated, instance);
+    }
+
+    // register before looking at callees so that (mutually) recursive functions are only instantiated once
+    scope_insert(instance->implemented, name, instantiated, E_FUNCTION, baseMember->accessibility);
+    type_entry_add_implemented(instance, instantiated, baseMember->accessibility);
+
+    if (concrete)
+    {
+        type_entry_instantiate_callees(instantiated);
+    }
+
+    return instantiated;
+}
+
+void type_entry_instantiate_required_functions(struct TypeEntry *instance, Set *required)
+{
+    Iterator *requiredIter = NULL;
+    for (requiredIter = set_begin(required); iterator_gettable(requiredIter); iterator_next(requiredIter))
+    {
+        struct FunctionEntry *requiredFunction = iterator_get(requiredIter);
+        type_entry_instantiate_implemented(instance, requiredFunction->name);
+    }
+    iterator_free(requiredIter);
+}
+
+// instantiate the functions required by the traits an instance's base implements, as they may be called implicitly (such as Drop::drop)
+void type_entry_instantiate_trait_functions(struct TypeEntry *instance)
+{
+    Iterator *traitIter = NULL;
+    for (traitIter = set_begin(instance->generic.instance.base->traits); iterator_gettable(traitIter); iterator_next(traitIter))
+    {
+        struct TraitEntry *trait = iterator_get(traitIter);
+        type_entry_instantiate_required_functions(instance, trait->public);
+        type_entry_instantiate_required_functions(instance, trait->private);
+    }
+    iterator_free(traitIter);
 }
 
 struct TypeEntry *type_entry_get_or_create_generic_instantiation(struct TypeEntry *baseType, List *paramsList)
@@ -491,6 +679,11 @@ struct TypeEntry *type_entry_get_or_create_generic_instantiation(struct TypeEntr
         // type_entry_resolve_capital_self(instance);
 
         hash_table_insert(baseType->generic.base.instances, paramsList, instance);
+
+        if (!type_is_generic(&instance->type))
+        {
+            type_entry_instantiate_trait_functions(instance);
+        }
     }
 
     return instance;
@@ -2,8 +2,11 @@
 
 #include "log.h"
 #include "symtab_function.h"
+#include "type_table.h"
 #include "util.h"
 
+extern _Thread_local struct StringInterner *stringInterner;
+
 // TODO: examine isGlobal - can it be related to scope->parentscope instead?
 struct VariableEntry *variable_entry_new(char *name,
                                          struct Type *type,
@@ -17,10 +20,10 @@ struct VariableEntry *variable_entry_new(char *name,
     }
 
     struct VariableEntry *newVariable = malloc(sizeof(struct VariableEntry));
-    newVariable->type = *type;
+    newVariable->type = type_intern(type);
     newVariable->stackOffset = 0;
     newVariable->mustSpill = 0;
-    newVariable->name = name;
+    newVariable->name = string_interner_intern(stringInterner, name, &newVariable->nameId);
 
     if (isGlobal)
     {
@@ -34,13 +37,23 @@ struct VariableEntry *variable_entry_new(char *name,
     // don't take these as arguments as they will only ever be set for specific declarations
     newVariable->isExtern = 0;
     newVariable->isStringLiteral = 0;
+    newVariable->initializeTo = NULL;
+    newVariable->initializeArrayTo = NULL;
 
     return newVariable;
 }
 
 void variable_entry_free(struct VariableEntry *variable)
 {
-    type_deinit(&variable->type);
+    if (variable->initializeArrayTo != NULL)
+    {
+        for (size_t i = 0; i < variable->type->array.size; i++)
+        {
+            free(variable->initializeArrayTo[i]);
+        }
+        free(variable->initializeArrayTo);
+    }
+    free(variable->initializeTo);
     free(variable);
 }
 
@@ -50,17 +63,28 @@ void variable_entry_print(struct VariableEntry *variable, FILE *outFile, size_t
     {
         fprintf(outFile, "\t");
     }
-    char *typeName = type_get_name(&variable->type);
+    char *typeName = type_get_name(variable->type);
     fprintf(outFile, "%s %s\n", typeName, variable->name);
     free(typeName);
 }
 
 void variable_entry_try_resolve_generic(struct VariableEntry *variable, HashTable *paramsMap, char *resolvedStructName, List *resolvedParams)
 {
-    type_try_resolve_generic(&variable->type, paramsMap, resolvedStructName, resolvedParams);
+    struct Type resolved = type_duplicate_non_pointer(variable->type);
+    type_try_resolve_generic(&resolved, paramsMap, resolvedStructName, resolvedParams);
     if ((strcmp(variable->name, OUT_OBJECT_POINTER_NAME) == 0) ||
         (strcmp(variable->name, "self") == 0))
     {
-        variable->type.pointerLevel = 1;
+        resolved.pointerLevel = 1;
     }
+    variable->type = type_intern(&resolved);
+    type_deinit(&resolved);
+}
+
+void variable_entry_resolve_vt_self(struct VariableEntry *variable, struct TypeEntry *theType)
+{
+    struct Type resolved = type_duplicate_non_pointer(variable->type);
+    type_try_resolve_vt_self(&resolved, theType);
+    variable->type = type_intern(&resolved);
+    type_deinit(&resolved);
 }
@@ -6,6 +6,39 @@
 
 #include "symtab_basicblock.h"
 
+const size_t TAC_ARENA_CHUNK_SIZE = 16 * 1024;
+
+struct Arena *tac_arena_new()
+{
+    return arena_new(TAC_ARENA_CHUNK_SIZE);
+}
+
+// TAC lines and the operands hanging off of them are allocated from this arena (see tac_set_arena)
+_Thread_local struct Arena *currentTacArena = NULL;
+
+struct Arena *tac_set_arena(struct Arena *arena)
+{
+    struct Arena *previousArena = currentTacArena;
+    currentTacArena = arena;
+    return previousArena;
+}
+
+void *tac_arena_alloc(size_t size)
+{
+    if (currentTacArena == NULL)
+    {
+        InternalError("No TAC arena set when allocating TAC");
+    }
+    void *allocated = arena_alloc(currentTacArena, size);
+    memset(allocated, 0, size);
+    return allocated;
+}
+
+struct TACOperand *tac_operand_new()
+{
+    return tac_arena_alloc(sizeof(struct TACOperand));
+}
+
 char *tac_operation_get_name(enum TAC_TYPE tacOperation)
 {
     switch (tacOperation)
@@ -98,13 +131,15 @@ char *tac_operation_get_name(enum TAC_TYPE tacOperation)
     return "";
 }
 
-struct TACLine *new_tac_line_function(enum TAC_TYPE operation, struct Ast *correspondingTree, char *file, int line)
+struct TACLine *new_tac_line(enum TAC_TYPE operation, struct Ast *correspondingTree)
+{
+    return new_tac_line_at(operation, source_location_of(correspondingTree));
+}
+
+struct TACLine *new_tac_line_at(enum TAC_TYPE operation, SourceLoc location)
 {
-    struct TACLine *wip = malloc(sizeof(struct TACLine));
-    memset(wip, 0, sizeof(struct TACLine));
-    wip->allocFile = file;
-    wip->allocLine = line;
-    wip->correspondingTree = *correspondingTree;
+    struct TACLine *wip = tac_arena_alloc(sizeof(struct TACLine));
+    wip->location = location;
 
     wip->operation = operation;
     // by default operands are NOT reorderable
@@ -155,9 +190,9 @@ char *sprint_tac_operand_type(struct TACOperand *operand)
         char *typeName = type_get_name(tac_operand_get_non_cast_type(operand));
         width += sprintf(operandString + width, " %s", typeName);
         free(typeName);
-        if (operand->castAsType.basicType != VT_NULL)
+        if (operand->castAsType != NULL)
         {
-            char *castAsTypeName = type_get_name(&operand->castAsType);
+            char *castAsTypeName = type_get_name(operand->castAsType);
             width += sprintf(operandString + width, "(%s)", castAsTypeName);
             free(castAsTypeName);
         }
@@ -526,50 +561,31 @@ ssize_t tac_get_jump_target(struct TACLine *line)
     return target;
 }
 
-void free_tac(struct TACLine *line)
+// free the parts of a TAC line which don't live in the TAC arena - the line itself and its operands are released with the arena
+void tac_line_deinit(struct TACLine *line)
 {
     switch (line->operation)
     {
     case TT_PHI:
     {
-        while (line->operands.phi.sources->size > 0)
-        {
-            struct TACOperand *source = deque_pop_front(line->operands.phi.sources);
-            free(source);
-        }
         deque_free(line->operands.phi.sources);
     }
     break;
 
     case TT_FUNCTION_CALL:
     {
-        while (line->operands.functionCall.arguments->size > 0)
-        {
-            struct TACOperand *argument = deque_pop_front(line->operands.functionCall.arguments);
-            free(argument);
-        }
         deque_free(line->operands.functionCall.arguments);
     }
     break;
 
     case TT_METHOD_CALL:
     {
-        while (line->operands.methodCall.arguments->size > 0)
-        {
-            struct TACOperand *argument = deque_pop_front(line->operands.methodCall.arguments);
-            free(argument);
-        }
         deque_free(line->operands.methodCall.arguments);
     }
     break;
 
     case TT_ASSOCIATED_CALL:
     {
-        while (line->operands.associatedCall.arguments->size > 0)
-        {
-            struct TACOperand *argument = deque_pop_front(line->operands.associatedCall.arguments);
-            free(argument);
-        }
         deque_free(line->operands.associatedCall.arguments);
     }
     break;
@@ -619,15 +635,29 @@ void free_tac(struct TACLine *line)
     case TT_ENDDO:
         break;
     }
+}
+
+void operand_usages_add_read(struct OperandUsages *usages, struct TACOperand *read)
+{
+    if (usages->nReads >= TAC_LINE_MAX_FIXED_READS)
+    {
+        InternalError("Too many fixed reads for OperandUsages (max %d)", TAC_LINE_MAX_FIXED_READS);
+    }
+    usages->reads[usages->nReads++] = read;
+}
 
-    free(line);
+void operand_usages_add_write(struct OperandUsages *usages, struct TACOperand *write)
+{
+    if (usages->nWrites >= TAC_LINE_MAX_WRITES)
+    {
+        InternalError("Too many writes for OperandUsages (max %d)", TAC_LINE_MAX_WRITES);
+    }
+    usages->writes[usages->nWrites++] = write;
 }
 
 struct OperandUsages get_operand_usages(struct TACLine *line) // NOLINT (forgive me)
 {
     struct OperandUsages usages = {0};
-    usages.reads = deque_new(NULL);
-    usages.writes = deque_new(NULL);
 
     switch (line->operation)
     {
@@ -637,63 +667,52 @@ struct OperandUsages get_operand_usages(struct TACLine *line) // NOLINT (forgive
         break;
 
     case TT_ASM_LOAD:
-        deque_push_back(usages.reads, &line->operands.asmLoad.sourceOperand);
+        operand_usages_add_read(&usages, &line->operands.asmLoad.sourceOperand);
         break;
 
     case TT_ASM_STORE:
-        deque_push_back(usages.writes, &line->operands.asmStore.destinationOperand);
+        operand_usages_add_write(&usages, &line->operands.asmStore.destinationOperand);
         break;
 
     case TT_FUNCTION_CALL:
         if ((tac_operand_get_type(&line->operands.functionCall.returnValue)->basicType != VT_NULL))
         {
-            deque_push_back(usages.writes, &line->operands.functionCall.returnValue);
-        }
-        for (size_t argIdx = 0; argIdx < line->operands.functionCall.arguments->size; argIdx++)
-        {
-            struct TACOperand *argument = deque_at(line->operands.functionCall.arguments, argIdx);
-            deque_push_back(usages.reads, argument);
+            operand_usages_add_write(&usages, &line->operands.functionCall.returnValue);
         }
+        usages.variadicReads = line->operands.functionCall.arguments;
         break;
 
     case TT_METHOD_CALL:
         if ((tac_operand_get_type(&line->operands.methodCall.returnValue)->basicType != VT_NULL))
         {
-            deque_push_back(usages.writes, &line->operands.methodCall.returnValue);
+            operand_usages_add_write(&usages, &line->operands.methodCall.returnValue);
         }
-        for (size_t argIdx = 0; argIdx < line->operands.methodCall.arguments->size; argIdx++)
-        {
-            struct TACOperand *argument = deque_at(line->operands.methodCall.arguments, argIdx);
-            deque_push_back(usages.reads, argument);
-        }
-        deque_push_back(usages.reads, &line->operands.methodCall.calledOn);
+        usages.variadicReads = line->operands.methodCall.arguments;
+        operand_usages_add_read(&usages, &line->operands.methodCall.calledOn);
         break;
 
     case TT_ASSOCIATED_CALL:
         if ((tac_operand_get_type(&line->operands.associatedCall.returnValue)->basicType != VT_NULL))
         {
-            deque_push_back(usages.writes, &line->operands.associatedCall.returnValue);
-        }
-        for (size_t argIdx = 0; argIdx < line->operands.associatedCall.arguments->size; argIdx++)
-        {
-            struct TACOperand *argument = deque_at(line->operands.associatedCall.arguments, argIdx);
-            deque_push_back(usages.reads, argument);
+            operand_usages_add_write(&usages, &line->operands.associatedCall.returnValue);
         }
+        usages.variadicReads = line->operands.associatedCall.arguments;
         break;
 
     case TT_ASSIGN:
-        deque_push_back(usages.writes, &line->operands.assign.destination);
-        deque_push_back(usages.reads, &line->operands.assign.source);
+        operand_usages_add_write(&usages, &line->operands.assign.destination);
+        operand_usages_add_read(&usages, &line->operands.assign.source);
         break;
 
-    // single operand in slot 0
+    // returning reads the value returned
     case TT_RETURN:
         if ((tac_operand_get_type(&line->operands.return_.returnValue)->basicType != VT_NULL))
         {
-            deque_push_back(usages.writes, &line->operands.return_.returnValue);
+            operand_usages_add_read(&usages, &line->operands.return_.returnValue);
         }
         break;
 
+    // arithmetic writes the destination and only reads its sources
     case TT_ADD:
     case TT_SUBTRACT:
     case TT_MUL:
@@ -705,55 +724,55 @@ struct OperandUsages get_operand_usages(struct TACLine *line) // NOLINT (forgive
     case TT_BITWISE_NOT:
     case TT_LSHIFT:
     case TT_RSHIFT:
-        deque_push_back(usages.writes, &line->operands.arithmetic.destination);
-        deque_push_back(usages.writes, &line->operands.arithmetic.sourceA);
-        deque_push_back(usages.writes, &line->operands.arithmetic.sourceB);
+        operand_usages_add_write(&usages, &line->operands.arithmetic.destination);
+        operand_usages_add_read(&usages, &line->operands.arithmetic.sourceA);
+        operand_usages_add_read(&usages, &line->operands.arithmetic.sourceB);
         break;
 
     // loading writes the destination, while reading from the pointer
     case TT_LOAD:
-        deque_push_back(usages.writes, &line->operands.load.destination);
-        deque_push_back(usages.reads, &line->operands.load.address);
+        operand_usages_add_write(&usages, &line->operands.load.destination);
+        operand_usages_add_read(&usages, &line->operands.load.address);
         break;
 
     // storing actually reads the variable containing the pionter to the location which the data is written
     case TT_STORE:
-        deque_push_back(usages.reads, &line->operands.store.address);
-        deque_push_back(usages.reads, &line->operands.store.source);
+        operand_usages_add_read(&usages, &line->operands.store.address);
+        operand_usages_add_read(&usages, &line->operands.store.source);
         break;
 
     case TT_ADDROF:
-        deque_push_back(usages.writes, &line->operands.addrof.destination);
-        deque_push_back(usages.reads, &line->operands.addrof.source);
+        operand_usages_add_write(&usages, &line->operands.addrof.destination);
+        operand_usages_add_read(&usages, &line->operands.addrof.source);
         break;
 
     case TT_ARRAY_LOAD:
     case TT_ARRAY_LEA:
-        deque_push_back(usages.writes, &line->operands.arrayLoad.destination);
-        deque_push_back(usages.reads, &line->operands.arrayLoad.array);
-        deque_push_back(usages.reads, &line->operands.arrayLoad.index);
-        break;
+        operand_usages_add_write(&usages, &line->operands.arrayLoad.destination);
+        operand_usages_add_read(&usages, &line->operands.arrayLoad.array);
+        operand_usages_add_read(&usages, &line->operands.arrayLoad.index);
         break;
 
     case TT_ARRAY_STORE:
-        deque_push_back(usages.reads, &line->operands.arrayStore.array);
-        deque_push_back(usages.reads, &line->operands.arrayStore.index);
-        deque_push_back(usages.reads, &line->operands.arrayStore.source);
+        operand_usages_add_read(&usages, &line->operands.arrayStore.array);
+        operand_usages_add_read(&usages, &line->operands.arrayStore.index);
+        operand_usages_add_read(&usages, &line->operands.arrayStore.source);
         break;
 
     case TT_FIELD_LOAD:
     case TT_FIELD_LEA:
-        deque_push_back(usages.writes, &line->operands.fieldLoad.destination);
-        deque_push_back(usages.reads, &line->operands.fieldLoad.source);
+        operand_usages_add_write(&usages, &line->operands.fieldLoad.destination);
+        operand_usages_add_read(&usages, &line->operands.fieldLoad.source);
         break;
 
+    // storing a field only writes part of the destination (or through it, if it is a pointer), so the rest of it is still live
     case TT_FIELD_STORE:
-        deque_push_back(usages.writes, &line->operands.fieldLoad.destination);
-        deque_push_back(usages.reads, &line->operands.fieldLoad.source);
+        operand_usages_add_read(&usages, &line->operands.fieldStore.destination);
+        operand_usages_add_read(&usages, &line->operands.fieldStore.source);
         break;
 
     case TT_SIZEOF:
-        deque_push_back(usages.writes, &line->operands.sizeof_.destination);
+        operand_usages_add_write(&usages, &line->operands.sizeof_.destination);
         break;
 
     case TT_BEQ:
@@ -764,23 +783,14 @@ struct OperandUsages get_operand_usages(struct TACLine *line) // NOLINT (forgive
     case TT_BLEU:
     case TT_BEQZ:
     case TT_BNEZ:
-        deque_push_back(usages.reads, &line->operands.conditionalBranch.sourceA);
-        deque_push_back(usages.reads, &line->operands.conditionalBranch.sourceB);
+        operand_usages_add_read(&usages, &line->operands.conditionalBranch.sourceA);
+        operand_usages_add_read(&usages, &line->operands.conditionalBranch.sourceB);
         break;
 
     case TT_PHI:
-    {
-        deque_push_back(usages.writes, &line->operands.phi.destination);
-        Iterator *sourceIterator = NULL;
-        for (sourceIterator = deque_front(line->operands.phi.sources); iterator_gettable(sourceIterator);)
-        {
-            struct TACOperand *source = iterator_get(sourceIterator);
-            deque_push_back(usages.reads, source);
-            iterator_next(sourceIterator);
-        }
-        iterator_free(sourceIterator);
-    }
-    break;
+        operand_usages_add_write(&usages, &line->operands.phi.destination);
+        usages.variadicReads = line->operands.phi.sources;
+        break;
 
     case TT_JMP:
     case TT_LABEL:
@@ -788,4 +798,23 @@ struct OperandUsages get_operand_usages(struct TACLine *line) // NOLINT (forgive
     }
 
     return usages;
-}
\ No newline at end of file
+}
+
+size_t operand_usages_n_reads(struct OperandUsages *usages)
+{
+    size_t nReads = usages->nReads;
+    if (usages->variadicReads != NULL)
+    {
+        nReads += usages->variadicReads->size;
+    }
+    return nReads;
+}
+
+struct TACOperand *operand_usages_read(struct OperandUsages *usages, size_t index)
+{
+    if (index < usages->nReads)
+    {
+        return usages->reads[index];
+    }
+    return deque_at(usages->variadicReads, index - usages->nReads);
+}
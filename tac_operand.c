@@ -12,49 +12,78 @@
 
 struct Type *tac_operand_get_type(struct TACOperand *operand)
 {
-    if ((operand->permutation == VP_UNUSED) || (operand->castAsType.basicType != VT_NULL))
+    if (operand->castAsType != NULL)
     {
-        return &operand->castAsType;
+        return operand->castAsType;
     }
 
-    struct Type *gottenType = NULL;
+    return tac_operand_get_non_cast_type(operand);
+}
+
+struct Type *tac_operand_get_non_cast_type(struct TACOperand *operand)
+{
+    struct Type *nonCastType = NULL;
 
     switch (operand->permutation)
     {
     case VP_STANDARD:
+        nonCastType = operand->name.variable->type;
+        break;
+
     case VP_TEMP:
-        gottenType = &operand->name.variable->type;
+        nonCastType = &operand->name.temp->type;
         break;
 
     case VP_LITERAL_STR:
     case VP_LITERAL_VAL:
     case VP_UNUSED:
-        gottenType = &operand->castAsType;
+        // the type of a literal is always its cast type
+        nonCastType = (operand->castAsType != NULL) ? operand->castAsType : type_intern_basic(VT_NULL, 0);
         break;
     }
 
-    return gottenType;
+    return nonCastType;
 }
 
-struct Type *tac_operand_get_non_cast_type(struct TACOperand *operand)
+char *tac_operand_get_variable_name(struct TACOperand *operand)
 {
-    struct Type *nonCastType = NULL;
-
+    char *name = NULL;
     switch (operand->permutation)
     {
     case VP_STANDARD:
+        name = operand->name.variable->name;
+        break;
+
     case VP_TEMP:
-        nonCastType = &operand->name.variable->type;
+        name = operand->name.temp->name;
         break;
 
     case VP_LITERAL_STR:
     case VP_LITERAL_VAL:
     case VP_UNUSED:
-        nonCastType = &operand->castAsType;
-        break;
+        InternalError("tac_operand_get_variable_name called on non-variable operand");
     }
 
-    return nonCastType;
+    return name;
+}
+
+void tac_operand_mark_must_spill(struct TACOperand *operand)
+{
+    switch (operand->permutation)
+    {
+    case VP_STANDARD:
+        operand->name.variable->mustSpill = true;
+        break;
+
+    case VP_TEMP:
+        operand->name.temp->mustSpill = true;
+        break;
+
+    case VP_LITERAL_STR:
+    case VP_LITERAL_VAL:
+    case VP_UNUSED:
+        InternalError("tac_operand_mark_must_spill called on non-variable operand");
+    }
 }
 
 const u8 TAC_OPERAND_NAME_LEN = 128;
@@ -73,9 +102,9 @@ char *tac_operand_sprint(void *operandData)
 
         if ((operand->permutation == VP_STANDARD) || (operand->permutation == VP_TEMP))
         {
-            if (operand->castAsType.basicType != VT_NULL)
+            if (operand->castAsType != NULL)
             {
-                char *castTypeName = type_get_name(&operand->castAsType);
+                char *castTypeName = type_get_name(operand->castAsType);
                 operandLen += sprintf(operandStr + operandLen, "(%s)", castTypeName);
                 free(castTypeName);
             }
@@ -87,7 +116,7 @@ char *tac_operand_sprint(void *operandData)
     {
     case VP_STANDARD:
     case VP_TEMP:
-        operandLen += sprintf(operandStr + operandLen, "%s", operand->name.variable->name);
+        operandLen += sprintf(operandStr + operandLen, "%s", tac_operand_get_variable_name(operand));
         break;
 
     case VP_LITERAL_STR:
@@ -117,7 +146,12 @@ ssize_t tac_operand_compare_ignore_ssa_number(void *dataA, void *dataB)
         return result;
     }
 
-    result = type_compare(&operandA->castAsType, &operandB->castAsType);
+    if (operandA->castAsType != operandB->castAsType)
+    {
+        struct Type *castTypeA = (operandA->castAsType != NULL) ? operandA->castAsType : type_intern_basic(VT_NULL, 0);
+        struct Type *castTypeB = (operandB->castAsType != NULL) ? operandB->castAsType : type_intern_basic(VT_NULL, 0);
+        result = type_compare(castTypeA, castTypeB);
+    }
 
     if (result)
     {
@@ -132,10 +166,13 @@ ssize_t tac_operand_compare_ignore_ssa_number(void *dataA, void *dataB)
     switch (operandA->permutation)
     {
     case VP_STANDARD:
-    case VP_TEMP:
         result = strcmp(operandA->name.variable->name, operandB->name.variable->name);
         break;
 
+    case VP_TEMP:
+        result = (ssize_t)operandA->name.temp->number - (ssize_t)operandB->name.temp->number;
+        break;
+
     case VP_LITERAL_STR:
         result = strcmp(operandA->name.str, operandB->name.str);
         break;
@@ -167,27 +204,60 @@ ssize_t tac_operand_compare(void *dataA, void *dataB)
     return ((ssize_t)operandA->ssaNumber - (ssize_t)operandB->ssaNumber);
 }
 
-extern struct Dictionary *parseDict;
-extern struct TempList *temps;
+const size_t TAC_OPERAND_HASH_MULTIPLIER = 31;
+size_t tac_operand_hash(void *data)
+{
+    struct TACOperand *operand = data;
+    size_t hash = operand->permutation;
+
+    switch (operand->permutation)
+    {
+    case VP_STANDARD:
+        hash = (hash * TAC_OPERAND_HASH_MULTIPLIER) + hash_string(operand->name.variable->name);
+        break;
+
+    case VP_TEMP:
+        hash = (hash * TAC_OPERAND_HASH_MULTIPLIER) + operand->name.temp->number;
+        break;
+
+    case VP_LITERAL_STR:
+        hash = (hash * TAC_OPERAND_HASH_MULTIPLIER) + hash_string(operand->name.str);
+        break;
+
+    case VP_LITERAL_VAL:
+        hash = (hash * TAC_OPERAND_HASH_MULTIPLIER) + operand->name.val;
+        break;
+
+    case VP_UNUSED:
+        break;
+    }
+
+    return (hash * TAC_OPERAND_HASH_MULTIPLIER) + operand->ssaNumber;
+}
 
 void tac_operand_populate_from_variable(struct TACOperand *operandToPopulate, struct VariableEntry *populateFrom)
 {
-    type_init(&operandToPopulate->castAsType);
+    operandToPopulate->castAsType = NULL;
     operandToPopulate->name.variable = populateFrom;
     operandToPopulate->permutation = VP_STANDARD;
+    operandToPopulate->lifetimeIndex = 0;
+}
+
+void temp_variable_free(struct TempVariable *temp)
+{
+    type_deinit(&temp->type);
+    free(temp);
 }
 
 void tac_operand_populate_as_temp(struct Scope *scope, struct TACOperand *operandToPopulate, struct Type *type)
 {
-    struct Type tempType = type_duplicate_non_pointer(type);
     if (scope->parentFunction == NULL)
     {
         InternalError("Attempt to create a temporary variable outside of a function scope\n");
     }
-    char *tempName = temp_list_get(temps, (scope->parentFunction->tempNum)++);
-    struct VariableEntry *tempVariable = scope_create_variable_by_name(scope, dictionary_lookup_or_insert(parseDict, tempName), &tempType, false, A_PUBLIC);
     operandToPopulate->permutation = VP_TEMP;
-    operandToPopulate->name.variable = tempVariable;
+    operandToPopulate->name.temp = function_entry_new_temp(scope->parentFunction, type);
+    operandToPopulate->lifetimeIndex = 0;
 }
 
 void tac_operand_copy_decay_arrays(struct TACOperand *dest, struct TACOperand *src)
@@ -198,5 +268,58 @@ void tac_operand_copy_decay_arrays(struct TACOperand *dest, struct TACOperand *s
 
 void tac_operand_copy_type_decay_arrays(struct TACOperand *dest, struct TACOperand *src)
 {
-    type_copy_decay_arrays(tac_operand_get_type(dest), tac_operand_get_type(src));
+    // cast types and the types of variables are canonical, so rather than being decayed in place they are replaced by a cast to the canonical decayed type
+    if ((dest->castAsType != NULL) || (dest->permutation == VP_STANDARD))
+    {
+        struct Type decayed;
+        type_copy_decay_arrays(&decayed, tac_operand_get_type(src));
+        dest->castAsType = type_intern(&decayed);
+    }
+    else
+    {
+        type_copy_decay_arrays(tac_operand_get_type(dest), tac_operand_get_type(src));
+    }
+}
+
+void tac_operand_resolve_cast_vt_self(struct TACOperand *operand, struct TypeEntry *typeEntry)
+{
+    if (operand->castAsType == NULL)
+    {
+        return;
+    }
+
+    struct Type resolved = type_duplicate_non_pointer(operand->castAsType);
+    type_try_resolve_vt_self(&resolved, typeEntry);
+    operand->castAsType = type_intern(&resolved);
+    type_deinit(&resolved);
+}
+
+void tac_operand_resolve_cast_generics(struct TACOperand *operand, HashTable *paramsMap, char *resolvedStructName, List *resolvedParams)
+{
+    if (operand->castAsType == NULL)
+    {
+        return;
+    }
+
+    struct Type resolved = type_duplicate_non_pointer(operand->castAsType);
+    type_try_resolve_generic(&resolved, paramsMap, resolvedStructName, resolvedParams);
+    operand->castAsType = type_intern(&resolved);
+    type_deinit(&resolved);
+}
+
+void tac_operand_increment_pointer_level(struct TACOperand *operand)
+{
+    if (operand->castAsType != NULL)
+    {
+        operand->castAsType = type_intern_pointer_to(operand->castAsType);
+    }
+    // the variable's own type is canonical and shared by its other uses, so cast this operand instead
+    else if (operand->permutation == VP_STANDARD)
+    {
+        operand->castAsType = type_intern_pointer_to(operand->name.variable->type);
+    }
+    else
+    {
+        tac_operand_get_non_cast_type(operand)->pointerLevel++;
+    }
 }
@@ -0,0 +1,93 @@
+#!/bin/bash
+# generate a large synthetic substratum file and report the parse phase of each sbcc given, as measured by -ftime-report
+# usage: parse-bench.sh [-f functions] [-s statements per function] [-r runs] [-b baseline rev] sbcc [sbcc...]
+#
+# -b builds sbcc at the given git revision in a temporary worktree and reports it first, so that comparing a change
+# against its parent is one command, e.g. from the repository root:
+#   make sbcc && tests/bench/parse-bench.sh -b HEAD~1 ./sbcc
+set -e
+
+USAGE="usage: $0 [-f functions] [-s statements per function] [-r runs] [-b baseline rev] sbcc [sbcc...]"
+
+FUNCTIONS=2000
+STATEMENTS=50
+RUNS=5
+BASELINE_REV=""
+
+while getopts "f:s:r:b:" opt; do
+    case $opt in
+        f) FUNCTIONS=$OPTARG ;;
+        s) STATEMENTS=$OPTARG ;;
+        r) RUNS=$OPTARG ;;
+        b) BASELINE_REV=$OPTARG ;;
+        *) echo "$USAGE"; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+if [ $# -eq 0 ]; then
+    echo "$USAGE"
+    exit 1
+fi
+
+WORK_DIR=$(mktemp -d)
+cleanup()
+{
+    if [ -n "$BASELINE_REV" ]; then
+        git worktree remove --force "$WORK_DIR/baseline" 2>/dev/null || true
+    fi
+    rm -rf "$WORK_DIR"
+}
+trap cleanup EXIT
+SOURCE=$WORK_DIR/bench.sb
+
+COMPILERS=("$@")
+if [ -n "$BASELINE_REV" ]; then
+    git worktree add --detach "$WORK_DIR/baseline" "$BASELINE_REV" > /dev/null
+    make -C "$WORK_DIR/baseline" sbcc > "$WORK_DIR/baseline-build.log" 2>&1 || { cat "$WORK_DIR/baseline-build.log"; exit 1; }
+    COMPILERS=("$WORK_DIR/baseline/sbcc" "$@")
+fi
+
+# each statement is a small block with a loop, a branch, and a few identifiers and constants, like ordinary code
+awk -v functions="$FUNCTIONS" -v statements="$STATEMENTS" 'BEGIN {
+    for (f = 0; f < functions; f++)
+    {
+        printf "fun bench_%d(u32 a, u32 b) -> u32\n{\n    u32 x = a + %d;\n", f, f;
+        for (s = 0; s < statements; s++)
+        {
+            printf "    while (x < b + %d)\n    {\n        x = (x * 3) + (a ^ %d);\n", s, s;
+            printf "        if (x > %d)\n        {\n            x = x - (b & %d);\n        }\n    }\n", 1000 + s, s;
+        }
+        printf "    return x;\n}\n\n";
+    }
+}' > "$SOURCE"
+
+echo "$(wc -l < "$SOURCE") lines, $(wc -c < "$SOURCE") bytes ($FUNCTIONS functions of $STATEMENTS statements), best of $RUNS runs"
+printf "%-40s %12s %12s %14s %14s\n" "Compiler" "Parse (ms)" "Total (ms)" "Parse allocs" "Parse (KiB)"
+
+for SBCC in "${COMPILERS[@]}"; do
+    BEST_PARSE=""
+    for ((run = 0; run < RUNS; run++)); do
+        # the phase rows of -ftime-report are: name, wall ms, cpu ms, allocations, allocated KiB (see time_report.c)
+        REPORT=$("$SBCC" -i "$SOURCE" -o "$WORK_DIR/bench.S" -ftime-report 2>&1)
+        PARSE=$(echo "$REPORT" | awk '/^parse / { print $2, $4, $5; exit }')
+        TOTAL=$(echo "$REPORT" | awk '/^total / { print $2; exit }')
+        if [ -z "$PARSE" ]; then
+            echo "$SBCC: no parse phase in -ftime-report output:"
+            echo "$REPORT"
+            exit 1
+        fi
+        read -r PARSE_MS PARSE_ALLOCS PARSE_KIB <<< "$PARSE"
+        if [ -z "$BEST_PARSE" ] || awk -v a="$PARSE_MS" -v b="$BEST_PARSE" 'BEGIN { exit !(a < b) }'; then
+            BEST_PARSE=$PARSE_MS
+            BEST_TOTAL=${TOTAL:--}
+            BEST_ALLOCS=$PARSE_ALLOCS
+            BEST_KIB=$PARSE_KIB
+        fi
+    done
+    NAME=$SBCC
+    if [ "$SBCC" = "$WORK_DIR/baseline/sbcc" ]; then
+        NAME="sbcc at $BASELINE_REV"
+    fi
+    printf "%-40s %12s %12s %14s %14s\n" "$NAME" "$BEST_PARSE" "$BEST_TOTAL" "$BEST_ALLOCS" "$BEST_KIB"
+done
@@ -0,0 +1,309 @@
+#include "time_report.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "log.h"
+
+_Thread_local struct TimeReport *activeTimeReport = NULL;
+
+/*
+ * Allocation counting
+ * The sbcc link wraps these functions (see Makefile), so every call from sbcc's own code goes through here first
+ */
+
+_Thread_local u64 threadAllocations = 0;
+_Thread_local u64 threadAllocatedBytes = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    threadAllocations++;
+    threadAllocatedBytes += size;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+    threadAllocations++;
+    threadAllocatedBytes += nmemb * size;
+    return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    threadAllocations++;
+    threadAllocatedBytes += size;
+    return __real_realloc(ptr, size);
+}
+
+u64 time_report_clock_ns(clockid_t clock)
+{
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return ((u64)now.tv_sec * 1000000000) + now.tv_nsec;
+}
+
+void time_report_sample(struct TimeReportSample *sample)
+{
+    sample->wallNs = time_report_clock_ns(CLOCK_MONOTONIC);
+    sample->cpuNs = time_report_clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    sample->nAllocations = threadAllocations;
+    sample->allocatedBytes = threadAllocatedBytes;
+}
+
+void time_report_event_free(struct TimeReportEvent *event)
+{
+    free(event->name);
+    free(event);
+}
+
+struct TimeReport *time_report_new()
+{
+    struct TimeReport *wip = malloc(sizeof(struct TimeReport));
+    wip->events = deque_new((MBCL_DATA_FREE_FUNCTION)time_report_event_free);
+    wip->openEvents = stack_new(NULL);
+    wip->originWallNs = time_report_clock_ns(CLOCK_MONOTONIC);
+    wip->nDataflowAnalyses = 0;
+    wip->nDataflowIterations = 0;
+    wip->nDataflowVisits = 0;
+    return wip;
+}
+
+void time_report_free(struct TimeReport *report)
+{
+    deque_free(report->events);
+    stack_free(report->openEvents);
+    free(report);
+}
+
+void time_report_set_active(struct TimeReport *report)
+{
+    activeTimeReport = report;
+}
+
+struct TimeReport *time_report_get_active()
+{
+    return activeTimeReport;
+}
+
+void time_report_begin(const char *name)
+{
+    struct TimeReport *report = activeTimeReport;
+    if (report == NULL)
+    {
+        return;
+    }
+
+    struct TimeReportEvent *event = malloc(sizeof(struct TimeReportEvent));
+    memset(event, 0, sizeof(struct TimeReportEvent));
+    event->name = strdup(name);
+    if (report->openEvents->size > 0)
+    {
+        event->parent = stack_peek(report->openEvents);
+    }
+    deque_push_back(report->events, event);
+    stack_push(report->openEvents, event);
+
+    // sample last so that the bookkeeping above isn't attributed to the event
+    time_report_sample(&event->start);
+}
+
+void time_report_end()
+{
+    struct TimeReport *report = activeTimeReport;
+    if (report == NULL)
+    {
+        return;
+    }
+
+    struct TimeReportSample end;
+    time_report_sample(&end);
+
+    if (report->openEvents->size == 0)
+    {
+        InternalError("time_report_end called with no open event");
+    }
+    struct TimeReportEvent *event = stack_pop(report->openEvents);
+    event->elapsed.wallNs = end.wallNs - event->start.wallNs;
+    event->elapsed.cpuNs = end.cpuNs - event->start.cpuNs;
+    event->elapsed.nAllocations = end.nAllocations - event->start.nAllocations;
+    event->elapsed.allocatedBytes = end.allocatedBytes - event->start.allocatedBytes;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    event->peakRssKb = usage.ru_maxrss;
+}
+
+void time_report_count_dataflow(size_t nIterations, size_t nVisits)
+{
+    struct TimeReport *report = activeTimeReport;
+    if (report == NULL)
+    {
+        return;
+    }
+
+    report->nDataflowAnalyses++;
+    report->nDataflowIterations += nIterations;
+    report->nDataflowVisits += nVisits;
+}
+
+/*
+ * Output
+ */
+
+const size_t TIME_REPORT_N_SLOWEST_FUNCTIONS = 10;
+
+void time_report_print_row(FILE *outFile, const char *indent, const char *name, struct TimeReportSample *elapsed, long peakRssKb)
+{
+    fprintf(outFile, "%s%-*s %10.3f %10.3f %10lu %12.1f",
+            indent,
+            (int)(32 - strlen(indent)),
+            name,
+            elapsed->wallNs / 1e6,
+            elapsed->cpuNs / 1e6,
+            elapsed->nAllocations,
+            elapsed->allocatedBytes / 1024.0);
+    if (peakRssKb >= 0)
+    {
+        fprintf(outFile, " %14ld", peakRssKb);
+    }
+    fprintf(outFile, "\n");
+}
+
+int time_report_compare_wall_descending(const void *a, const void *b)
+{
+    const struct TimeReportEvent *eventA = *(struct TimeReportEvent *const *)a;
+    const struct TimeReportEvent *eventB = *(struct TimeReportEvent *const *)b;
+    if (eventA->elapsed.wallNs == eventB->elapsed.wallNs)
+    {
+        return 0;
+    }
+    return (eventA->elapsed.wallNs > eventB->elapsed.wallNs) ? -1 : 1;
+}
+
+// print the most expensive events directly within phase
+void time_report_print_children(struct TimeReport *report, struct TimeReportEvent *phase, FILE *outFile)
+{
+    size_t nChildren = 0;
+    struct TimeReportEvent **children = malloc(report->events->size * sizeof(struct TimeReportEvent *));
+    for (size_t eventIndex = 0; eventIndex < report->events->size; eventIndex++)
+    {
+        struct TimeReportEvent *event = deque_at(report->events, eventIndex);
+        if (event->parent == phase)
+        {
+            children[nChildren++] = event;
+        }
+    }
+
+    if (nChildren > 0)
+    {
+        qsort(children, nChildren, sizeof(struct TimeReportEvent *), time_report_compare_wall_descending);
+        size_t nPrinted = MIN(nChildren, TIME_REPORT_N_SLOWEST_FUNCTIONS);
+        for (size_t childIndex = 0; childIndex < nPrinted; childIndex++)
+        {
+            time_report_print_row(outFile, "  ", children[childIndex]->name, &children[childIndex]->elapsed, -1);
+        }
+        if (nChildren > nPrinted)
+        {
+            fprintf(outFile, "  (%zu more)\n", nChildren - nPrinted);
+        }
+    }
+
+    free(children);
+}
+
+void time_report_print(struct TimeReport *report, FILE *outFile)
+{
+    // see time_report.h for why neither figure can be narrowed down further
+    fprintf(outFile, "Allocations count only sbcc's own calls, not those made within libc or mbcl\n");
+    fprintf(outFile, "Peak RSS is of the whole process, including any other units compiled in parallel\n");
+    fprintf(outFile, "%-32s %10s %10s %10s %12s %14s\n", "Phase", "Wall (ms)", "CPU (ms)", "Allocs", "Alloc (KiB)", "Peak RSS (KiB)");
+
+    struct TimeReportSample total = {0};
+    long peakRssKb = 0;
+    for (size_t eventIndex = 0; eventIndex < report->events->size; eventIndex++)
+    {
+        struct TimeReportEvent *event = deque_at(report->events, eventIndex);
+        if (event->parent != NULL)
+        {
+            continue;
+        }
+
+        time_report_print_row(outFile, "", event->name, &event->elapsed, event->peakRssKb);
+        time_report_print_children(report, event, outFile);
+
+        total.wallNs += event->elapsed.wallNs;
+        total.cpuNs += event->elapsed.cpuNs;
+        total.nAllocations += event->elapsed.nAllocations;
+        total.allocatedBytes += event->elapsed.allocatedBytes;
+        peakRssKb = MAX(peakRssKb, event->peakRssKb);
+    }
+
+    time_report_print_row(outFile, "", "total", &total, peakRssKb);
+
+    if (report->nDataflowAnalyses > 0)
+    {
+        fprintf(outFile, "dataflow: %lu analyses solved in %lu iterations (%lu block visits)\n",
+                report->nDataflowAnalyses,
+                report->nDataflowIterations,
+                report->nDataflowVisits);
+    }
+}
+
+void time_report_write_json_string(FILE *outFile, const char *str)
+{
+    putc('"', outFile);
+    for (const char *c = str; *c != '\0'; c++)
+    {
+        if ((*c == '"') || (*c == '\\'))
+        {
+            putc('\\', outFile);
+        }
+        putc(*c, outFile);
+    }
+    putc('"', outFile);
+}
+
+bool time_report_write_trace(struct TimeReport *report, char *fileName)
+{
+    FILE *traceFile = fopen(fileName, "wb");
+    if (traceFile == NULL)
+    {
+        log(LOG_ERROR, "Unable to open time trace file %s", fileName);
+        return false;
+    }
+
+    fprintf(traceFile, "{\"traceEvents\":[\n");
+    for (size_t eventIndex = 0; eventIndex < report->events->size; eventIndex++)
+    {
+        struct TimeReportEvent *event = deque_at(report->events, eventIndex);
+        fprintf(traceFile, "{\"ph\":\"X\",\"pid\":%d,\"tid\":0,\"name\":", getpid());
+        time_report_write_json_string(traceFile, event->name);
+        fprintf(traceFile, ",\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"cpu_ms\":%.3f,\"allocations\":%lu,\"allocated_bytes\":%lu}}%s\n",
+                (event->start.wallNs - report->originWallNs) / 1e3,
+                event->elapsed.wallNs / 1e3,
+                event->elapsed.cpuNs / 1e6,
+                event->elapsed.nAllocations,
+                event->elapsed.allocatedBytes,
+                (eventIndex + 1 < report->events->size) ? "," : "");
+    }
+    fprintf(traceFile, "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dataflow_analyses\":%lu,\"dataflow_iterations\":%lu,\"dataflow_visits\":%lu}}\n",
+            report->nDataflowAnalyses,
+            report->nDataflowIterations,
+            report->nDataflowVisits);
+
+    bool writeFailed = (ferror(traceFile) != 0);
+    writeFailed |= (fclose(traceFile) != 0);
+    if (writeFailed)
+    {
+        log(LOG_ERROR, "Unable to write time trace file %s", fileName);
+        return false;
+    }
+    return true;
+}
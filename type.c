@@ -5,6 +5,7 @@
 #include <string.h>
 
 #include "symtab.h"
+#include "type_table.h"
 
 #include "log.h"
 #include "util.h"
@@ -112,6 +113,12 @@ void type_copy_decay_arrays(struct Type *dest, struct Type *src)
 
 ssize_t type_compare(struct Type *typeA, struct Type *typeB)
 {
+    // a type is always equal to itself, which is cheap to check now that operand casts are canonical (see type_table.h)
+    if (typeA == typeB)
+    {
+        return 0;
+    }
+
     if (typeA->basicType != typeB->basicType)
     {
         return 1;
@@ -622,6 +629,24 @@ struct Type type_duplicate_non_pointer(struct Type *type)
     return dup;
 }
 
+// entry of the struct or enum named by type
+// types are only ever declared in the global scope, so a canonical type always names the same entry wherever it is looked
+// up from, and is only looked up once
+struct TypeEntry *type_lookup_entry(struct Type *type, struct Scope *scope)
+{
+    struct TypeEntry **cachedEntry = type_table_entry_cache(type);
+    if (cachedEntry == NULL)
+    {
+        return scope_lookup_type(scope, type);
+    }
+
+    if (*cachedEntry == NULL)
+    {
+        *cachedEntry = scope_lookup_type(scope, type);
+    }
+    return *cachedEntry;
+}
+
 size_t type_get_size(struct Type *type, struct Scope *scope)
 {
     size_t size = 0;
@@ -665,19 +690,9 @@ size_t type_get_size(struct Type *type, struct Scope *scope)
         break;
 
     case VT_STRUCT:
-    {
-        struct StructDesc *theStruct = scope_lookup_struct_by_type(scope, type);
-        size = theStruct->totalSize;
-    }
-    break;
-
     case VT_ENUM:
-    {
-        size = sizeof(size_t);
-        struct EnumDesc *theEnum = scope_lookup_enum_by_type(scope, type);
-        size += theEnum->unionSize;
-    }
-    break;
+        size = type_entry_get_layout(type_lookup_entry(type, scope))->size;
+        break;
 
     case VT_ARRAY:
     {
@@ -746,21 +761,9 @@ u8 type_get_alignment(struct Type *type, struct Scope *scope)
     switch (type->basicType)
     {
     case VT_STRUCT:
-    {
-        struct StructDesc *theStruct = scope_lookup_struct_by_type(scope, type);
-        Iterator *memberIterator = NULL;
-        for (memberIterator = deque_front(theStruct->fieldLocations); iterator_gettable(memberIterator); iterator_next(memberIterator))
-        {
-            struct StructField *offset = iterator_get(memberIterator);
-            u8 memberAlignment = type_get_alignment(&offset->variable->type, scope);
-            if (memberAlignment > alignment)
-            {
-                alignment = memberAlignment;
-            }
-        }
-        iterator_free(memberIterator);
-    }
-    break;
+    case VT_ENUM:
+        alignment = type_entry_get_layout(type_lookup_entry(type, scope))->alignment;
+        break;
 
     case VT_ARRAY:
         alignment = align_size(type_get_size(type->array.type, scope));
@@ -0,0 +1,378 @@
+#include "type_table.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "log.h"
+#include "util.h"
+
+_Thread_local struct TypeTable *activeTypeTable = NULL;
+
+const size_t TYPE_TABLE_INITIAL_SLOTS = 256;
+const size_t TYPE_TABLE_ARENA_CHUNK_SIZE = 16 * 1024;
+const u32 TYPE_TABLE_HASH_BASIS = 2166136261u;
+const u32 TYPE_TABLE_HASH_PRIME = 16777619u;
+
+struct TypeTable *type_table_new()
+{
+    struct TypeTable *wip = malloc(sizeof(struct TypeTable));
+    wip->storage = arena_new(TYPE_TABLE_ARENA_CHUNK_SIZE);
+    wip->paramLists = deque_new((MBCL_DATA_FREE_FUNCTION)list_free);
+    wip->nSlots = TYPE_TABLE_INITIAL_SLOTS;
+    wip->slots = calloc(wip->nSlots, sizeof(struct TypeTableSlot));
+    wip->entrySlots = calloc(wip->nSlots, sizeof(struct TypeTableEntrySlot));
+    wip->nTypes = 0;
+    return wip;
+}
+
+void type_table_free(struct TypeTable *table)
+{
+    arena_free(table->storage);
+    deque_free(table->paramLists);
+    free(table->slots);
+    free(table->entrySlots);
+    free(table);
+}
+
+void type_table_set_active(struct TypeTable *table)
+{
+    activeTypeTable = table;
+}
+
+struct TypeTable *type_table_active()
+{
+    if (activeTypeTable == NULL)
+    {
+        InternalError("No type table active");
+    }
+    return activeTypeTable;
+}
+
+// FNV-1a over the bytes of value
+u32 type_table_hash_mix(u32 hash, size_t value)
+{
+    for (size_t byteIndex = 0; byteIndex < sizeof(size_t); byteIndex++)
+    {
+        hash ^= (value >> (byteIndex * 8)) & 0xff;
+        hash *= TYPE_TABLE_HASH_PRIME;
+    }
+    return hash;
+}
+
+// hash a key type, whose array element type and generic parameters (passed separately in params) are already canonical
+u32 type_table_hash_key(struct Type *key, struct Type **params, size_t nParams)
+{
+    u32 hash = type_table_hash_mix(TYPE_TABLE_HASH_BASIS, key->basicType);
+    hash = type_table_hash_mix(hash, key->pointerLevel);
+
+    switch (key->basicType)
+    {
+    case VT_NULL:
+    case VT_ANY:
+    case VT_U8:
+    case VT_U16:
+    case VT_U32:
+    case VT_U64:
+    case VT_SELF:
+        break;
+
+    case VT_STRUCT:
+    case VT_ENUM:
+    case VT_GENERIC_PARAM:
+    {
+        if (key->nonArray.complexType.name != NULL)
+        {
+            hash = type_table_hash_mix(hash, hash_string(key->nonArray.complexType.name));
+        }
+        hash = type_table_hash_mix(hash, key->nonArray.complexType.genericParams != NULL);
+        for (size_t paramIndex = 0; paramIndex < nParams; paramIndex++)
+        {
+            hash = type_table_hash_mix(hash, (size_t)params[paramIndex]);
+        }
+    }
+    break;
+
+    case VT_ARRAY:
+        hash = type_table_hash_mix(hash, key->array.size);
+        hash = type_table_hash_mix(hash, (size_t)key->array.type);
+        break;
+    }
+
+    return hash;
+}
+
+bool type_table_key_matches(struct Type *canonical, struct Type *key, struct Type **params, size_t nParams)
+{
+    if ((canonical->basicType != key->basicType) || (canonical->pointerLevel != key->pointerLevel))
+    {
+        return false;
+    }
+
+    bool matches = true;
+    switch (key->basicType)
+    {
+    case VT_NULL:
+    case VT_ANY:
+    case VT_U8:
+    case VT_U16:
+    case VT_U32:
+    case VT_U64:
+    case VT_SELF:
+        break;
+
+    case VT_STRUCT:
+    case VT_ENUM:
+    case VT_GENERIC_PARAM:
+    {
+        char *canonicalName = canonical->nonArray.complexType.name;
+        char *keyName = key->nonArray.complexType.name;
+        if ((canonicalName != keyName) && ((canonicalName == NULL) || (keyName == NULL) || (strcmp(canonicalName, keyName) != 0)))
+        {
+            return false;
+        }
+
+        List *canonicalParams = canonical->nonArray.complexType.genericParams;
+        if ((canonicalParams == NULL) || (key->nonArray.complexType.genericParams == NULL))
+        {
+            return (canonicalParams == NULL) && (key->nonArray.complexType.genericParams == NULL);
+        }
+
+        if (canonicalParams->size != nParams)
+        {
+            return false;
+        }
+
+        // parameters of both are canonical, so identical parameters are the same pointer
+        size_t paramIndex = 0;
+        Iterator *paramIter = NULL;
+        for (paramIter = list_begin(canonicalParams); iterator_gettable(paramIter); iterator_next(paramIter))
+        {
+            if (iterator_get(paramIter) != params[paramIndex++])
+            {
+                matches = false;
+                break;
+            }
+        }
+        iterator_free(paramIter);
+    }
+    break;
+
+    case VT_ARRAY:
+        matches = (canonical->array.size == key->array.size) && (canonical->array.type == key->array.type);
+        break;
+    }
+
+    return matches;
+}
+
+struct TypeTableSlot *type_table_probe(struct TypeTable *table, struct Type *key, struct Type **params, size_t nParams, u32 hash)
+{
+    size_t mask = table->nSlots - 1;
+    size_t slotIndex = hash & mask;
+    while (table->slots[slotIndex].type != NULL)
+    {
+        struct TypeTableSlot *slot = &table->slots[slotIndex];
+        if ((slot->hash == hash) && type_table_key_matches(slot->type, key, params, nParams))
+        {
+            break;
+        }
+        slotIndex = (slotIndex + 1) & mask;
+    }
+
+    return &table->slots[slotIndex];
+}
+
+// index of the entry slot for the canonical type at address type, or of the empty slot where it would go
+size_t type_table_probe_entry(struct TypeTable *table, struct Type *type)
+{
+    size_t mask = table->nSlots - 1;
+    // canonical types are arena-allocated, so the low bits of their addresses carry little information
+    size_t slotIndex = (((size_t)type >> 4) * 2654435761u) & mask;
+    while ((table->entrySlots[slotIndex].type != NULL) && (table->entrySlots[slotIndex].type != type))
+    {
+        slotIndex = (slotIndex + 1) & mask;
+    }
+    return slotIndex;
+}
+
+void type_table_grow(struct TypeTable *table)
+{
+    struct TypeTableSlot *oldSlots = table->slots;
+    struct TypeTableEntrySlot *oldEntrySlots = table->entrySlots;
+    size_t oldNSlots = table->nSlots;
+
+    table->nSlots *= 2;
+    table->slots = calloc(table->nSlots, sizeof(struct TypeTableSlot));
+    size_t mask = table->nSlots - 1;
+    for (size_t oldIndex = 0; oldIndex < oldNSlots; oldIndex++)
+    {
+        if (oldSlots[oldIndex].type == NULL)
+        {
+            continue;
+        }
+
+        size_t slotIndex = oldSlots[oldIndex].hash & mask;
+        while (table->slots[slotIndex].type != NULL)
+        {
+            slotIndex = (slotIndex + 1) & mask;
+        }
+        table->slots[slotIndex] = oldSlots[oldIndex];
+    }
+
+    table->entrySlots = calloc(table->nSlots, sizeof(struct TypeTableEntrySlot));
+    for (size_t oldIndex = 0; oldIndex < oldNSlots; oldIndex++)
+    {
+        if (oldEntrySlots[oldIndex].type != NULL)
+        {
+            table->entrySlots[type_table_probe_entry(table, oldEntrySlots[oldIndex].type)] = oldEntrySlots[oldIndex];
+        }
+    }
+
+    free(oldSlots);
+    free(oldEntrySlots);
+}
+
+struct Type *type_table_add(struct TypeTable *table, struct Type *key, struct Type **params, size_t nParams)
+{
+    struct Type *canonical = arena_alloc(table->storage, sizeof(struct Type));
+    *canonical = *key;
+
+    switch (key->basicType)
+    {
+    case VT_NULL:
+    case VT_ANY:
+    case VT_U8:
+    case VT_U16:
+    case VT_U32:
+    case VT_U64:
+    case VT_SELF:
+    case VT_ARRAY:
+        break;
+
+    case VT_STRUCT:
+    case VT_ENUM:
+    case VT_GENERIC_PARAM:
+    {
+        if (key->nonArray.complexType.name != NULL)
+        {
+            canonical->nonArray.complexType.name = arena_strdup(table->storage, key->nonArray.complexType.name);
+        }
+
+        if (key->nonArray.complexType.genericParams != NULL)
+        {
+            List *canonicalParams = list_new(NULL, NULL);
+            for (size_t paramIndex = 0; paramIndex < nParams; paramIndex++)
+            {
+                list_append(canonicalParams, params[paramIndex]);
+            }
+            deque_push_back(table->paramLists, canonicalParams);
+            canonical->nonArray.complexType.genericParams = canonicalParams;
+        }
+    }
+    break;
+    }
+
+    return canonical;
+}
+
+struct Type *type_intern(struct Type *type)
+{
+    struct TypeTable *table = type_table_active();
+
+    // build a key out of only the fields which identify the type, with its constituent types canonicalized
+    struct Type key;
+    type_init(&key);
+    key.basicType = type->basicType;
+    key.pointerLevel = type->pointerLevel;
+
+    struct Type **params = NULL;
+    size_t nParams = 0;
+    switch (type->basicType)
+    {
+    case VT_NULL:
+    case VT_ANY:
+    case VT_U8:
+    case VT_U16:
+    case VT_U32:
+    case VT_U64:
+    case VT_SELF:
+        break;
+
+    case VT_STRUCT:
+    case VT_ENUM:
+    case VT_GENERIC_PARAM:
+    {
+        key.nonArray.complexType.name = type->nonArray.complexType.name;
+        List *genericParams = type->nonArray.complexType.genericParams;
+        key.nonArray.complexType.genericParams = genericParams;
+        if ((genericParams != NULL) && (genericParams->size > 0))
+        {
+            params = malloc(genericParams->size * sizeof(struct Type *));
+            Iterator *paramIter = NULL;
+            for (paramIter = list_begin(genericParams); iterator_gettable(paramIter); iterator_next(paramIter))
+            {
+                params[nParams++] = type_intern(iterator_get(paramIter));
+            }
+            iterator_free(paramIter);
+        }
+    }
+    break;
+
+    case VT_ARRAY:
+        key.array.size = type->array.size;
+        key.array.type = type_intern(type->array.type);
+        break;
+    }
+
+    u32 hash = type_table_hash_key(&key, params, nParams);
+    struct TypeTableSlot *slot = type_table_probe(table, &key, params, nParams, hash);
+    if (slot->type == NULL)
+    {
+        // keep the table at most half full so probe sequences stay short
+        if ((table->nTypes + 1) * 2 > table->nSlots)
+        {
+            type_table_grow(table);
+            slot = type_table_probe(table, &key, params, nParams, hash);
+        }
+
+        slot->hash = hash;
+        slot->type = type_table_add(table, &key, params, nParams);
+        table->entrySlots[type_table_probe_entry(table, slot->type)].type = slot->type;
+        table->nTypes++;
+    }
+
+    free(params);
+    return slot->type;
+}
+
+struct Type *type_intern_basic(enum BASIC_TYPES basicType, size_t pointerLevel)
+{
+    struct Type basic;
+    type_init(&basic);
+    type_set_basic_type(&basic, basicType, NULL, pointerLevel);
+    return type_intern(&basic);
+}
+
+struct Type *type_intern_pointer_to(struct Type *type)
+{
+    struct Type pointer = *type;
+    pointer.pointerLevel++;
+    return type_intern(&pointer);
+}
+
+struct TypeEntry **type_table_entry_cache(struct Type *type)
+{
+    struct TypeTable *table = activeTypeTable;
+    if (table == NULL)
+    {
+        return NULL;
+    }
+
+    struct TypeTableEntrySlot *slot = &table->entrySlots[type_table_probe_entry(table, type)];
+    if (slot->type == NULL)
+    {
+        return NULL;
+    }
+    return &slot->entry;
+}
@@ -1,4 +1,5 @@
 #include "util.h"
+#include "arena.h"
 #include "log.h"
 
 // given a raw size, find the nearest power-of-two aligned size (number of bits required to store nBytes)
@@ -97,7 +98,7 @@ size_t parse_hex_constant(char *hexConstant)
  */
 
 /*
- * DICTIONARY FUNCTIONS
+ * STRING HASHING
  * This string hashing algorithm is the djb2 algorithm
  * further information can be found at http://www.cse.yorku.ca/~oz/hash.html
  */
@@ -118,39 +119,165 @@ size_t hash_string(void *data)
     return hash;
 }
 
-struct Dictionary *dictionary_new(MBCL_DATA_FREE_FUNCTION freeData,
-                                  MBCL_DATA_COMPARE_FUNCTION compareKey,
-                                  size_t (*hashData)(void *data),
-                                  size_t nBuckets,
-                                  void *(*duplicateFunction)(void *))
+const u64 FNV1A_OFFSET_BASIS = 0xcbf29ce484222325;
+const u64 FNV1A_PRIME = 0x100000001b3;
+const u64 MIX_LANE_SEED = 0x9e3779b97f4a7c15;
+const u64 MIX_LANE_MULTIPLIER = 0xff51afd7ed558ccd;
+void content_hash_init(struct ContentHash *hash)
 {
-    struct Dictionary *wip = malloc(sizeof(struct Dictionary));
-    wip->table = hash_table_new(NULL, freeData, compareKey, hashData, nBuckets);
-    wip->duplicateFunction = duplicateFunction;
+    hash->lanes[0] = FNV1A_OFFSET_BASIS;
+    hash->lanes[1] = MIX_LANE_SEED;
+}
+
+void content_hash_update(struct ContentHash *hash, const void *data, size_t length)
+{
+    const u8 *bytes = data;
+    u64 fnvLane = hash->lanes[0];
+    u64 mixLane = hash->lanes[1];
+    for (size_t byteIndex = 0; byteIndex < length; byteIndex++)
+    {
+        fnvLane = (fnvLane ^ bytes[byteIndex]) * FNV1A_PRIME;
+        mixLane = (mixLane + bytes[byteIndex] + 1) * MIX_LANE_MULTIPLIER;
+        mixLane ^= mixLane >> 29;
+    }
+    hash->lanes[0] = fnvLane;
+    hash->lanes[1] = mixLane;
+}
+
+void content_hash_update_string(struct ContentHash *hash, const char *str)
+{
+    content_hash_update(hash, str, strlen(str) + 1);
+}
+
+void content_hash_update_u64(struct ContentHash *hash, u64 value)
+{
+    content_hash_update(hash, &value, sizeof(u64));
+}
+
+void content_hash_sprint(struct ContentHash *hash, char *str)
+{
+    sprintf(str, "%016lx%016lx", hash->lanes[0], hash->lanes[1]);
+}
+
+/*
+ * STRING INTERNER FUNCTIONS
+ * Open addressing with linear probing - each slot holds a string's hash and (id + 1), with 0 marking an empty slot
+ */
+
+const size_t STRING_INTERNER_INITIAL_SLOTS = 1024;
+const size_t STRING_INTERNER_ARENA_CHUNK_SIZE = 16 * 1024;
+
+struct StringInterner *string_interner_new()
+{
+    struct StringInterner *wip = malloc(sizeof(struct StringInterner));
+    wip->storage = arena_new(STRING_INTERNER_ARENA_CHUNK_SIZE);
+    wip->nStrings = 0;
+    wip->stringsCapacity = STRING_INTERNER_INITIAL_SLOTS / 2;
+    wip->strings = malloc(wip->stringsCapacity * sizeof(char *));
+    wip->nSlots = STRING_INTERNER_INITIAL_SLOTS;
+    wip->slots = calloc(wip->nSlots, sizeof(struct StringInternerSlot));
     return wip;
 }
 
-void *dictionary_insert(struct Dictionary *dict, void *value)
+void string_interner_free(struct StringInterner *interner)
 {
-    void *duplicatedValue = dict->duplicateFunction(value);
-    hash_table_insert(dict->table, duplicatedValue, duplicatedValue);
-    return duplicatedValue;
+    arena_free(interner->storage);
+    free(interner->strings);
+    free(interner->slots);
+    free(interner);
 }
 
-void *dictionary_lookup_or_insert(struct Dictionary *dict, void *value)
+// find the slot which either holds str or is the empty slot where str would be inserted
+struct StringInternerSlot *string_interner_probe(struct StringInterner *interner, const char *str, u32 hash)
 {
-    void *returnedStr = hash_table_find(dict->table, value);
-    if (returnedStr == NULL)
+    size_t slotIndex = hash & (interner->nSlots - 1);
+    while (true)
     {
-        returnedStr = dictionary_insert(dict, value);
+        struct StringInternerSlot *slot = &interner->slots[slotIndex];
+        if ((slot->idPlusOne == 0) || ((slot->hash == hash) && (strcmp(interner->strings[slot->idPlusOne - 1], str) == 0)))
+        {
+            return slot;
+        }
+        slotIndex = (slotIndex + 1) & (interner->nSlots - 1);
     }
-    return returnedStr;
 }
 
-void dictionary_free(struct Dictionary *dict)
+void string_interner_grow(struct StringInterner *interner)
 {
-    hash_table_free(dict->table);
-    free(dict);
+    struct StringInternerSlot *oldSlots = interner->slots;
+    size_t oldNSlots = interner->nSlots;
+
+    interner->nSlots *= 2;
+    interner->slots = calloc(interner->nSlots, sizeof(struct StringInternerSlot));
+    for (size_t slotIndex = 0; slotIndex < oldNSlots; slotIndex++)
+    {
+        struct StringInternerSlot *oldSlot = &oldSlots[slotIndex];
+        if (oldSlot->idPlusOne != 0)
+        {
+            size_t newIndex = oldSlot->hash & (interner->nSlots - 1);
+            while (interner->slots[newIndex].idPlusOne != 0)
+            {
+                newIndex = (newIndex + 1) & (interner->nSlots - 1);
+            }
+            interner->slots[newIndex] = *oldSlot;
+        }
+    }
+    free(oldSlots);
+}
+
+char *string_interner_intern(struct StringInterner *interner, const char *str, u32 *id)
+{
+    u32 hash = hash_string((void *)str);
+    struct StringInternerSlot *slot = string_interner_probe(interner, str, hash);
+    if (slot->idPlusOne == 0)
+    {
+        // keep the table at most half full so probe sequences stay short
+        if ((interner->nStrings + 1) * 2 > interner->nSlots)
+        {
+            string_interner_grow(interner);
+            slot = string_interner_probe(interner, str, hash);
+        }
+
+        if (interner->nStrings == interner->stringsCapacity)
+        {
+            interner->stringsCapacity *= 2;
+            interner->strings = realloc(interner->strings, interner->stringsCapacity * sizeof(char *));
+        }
+
+        interner->strings[interner->nStrings] = arena_strdup(interner->storage, str);
+        slot->hash = hash;
+        slot->idPlusOne = ++interner->nStrings;
+    }
+
+    if (id != NULL)
+    {
+        *id = slot->idPlusOne - 1;
+    }
+    return interner->strings[slot->idPlusOne - 1];
+}
+
+char *string_interner_find(struct StringInterner *interner, const char *str, u32 *id)
+{
+    struct StringInternerSlot *slot = string_interner_probe(interner, str, hash_string((void *)str));
+    if (slot->idPlusOne == 0)
+    {
+        return NULL;
+    }
+
+    if (id != NULL)
+    {
+        *id = slot->idPlusOne - 1;
+    }
+    return interner->strings[slot->idPlusOne - 1];
+}
+
+char *string_interner_get(struct StringInterner *interner, u32 id)
+{
+    if (id >= interner->nStrings)
+    {
+        InternalError("String id %u out of range (%zu strings interned)", id, interner->nStrings);
+    }
+    return interner->strings[id];
 }
 
 /*